@@ -79,6 +79,12 @@
 
 #include <gst/gst-i18n-plugin.h>
 
+#include <errno.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <fcntl.h>
+#include <sys/epoll.h>
+#endif
+
 #include "gstcurlhttpsrc.h"
 #include "gstcurlqueue.h"
 #include "gstcurldefaults.h"
@@ -87,6 +93,14 @@ GST_DEBUG_CATEGORY_STATIC (gst_curl_http_src_debug);
 #define GST_CAT_DEFAULT gst_curl_http_src_debug
 GST_DEBUG_CATEGORY_STATIC (gst_curl_loop_debug);
 
+/* Longest time the multi loop sleeps without checking its state */
+#define GSTCURL_MULTI_MAX_WAIT_MS 1000
+/* Socket events handled per epoll_wait() call */
+#define GSTCURL_MULTI_MAX_EVENTS 64
+/* Size of the memory blocks received data is written to, the same as the
+ * largest chunk curl hands to the write callback by default */
+#define GSTCURL_CHUNK_BLOCK_SIZE CURL_MAX_WRITE_SIZE
+
 /*
  * Make a source pad template to be able to kick out recv'd data
  */
@@ -138,6 +152,12 @@ static size_t gst_curl_http_src_get_header (void *header, size_t size,
 static size_t gst_curl_http_src_get_chunks (void *chunk, size_t size,
     size_t nmemb, void *src);
 static void gst_curl_http_src_request_remove (GstCurlHttpSrc * src);
+static void gst_curl_http_src_multi_wakeup (GstCurlHttpSrcMultiTaskContext *
+    context);
+static void gst_curl_http_src_update_stats (GstCurlHttpSrc * src);
+static void gst_curl_http_src_clear_chunks (GstCurlHttpSrc * src);
+static GstBufferList *gst_curl_http_src_take_chunks (GstCurlHttpSrc * src);
+static GstStructure *gst_curl_http_src_get_stats (GstCurlHttpSrc * src);
 static char *gst_curl_http_src_strcasestr (const char *haystack,
     const char *needle);
 
@@ -382,6 +402,19 @@ gst_curl_http_src_class_init (GstCurlHttpSrcClass * klass)
           GST_TYPE_CURL_HTTP_VERSION, pref_http_ver,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCurlHttpSrc:stats:
+   *
+   * Statistics of the transfers done by this element: "bytes-received"
+   * and "requests" for its whole lifetime, and "name-lookup-time",
+   * "connect-time", "tls-time", "time-to-first-byte" and "transfer-time"
+   * for the last complete transfer. Times are counted from the start of
+   * the request, a reused connection has a connect-time of 0.
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Stats", "Transfer statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /* Add a debugging task so it's easier to debug in the Multi worker thread */
   GST_DEBUG_CATEGORY_INIT (gst_curl_loop_debug, "curl_multi_loop", 0,
       "libcURL loop thread debugging");
@@ -570,6 +603,9 @@ gst_curl_http_src_get_property (GObject * object, guint prop_id,
     case PROP_HTTPVERSION:
       g_value_set_enum (value, source->preferred_http_version);
       break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_curl_http_src_get_stats (source));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -619,8 +655,12 @@ gst_curl_http_src_init (GstCurlHttpSrc * source)
   g_mutex_init (&source->buffer_mutex);
   g_cond_init (&source->signal);
 
-  source->buffer = NULL;
+  g_queue_init (&source->chunk_blocks);
+  source->fill_block = NULL;
+  source->fill_offset = 0;
   source->buffer_len = 0;
+  source->allocator = NULL;
+  gst_allocation_params_init (&source->alloc_params);
   source->state = GSTCURL_NONE;
   source->pending_state = GSTCURL_NONE;
   source->status_code = 0;
@@ -630,9 +670,124 @@ gst_curl_http_src_init (GstCurlHttpSrc * source)
 
   source->curl_result = CURLE_OK;
 
+  source->bytes_received = 0;
+  source->requests_completed = 0;
+  source->name_lookup_time = GST_CLOCK_TIME_NONE;
+  source->connect_time = GST_CLOCK_TIME_NONE;
+  source->tls_time = GST_CLOCK_TIME_NONE;
+  source->ttfb = GST_CLOCK_TIME_NONE;
+  source->transfer_time = GST_CLOCK_TIME_NONE;
+
   GSTCURL_FUNCTION_EXIT (source);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Called by curl from the multi loop thread to tell which events it wants
+ * to be woken up for on a socket.
+ */
+static int
+gst_curl_http_src_multi_socket_cb (CURL * easy, curl_socket_t sock, int what,
+    void *userp, void *socketp)
+{
+  GstCurlHttpSrcMultiTaskContext *context = userp;
+  struct epoll_event ev = { 0, };
+
+  if (what == CURL_POLL_REMOVE) {
+    /* curl may have closed the socket already, ignore errors */
+    epoll_ctl (context->epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+    return 0;
+  }
+
+  ev.data.fd = sock;
+  if (what & CURL_POLL_IN)
+    ev.events |= EPOLLIN;
+  if (what & CURL_POLL_OUT)
+    ev.events |= EPOLLOUT;
+
+  if (epoll_ctl (context->epoll_fd, EPOLL_CTL_MOD, sock, &ev) != 0) {
+    if (errno != ENOENT
+        || epoll_ctl (context->epoll_fd, EPOLL_CTL_ADD, sock, &ev) != 0) {
+      GSTCURL_WARNING_PRINT ("Couldn't watch socket %d: %s", sock,
+          g_strerror (errno));
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Called by curl from the multi loop thread when its timeout changes.
+ */
+static int
+gst_curl_http_src_multi_timer_cb (CURLM * multi, long timeout_ms, void *userp)
+{
+  GstCurlHttpSrcMultiTaskContext *context = userp;
+
+  if (timeout_ms < 0)
+    context->timer_deadline = -1;
+  else
+    context->timer_deadline = g_get_monotonic_time () + timeout_ms * 1000;
+
+  return 0;
+}
+
+/*
+ * Drive the multi handle with curl_multi_socket_action() from an epoll set,
+ * so that the cost of a wakeup only depends on the sockets that are ready
+ * and not on the total number of transfers. If this fails, the multi loop
+ * uses curl_multi_wait() instead.
+ */
+static void
+gst_curl_http_src_multi_setup_epoll (GstCurlHttpSrcMultiTaskContext * context)
+{
+  struct epoll_event ev = { 0, };
+
+  context->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (context->epoll_fd < 0) {
+    GSTCURL_WARNING_PRINT ("Couldn't create epoll instance: %s",
+        g_strerror (errno));
+    return;
+  }
+
+  if (pipe (context->wakeup_fds) != 0) {
+    GSTCURL_WARNING_PRINT ("Couldn't create wakeup pipe: %s",
+        g_strerror (errno));
+    close (context->epoll_fd);
+    context->epoll_fd = -1;
+    return;
+  }
+  fcntl (context->wakeup_fds[0], F_SETFL, O_NONBLOCK);
+  fcntl (context->wakeup_fds[1], F_SETFL, O_NONBLOCK);
+  fcntl (context->wakeup_fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl (context->wakeup_fds[1], F_SETFD, FD_CLOEXEC);
+
+  ev.events = EPOLLIN;
+  ev.data.fd = context->wakeup_fds[0];
+  epoll_ctl (context->epoll_fd, EPOLL_CTL_ADD, context->wakeup_fds[0], &ev);
+
+  curl_multi_setopt (context->multi_handle, CURLMOPT_SOCKETFUNCTION,
+      gst_curl_http_src_multi_socket_cb);
+  curl_multi_setopt (context->multi_handle, CURLMOPT_SOCKETDATA, context);
+  curl_multi_setopt (context->multi_handle, CURLMOPT_TIMERFUNCTION,
+      gst_curl_http_src_multi_timer_cb);
+  curl_multi_setopt (context->multi_handle, CURLMOPT_TIMERDATA, context);
+}
+
+static void
+gst_curl_http_src_multi_close_epoll (GstCurlHttpSrcMultiTaskContext * context)
+{
+  if (context->epoll_fd < 0)
+    return;
+
+  close (context->wakeup_fds[0]);
+  close (context->wakeup_fds[1]);
+  close (context->epoll_fd);
+  context->epoll_fd = -1;
+}
+#endif
+
 /*
  * Check if the Curl multi loop has been started. If not, initialise it and
  * start it running. If it is already running, increment the refcount.
@@ -665,6 +820,13 @@ gst_curl_http_src_ref_multi (GstCurlHttpSrc * src)
         CURLMOPT_MAX_HOST_CONNECTIONS, 1);
 #endif
 
+    klass->multi_task_context.still_running = 0;
+    klass->multi_task_context.epoll_fd = -1;
+    klass->multi_task_context.timer_deadline = -1;
+#ifdef HAVE_SYS_EPOLL_H
+    gst_curl_http_src_multi_setup_epoll (&klass->multi_task_context);
+#endif
+
     /* Start the thread */
     klass->multi_task_context.task = gst_task_new (
         (GstTaskFunction) gst_curl_http_src_curl_multi_loop,
@@ -713,9 +875,12 @@ gst_curl_http_src_unref_multi (GstCurlHttpSrc * src)
     /* Everything's done! Clean up. */
     gst_task_pause (klass->multi_task_context.task);
     klass->multi_task_context.state = GSTCURL_MULTI_LOOP_STATE_STOP;
-    g_cond_signal (&klass->multi_task_context.signal);
+    gst_curl_http_src_multi_wakeup (&klass->multi_task_context);
     g_mutex_unlock (&klass->multi_task_context.mutex);
     gst_task_join (klass->multi_task_context.task);
+#ifdef HAVE_SYS_EPOLL_H
+    gst_curl_http_src_multi_close_epoll (&klass->multi_task_context);
+#endif
   } else {
     g_mutex_unlock (&klass->multi_task_context.mutex);
   }
@@ -764,6 +929,12 @@ gst_curl_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 retry:
   if (!src->transfer_begun) {
     GST_DEBUG_OBJECT (src, "Starting new request for URI %s", src->uri);
+    /* The write callback allocates from the negotiated allocator */
+    if (src->allocator)
+      gst_object_unref (src->allocator);
+    gst_base_src_get_allocator (GST_BASE_SRC (src), &src->allocator,
+        &src->alloc_params);
+
     /* Create the Easy Handle and set up the session. */
     src->curl_handle = gst_curl_http_src_create_easy_handle (src);
     if (src->curl_handle == NULL) {
@@ -782,7 +953,7 @@ retry:
 
     /* Signal the worker thread */
     klass->multi_task_context.state = GSTCURL_MULTI_LOOP_STATE_QUEUE_EVENT;
-    g_cond_signal (&klass->multi_task_context.signal);
+    gst_curl_http_src_multi_wakeup (&klass->multi_task_context);
     g_mutex_unlock (&klass->multi_task_context.mutex);
 
     src->state = GSTCURL_OK;
@@ -806,11 +977,7 @@ retry:
   }
 
   if (src->state == GSTCURL_UNLOCK) {
-    if (src->buffer_len > 0) {
-      g_free (src->buffer);
-      src->buffer = NULL;
-      src->buffer_len = 0;
-    }
+    gst_curl_http_src_clear_chunks (src);
     ret = GST_FLOW_FLUSHING;
     goto escape;
   }
@@ -859,14 +1026,13 @@ retry:
   if (((src->state == GSTCURL_OK) || (src->state == GSTCURL_DONE)) &&
       (src->buffer_len > 0)) {
 
-    GST_DEBUG_OBJECT (src, "Pushing %u bytes of transfer for URI %s to pad",
-        src->buffer_len, src->uri);
-    *outbuf = gst_buffer_new_allocate (NULL, src->buffer_len, NULL);
-    gst_buffer_fill (*outbuf, 0, src->buffer, src->buffer_len);
+    GstBufferList *list;
 
-    g_free (src->buffer);
-    src->buffer = NULL;
-    src->buffer_len = 0;
+    list = gst_curl_http_src_take_chunks (src);
+    GST_DEBUG_OBJECT (src, "Pushing %" G_GSIZE_FORMAT " bytes of transfer for "
+        "URI %s to pad", gst_buffer_list_calculate_size (list), src->uri);
+    gst_base_src_submit_buffer_list (GST_BASE_SRC (src), list);
+    *outbuf = NULL;
     src->data_received = TRUE;
 
     /* ret should still be GST_FLOW_OK */
@@ -877,6 +1043,7 @@ retry:
     src->transfer_begun = FALSE;
     src->status_code = 0;
     src->hdrs_updated = FALSE;
+    gst_curl_http_src_update_stats (src);
     gst_curl_http_src_destroy_easy_handle (src);
     ret = GST_FLOW_EOS;
   } else {
@@ -1318,8 +1485,11 @@ gst_curl_http_src_cleanup_instance (GstCurlHttpSrc * src)
 
   g_cond_clear (&src->signal);
 
-  g_free (src->buffer);
-  src->buffer = NULL;
+  gst_curl_http_src_clear_chunks (src);
+  if (src->allocator) {
+    gst_object_unref (src->allocator);
+    src->allocator = NULL;
+  }
 
   if (src->http_headers != NULL) {
     gst_structure_free (src->http_headers);
@@ -1505,6 +1675,101 @@ gst_curl_http_src_unlock_stop (GstBaseSrc * bsrc)
 /*****************************************************************************
  * Curl loop task functions begin
  *****************************************************************************/
+/*
+ * Wake the multi loop up, whether it waits for a state change or for socket
+ * activity. Must be called with the context mutex held.
+ */
+static void
+gst_curl_http_src_multi_wakeup (GstCurlHttpSrcMultiTaskContext * context)
+{
+  g_cond_signal (&context->signal);
+#ifdef HAVE_SYS_EPOLL_H
+  if (context->epoll_fd >= 0) {
+    const gchar c = 0;
+
+    /* the pipe is non-blocking, a full pipe already means a pending wakeup */
+    if (write (context->wakeup_fds[1], &c, 1) < 0 && errno != EAGAIN)
+      GSTCURL_WARNING_PRINT ("Couldn't wake up multi loop: %s",
+          g_strerror (errno));
+  }
+#endif
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static void
+gst_curl_http_src_multi_run_epoll (GstCurlHttpSrcMultiTaskContext * context)
+{
+  struct epoll_event events[GSTCURL_MULTI_MAX_EVENTS];
+  int timeout_ms = GSTCURL_MULTI_MAX_WAIT_MS;
+  int i, n;
+
+  if (context->still_running == 0) {
+    /* Only refresh still_running, so that the loop can go back to waiting
+     * once the transfers are over */
+    timeout_ms = 0;
+  } else if (context->timer_deadline >= 0) {
+    gint64 remaining = context->timer_deadline - g_get_monotonic_time ();
+
+    timeout_ms = CLAMP ((remaining + 999) / 1000, 0, timeout_ms);
+  }
+
+  n = epoll_wait (context->epoll_fd, events, GSTCURL_MULTI_MAX_EVENTS,
+      timeout_ms);
+  if (n < 0 && errno != EINTR)
+    GSTCURL_WARNING_PRINT ("epoll_wait failed: %s", g_strerror (errno));
+
+  for (i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    int action = 0;
+
+    if (fd == context->wakeup_fds[0]) {
+      gchar buf[64];
+
+      while (read (fd, buf, sizeof (buf)) > 0);
+      continue;
+    }
+
+    if (events[i].events & EPOLLIN)
+      action |= CURL_CSELECT_IN;
+    if (events[i].events & EPOLLOUT)
+      action |= CURL_CSELECT_OUT;
+    if (events[i].events & (EPOLLERR | EPOLLHUP))
+      action |= CURL_CSELECT_ERR;
+
+    curl_multi_socket_action (context->multi_handle, fd, action,
+        &context->still_running);
+  }
+
+  /* Without any event still_running would not be updated, and the loop
+   * would keep waking up for transfers that are already over */
+  if (n == 0 || (context->timer_deadline >= 0
+          && g_get_monotonic_time () >= context->timer_deadline)) {
+    /* curl may set a new timeout from within socket_action */
+    context->timer_deadline = -1;
+    curl_multi_socket_action (context->multi_handle, CURL_SOCKET_TIMEOUT, 0,
+        &context->still_running);
+  }
+}
+#endif
+
+/*
+ * Fallback without epoll. curl_multi_wait() polls all the sockets of the
+ * multi handle on each call, but unlike select() it is not limited to
+ * FD_SETSIZE descriptors.
+ */
+static void
+gst_curl_http_src_multi_run_wait (GstCurlHttpSrcMultiTaskContext * context)
+{
+  long curl_timeo = -1;
+
+  curl_multi_timeout (context->multi_handle, &curl_timeo);
+  if (curl_timeo < 0 || curl_timeo > GSTCURL_MULTI_MAX_WAIT_MS)
+    curl_timeo = GSTCURL_MULTI_MAX_WAIT_MS;
+
+  curl_multi_wait (context->multi_handle, NULL, 0, curl_timeo, NULL);
+  curl_multi_perform (context->multi_handle, &context->still_running);
+}
+
 static void
 gst_curl_http_src_curl_multi_loop (gpointer thread_data)
 {
@@ -1559,50 +1824,18 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
     }
     g_mutex_unlock (&context->mutex);
   } else if (context->state == GSTCURL_MULTI_LOOP_STATE_RUNNING) {
-    struct timeval timeout;
-    gint rc;
-    fd_set fdread, fdwrite, fdexcep;
-    int maxfd = -1;
-    long curl_timeo = -1;
-
     /* Because curl can possibly take some time here, be nice and let go of the
      * mutex so other threads can perform state/queue operations as we don't
      * care about those until the end of this. */
     g_mutex_unlock (&context->mutex);
 
-    FD_ZERO (&fdread);
-    FD_ZERO (&fdwrite);
-    FD_ZERO (&fdexcep);
-
-    timeout.tv_sec = 1;
-    timeout.tv_usec = 0;
-
-    curl_multi_timeout (context->multi_handle, &curl_timeo);
-    if (curl_timeo >= 0) {
-      timeout.tv_sec = curl_timeo / 1000;
-      if (timeout.tv_sec > 1) {
-        timeout.tv_sec = 1;
-      } else {
-        timeout.tv_usec = (curl_timeo % 1000) * 1000;
-      }
-    }
-
-    /* get file descriptors from the transfers */
-    curl_multi_fdset (context->multi_handle, &fdread, &fdwrite, &fdexcep,
-        &maxfd);
-
-    rc = select (maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-
-    switch (rc) {
-      case -1:
-        /* select error */
-        break;
-      case 0:
-      default:
-        /* timeout or readable/writable sockets */
-        curl_multi_perform (context->multi_handle, &still_running);
-        break;
-    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (context->epoll_fd >= 0)
+      gst_curl_http_src_multi_run_epoll (context);
+    else
+#endif
+      gst_curl_http_src_multi_run_wait (context);
+    still_running = context->still_running;
 
     /*
      * Check the CURL message buffer to find out if any transfers have
@@ -1674,6 +1907,14 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
     context->request_removal_element = NULL;
     context->state = GSTCURL_MULTI_LOOP_STATE_RUNNING;
     g_mutex_unlock (&context->mutex);
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* Removing a handle changes the number of running transfers, which only
+     * socket_action reports */
+    if (context->epoll_fd >= 0)
+      curl_multi_socket_action (context->multi_handle, CURL_SOCKET_TIMEOUT, 0,
+          &context->still_running);
+#endif
   } else {
     GSTCURL_WARNING_PRINT ("Curl Loop State was invalid or unsupported");
     GSTCURL_WARNING_PRINT ("Signal State is %d, resetting to RUNNING.",
@@ -1835,6 +2076,8 @@ gst_curl_http_src_get_chunks (void *chunk, size_t size, size_t nmemb, void *src)
 {
   GstCurlHttpSrc *s = src;
   size_t chunk_len = size * nmemb;
+  size_t written = 0;
+  GstMapInfo map;
   GST_TRACE_OBJECT (s,
       "Received curl chunk for URI %s of size %d", s->uri, (int) chunk_len);
   g_mutex_lock (&s->buffer_mutex);
@@ -1842,14 +2085,38 @@ gst_curl_http_src_get_chunks (void *chunk, size_t size, size_t nmemb, void *src)
     g_mutex_unlock (&s->buffer_mutex);
     return chunk_len;
   }
-  s->buffer =
-      g_realloc (s->buffer, (s->buffer_len + chunk_len + 1) * sizeof (char));
-  if (s->buffer == NULL) {
-    GST_ERROR_OBJECT (s, "Realloc for cURL response message failed!\n");
-    return 0;
+  while (written < chunk_len) {
+    gsize len;
+
+    if (s->fill_block == NULL) {
+      s->fill_block = gst_allocator_alloc (s->allocator,
+          GSTCURL_CHUNK_BLOCK_SIZE, &s->alloc_params);
+      s->fill_offset = 0;
+      if (s->fill_block == NULL) {
+        GST_ERROR_OBJECT (s, "Allocation for cURL response message failed!");
+        g_mutex_unlock (&s->buffer_mutex);
+        return 0;
+      }
+    }
+
+    len = MIN (chunk_len - written, GSTCURL_CHUNK_BLOCK_SIZE - s->fill_offset);
+    if (!gst_memory_map (s->fill_block, &map, GST_MAP_WRITE)) {
+      GST_ERROR_OBJECT (s, "Couldn't map block for cURL response message!");
+      g_mutex_unlock (&s->buffer_mutex);
+      return 0;
+    }
+    memcpy (map.data + s->fill_offset, (guint8 *) chunk + written, len);
+    gst_memory_unmap (s->fill_block, &map);
+    s->fill_offset += len;
+    written += len;
+
+    if (s->fill_offset == GSTCURL_CHUNK_BLOCK_SIZE) {
+      g_queue_push_tail (&s->chunk_blocks, s->fill_block);
+      s->fill_block = NULL;
+    }
   }
-  memcpy (s->buffer + s->buffer_len, chunk, chunk_len);
   s->buffer_len += chunk_len;
+  s->bytes_received += chunk_len;
   g_cond_signal (&s->signal);
   g_mutex_unlock (&s->buffer_mutex);
   return chunk_len;
@@ -1868,6 +2135,118 @@ gst_curl_http_src_request_remove (GstCurlHttpSrc * src)
 
   klass->multi_task_context.state = GSTCURL_MULTI_LOOP_STATE_REQUEST_REMOVAL;
   klass->multi_task_context.request_removal_element = src;
-  g_cond_signal (&klass->multi_task_context.signal);
+  gst_curl_http_src_multi_wakeup (&klass->multi_task_context);
   g_mutex_unlock (&klass->multi_task_context.mutex);
 }
+
+static GstClockTime
+gst_curl_http_src_get_info_time (CURL * handle, CURLINFO info)
+{
+  gdouble secs;
+
+  if (curl_easy_getinfo (handle, info, &secs) != CURLE_OK || secs < 0)
+    return GST_CLOCK_TIME_NONE;
+
+  return (GstClockTime) (secs * GST_SECOND);
+}
+
+/*
+ * Record the timings of the transfer that just completed. Must be called
+ * with the buffer mutex held.
+ */
+static void
+gst_curl_http_src_update_stats (GstCurlHttpSrc * src)
+{
+  CURL *handle = src->curl_handle;
+
+  if (handle == NULL)
+    return;
+
+  src->requests_completed++;
+  src->name_lookup_time =
+      gst_curl_http_src_get_info_time (handle, CURLINFO_NAMELOOKUP_TIME);
+  src->connect_time =
+      gst_curl_http_src_get_info_time (handle, CURLINFO_CONNECT_TIME);
+  src->tls_time =
+      gst_curl_http_src_get_info_time (handle, CURLINFO_APPCONNECT_TIME);
+  src->ttfb =
+      gst_curl_http_src_get_info_time (handle, CURLINFO_STARTTRANSFER_TIME);
+  src->transfer_time =
+      gst_curl_http_src_get_info_time (handle, CURLINFO_TOTAL_TIME);
+
+  GST_DEBUG_OBJECT (src, "Transfer of %s done, connect %" GST_TIME_FORMAT
+      " tls %" GST_TIME_FORMAT " ttfb %" GST_TIME_FORMAT " total %"
+      GST_TIME_FORMAT, src->uri, GST_TIME_ARGS (src->connect_time),
+      GST_TIME_ARGS (src->tls_time), GST_TIME_ARGS (src->ttfb),
+      GST_TIME_ARGS (src->transfer_time));
+}
+
+static GstStructure *
+gst_curl_http_src_get_stats (GstCurlHttpSrc * src)
+{
+  GstStructure *stats;
+
+  g_mutex_lock (&src->buffer_mutex);
+  stats = gst_structure_new ("application/x-curl-http-src-stats",
+      "bytes-received", G_TYPE_UINT64, src->bytes_received,
+      "requests", G_TYPE_UINT, src->requests_completed,
+      "name-lookup-time", G_TYPE_UINT64, src->name_lookup_time,
+      "connect-time", G_TYPE_UINT64, src->connect_time,
+      "tls-time", G_TYPE_UINT64, src->tls_time,
+      "time-to-first-byte", G_TYPE_UINT64, src->ttfb,
+      "transfer-time", G_TYPE_UINT64, src->transfer_time, NULL);
+  g_mutex_unlock (&src->buffer_mutex);
+
+  return stats;
+}
+
+/*
+ * Drop the received data that wasn't pushed yet. Must be called with the
+ * buffer mutex held.
+ */
+static void
+gst_curl_http_src_clear_chunks (GstCurlHttpSrc * src)
+{
+  GstMemory *mem;
+
+  while ((mem = g_queue_pop_head (&src->chunk_blocks)))
+    gst_memory_unref (mem);
+  if (src->fill_block) {
+    gst_memory_unref (src->fill_block);
+    src->fill_block = NULL;
+  }
+  src->fill_offset = 0;
+  src->buffer_len = 0;
+}
+
+/*
+ * Wrap each received block in its own buffer, without copying it. The
+ * partially filled block is only handed over when there is nothing else to
+ * push, so that it can keep being filled otherwise. Must be called with the
+ * buffer mutex held.
+ */
+static GstBufferList *
+gst_curl_http_src_take_chunks (GstCurlHttpSrc * src)
+{
+  GstBufferList *list;
+  GstMemory *mem;
+
+  if (src->fill_block && (g_queue_is_empty (&src->chunk_blocks)
+          || src->state == GSTCURL_DONE)) {
+    gst_memory_resize (src->fill_block, 0, src->fill_offset);
+    g_queue_push_tail (&src->chunk_blocks, src->fill_block);
+    src->fill_block = NULL;
+    src->fill_offset = 0;
+  }
+
+  list = gst_buffer_list_new_sized (g_queue_get_length (&src->chunk_blocks));
+  while ((mem = g_queue_pop_head (&src->chunk_blocks))) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    src->buffer_len -= gst_memory_get_sizes (mem, NULL, NULL);
+    gst_buffer_append_memory (buf, mem);
+    gst_buffer_list_add (list, buf);
+  }
+
+  return list;
+}
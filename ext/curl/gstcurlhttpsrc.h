@@ -126,6 +126,14 @@ struct _GstCurlHttpSrcMultiTaskContext
 
   /* < private > */
   CURLM *multi_handle;
+  int still_running;
+
+  /* curl_multi_socket_action() event loop, only used if epoll is available.
+   * Only touched from the multi loop thread, apart from writing to the
+   * wakeup pipe to interrupt epoll_wait() */
+  int epoll_fd;
+  int wakeup_fds[2];
+  gint64 timer_deadline;
 };
 
 struct _GstCurlHttpSrcClass
@@ -201,8 +209,14 @@ struct _GstCurlHttpSrc
   CURL *curl_handle;
   GMutex buffer_mutex;
   GCond signal;
-  gchar *buffer;
-  guint buffer_len;
+  /* Received data, written once by curl into these blocks and pushed
+   * downstream as they are */
+  GQueue chunk_blocks;          /* full GstMemory blocks */
+  GstMemory *fill_block;        /* block being written to */
+  gsize fill_offset;
+  guint buffer_len;             /* bytes in chunk_blocks and fill_block */
+  GstAllocator *allocator;
+  GstAllocationParams alloc_params;
   gboolean transfer_begun;
   gboolean data_received;
 
@@ -217,6 +231,16 @@ struct _GstCurlHttpSrc
   CURLcode curl_result;
   char curl_errbuf[CURL_ERROR_SIZE];
 
+  /* Transfer statistics, protected by buffer_mutex. The times are the ones
+   * of the last complete transfer, counted from the start of the request */
+  guint64 bytes_received;
+  guint requests_completed;
+  GstClockTime name_lookup_time;
+  GstClockTime connect_time;
+  GstClockTime tls_time;
+  GstClockTime ttfb;
+  GstClockTime transfer_time;
+
   GstCaps *caps;
 };
 
@@ -245,6 +269,7 @@ enum
   PROP_MAXCONCURRENT_PROXY,
   PROP_MAXCONCURRENT_GLOBAL,
   PROP_HTTPVERSION,
+  PROP_STATS,
   PROP_MAX
 };
 
@@ -379,6 +379,8 @@ static gboolean gst_dash_demux_process_manifest (GstAdaptiveDemux * ademux,
 static gboolean gst_dash_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek);
 static GstFlowReturn
 gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream);
+static gboolean gst_dash_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint offset, GstAdaptiveDemuxStreamFragment * fragment);
 static GstFlowReturn gst_dash_demux_stream_seek (GstAdaptiveDemuxStream *
     stream, gboolean forward, GstSeekFlags flags, GstClockTime ts,
     GstClockTime * final_ts);
@@ -637,6 +639,8 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
       gst_dash_demux_stream_select_bitrate;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_peek_fragment =
+      gst_dash_demux_stream_peek_fragment;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
   gstadaptivedemux_class->get_live_seek_range =
       gst_dash_demux_get_live_seek_range;
@@ -1375,6 +1379,37 @@ gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_EOS;
 }
 
+static gboolean
+gst_dash_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream,
+    guint offset, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
+  GstMediaFragmentInfo info = { 0, };
+
+  /* Subsegments of isoff-ondemand streams and key unit trick mode ranges are
+   * only known once the index or moof of the current one is parsed */
+  if (gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client)
+      || dashstream->sidx_position != GST_CLOCK_TIME_NONE
+      || GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (dashdemux))
+    return FALSE;
+
+  if (!gst_mpd_client_peek_fragment (dashdemux->client, dashstream->index,
+          stream->demux->segment.rate > 0, offset, &info))
+    return FALSE;
+
+  fragment->uri = info.uri;
+  info.uri = NULL;
+  fragment->range_start = MAX (info.range_start, dashstream->sidx_base_offset);
+  fragment->range_end = info.range_end;
+  fragment->timestamp = info.timestamp;
+  fragment->duration = info.duration;
+
+  gst_media_fragment_info_clear (&info);
+
+  return TRUE;
+}
+
 static gint
 gst_dash_demux_index_entry_search (GstSidxBoxEntry * entry, GstClockTime * ts,
     gpointer user_data)
@@ -2441,12 +2476,17 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
       }
     }
 
+    /* let the new client reuse the segments of the current one for the
+     * parts of the SegmentTimelines that did not change */
+    new_client->previous = dashdemux->client;
     if (!gst_dash_demux_setup_mpdparser_streams (dashdemux, new_client)) {
       GST_ERROR_OBJECT (demux, "Failed to setup streams on manifest " "update");
+      new_client->previous = NULL;
       gst_mpd_client_free (new_client);
       gst_buffer_unmap (buffer, &mapinfo);
       return GST_FLOW_ERROR;
     }
+    new_client->previous = NULL;
 
     /* If no pads have been exposed yet, need to use those */
     streams = NULL;
@@ -3147,7 +3147,7 @@ gst_mpdparser_free_stream_period (GstStreamPeriod * stream_period)
 static void
 gst_mpdparser_free_media_segment (GstMediaSegment * media_segment)
 {
-  if (media_segment) {
+  if (media_segment && g_atomic_int_dec_and_test (&media_segment->ref_count)) {
     g_slice_free (GstMediaSegment, media_segment);
   }
 }
@@ -3923,6 +3923,7 @@ gst_mpd_client_add_media_segment (GstActiveStream * stream,
   media_segment->start = start;
   media_segment->duration = duration;
   media_segment->repeat = repeat;
+  media_segment->ref_count = 1;
 
   g_ptr_array_add (stream->segments, media_segment);
   GST_LOG ("Added new segment: number %d, repeat %d, "
@@ -3933,6 +3934,82 @@ gst_mpd_client_add_media_segment (GstActiveStream * stream,
   return TRUE;
 }
 
+/* Returns the stream of the previous manifest whose segments were built
+ * from a SegmentTimeline for the same Representation, if any */
+static GstActiveStream *
+gst_mpd_client_get_previous_stream (GstMpdClient * client,
+    GstActiveStream * stream)
+{
+  GList *list;
+  const gchar *id = stream->cur_representation->id;
+
+  if (client->previous == NULL || id == NULL)
+    return NULL;
+
+  for (list = client->previous->active_streams; list;
+      list = g_list_next (list)) {
+    GstActiveStream *prev_stream = list->data;
+
+    if (prev_stream->mimeType != stream->mimeType
+        || prev_stream->cur_seg_template == NULL
+        || prev_stream->cur_representation == NULL
+        || prev_stream->segments == NULL
+        || prev_stream->timeline_end == 0)
+      continue;
+
+    if (g_strcmp0 (prev_stream->cur_representation->id, id) == 0)
+      return prev_stream;
+  }
+
+  return NULL;
+}
+
+/* Adds the @n_segments segments of @prev_stream starting at @scale_start to
+ * the stream instead of building them again. A live SegmentTimeline only
+ * drops entries at its head and appends new ones at its tail, so only the
+ * ends of the range are checked: the first segment must have the same
+ * number and the last one the same start and duration, as its duration
+ * may have been clipped to the end of the previous period. */
+static gboolean
+gst_mpd_client_reuse_media_segments (GstActiveStream * stream,
+    GstActiveStream * prev_stream, guint number, guint64 scale_start,
+    guint64 last_scale_start, GstClockTime last_duration, guint n_segments)
+{
+  GPtrArray *prev_segments = prev_stream->segments;
+  GstMediaSegment *first, *last;
+  guint lower = 0, upper = prev_segments->len, n;
+
+  while (lower < upper) {
+    guint mid = lower + (upper - lower) / 2;
+
+    first = g_ptr_array_index (prev_segments, mid);
+    if (first->scale_start < scale_start)
+      lower = mid + 1;
+    else
+      upper = mid;
+  }
+
+  if (lower + n_segments > prev_segments->len)
+    return FALSE;
+
+  first = g_ptr_array_index (prev_segments, lower);
+  last = g_ptr_array_index (prev_segments, lower + n_segments - 1);
+  if (first->SegmentURL != NULL || first->number != number
+      || first->scale_start != scale_start
+      || last->scale_start != last_scale_start
+      || last->duration != last_duration)
+    return FALSE;
+
+  for (n = lower; n < lower + n_segments; n++) {
+    GstMediaSegment *media_segment = g_ptr_array_index (prev_segments, n);
+
+    g_atomic_int_inc (&media_segment->ref_count);
+    g_ptr_array_add (stream->segments, media_segment);
+  }
+
+  return TRUE;
+}
+
 static void
 gst_mpd_client_stream_update_presentation_time_offset (GstMpdClient * client,
     GstActiveStream * stream)
@@ -3985,6 +4062,7 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
     g_ptr_array_unref (stream->segments);
     stream->segments = NULL;
   }
+  stream->timeline_end = 0;
 
   stream_period = gst_mpdparser_get_stream_period (client);
   g_return_val_if_fail (stream_period != NULL, FALSE);
@@ -4129,17 +4207,62 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
         GstSegmentTimelineNode *timeline;
         GstSNode *S;
         GList *list;
+        GstActiveStream *prev_stream;
+        guint timescale;
 
         timeline = mult_seg->SegmentTimeline;
+        timescale = mult_seg->SegBaseType->timescale;
+        prev_stream = gst_mpd_client_get_previous_stream (client, stream);
         gst_mpdparser_init_active_stream_segments (stream);
-        for (list = g_queue_peek_head_link (&timeline->S); list;
-            list = g_list_next (list)) {
-          guint timescale;
+        list = g_queue_peek_head_link (&timeline->S);
+
+        if (prev_stream) {
+          guint first_number = i, n_covered = 0;
+          guint64 first_start = 0, last_start = 0;
+          GstClockTime last_duration = 0;
+
+          /* Skip the entries that end before the previous timeline did,
+           * they can be taken over from it without building anything */
+          for (; list; list = g_list_next (list)) {
+            S = (GstSNode *) list->data;
+            if (S->t > 0)
+              start = S->t;
+            if (start + S->d * (S->r + 1) > prev_stream->timeline_end)
+              break;
+
+            if (n_covered == 0) {
+              first_number = i;
+              first_start = start;
+            }
+            last_start = start;
+            last_duration = gst_util_uint64_scale (S->d, GST_SECOND,
+                timescale);
+            n_covered++;
+            i += S->r + 1;
+            start += S->d * (S->r + 1);
+          }
+
+          if (n_covered > 0 && gst_mpd_client_reuse_media_segments (stream,
+                  prev_stream, first_number, first_start, last_start,
+                  last_duration, n_covered)) {
+            GstMediaSegment *last = g_ptr_array_index (stream->segments,
+                stream->segments->len - 1);
 
+            GST_LOG ("Reused %u segments from the previous manifest",
+                n_covered);
+            start_time = last->start + last->duration * (last->repeat + 1);
+          } else {
+            /* build the whole list */
+            list = g_queue_peek_head_link (&timeline->S);
+            i = mult_seg->startNumber;
+            start = 0;
+          }
+        }
+
+        for (; list; list = g_list_next (list)) {
           S = (GstSNode *) list->data;
           GST_LOG ("Processing S node: d=%" G_GUINT64_FORMAT " r=%u t=%"
               G_GUINT64_FORMAT, S->d, S->r, S->t);
-          timescale = mult_seg->SegBaseType->timescale;
           duration = gst_util_uint64_scale (S->d, GST_SECOND, timescale);
           if (S->t > 0) {
             start = S->t;
@@ -4154,6 +4277,7 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
           start += S->d * (S->r + 1);
           start_time += duration * (S->r + 1);
         }
+        stream->timeline_end = start;
       } else {
         /* NOP - The segment is created on demand with the template, no need
          * to build a list */
@@ -4173,6 +4297,18 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
           if (media_segment->start + media_segment->duration >
               PeriodEnd - PeriodStart) {
             GstClockTime stop = PeriodEnd - PeriodStart;
+
+            /* don't modify a segment shared with the previous manifest */
+            if (g_atomic_int_get (&media_segment->ref_count) > 1) {
+              GstMediaSegment *copy =
+                  g_slice_dup (GstMediaSegment, media_segment);
+
+              copy->ref_count = 1;
+              gst_mpdparser_free_media_segment (media_segment);
+              g_ptr_array_index (stream->segments, n) = copy;
+              media_segment = copy;
+            }
+
             if (n < stream->segments->len - 1) {
               GstMediaSegment *next_segment =
                   g_ptr_array_index (stream->segments, n + 1);
@@ -5435,6 +5571,38 @@ done:
   return ret;
 }
 
+/* Fills @fragment with the information of the fragment @offset positions
+ * after the current one, without changing the current position */
+gboolean
+gst_mpd_client_peek_fragment (GstMpdClient * client, guint indexStream,
+    gboolean forward, guint offset, GstMediaFragmentInfo * fragment)
+{
+  GstActiveStream *stream;
+  gint segment_index;
+  gint segment_repeat_index;
+  gboolean ret = TRUE;
+
+  stream = gst_mpdparser_get_active_stream_by_index (client, indexStream);
+  g_return_val_if_fail (stream != NULL, FALSE);
+
+  segment_index = stream->segment_index;
+  segment_repeat_index = stream->segment_repeat_index;
+
+  while (ret && offset > 0) {
+    ret = gst_mpd_client_advance_segment (client, stream, forward)
+        == GST_FLOW_OK;
+    offset--;
+  }
+
+  if (ret)
+    ret = gst_mpd_client_get_next_fragment (client, indexStream, fragment);
+
+  stream->segment_index = segment_index;
+  stream->segment_repeat_index = segment_repeat_index;
+
+  return ret;
+}
+
 gboolean
 gst_mpd_client_get_next_header (GstMpdClient * client, gchar ** uri,
     guint stream_idx, gint64 * range_start, gint64 * range_end)
@@ -459,6 +459,7 @@ struct _GstMediaSegment
   guint64 scale_duration;                     /* duration in timescale units */
   GstClockTime start;                         /* segment start time */
   GstClockTime duration;                      /* segment duration */
+  gint ref_count;                             /* segments may be shared with the client of an updated manifest */
 };
 
 struct _GstMediaFragmentInfo
@@ -500,6 +501,8 @@ struct _GstActiveStream
   guint segment_repeat_index;                 /* index of the repeat count of a segment */
   GPtrArray *segments;                        /* array of GstMediaSegment */
   GstClockTime presentationTimeOffset;        /* presentation time offset of the current segment */
+  guint64 timeline_end;                       /* end of the SegmentTimeline the segments were built from,
+                                               * in timescale units, 0 if none */
 };
 
 struct _GstMpdClient
@@ -520,6 +523,9 @@ struct _GstMpdClient
   gboolean profile_isoff_ondemand;
 
   GstUriDownloader * downloader;
+
+  GstMpdClient *previous;                     /* client of the manifest being updated, only
+                                               * set while setting up the new streams */
 };
 
 /* Basic initialization/deinitialization functions */
@@ -543,6 +549,7 @@ GstClockTime gst_mpd_client_get_maximum_segment_duration (GstMpdClient * client)
 gboolean gst_mpd_client_get_last_fragment_timestamp_end (GstMpdClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment_timestamp (GstMpdClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment (GstMpdClient *client, guint indexStream, GstMediaFragmentInfo * fragment);
+gboolean gst_mpd_client_peek_fragment (GstMpdClient * client, guint indexStream, gboolean forward, guint offset, GstMediaFragmentInfo * fragment);
 gboolean gst_mpd_client_get_next_header (GstMpdClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_get_next_header_index (GstMpdClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_is_live (GstMpdClient * client);
@@ -358,3 +358,653 @@ gst_hlsdemux_tsreader_find_pcrs (GstHLSTSReader * r,
   return gst_hlsdemux_tsreader_find_pcrs_id3 (r, buffer, first_pcr, last_pcr,
       tags);
 }
+
+/* SAMPLE-AES (Apple "MPEG-2 Stream Encryption Format for HTTP Live
+ * Streaming"): only parts of the H.264 NAL units and audio frames are
+ * encrypted, and the PMT announces the elementary streams with private
+ * stream types. The reader collects the PES packets of those streams,
+ * decrypts them and writes them back into their original TS packets with
+ * the regular stream types, so the rest of the pipeline sees clear TS.
+ * Everything from the first packet of a PES still being collected onwards
+ * is held back, so that the packets come out in the order they came in. */
+
+#define SAMPLE_AES_TS_PACKET_SIZE 188
+
+static const struct
+{
+  guint8 encrypted_type;
+  guint8 clear_type;
+  GstHLSSampleAesCodec codec;
+} sample_aes_stream_types[] = {
+  {0xdb, 0x1b, GST_HLS_SAMPLE_AES_H264},
+  {0xcf, 0x0f, GST_HLS_SAMPLE_AES_AAC},
+  {0xc1, 0x81, GST_HLS_SAMPLE_AES_AC3},
+  {0xc2, 0x87, GST_HLS_SAMPLE_AES_AC3}
+};
+
+static guint32
+sample_aes_crc32 (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gint i;
+
+  while (size--) {
+    crc ^= (guint32) (*data++) << 24;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static gint
+sample_aes_payload_offset (const guint8 * p)
+{
+  gint offset = 4;
+
+  if ((p[3] & 0x10) == 0)       /* no payload */
+    return -1;
+  if ((p[3] & 0x20) != 0)       /* has_adaptation_field */
+    offset += 1 + p[4];
+
+  return offset < SAMPLE_AES_TS_PACKET_SIZE ? offset : -1;
+}
+
+/* Returns the PSI section starting in packet @p, if it fits in the packet */
+static guint8 *
+sample_aes_get_section (guint8 * p, guint * section_size)
+{
+  guint8 *end = p + SAMPLE_AES_TS_PACKET_SIZE;
+  guint8 *data;
+  gint offset;
+
+  offset = sample_aes_payload_offset (p);
+  if (offset < 0)
+    return NULL;
+  data = p + offset;
+  data += 1 + data[0];          /* pointer_field */
+  if (data + 3 > end)
+    return NULL;
+  *section_size = 3 + (GST_READ_UINT16_BE (data + 1) & 0x0FFF);
+  if (data + *section_size > end)
+    return NULL;
+
+  return data;
+}
+
+static void
+sample_aes_handle_pat (GstHLSSampleAesReader * r, guint8 * p)
+{
+  guint8 *data, *end;
+  guint size;
+
+  data = sample_aes_get_section (p, &size);
+  if (data == NULL || data[0] != 0x00 || size < 8 + 4 + 4)
+    return;
+
+  end = data + size - 4;
+  for (data += 8; data + 4 <= end; data += 4) {
+    if (GST_READ_UINT16_BE (data) != 0) {
+      r->pmt_pid = GST_READ_UINT16_BE (data + 2) & 0x1fff;
+      return;
+    }
+  }
+}
+
+static GstHLSSampleAesStream *
+sample_aes_find_stream (GstHLSSampleAesReader * r, gint pid)
+{
+  guint i;
+
+  for (i = 0; i < r->n_streams; i++) {
+    if (r->streams[i].pid == pid)
+      return &r->streams[i];
+  }
+
+  return NULL;
+}
+
+/* Replaces the SAMPLE-AES stream types in the PMT by the clear ones and
+ * remembers which PIDs need decrypting */
+static void
+sample_aes_handle_pmt (GstHLSSampleAesReader * r, guint8 * p)
+{
+  guint8 *data, *es, *end;
+  gboolean changed = FALSE;
+  guint size, i;
+
+  data = sample_aes_get_section (p, &size);
+  if (data == NULL || data[0] != 0x02 || size < 12 + 4) {
+    GST_WARNING ("Can't handle PMT for SAMPLE-AES");
+    return;
+  }
+
+  end = data + size - 4;
+  es = data + 12 + (GST_READ_UINT16_BE (data + 10) & 0x0FFF);
+  while (es + 5 <= end) {
+    gint pid = GST_READ_UINT16_BE (es + 1) & 0x1fff;
+
+    for (i = 0; i < G_N_ELEMENTS (sample_aes_stream_types); i++) {
+      GstHLSSampleAesStream *stream;
+
+      if (es[0] != sample_aes_stream_types[i].encrypted_type)
+        continue;
+
+      stream = sample_aes_find_stream (r, pid);
+      if (stream == NULL) {
+        if (r->n_streams == GST_HLS_SAMPLE_AES_MAX_STREAMS) {
+          GST_WARNING ("Too many SAMPLE-AES streams, ignoring PID %04x", pid);
+          break;
+        }
+        stream = &r->streams[r->n_streams++];
+        stream->pid = pid;
+        stream->cc = -1;
+        if (stream->packets == NULL) {
+          stream->packets = g_byte_array_new ();
+          stream->slots = g_array_new (FALSE, FALSE, sizeof (guint64));
+        }
+        g_byte_array_set_size (stream->packets, 0);
+        g_array_set_size (stream->slots, 0);
+      }
+      stream->codec = sample_aes_stream_types[i].codec;
+      es[0] = sample_aes_stream_types[i].clear_type;
+      changed = TRUE;
+      GST_DEBUG ("SAMPLE-AES stream type %02x on PID %04x",
+          sample_aes_stream_types[i].encrypted_type, pid);
+      break;
+    }
+
+    es += 5 + (GST_READ_UINT16_BE (es + 3) & 0x0FFF);
+  }
+
+  if (changed)
+    GST_WRITE_UINT32_BE (end, sample_aes_crc32 (data, size - 4));
+}
+
+static guint8 *
+sample_aes_find_start_code (guint8 * data, guint8 * end)
+{
+  while (end - data >= 3) {
+    if (data[2] > 1)
+      data += 3;
+    else if (data[1] != 0)
+      data += 2;
+    else if (data[0] == 0 && data[2] == 1)
+      return data;
+    else
+      data++;
+  }
+
+  return end;
+}
+
+/* Removes emulation prevention bytes in place, returns the new size */
+static gsize
+sample_aes_unescape (guint8 * data, gsize size)
+{
+  gsize i, o = 0;
+  guint zeros = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && data[i] == 0x03) {
+      zeros = 0;
+      continue;
+    }
+    zeros = data[i] == 0x00 ? zeros + 1 : 0;
+    data[o++] = data[i];
+  }
+
+  return o;
+}
+
+/* After the first 32 bytes, every 16 byte block followed by up to 144
+ * clear bytes is encrypted, except for a trailing block shorter than 16
+ * bytes. The blocks form a single CBC chain, so they're gathered and
+ * decrypted in one go */
+static gboolean
+sample_aes_decrypt_nal (GstHLSSampleAesReader * r, guint8 * data, gsize size)
+{
+  gsize pos, i;
+
+  g_byte_array_set_size (r->blocks, 0);
+  for (pos = 32; pos + 16 < size; pos += 16 + 144)
+    g_byte_array_append (r->blocks, data + pos, 16);
+
+  if (r->blocks->len == 0)
+    return TRUE;
+
+  if (!r->decrypt (r->blocks->data, r->blocks->len, r->user_data))
+    return FALSE;
+
+  for (pos = 32, i = 0; i < r->blocks->len; pos += 16 + 144, i += 16)
+    memcpy (data + pos, r->blocks->data + i, 16);
+
+  return TRUE;
+}
+
+/* Decrypts the slice NAL units of an H.264 byte-stream in place. The
+ * encrypted NAL units were escaped after encryption, so removing the
+ * emulation prevention bytes again yields the original NAL units once
+ * decrypted, and the data can only shrink */
+static gboolean
+sample_aes_decrypt_h264 (GstHLSSampleAesReader * r, guint8 * data,
+    gsize size, gsize * out_size)
+{
+  guint8 *end = data + size;
+  guint8 *nal, *next, *out;
+
+  nal = out = sample_aes_find_start_code (data, end);
+  while (nal < end) {
+    guint8 *nal_data = nal + 3;
+    gsize nal_size, zeros;
+    guint8 nal_type;
+
+    next = sample_aes_find_start_code (nal_data, end);
+    nal_size = next - nal_data;
+    /* trailing zero bytes belong to the next start code */
+    while (nal_size > 0 && nal_data[nal_size - 1] == 0x00)
+      nal_size--;
+    zeros = next - nal_data - nal_size;
+
+    memmove (out, nal, 3 + nal_size);
+    out += 3;
+    nal_type = nal_size > 0 ? out[0] & 0x1f : 0;
+    if ((nal_type == 1 || nal_type == 5) && nal_size > 48) {
+      nal_size = sample_aes_unescape (out, nal_size);
+      if (!sample_aes_decrypt_nal (r, out, nal_size))
+        return FALSE;
+    }
+    out += nal_size;
+
+    memmove (out, next - zeros, zeros);
+    out += zeros;
+    nal = next;
+  }
+
+  *out_size = out - data;
+  return TRUE;
+}
+
+static const guint16 sample_aes_ac3_bitrates[] = {
+  32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448,
+  512, 576, 640
+};
+
+static gsize
+sample_aes_ac3_frame_size (const guint8 * data)
+{
+  guint fscod, frmsizecod, bitrate;
+
+  /* E-AC-3 */
+  if ((data[5] >> 3) > 10)
+    return (((data[2] & 0x07) << 8 | data[3]) + 1) * 2;
+
+  fscod = data[4] >> 6;
+  frmsizecod = data[4] & 0x3f;
+  if (frmsizecod >= 2 * G_N_ELEMENTS (sample_aes_ac3_bitrates))
+    return 0;
+  bitrate = sample_aes_ac3_bitrates[frmsizecod >> 1];
+
+  /* in 16 bit words */
+  switch (fscod) {
+    case 0:                    /* 48 kHz */
+      return bitrate * 2 * 2;
+    case 1:                    /* 44.1 kHz */
+      return (bitrate * 320 / 147 + (frmsizecod & 1)) * 2;
+    case 2:                    /* 32 kHz */
+      return bitrate * 3 * 2;
+    default:
+      return 0;
+  }
+}
+
+/* In each audio frame, everything after the (ADTS) header and 16 clear
+ * bytes is encrypted, except for a trailing block shorter than 16 bytes */
+static gboolean
+sample_aes_decrypt_audio (GstHLSSampleAesReader * r,
+    GstHLSSampleAesCodec codec, guint8 * data, gsize size)
+{
+  while (size > 0) {
+    gsize frame_size, header_size = 0, encrypted_size = 0;
+
+    if (codec == GST_HLS_SAMPLE_AES_AAC) {
+      if (size < 7 || data[0] != 0xff || (data[1] & 0xf6) != 0xf0)
+        break;
+      header_size = (data[1] & 0x01) ? 7 : 9;
+      frame_size = (data[3] & 0x03) << 11 | data[4] << 3 | data[5] >> 5;
+    } else {
+      if (size < 6 || GST_READ_UINT16_BE (data) != 0x0b77)
+        break;
+      frame_size = sample_aes_ac3_frame_size (data);
+    }
+
+    if (frame_size <= header_size || frame_size > size)
+      break;
+
+    if (frame_size > header_size + 16)
+      encrypted_size = (frame_size - header_size - 16) & ~0xf;
+    if (encrypted_size > 0 &&
+        !r->decrypt (data + header_size + 16, encrypted_size, r->user_data))
+      return FALSE;
+
+    data += frame_size;
+    size -= frame_size;
+  }
+
+  /* Most likely a frame continuing in the next PES packet, which can't be
+   * decrypted on its own */
+  if (size > 0) {
+    GST_WARNING ("%" G_GSIZE_FORMAT " bytes of audio are not a complete frame",
+        size);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guint8 *
+sample_aes_held_packet (GstHLSSampleAesReader * r, guint64 slot)
+{
+  return r->held->data + (slot - r->held_base) * SAMPLE_AES_TS_PACKET_SIZE;
+}
+
+/* Writes @payload back into the held TS packets of @stream, keeping their
+ * adaptation fields (and PCRs). The payload can only have shrunk, the
+ * difference is made up with adaptation field stuffing. The sync byte of
+ * the packets that aren't needed anymore is cleared so they get dropped */
+static void
+sample_aes_write_packets (GstHLSSampleAesReader * r,
+    GstHLSSampleAesStream * stream, const guint8 * payload, gsize payload_size)
+{
+  gsize i, pos = 0;
+
+  for (i = 0; i < stream->slots->len; i++) {
+    const guint8 *in = stream->packets->data + i * SAMPLE_AES_TS_PACKET_SIZE;
+    guint af_size, avail, n, stuffing, total;
+    guint8 *p;
+
+    p = sample_aes_held_packet (r, g_array_index (stream->slots, guint64, i));
+    af_size = (in[3] & 0x20) ? MIN (1 + in[4], 184) : 0;
+    avail = 184 - af_size;
+    n = MIN (avail, payload_size - pos);
+
+    /* packet with neither payload nor adaptation field data left */
+    if (n == 0 && af_size <= 1) {
+      p[0] = 0x00;
+      continue;
+    }
+
+    memcpy (p, in, 3);
+
+    stuffing = avail - n;
+    total = af_size + stuffing;
+    if (n > 0) {
+      p[3] = (in[3] & 0xc0) | (total > 0 ? 0x30 : 0x10) | (stream->cc & 0xf);
+      stream->cc++;
+    } else {
+      /* adaptation field only, doesn't increment the continuity counter */
+      p[1] &= ~0x40;
+      p[3] = (in[3] & 0xc0) | 0x20 | ((stream->cc - 1) & 0xf);
+    }
+
+    if (af_size > 1) {
+      p[4] = total - 1;
+      memcpy (p + 5, in + 5, af_size - 1);
+      memset (p + 4 + af_size, 0xff, stuffing);
+    } else if (total > 0) {
+      p[4] = total - 1;
+      if (total > 1) {
+        p[5] = 0x00;            /* no flags */
+        memset (p + 6, 0xff, total - 2);
+      }
+    }
+
+    memcpy (p + 4 + total, payload + pos, n);
+    pos += n;
+  }
+}
+
+static gboolean
+sample_aes_finish_pes (GstHLSSampleAesReader * r,
+    GstHLSSampleAesStream * stream)
+{
+  GByteArray *packets = stream->packets;
+  guint8 *pes;
+  gsize i, size, header_size, es_end, es_size;
+  guint pes_packet_length;
+  gboolean ret = TRUE;
+
+  if (packets->len == 0)
+    return TRUE;
+
+  g_byte_array_set_size (r->pes, 0);
+  for (i = 0; i < packets->len; i += SAMPLE_AES_TS_PACKET_SIZE) {
+    gint offset = sample_aes_payload_offset (packets->data + i);
+
+    if (offset >= 0)
+      g_byte_array_append (r->pes, packets->data + i + offset,
+          SAMPLE_AES_TS_PACKET_SIZE - offset);
+  }
+  pes = r->pes->data;
+  size = r->pes->len;
+
+  if (size < 9 || GST_READ_UINT24_BE (pes) != 0x000001 || size < 9 + pes[8]) {
+    /* the held packets are left as they are */
+    GST_WARNING ("Invalid PES packet on PID %04x", stream->pid);
+    goto done;
+  }
+
+  header_size = 9 + pes[8];
+  pes_packet_length = GST_READ_UINT16_BE (pes + 4);
+  es_end = size;
+  if (pes_packet_length != 0)
+    es_end = CLAMP (6 + pes_packet_length, header_size, size);
+  es_size = es_end - header_size;
+
+  if (stream->codec == GST_HLS_SAMPLE_AES_H264) {
+    gsize new_es_size;
+
+    ret = sample_aes_decrypt_h264 (r, pes + header_size, es_size,
+        &new_es_size);
+    if (ret && new_es_size < es_size) {
+      gsize removed = es_size - new_es_size;
+
+      memmove (pes + header_size + new_es_size, pes + es_end, size - es_end);
+      size -= removed;
+      if (pes_packet_length != 0)
+        GST_WRITE_UINT16_BE (pes + 4, pes_packet_length - removed);
+    }
+  } else {
+    ret = sample_aes_decrypt_audio (r, stream->codec, pes + header_size,
+        es_size);
+  }
+
+  if (ret)
+    sample_aes_write_packets (r, stream, pes, size);
+
+done:
+  g_byte_array_set_size (packets, 0);
+  g_array_set_size (stream->slots, 0);
+  return ret;
+}
+
+static gboolean
+sample_aes_handle_packet (GstHLSSampleAesReader * r, const guint8 * p)
+{
+  GstHLSSampleAesStream *stream;
+  gboolean pusi;
+  guint64 slot;
+  guint8 *held;
+  gint pid;
+
+  if (p[0] != 0x47) {
+    GST_WARNING ("Lost sync, SAMPLE-AES is only supported for MPEG-TS");
+    return FALSE;
+  }
+
+  pid = GST_READ_UINT16_BE (p + 1) & 0x1fff;
+  pusi = (p[1] & 0x40) != 0 && (p[3] & 0x10) != 0;
+
+  stream = sample_aes_find_stream (r, pid);
+  if (stream != NULL && pusi && !sample_aes_finish_pes (r, stream))
+    return FALSE;
+
+  slot = r->held_base + r->held->len / SAMPLE_AES_TS_PACKET_SIZE;
+  g_byte_array_append (r->held, p, SAMPLE_AES_TS_PACKET_SIZE);
+  held = sample_aes_held_packet (r, slot);
+
+  /* pass through anything before the first PES start */
+  if (stream != NULL && (pusi || stream->packets->len > 0)) {
+    if (stream->cc == -1)
+      stream->cc = p[3] & 0xf;
+    g_byte_array_append (stream->packets, p, SAMPLE_AES_TS_PACKET_SIZE);
+    g_array_append_val (stream->slots, slot);
+  } else if (pusi && pid == 0) {
+    sample_aes_handle_pat (r, held);
+  } else if (pusi && pid == r->pmt_pid) {
+    sample_aes_handle_pmt (r, held);
+  }
+
+  return TRUE;
+}
+
+/* Moves the held packets preceding all the PES packets still being
+ * collected to @out */
+static void
+sample_aes_release_packets (GstHLSSampleAesReader * r, GByteArray * out)
+{
+  guint64 end, slot;
+  guint i;
+
+  end = r->held_base + r->held->len / SAMPLE_AES_TS_PACKET_SIZE;
+  for (i = 0; i < r->n_streams; i++) {
+    if (r->streams[i].slots->len > 0)
+      end = MIN (end, g_array_index (r->streams[i].slots, guint64, 0));
+  }
+
+  for (slot = r->held_base; slot < end; slot++) {
+    const guint8 *p = sample_aes_held_packet (r, slot);
+
+    if (p[0] == 0x47)
+      g_byte_array_append (out, p, SAMPLE_AES_TS_PACKET_SIZE);
+  }
+
+  g_byte_array_remove_range (r->held, 0,
+      (end - r->held_base) * SAMPLE_AES_TS_PACKET_SIZE);
+  r->held_base = end;
+}
+
+void
+gst_hlsdemux_sample_aes_reader_init (GstHLSSampleAesReader * r,
+    GstHLSSampleAesDecryptFunc decrypt, gpointer user_data)
+{
+  memset (r, 0, sizeof (GstHLSSampleAesReader));
+  r->decrypt = decrypt;
+  r->user_data = user_data;
+  r->pmt_pid = -1;
+  r->held = g_byte_array_new ();
+  r->pes = g_byte_array_new ();
+  r->blocks = g_byte_array_new ();
+}
+
+void
+gst_hlsdemux_sample_aes_reader_reset (GstHLSSampleAesReader * r)
+{
+  guint i;
+
+  if (r->adapter)
+    gst_adapter_clear (r->adapter);
+  for (i = 0; i < r->n_streams; i++) {
+    g_byte_array_set_size (r->streams[i].packets, 0);
+    g_array_set_size (r->streams[i].slots, 0);
+  }
+  r->n_streams = 0;
+  r->pmt_pid = -1;
+  g_byte_array_set_size (r->held, 0);
+  r->held_base = 0;
+}
+
+void
+gst_hlsdemux_sample_aes_reader_clear (GstHLSSampleAesReader * r)
+{
+  guint i;
+
+  if (r->adapter) {
+    g_object_unref (r->adapter);
+    r->adapter = NULL;
+  }
+  for (i = 0; i < GST_HLS_SAMPLE_AES_MAX_STREAMS; i++) {
+    if (r->streams[i].packets) {
+      g_byte_array_unref (r->streams[i].packets);
+      g_array_unref (r->streams[i].slots);
+      r->streams[i].packets = NULL;
+      r->streams[i].slots = NULL;
+    }
+  }
+  r->n_streams = 0;
+  if (r->held) {
+    g_byte_array_unref (r->held);
+    r->held = NULL;
+  }
+  if (r->pes) {
+    g_byte_array_unref (r->pes);
+    r->pes = NULL;
+  }
+  if (r->blocks) {
+    g_byte_array_unref (r->blocks);
+    r->blocks = NULL;
+  }
+}
+
+/* Takes ownership of @buffer (which may be NULL) and returns the decrypted
+ * TS packets that are complete so far in @out, or NULL. PES packets are
+ * only complete once the next one starts, and the packets following them
+ * are held back until then, so @at_eos flushes them */
+gboolean
+gst_hlsdemux_sample_aes_reader_push (GstHLSSampleAesReader * r,
+    GstBuffer * buffer, gboolean at_eos, GstBuffer ** out)
+{
+  GByteArray *out_data;
+  gboolean ret = TRUE;
+  gsize size, i;
+  guint len;
+
+  *out = NULL;
+
+  if (r->adapter == NULL)
+    r->adapter = gst_adapter_new ();
+  if (buffer)
+    gst_adapter_push (r->adapter, buffer);
+
+  size = gst_adapter_available (r->adapter);
+  size -= size % SAMPLE_AES_TS_PACKET_SIZE;
+
+  out_data = g_byte_array_sized_new (size);
+  if (size > 0) {
+    const guint8 *data = gst_adapter_map (r->adapter, size);
+
+    for (i = 0; ret && i < size; i += SAMPLE_AES_TS_PACKET_SIZE)
+      ret = sample_aes_handle_packet (r, data + i);
+
+    gst_adapter_unmap (r->adapter);
+    gst_adapter_flush (r->adapter, size);
+  }
+
+  if (ret && at_eos) {
+    for (i = 0; ret && i < r->n_streams; i++)
+      ret = sample_aes_finish_pes (r, &r->streams[i]);
+    gst_adapter_clear (r->adapter);
+  }
+
+  if (ret)
+    sample_aes_release_packets (r, out_data);
+
+  if (!ret || out_data->len == 0) {
+    g_byte_array_unref (out_data);
+    return ret;
+  }
+
+  len = out_data->len;
+  *out = gst_buffer_new_wrapped (g_byte_array_free (out_data, FALSE), len);
+  return TRUE;
+}
@@ -81,6 +81,8 @@ static gboolean
 gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
     const guint8 * key_data, const guint8 * iv_data);
 static void gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream);
+static gboolean gst_hls_demux_stream_decrypt_sample (guint8 * data,
+    gsize length, gpointer user_data);
 
 static gboolean gst_hls_demux_is_live (GstAdaptiveDemux * demux);
 static GstClockTime gst_hls_demux_get_duration (GstAdaptiveDemux * demux);
@@ -107,6 +109,8 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint offset, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
@@ -174,6 +178,8 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment =
+      gst_hls_demux_stream_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
@@ -257,6 +263,7 @@ gst_hls_demux_stream_clear_pending_data (GstHLSDemuxStream * hls_stream)
   gst_buffer_replace (&hls_stream->pending_decrypted_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_typefind_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_pcr_buffer, NULL);
+  gst_hlsdemux_sample_aes_reader_reset (&hls_stream->sample_aes_reader);
   hls_stream->current_offset = -1;
   gst_hls_demux_stream_decrypt_end (hls_stream);
 }
@@ -505,6 +512,9 @@ create_stream_for_playlist (GstAdaptiveDemux * demux, GstM3U8 * playlist,
 
   hlsdemux_stream->do_typefind = TRUE;
   hlsdemux_stream->reset_pts = TRUE;
+
+  gst_hlsdemux_sample_aes_reader_init (&hlsdemux_stream->sample_aes_reader,
+      gst_hls_demux_stream_decrypt_sample, hlsdemux_stream);
 }
 
 static gboolean
@@ -900,10 +910,22 @@ gst_hls_demux_finish_fragment (GstAdaptiveDemux * demux,
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);   // FIXME: pass HlsStream into function
   GstFlowReturn ret = GST_FLOW_OK;
 
-  if (hls_stream->current_key)
-    gst_hls_demux_stream_decrypt_end (hls_stream);
-
   if (stream->last_ret == GST_FLOW_OK) {
+    if (hls_stream->current_key
+        && hls_stream->current_key_method == GST_M3U8_KEY_METHOD_SAMPLE_AES) {
+      GstBuffer *buf;
+
+      /* Flush the PES packets that were still being collected */
+      if (gst_hlsdemux_sample_aes_reader_push (&hls_stream->sample_aes_reader,
+              NULL, TRUE, &buf)) {
+        ret = gst_hls_demux_handle_buffer (demux, stream, buf, TRUE);
+      } else {
+        GST_ELEMENT_ERROR (demux, STREAM, DECODE,
+            ("Failed to decrypt buffer"), ("SAMPLE-AES decryption failed"));
+        ret = GST_FLOW_ERROR;
+      }
+    }
+
     if (hls_stream->pending_decrypted_buffer) {
       if (hls_stream->current_key) {
         GstMapInfo info;
@@ -947,6 +969,9 @@ gst_hls_demux_finish_fragment (GstAdaptiveDemux * demux,
     }
   }
 
+  if (hls_stream->current_key)
+    gst_hls_demux_stream_decrypt_end (hls_stream);
+
   gst_hls_demux_stream_clear_pending_data (hls_stream);
 
   if (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED)
@@ -966,7 +991,15 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
     hls_stream->current_offset = 0;
 
   /* Is it encrypted? */
-  if (hls_stream->current_key) {
+  if (hls_stream->current_key
+      && hls_stream->current_key_method == GST_M3U8_KEY_METHOD_SAMPLE_AES) {
+    if (!gst_hlsdemux_sample_aes_reader_push (&hls_stream->sample_aes_reader,
+            buffer, FALSE, &buffer)) {
+      GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Failed to decrypt buffer"),
+          ("SAMPLE-AES decryption failed"));
+      return GST_FLOW_ERROR;
+    }
+  } else if (hls_stream->current_key) {
     GError *err = NULL;
     gsize size;
     GstBuffer *tmp_buffer;
@@ -1018,6 +1051,7 @@ gst_hls_demux_stream_free (GstAdaptiveDemuxStream * stream)
   gst_buffer_replace (&hls_stream->pending_decrypted_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_typefind_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_pcr_buffer, NULL);
+  gst_hlsdemux_sample_aes_reader_clear (&hls_stream->sample_aes_reader);
 
   if (hls_stream->current_key) {
     g_free (hls_stream->current_key);
@@ -1100,6 +1134,7 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
 
   g_free (hlsdemux_stream->current_key);
   hlsdemux_stream->current_key = g_strdup (file->key);
+  hlsdemux_stream->current_key_method = file->key_method;
   g_free (hlsdemux_stream->current_iv);
   hlsdemux_stream->current_iv = g_memdup (file->iv, sizeof (file->iv));
 
@@ -1124,6 +1159,34 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream,
+    guint offset, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstHLSDemuxStream *hlsdemux_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (hlsdemux_stream);
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0,
+      offset);
+  if (file == NULL)
+    return FALSE;
+
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1669,6 +1732,21 @@ gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
   return TRUE;
 }
 
+static gboolean
+gst_hls_demux_stream_decrypt_set_iv (GstHLSDemuxStream * stream,
+    const guint8 * iv_data)
+{
+  EVP_CIPHER_CTX *ctx;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  ctx = &stream->aes_ctx;
+#else
+  ctx = stream->aes_ctx;
+#endif
+
+  return EVP_DecryptInit_ex (ctx, NULL, NULL, NULL, iv_data);
+}
+
 static gboolean
 decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
     const guint8 * encrypted_data, guint8 * decrypted_data)
@@ -1715,6 +1793,15 @@ gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
   return TRUE;
 }
 
+static gboolean
+gst_hls_demux_stream_decrypt_set_iv (GstHLSDemuxStream * stream,
+    const guint8 * iv_data)
+{
+  CBC_SET_IV (&stream->aes_ctx, iv_data);
+
+  return TRUE;
+}
+
 static gboolean
 decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
     const guint8 * encrypted_data, guint8 * decrypted_data)
@@ -1762,14 +1849,25 @@ out:
   return ret;
 }
 
+static gboolean
+gst_hls_demux_stream_decrypt_set_iv (GstHLSDemuxStream * stream,
+    const guint8 * iv_data)
+{
+  return gcry_cipher_setiv (stream->aes_ctx, iv_data, 16) == 0;
+}
+
 static gboolean
 decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
     const guint8 * encrypted_data, guint8 * decrypted_data)
 {
   gcry_error_t err = 0;
 
-  err = gcry_cipher_decrypt (stream->aes_ctx, decrypted_data, length,
-      encrypted_data, length);
+  if (encrypted_data == decrypted_data)
+    err = gcry_cipher_decrypt (stream->aes_ctx, decrypted_data, length, NULL,
+        0);
+  else
+    err = gcry_cipher_decrypt (stream->aes_ctx, decrypted_data, length,
+        encrypted_data, length);
 
   return err == 0;
 }
@@ -1784,42 +1882,56 @@ gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
 }
 #endif
 
+static gboolean
+gst_hls_demux_stream_decrypt_sample (guint8 * data, gsize length,
+    gpointer user_data)
+{
+  GstHLSDemuxStream *stream = user_data;
+
+  /* every SAMPLE-AES NAL unit or audio frame starts from the segment IV */
+  if (!gst_hls_demux_stream_decrypt_set_iv (stream, stream->current_iv))
+    return FALSE;
+
+  return decrypt_fragment (stream, length, data, data);
+}
+
 static GstBuffer *
 gst_hls_demux_decrypt_fragment (GstHLSDemux * demux, GstHLSDemuxStream * stream,
     GstBuffer * encrypted_buffer, GError ** err)
 {
-  GstBuffer *decrypted_buffer = NULL;
-  GstMapInfo encrypted_info, decrypted_info;
+  GstBuffer *buffer;
+  GstMapInfo info;
 
-  decrypted_buffer =
-      gst_buffer_new_allocate (NULL, gst_buffer_get_size (encrypted_buffer),
-      NULL);
+  /* Decrypt in place, mapping for writing only copies the data if its
+   * memory is shared */
+  buffer = gst_buffer_make_writable (encrypted_buffer);
 
-  gst_buffer_map (encrypted_buffer, &encrypted_info, GST_MAP_READ);
-  gst_buffer_map (decrypted_buffer, &decrypted_info, GST_MAP_WRITE);
+  if (!gst_buffer_map (buffer, &info, GST_MAP_READWRITE))
+    goto map_error;
 
-  if (!decrypt_fragment (stream, encrypted_info.size,
-          encrypted_info.data, decrypted_info.data))
+  if (!decrypt_fragment (stream, info.size, info.data, info.data))
     goto decrypt_error;
 
+  gst_buffer_unmap (buffer, &info);
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
+  return buffer;
 
-  gst_buffer_unref (encrypted_buffer);
+map_error:
+  GST_ERROR_OBJECT (demux, "Failed to map fragment");
+  g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
+      "Failed to map fragment");
+
+  gst_buffer_unref (buffer);
 
-  return decrypted_buffer;
+  return NULL;
 
 decrypt_error:
   GST_ERROR_OBJECT (demux, "Failed to decrypt fragment");
   g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
       "Failed to decrypt fragment");
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-  gst_buffer_unref (decrypted_buffer);
+  gst_buffer_unmap (buffer, &info);
+  gst_buffer_unref (buffer);
 
   return NULL;
 }
@@ -59,6 +59,7 @@ typedef struct _GstHLSDemux GstHLSDemux;
 typedef struct _GstHLSDemuxClass GstHLSDemuxClass;
 typedef struct _GstHLSDemuxStream GstHLSDemuxStream;
 typedef struct _GstHLSTSReader GstHLSTSReader;
+typedef struct _GstHLSSampleAesReader GstHLSSampleAesReader;
 
 #define GST_HLS_DEMUX_STREAM_CAST(stream) ((GstHLSDemuxStream *)(stream))
 
@@ -81,6 +82,47 @@ struct _GstHLSTSReader
   GstClockTime first_pcr;
 };
 
+/* Decrypts @length bytes (a multiple of 16) in place, starting a new CBC
+ * chain from the segment IV */
+typedef gboolean (*GstHLSSampleAesDecryptFunc) (guint8 * data, gsize length,
+    gpointer user_data);
+
+typedef enum {
+  GST_HLS_SAMPLE_AES_H264,
+  GST_HLS_SAMPLE_AES_AAC,
+  GST_HLS_SAMPLE_AES_AC3        /* AC-3 and E-AC-3 */
+} GstHLSSampleAesCodec;
+
+#define GST_HLS_SAMPLE_AES_MAX_STREAMS 8
+
+typedef struct {
+  gint pid;
+  GstHLSSampleAesCodec codec;
+  gint cc;                      /* next output CC, -1 if unset */
+  GByteArray *packets;          /* TS packets of the PES being collected */
+  GArray *slots;                /* their guint64 indices in the held packets */
+} GstHLSSampleAesStream;
+
+struct _GstHLSSampleAesReader
+{
+  GstHLSSampleAesDecryptFunc decrypt;
+  gpointer user_data;
+
+  GstAdapter *adapter;          /* incomplete TS packets */
+  gint pmt_pid;
+
+  GstHLSSampleAesStream streams[GST_HLS_SAMPLE_AES_MAX_STREAMS];
+  guint n_streams;
+
+  /* Packets from the first one of a PES still being collected onwards, kept
+   * in input order until that PES is decrypted */
+  GByteArray *held;
+  guint64 held_base;            /* index of the first held packet */
+
+  GByteArray *pes;              /* scratch for PES reassembly */
+  GByteArray *blocks;           /* scratch for gathering encrypted blocks */
+};
+
 struct _GstHLSDemuxStream
 {
   GstAdaptiveDemuxStream adaptive_demux_stream;
@@ -113,8 +155,12 @@ struct _GstHLSDemuxStream
 #endif
 
   gchar     *current_key;
+  GstM3U8KeyMethod current_key_method;
   guint8    *current_iv;
 
+  /* SAMPLE-AES decryption of MPEG-TS segments */
+  GstHLSSampleAesReader sample_aes_reader;
+
   /* Accumulator for reading PAT/PMT/PCR from
    * the stream so we can set timestamps/segments
    * and switch cleanly */
@@ -161,6 +207,14 @@ void gst_hlsdemux_tsreader_set_type (GstHLSTSReader *r, GstHLSTSReaderType rtype
 gboolean gst_hlsdemux_tsreader_find_pcrs (GstHLSTSReader *r, GstBuffer **buffer,
     GstClockTime *first_pcr, GstClockTime *last_pcr, GstTagList **tags);
 
+void gst_hlsdemux_sample_aes_reader_init (GstHLSSampleAesReader *r,
+    GstHLSSampleAesDecryptFunc decrypt, gpointer user_data);
+void gst_hlsdemux_sample_aes_reader_reset (GstHLSSampleAesReader *r);
+void gst_hlsdemux_sample_aes_reader_clear (GstHLSSampleAesReader *r);
+
+gboolean gst_hlsdemux_sample_aes_reader_push (GstHLSSampleAesReader *r,
+    GstBuffer *buffer, gboolean at_eos, GstBuffer **out);
+
 GType gst_hls_demux_get_type (void);
 
 G_END_DECLS
@@ -452,6 +452,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   gchar *title, *end;
   gboolean discontinuity = FALSE;
   gchar *current_key = NULL;
+  GstM3U8KeyMethod current_key_method = GST_M3U8_KEY_METHOD_NONE;
   gboolean have_iv = FALSE;
   guint8 iv[16] = { 0, };
   gint64 size = -1, offset = -1;
@@ -527,6 +528,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         /* set encryption params */
         file->key = current_key ? g_strdup (current_key) : NULL;
         if (file->key) {
+          file->key_method = current_key_method;
           if (have_iv) {
             memcpy (file->iv, iv, sizeof (iv));
           } else {
@@ -622,6 +624,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         have_iv = FALSE;
         g_free (current_key);
         current_key = NULL;
+        current_key_method = GST_M3U8_KEY_METHOD_AES_128;
         while (data && parse_attributes (&data, &a, &v)) {
           if (g_str_equal (a, "URI")) {
             current_key =
@@ -657,7 +660,11 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
             }
             have_iv = TRUE;
           } else if (g_str_equal (a, "METHOD")) {
-            if (!g_str_equal (v, "AES-128")) {
+            if (g_str_equal (v, "NONE")) {
+              current_key_method = GST_M3U8_KEY_METHOD_NONE;
+            } else if (g_str_equal (v, "SAMPLE-AES")) {
+              current_key_method = GST_M3U8_KEY_METHOD_SAMPLE_AES;
+            } else if (!g_str_equal (v, "AES-128")) {
               GST_WARNING ("Encryption method %s not supported", v);
               continue;
             }
@@ -902,6 +909,37 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   return have_next;
 }
 
+/* Returns the fragment @offset positions after the current one, without
+ * changing the current position */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint offset)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *cur;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->current_file) {
+    cur = m3u8->current_file;
+  } else {
+    cur = m3u8_find_next_fragment (m3u8, forward);
+  }
+
+  while (cur && offset > 0) {
+    cur = forward ? cur->next : cur->prev;
+    offset--;
+  }
+
+  if (cur)
+    file = gst_m3u8_media_file_ref (cur->data);
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 /* call with M3U8_LOCK held */
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
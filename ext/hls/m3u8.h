@@ -88,6 +88,13 @@ GstM3U8 *          gst_m3u8_ref   (GstM3U8 * m3u8);
 void               gst_m3u8_unref (GstM3U8 * m3u8);
 
 
+typedef enum
+{
+  GST_M3U8_KEY_METHOD_NONE,
+  GST_M3U8_KEY_METHOD_AES_128,
+  GST_M3U8_KEY_METHOD_SAMPLE_AES
+} GstM3U8KeyMethod;
+
 struct _GstM3U8MediaFile
 {
   gchar *title;
@@ -96,6 +103,7 @@ struct _GstM3U8MediaFile
   gint64 sequence;               /* the sequence nb of this file */
   gboolean discont;             /* this file marks a discontinuity */
   gchar *key;
+  GstM3U8KeyMethod key_method;  /* only meaningful if key is set */
   guint8 iv[16];
   gint64 offset, size;
   gint ref_count;               /* ATOMIC */
@@ -123,6 +131,10 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  gboolean  forward,
+                                                  guint     offset);
+
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
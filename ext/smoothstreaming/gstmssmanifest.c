@@ -1034,24 +1034,16 @@ gst_mss_stream_get_caps (GstMssStream * stream)
   return caps;
 }
 
-GstFlowReturn
-gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+static GstFlowReturn
+gst_mss_stream_build_fragment_url (GstMssStream * stream,
+    GstMssStreamFragment * fragment, guint repetition_index, gchar ** url)
 {
   gchar *tmp;
   gchar *start_time_str;
   guint64 time;
-  GstMssStreamFragment *fragment;
   GstMssStreamQuality *quality = stream->current_quality->data;
 
-  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
-
-  if (stream->current_fragment == NULL) /* stream is over */
-    return GST_FLOW_EOS;
-
-  fragment = stream->current_fragment->data;
-
-  time =
-      fragment->time + fragment->duration * stream->fragment_repetition_index;
+  time = fragment->time + fragment->duration * repetition_index;
   start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
 
   tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
@@ -1068,6 +1060,49 @@ gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
   return GST_FLOW_OK;
 }
 
+GstFlowReturn
+gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+{
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  if (stream->current_fragment == NULL) /* stream is over */
+    return GST_FLOW_EOS;
+
+  return gst_mss_stream_build_fragment_url (stream,
+      stream->current_fragment->data, stream->fragment_repetition_index, url);
+}
+
+/* Gets the url of the fragment @offset positions after the current one,
+ * without changing the current position */
+GstFlowReturn
+gst_mss_stream_peek_fragment_url (GstMssStream * stream, guint offset,
+    gchar ** url)
+{
+  GList *iter;
+  GstMssStreamFragment *fragment;
+  guint repetition_index;
+
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  iter = stream->current_fragment;
+  repetition_index = stream->fragment_repetition_index;
+  while (iter && offset > 0) {
+    fragment = iter->data;
+    repetition_index++;
+    if (repetition_index >= fragment->repetitions) {
+      repetition_index = 0;
+      iter = g_list_next (iter);
+    }
+    offset--;
+  }
+
+  if (iter == NULL)
+    return GST_FLOW_EOS;
+
+  return gst_mss_stream_build_fragment_url (stream, iter->data,
+      repetition_index, url);
+}
+
 GstClockTime
 gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream)
 {
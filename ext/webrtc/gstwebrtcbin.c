@@ -352,6 +352,9 @@ enum
   PROP_STUN_SERVER,
   PROP_TURN_SERVER,
   PROP_BUNDLE_POLICY,
+  PROP_PC_THREAD_POOL_SIZE,
+  PROP_PC_WORKER_STATS,
+  PROP_STATS_CACHE_TIME,
 };
 
 static guint gst_webrtc_bin_signals[LAST_SIGNAL] = { 0 };
@@ -687,49 +690,173 @@ match_for_pad (GstWebRTCBinPad * pad, GstWebRTCBinPad * other)
 }
 #endif
 
+/* Workers shared between all webrtcbins with a non-zero pc-thread-pool-size.
+ * A webrtcbin sticks to the same worker from READY to NULL so its tasks are
+ * still executed in order. The pool has a single bound, taken from the
+ * webrtcbin creating its first worker and kept until the last one is
+ * gone */
+static GMutex pc_workers_lock;
+static GPtrArray *pc_workers;
+static guint pc_workers_max;
+
+static gpointer
+_gst_pc_thread (GstWebRTCBinWorker * worker)
+{
+  /* Having the thread be the thread default GMainContext will break the
+   * required queue-like ordering (from W3's peerconnection spec) of re-entrant
+   * tasks */
+  g_main_loop_run (worker->loop);
+
+  return NULL;
+}
+
+static GstWebRTCBinWorker *
+_pc_worker_new (void)
+{
+  GstWebRTCBinWorker *worker = g_new0 (GstWebRTCBinWorker, 1);
+
+  g_mutex_init (&worker->stats_lock);
+  worker->main_context = g_main_context_new ();
+  worker->loop = g_main_loop_new (worker->main_context, FALSE);
+  worker->thread = g_thread_new ("gst-pc-ops",
+      (GThreadFunc) _gst_pc_thread, worker);
+
+  return worker;
+}
+
 static gboolean
-_unlock_pc_thread (GMutex * lock)
+_quit_pc_worker (GMainLoop * loop)
 {
-  g_mutex_unlock (lock);
+  g_main_loop_quit (loop);
   return G_SOURCE_REMOVE;
 }
 
-static gpointer
-_gst_pc_thread (GstWebRTCBin * webrtc)
+static void
+_pc_worker_free (GstWebRTCBinWorker * worker)
 {
-  PC_LOCK (webrtc);
-  webrtc->priv->main_context = g_main_context_new ();
-  webrtc->priv->loop = g_main_loop_new (webrtc->priv->main_context, FALSE);
+  GSource *source;
 
-  PC_COND_BROADCAST (webrtc);
-  g_main_context_invoke (webrtc->priv->main_context,
-      (GSourceFunc) _unlock_pc_thread, PC_GET_LOCK (webrtc));
+  /* The loop might not be running yet, quit from inside of it */
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_set_callback (source, (GSourceFunc) _quit_pc_worker, worker->loop,
+      NULL);
+  g_source_attach (source, worker->main_context);
+  g_source_unref (source);
 
-  /* Having the thread be the thread default GMainContext will break the
-   * required queue-like ordering (from W3's peerconnection spec) of re-entrant
-   * tasks */
-  g_main_loop_run (webrtc->priv->loop);
+  g_thread_join (worker->thread);
 
-  PC_LOCK (webrtc);
-  g_main_context_unref (webrtc->priv->main_context);
-  webrtc->priv->main_context = NULL;
-  g_main_loop_unref (webrtc->priv->loop);
-  webrtc->priv->loop = NULL;
-  PC_COND_BROADCAST (webrtc);
-  PC_UNLOCK (webrtc);
+  GST_DEBUG ("pc worker %p executed %" G_GUINT64_FORMAT " tasks, max latency %"
+      G_GINT64_FORMAT " us, average latency %" G_GINT64_FORMAT " us", worker,
+      worker->n_tasks, worker->max_latency,
+      worker->n_tasks ? (gint64) (worker->total_latency / worker->n_tasks) : 0);
 
-  return NULL;
+  /* Destroys the tasks that never got to run */
+  g_main_loop_unref (worker->loop);
+  g_main_context_unref (worker->main_context);
+  g_mutex_clear (&worker->stats_lock);
+  g_free (worker);
+}
+
+/* With @pool_size 0 the worker is private to the caller. Otherwise a new
+ * shared worker is created while the pool is below its bound, and the least
+ * used one is picked after that. */
+static GstWebRTCBinWorker *
+_pc_worker_acquire (guint pool_size)
+{
+  GstWebRTCBinWorker *worker = NULL;
+  guint i;
+
+  if (pool_size == 0) {
+    worker = _pc_worker_new ();
+    worker->n_users = 1;
+    return worker;
+  }
+
+  g_mutex_lock (&pc_workers_lock);
+  if (!pc_workers)
+    pc_workers = g_ptr_array_new ();
+
+  if (pc_workers->len == 0) {
+    pc_workers_max = pool_size;
+  } else if (pool_size != pc_workers_max) {
+    GST_WARNING ("pc-thread-pool-size %u ignored, the running pool has a "
+        "size of %u", pool_size, pc_workers_max);
+  }
+
+  if (pc_workers->len < pc_workers_max) {
+    worker = _pc_worker_new ();
+    worker->shared = TRUE;
+    g_ptr_array_add (pc_workers, worker);
+  } else {
+    for (i = 0; i < pc_workers->len; i++) {
+      GstWebRTCBinWorker *w = g_ptr_array_index (pc_workers, i);
+
+      if (!worker || w->n_users < worker->n_users)
+        worker = w;
+    }
+  }
+  worker->n_users++;
+
+  GST_DEBUG ("using shared pc worker %p, %u users, %u workers", worker,
+      worker->n_users, pc_workers->len);
+  g_mutex_unlock (&pc_workers_lock);
+
+  return worker;
+}
+
+static void
+_pc_worker_release (GstWebRTCBinWorker * worker)
+{
+  if (worker->shared) {
+    g_mutex_lock (&pc_workers_lock);
+    if (--worker->n_users > 0) {
+      g_mutex_unlock (&pc_workers_lock);
+      return;
+    }
+    g_ptr_array_remove (pc_workers, worker);
+    g_mutex_unlock (&pc_workers_lock);
+  }
+
+  _pc_worker_free (worker);
+}
+
+static GstStructure *
+_pc_worker_get_stats (GstWebRTCBinWorker * worker)
+{
+  GstStructure *s;
+  guint64 avg_latency;
+  gboolean shared;
+  guint n_users;
+
+  g_mutex_lock (&pc_workers_lock);
+  shared = worker->shared;
+  n_users = worker->n_users;
+  g_mutex_unlock (&pc_workers_lock);
+
+  g_mutex_lock (&worker->stats_lock);
+  avg_latency = worker->n_tasks ? worker->total_latency / worker->n_tasks : 0;
+  s = gst_structure_new ("pc-worker-stats",
+      "shared", G_TYPE_BOOLEAN, shared,
+      "users", G_TYPE_UINT, n_users,
+      "queued", G_TYPE_UINT, (guint) g_atomic_int_get (&worker->n_queued),
+      "max-queued", G_TYPE_UINT, worker->max_queued,
+      "tasks", G_TYPE_UINT64, worker->n_tasks,
+      "average-latency", G_TYPE_UINT64, avg_latency * GST_USECOND,
+      "max-latency", G_TYPE_UINT64,
+      (guint64) worker->max_latency * GST_USECOND, NULL);
+  g_mutex_unlock (&worker->stats_lock);
+
+  return s;
 }
 
 static void
 _start_thread (GstWebRTCBin * webrtc)
 {
   PC_LOCK (webrtc);
-  webrtc->priv->thread = g_thread_new ("gst-pc-ops",
-      (GThreadFunc) _gst_pc_thread, webrtc);
-
-  while (!webrtc->priv->loop)
-    PC_COND_WAIT (webrtc);
+  webrtc->priv->worker =
+      _pc_worker_acquire (webrtc->priv->pc_thread_pool_size);
+  webrtc->priv->worker_generation++;
   webrtc->priv->is_closed = FALSE;
   PC_UNLOCK (webrtc);
 }
@@ -737,25 +864,47 @@ _start_thread (GstWebRTCBin * webrtc)
 static void
 _stop_thread (GstWebRTCBin * webrtc)
 {
+  GstWebRTCBinWorker *worker;
+
   PC_LOCK (webrtc);
   webrtc->priv->is_closed = TRUE;
-  g_main_loop_quit (webrtc->priv->loop);
-  while (webrtc->priv->loop)
-    PC_COND_WAIT (webrtc);
+  worker = webrtc->priv->worker;
+  webrtc->priv->worker = NULL;
   PC_UNLOCK (webrtc);
 
-  g_thread_unref (webrtc->priv->thread);
+  /* Our pending tasks on a shared worker are skipped as we're closed, or
+   * as they belong to an older generation once we're started again */
+  _pc_worker_release (worker);
 }
 
 static gboolean
 _execute_op (GstWebRTCBinTask * op)
 {
+  GstWebRTCBinWorker *worker = op->worker;
+  gint64 latency;
+
+  latency = g_get_monotonic_time () - op->enqueue_time;
+  g_mutex_lock (&worker->stats_lock);
+  worker->n_tasks++;
+  worker->total_latency += latency;
+  worker->max_latency = MAX (worker->max_latency, latency);
+  g_mutex_unlock (&worker->stats_lock);
+
+  GST_LOG_OBJECT (op->webrtc, "executing task after %" G_GINT64_FORMAT
+      " us, %d tasks queued", latency, g_atomic_int_get (&worker->n_queued));
+
   PC_LOCK (op->webrtc);
   if (op->webrtc->priv->is_closed) {
     GST_DEBUG_OBJECT (op->webrtc,
         "Peerconnection is closed, aborting execution");
     goto out;
   }
+  if (op->worker != op->webrtc->priv->worker
+      || op->worker_generation != op->webrtc->priv->worker_generation) {
+    GST_DEBUG_OBJECT (op->webrtc,
+        "Task was queued before the peerconnection was restarted, dropping");
+    goto out;
+  }
 
   op->op (op->webrtc, op->data);
 
@@ -767,8 +916,10 @@ out:
 static void
 _free_op (GstWebRTCBinTask * op)
 {
+  g_atomic_int_add (&op->worker->n_queued, -1);
   if (op->notify)
     op->notify (op->data);
+  gst_object_unref (op->webrtc);
   g_free (op);
 }
 
@@ -777,27 +928,40 @@ gst_webrtc_bin_enqueue_task (GstWebRTCBin * webrtc, GstWebRTCBinFunc func,
     gpointer data, GDestroyNotify notify)
 {
   GstWebRTCBinTask *op;
+  GstWebRTCBinWorker *worker;
   GSource *source;
+  gint queued;
 
   g_return_if_fail (GST_IS_WEBRTC_BIN (webrtc));
 
-  if (webrtc->priv->is_closed) {
+  worker = webrtc->priv->worker;
+  if (webrtc->priv->is_closed || !worker) {
     GST_DEBUG_OBJECT (webrtc, "Peerconnection is closed, aborting execution");
     if (notify)
       notify (data);
     return;
   }
   op = g_new0 (GstWebRTCBinTask, 1);
-  op->webrtc = webrtc;
+  /* a shared worker may run the task after we've been stopped */
+  op->webrtc = gst_object_ref (webrtc);
   op->op = func;
   op->data = data;
   op->notify = notify;
+  op->worker = worker;
+  op->worker_generation = webrtc->priv->worker_generation;
+  op->enqueue_time = g_get_monotonic_time ();
+
+  queued = g_atomic_int_add (&worker->n_queued, 1) + 1;
+  GST_TRACE_OBJECT (webrtc, "enqueued task, %d tasks queued", queued);
+  g_mutex_lock (&worker->stats_lock);
+  worker->max_queued = MAX (worker->max_queued, queued);
+  g_mutex_unlock (&worker->stats_lock);
 
   source = g_idle_source_new ();
   g_source_set_priority (source, G_PRIORITY_DEFAULT);
   g_source_set_callback (source, (GSourceFunc) _execute_op, op,
       (GDestroyNotify) _free_op);
-  g_source_attach (source, webrtc->priv->main_context);
+  g_source_attach (source, worker->main_context);
   g_source_unref (source);
 }
 
@@ -4100,10 +4264,16 @@ _on_ice_candidate (GstWebRTCICE * ice, guint session_id,
 static GstStructure *
 _get_stats_from_selector (GstWebRTCBin * webrtc, gpointer selector)
 {
+  GstStructure *s;
+
   if (selector)
     GST_FIXME_OBJECT (webrtc, "Implement stats selection");
 
-  return gst_structure_copy (webrtc->priv->stats);
+  GST_OBJECT_LOCK (webrtc);
+  s = gst_structure_copy (webrtc->priv->stats);
+  GST_OBJECT_UNLOCK (webrtc);
+
+  return s;
 }
 
 struct get_stats
@@ -4152,10 +4322,29 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
     GstPromise * promise)
 {
   struct get_stats *stats;
+  GstClockTime age;
+  GstStructure *s = NULL;
 
   g_return_if_fail (promise != NULL);
   g_return_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad));
 
+  /* Answer directly with recent enough stats instead of collecting them all
+   * again on the peerconnection thread */
+  GST_OBJECT_LOCK (webrtc);
+  if (webrtc->priv->stats && webrtc->priv->stats_cache_time > 0) {
+    age = (g_get_monotonic_time () - webrtc->priv->stats_updated) *
+        GST_USECOND;
+    if (age < webrtc->priv->stats_cache_time)
+      s = gst_structure_copy (webrtc->priv->stats);
+  }
+  GST_OBJECT_UNLOCK (webrtc);
+
+  if (s) {
+    GST_LOG_OBJECT (webrtc, "replying with cached stats");
+    gst_promise_reply (promise, s);
+    return;
+  }
+
   stats = g_new0 (struct get_stats, 1);
   stats->promise = gst_promise_ref (promise);
   /* FIXME: check that pad exists in element */
@@ -4920,6 +5109,16 @@ gst_webrtc_bin_set_property (GObject * object, guint prop_id,
         webrtc->bundle_policy = g_value_get_enum (value);
       }
       break;
+    case PROP_PC_THREAD_POOL_SIZE:
+      PC_LOCK (webrtc);
+      webrtc->priv->pc_thread_pool_size = g_value_get_uint (value);
+      PC_UNLOCK (webrtc);
+      break;
+    case PROP_STATS_CACHE_TIME:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->stats_cache_time = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4981,6 +5180,21 @@ gst_webrtc_bin_get_property (GObject * object, guint prop_id,
     case PROP_BUNDLE_POLICY:
       g_value_set_enum (value, webrtc->bundle_policy);
       break;
+    case PROP_PC_THREAD_POOL_SIZE:
+      g_value_set_uint (value, webrtc->priv->pc_thread_pool_size);
+      break;
+    case PROP_PC_WORKER_STATS:
+      if (webrtc->priv->worker)
+        g_value_take_boxed (value,
+            _pc_worker_get_stats (webrtc->priv->worker));
+      else
+        g_value_set_boxed (value, NULL);
+      break;
+    case PROP_STATS_CACHE_TIME:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_uint64 (value, webrtc->priv->stats_cache_time);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -5166,6 +5380,65 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
           GST_WEBRTC_BUNDLE_POLICY_NONE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebRTCBin:pc-thread-pool-size:
+   *
+   * By default every webrtcbin runs its peerconnection operations on its
+   * own thread. If set to a non-zero value, the operations are instead run
+   * on a pool of at most this many threads shared by all webrtcbins in the
+   * process, which avoids a mostly idle thread per peerconnection when many
+   * of them are used. The operations of a given webrtcbin are still executed
+   * in order. Only takes effect on the next change from NULL to READY.
+   *
+   * There is only one pool per process. Its size is the value of the
+   * webrtcbin that creates the first thread of the pool, and stays in effect
+   * until all webrtcbins using the pool are back in the NULL state. Different
+   * non-zero values set on other webrtcbins meanwhile are ignored.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_PC_THREAD_POOL_SIZE,
+      g_param_spec_uint ("pc-thread-pool-size", "PC Thread Pool Size",
+          "Size of the process-wide pool of threads to run peerconnection "
+          "operations on (0 = use a dedicated thread)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:pc-worker-stats:
+   *
+   * Statistics of the thread running the peerconnection operations, or
+   * %NULL in the NULL state. For a thread of the shared pool they cover the
+   * operations of all webrtcbins using it. The structure contains:
+   *
+   * "shared"           G_TYPE_BOOLEAN  whether the thread is from the pool
+   * "users"            G_TYPE_UINT     number of webrtcbins using the thread
+   * "queued"           G_TYPE_UINT     operations currently waiting or running
+   * "max-queued"       G_TYPE_UINT     highest number of queued operations
+   * "tasks"            G_TYPE_UINT64   number of operations executed
+   * "average-latency"  G_TYPE_UINT64   average time in nanoseconds between
+   *                                    queueing an operation and its start
+   * "max-latency"      G_TYPE_UINT64   highest such time in nanoseconds
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_PC_WORKER_STATS,
+      g_param_spec_boxed ("pc-worker-stats", "PC Worker Stats",
+          "Statistics of the thread running peerconnection operations",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:stats-cache-time:
+   *
+   * Maximum age of the statistics returned by #GstWebRTCBin::get-stats. If
+   * the last collected statistics are more recent, they are returned right
+   * away without walking all pads and transports again on the
+   * peerconnection thread. 0 always collects new statistics.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_STATS_CACHE_TIME,
+      g_param_spec_uint64 ("stats-cache-time", "Stats Cache Time",
+          "Maximum age in nanoseconds of statistics returned from cache "
+          "(0 = always collect)", 0, G_MAXUINT64, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCBin::create-offer:
    * @object: the #GstWebRtcBin
@@ -105,6 +105,29 @@ struct _GstWebRTCBinClass
   GstBinClass           parent_class;
 };
 
+/* A thread running peerconnection operations, possibly for several
+ * webrtcbins */
+typedef struct
+{
+  GMainContext *main_context;
+  GMainLoop *loop;
+  GThread *thread;
+
+  /* protected by the worker pool lock */
+  gboolean shared;
+  guint n_users;
+
+  /* tasks enqueued but not yet finished */
+  gint n_queued;
+
+  /* statistics, protected by the stats lock */
+  GMutex stats_lock;
+  guint max_queued;
+  guint64 n_tasks;
+  guint64 total_latency;
+  gint64 max_latency;
+} GstWebRTCBinWorker;
+
 struct _GstWebRTCBinPrivate
 {
   guint max_sink_pad_serial;
@@ -130,9 +153,11 @@ struct _GstWebRTCBinPrivate
   gboolean need_negotiation;
 
   /* peerconnection helper thread for promises */
-  GMainContext *main_context;
-  GMainLoop *loop;
-  GThread *thread;
+  GstWebRTCBinWorker *worker;
+  /* incremented for each worker acquired, tasks of an older one are
+   * dropped. Protected by pc_lock */
+  guint worker_generation;
+  guint pc_thread_pool_size;
   GMutex pc_lock;
   GCond pc_cond;
 
@@ -147,6 +172,10 @@ struct _GstWebRTCBinPrivate
   guint media_counter;
 
   GstStructure *stats;
+  /* monotonic time of the last stats update, protected by the object lock
+   * like stats and stats_cache_time */
+  gint64 stats_updated;
+  GstClockTime stats_cache_time;
 };
 
 typedef void (*GstWebRTCBinFunc) (GstWebRTCBin * webrtc, gpointer data);
@@ -157,6 +186,10 @@ typedef struct
   GstWebRTCBinFunc op;
   gpointer data;
   GDestroyNotify notify;
+  GstWebRTCBinWorker *worker;
+  guint worker_generation;
+  /* monotonic time, for latency instrumentation */
+  gint64 enqueue_time;
 //  GstPromise *promise;      /* FIXME */
 } GstWebRTCBinTask;
 
@@ -519,14 +519,13 @@ gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc)
 {
   GstStructure *s = gst_structure_new_empty ("application/x-webrtc-stats");
   double ts = monotonic_time_as_double_milliseconds ();
-  GstStructure *pc_stats;
+  GstStructure *pc_stats, *old;
 
   _init_debug ();
 
   gst_structure_set (s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
 
   /* FIXME: better unique IDs */
-  /* FIXME: rate limitting stat updates? */
   /* FIXME: all stats need to be kept forever */
 
   GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", ts);
@@ -543,7 +542,13 @@ gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc)
 
   gst_structure_remove_field (s, "timestamp");
 
-  if (webrtc->priv->stats)
-    gst_structure_free (webrtc->priv->stats);
+  /* get-stats may return the cached structure from any thread */
+  GST_OBJECT_LOCK (webrtc);
+  old = webrtc->priv->stats;
   webrtc->priv->stats = s;
+  webrtc->priv->stats_updated = g_get_monotonic_time ();
+  GST_OBJECT_UNLOCK (webrtc);
+
+  if (old)
+    gst_structure_free (old);
 }
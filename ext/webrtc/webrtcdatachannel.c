@@ -56,7 +56,10 @@ enum
   SIGNAL_ON_ERROR,
   SIGNAL_ON_MESSAGE_DATA,
   SIGNAL_ON_MESSAGE_STRING,
+  SIGNAL_ON_MESSAGE_DATA_BATCH,
+  SIGNAL_ON_MESSAGE_STRING_BATCH,
   SIGNAL_ON_BUFFERED_AMOUNT_LOW,
+  SIGNAL_ON_BUFFERED_AMOUNT_HIGH,
   SIGNAL_SEND_DATA,
   SIGNAL_SEND_STRING,
   SIGNAL_CLOSE,
@@ -77,6 +80,7 @@ enum
   PROP_READY_STATE,
   PROP_BUFFERED_AMOUNT,
   PROP_BUFFERED_AMOUNT_LOW_THRESHOLD,
+  PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD,
 };
 
 static guint gst_webrtc_data_channel_signals[LAST_SIGNAL] = { 0 };
@@ -260,10 +264,10 @@ _execute_task (GstWebRTCBin * webrtc, struct task *task)
 static void
 _free_task (struct task *task)
 {
-  gst_object_unref (task->channel);
-
   if (task->notify)
     task->notify (task->user_data);
+
+  gst_object_unref (task->channel);
   g_free (task);
 }
 
@@ -282,6 +286,33 @@ _channel_enqueue_task (GstWebRTCDataChannel * channel, ChannelTask func,
       (GstWebRTCBinFunc) _execute_task, task, (GDestroyNotify) _free_task);
 }
 
+static void
+_emit_high_threshold (GstWebRTCDataChannel * channel, gpointer user_data)
+{
+  GST_LOG_OBJECT (channel, "High threshold reached");
+  g_signal_emit (channel,
+      gst_webrtc_data_channel_signals[SIGNAL_ON_BUFFERED_AMOUNT_HIGH], 0);
+}
+
+/* Accounts for @buffer about to be pushed to the appsrc */
+static void
+_channel_add_buffered_amount (GstWebRTCDataChannel * channel,
+    GstBuffer * buffer)
+{
+  guint64 prev_amount;
+
+  GST_OBJECT_LOCK (channel);
+  prev_amount = channel->buffered_amount;
+  channel->buffered_amount += gst_buffer_get_size (buffer);
+  if (channel->buffered_amount_high_threshold > 0 &&
+      prev_amount <= channel->buffered_amount_high_threshold &&
+      channel->buffered_amount > channel->buffered_amount_high_threshold) {
+    _channel_enqueue_task (channel, (ChannelTask) _emit_high_threshold,
+        NULL, NULL);
+  }
+  GST_OBJECT_UNLOCK (channel);
+}
+
 static void
 _channel_store_error (GstWebRTCDataChannel * channel, GError * error)
 {
@@ -512,9 +543,7 @@ _parse_control_packet (GstWebRTCDataChannel * channel, guint8 * data,
     GST_INFO_OBJECT (channel, "Sending channel ack");
     buffer = construct_ack_packet (channel);
 
-    GST_OBJECT_LOCK (channel);
-    channel->buffered_amount += gst_buffer_get_size (buffer);
-    GST_OBJECT_UNLOCK (channel);
+    _channel_add_buffered_amount (channel, buffer);
 
     ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
     if (ret != GST_FLOW_OK) {
@@ -573,6 +602,175 @@ _emit_have_string (GstWebRTCDataChannel * channel, gchar * str)
       gst_webrtc_data_channel_signals[SIGNAL_ON_MESSAGE_STRING], 0, str);
 }
 
+/* A received message waiting to be emitted. For empty messages both data and
+ * str are NULL */
+struct message
+{
+  gboolean is_string;
+  GBytes *data;
+  gchar *str;
+};
+
+static void
+_free_message (struct message *msg)
+{
+  if (msg->data)
+    g_bytes_unref (msg->data);
+  g_free (msg->str);
+  g_free (msg);
+}
+
+/* The task emitting the pending messages of a channel */
+struct emit_task
+{
+  GstWebRTCDataChannel *channel;
+  gboolean emitted;
+};
+
+/* Emits the @n_messages messages starting at @messages, which are all
+ * strings or all binary, as one batch if anyone is interested */
+static void
+_emit_message_batch (GstWebRTCDataChannel * channel, gboolean is_string,
+    GList * messages, guint n_messages)
+{
+  guint signal_id;
+  GList *l;
+  guint i;
+
+  signal_id = is_string ?
+      gst_webrtc_data_channel_signals[SIGNAL_ON_MESSAGE_STRING_BATCH] :
+      gst_webrtc_data_channel_signals[SIGNAL_ON_MESSAGE_DATA_BATCH];
+  if (!g_signal_has_handler_pending (channel, signal_id, 0, FALSE))
+    return;
+
+  GST_LOG_OBJECT (channel, "Have a batch of %u %s messages", n_messages,
+      is_string ? "string" : "binary");
+
+  if (is_string) {
+    gchar **strv = g_new (gchar *, n_messages + 1);
+
+    for (i = 0, l = messages; i < n_messages; i++, l = l->next) {
+      struct message *msg = l->data;
+
+      strv[i] = msg->str ? msg->str : (gchar *) "";
+    }
+    strv[n_messages] = NULL;
+
+    g_signal_emit (channel, signal_id, 0, strv);
+    g_free (strv);
+  } else {
+    GPtrArray *array;
+
+    array = g_ptr_array_new_full (n_messages,
+        (GDestroyNotify) g_bytes_unref);
+    for (i = 0, l = messages; i < n_messages; i++, l = l->next) {
+      struct message *msg = l->data;
+
+      g_ptr_array_add (array,
+          msg->data ? g_bytes_ref (msg->data) : g_bytes_new (NULL, 0));
+    }
+
+    g_signal_emit (channel, signal_id, 0, array);
+    g_ptr_array_unref (array);
+  }
+}
+
+static void
+_emit_pending_messages (GstWebRTCDataChannel * channel,
+    struct emit_task *emit)
+{
+  GQueue messages;
+  GList *run, *l;
+
+  GST_OBJECT_LOCK (channel);
+  messages = channel->pending_messages;
+  g_queue_init (&channel->pending_messages);
+  channel->messages_scheduled = FALSE;
+  GST_OBJECT_UNLOCK (channel);
+  emit->emitted = TRUE;
+
+  GST_LOG_OBJECT (channel, "Emitting %u received messages", messages.length);
+
+  /* Consecutive messages of the same type go out as one batch, followed
+   * by each of them on its own */
+  run = messages.head;
+  while (run) {
+    gboolean is_string = ((struct message *) run->data)->is_string;
+    guint n_messages = 0;
+
+    for (l = run; l && ((struct message *) l->data)->is_string == is_string;
+        l = l->next)
+      n_messages++;
+
+    _emit_message_batch (channel, is_string, run, n_messages);
+
+    for (; run != l; run = run->next) {
+      struct message *msg = run->data;
+
+      if (msg->is_string)
+        _emit_have_string (channel, msg->str);
+      else
+        _emit_have_data (channel, msg->data);
+    }
+  }
+
+  g_queue_foreach (&messages, (GFunc) _free_message, NULL);
+  g_queue_clear (&messages);
+}
+
+/* Called whether or not the task ran. When it was dropped because the
+ * peerconnection is closed, the pending messages would never be emitted */
+static void
+_free_emit_task (struct emit_task *emit)
+{
+  GstWebRTCDataChannel *channel = emit->channel;
+  GQueue messages;
+
+  if (!emit->emitted) {
+    GST_OBJECT_LOCK (channel);
+    messages = channel->pending_messages;
+    g_queue_init (&channel->pending_messages);
+    channel->messages_scheduled = FALSE;
+    GST_OBJECT_UNLOCK (channel);
+
+    GST_DEBUG_OBJECT (channel, "Dropping %u received messages",
+        messages.length);
+    g_queue_foreach (&messages, (GFunc) _free_message, NULL);
+    g_queue_clear (&messages);
+  }
+
+  g_free (emit);
+}
+
+/* takes ownership of @data and @str */
+static void
+_channel_queue_message (GstWebRTCDataChannel * channel, gboolean is_string,
+    GBytes * data, gchar * str)
+{
+  struct message *msg = g_new0 (struct message, 1);
+  gboolean schedule;
+
+  msg->is_string = is_string;
+  msg->data = data;
+  msg->str = str;
+
+  GST_OBJECT_LOCK (channel);
+  schedule = !channel->messages_scheduled;
+  channel->messages_scheduled = TRUE;
+  g_queue_push_tail (&channel->pending_messages, msg);
+  GST_OBJECT_UNLOCK (channel);
+
+  /* Instead of a task per message, a single task emits all the messages
+   * received until it gets to run */
+  if (schedule) {
+    struct emit_task *emit = g_new0 (struct emit_task, 1);
+
+    emit->channel = channel;
+    _channel_enqueue_task (channel, (ChannelTask) _emit_pending_messages,
+        emit, (GDestroyNotify) _free_emit_task);
+  }
+}
+
 static GstFlowReturn
 _data_channel_have_sample (GstWebRTCDataChannel * channel, GstSample * sample,
     GError ** error)
@@ -622,8 +820,8 @@ _data_channel_have_sample (GstWebRTCDataChannel * channel, GstSample * sample,
         ret = GST_FLOW_ERROR;
       } else {
         gchar *str = g_strndup ((gchar *) info.data, info.size);
-        _channel_enqueue_task (channel, (ChannelTask) _emit_have_string, str,
-            g_free);
+        gst_buffer_unmap (buffer, &info);
+        _channel_queue_message (channel, TRUE, NULL, str);
       }
       break;
     }
@@ -639,18 +837,15 @@ _data_channel_have_sample (GstWebRTCDataChannel * channel, GstSample * sample,
         GBytes *data = g_bytes_new_with_free_func (info->map_info.data,
             info->map_info.size, (GDestroyNotify) buffer_unmap_and_unref, info);
         info->buffer = gst_buffer_ref (buffer);
-        _channel_enqueue_task (channel, (ChannelTask) _emit_have_data, data,
-            (GDestroyNotify) g_bytes_unref);
+        _channel_queue_message (channel, FALSE, data, NULL);
       }
       break;
     }
     case DATA_CHANNEL_PPID_WEBRTC_BINARY_EMPTY:
-      _channel_enqueue_task (channel, (ChannelTask) _emit_have_data, NULL,
-          NULL);
+      _channel_queue_message (channel, FALSE, NULL, NULL);
       break;
     case DATA_CHANNEL_PPID_WEBRTC_STRING_EMPTY:
-      _channel_enqueue_task (channel, (ChannelTask) _emit_have_string, NULL,
-          NULL);
+      _channel_queue_message (channel, TRUE, NULL, NULL);
       break;
     default:
       g_set_error (error, GST_WEBRTC_BIN_ERROR,
@@ -736,9 +931,7 @@ gst_webrtc_data_channel_start_negotiation (GstWebRTCDataChannel * channel)
       "label %s protocol %s ordered %s", channel->id, channel->label,
       channel->protocol, channel->ordered ? "true" : "false");
 
-  GST_OBJECT_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  GST_OBJECT_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, buffer);
 
   if (gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc),
           buffer) == GST_FLOW_OK) {
@@ -818,9 +1011,7 @@ gst_webrtc_data_channel_send_data (GstWebRTCDataChannel * channel,
   GST_LOG_OBJECT (channel, "Sending data using buffer %" GST_PTR_FORMAT,
       buffer);
 
-  GST_OBJECT_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  GST_OBJECT_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, buffer);
 
   ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
 
@@ -878,9 +1069,7 @@ gst_webrtc_data_channel_send_string (GstWebRTCDataChannel * channel,
   GST_TRACE_OBJECT (channel, "Sending string using buffer %" GST_PTR_FORMAT,
       buffer);
 
-  GST_OBJECT_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  GST_OBJECT_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, buffer);
 
   ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
 
@@ -974,6 +1163,9 @@ gst_webrtc_data_channel_set_property (GObject * object, guint prop_id,
     case PROP_BUFFERED_AMOUNT_LOW_THRESHOLD:
       channel->buffered_amount_low_threshold = g_value_get_uint64 (value);
       break;
+    case PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD:
+      channel->buffered_amount_high_threshold = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1022,6 +1214,9 @@ gst_webrtc_data_channel_get_property (GObject * object, guint prop_id,
     case PROP_BUFFERED_AMOUNT_LOW_THRESHOLD:
       g_value_set_uint64 (value, channel->buffered_amount_low_threshold);
       break;
+    case PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD:
+      g_value_set_uint64 (value, channel->buffered_amount_high_threshold);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1125,6 +1320,9 @@ gst_webrtc_data_channel_finalize (GObject * object)
   g_clear_object (&channel->appsrc);
   g_clear_object (&channel->appsink);
 
+  g_queue_foreach (&channel->pending_messages, (GFunc) _free_message, NULL);
+  g_queue_clear (&channel->pending_messages);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1224,6 +1422,23 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
           "the buffered-amount-low signal is emitted",
           0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebRTCDataChannel:buffered-amount-high-threshold:
+   *
+   * When data sent makes the buffered amount go above this threshold, the
+   * #GstWebRTCDataChannel::on-buffered-amount-high signal is emitted. Senders
+   * can then hold back until #GstWebRTCDataChannel::on-buffered-amount-low
+   * instead of polling #GstWebRTCDataChannel:buffered-amount. 0 disables the
+   * signal.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD,
+      g_param_spec_uint64 ("buffered-amount-high-threshold",
+          "Buffered Amount High Threshold",
+          "The threshold above which the buffered amount is considered high "
+          "and the buffered-amount-high signal is emitted (0 = disabled)",
+          0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCDataChannel::on-open:
    * @object: the #GstWebRTCDataChannel
@@ -1272,6 +1487,36 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
       G_TYPE_NONE, 1, G_TYPE_STRING);
 
+  /**
+   * GstWebRTCDataChannel::on-message-data-batch:
+   * @object: the #GstWebRTCDataChannel
+   * @data: (element-type GBytes): a #GPtrArray of the #GBytes received
+   *
+   * Emitted with consecutive binary messages received since the last
+   * emission, right before #GstWebRTCDataChannel::on-message-data is
+   * emitted for each of them. Empty messages are empty #GBytes. Handlers
+   * only interested in batches don't need to connect to
+   * #GstWebRTCDataChannel::on-message-data.
+   */
+  gst_webrtc_data_channel_signals[SIGNAL_ON_MESSAGE_DATA_BATCH] =
+      g_signal_new ("on-message-data-batch", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
+
+  /**
+   * GstWebRTCDataChannel::on-message-string-batch:
+   * @object: the #GstWebRTCDataChannel
+   * @data: the strings received
+   *
+   * Emitted with consecutive string messages received since the last
+   * emission, right before #GstWebRTCDataChannel::on-message-string is
+   * emitted for each of them. Empty messages are empty strings.
+   */
+  gst_webrtc_data_channel_signals[SIGNAL_ON_MESSAGE_STRING_BATCH] =
+      g_signal_new ("on-message-string-batch", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 1, G_TYPE_STRV);
+
   /**
    * GstWebRTCDataChannel::on-buffered-amount-low:
    * @object: the #GstWebRTCDataChannel
@@ -1281,6 +1526,17 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
       G_TYPE_NONE, 0);
 
+  /**
+   * GstWebRTCDataChannel::on-buffered-amount-high:
+   * @object: the #GstWebRTCDataChannel
+   *
+   * See #GstWebRTCDataChannel:buffered-amount-high-threshold
+   */
+  gst_webrtc_data_channel_signals[SIGNAL_ON_BUFFERED_AMOUNT_HIGH] =
+      g_signal_new ("on-buffered-amount-high", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 0);
+
   /**
    * GstWebRTCDataChannel::send-data:
    * @object: the #GstWebRTCDataChannel
@@ -1319,4 +1575,5 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
 static void
 gst_webrtc_data_channel_init (GstWebRTCDataChannel * channel)
 {
+  g_queue_init (&channel->pending_messages);
 }
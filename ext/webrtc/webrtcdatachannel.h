@@ -58,11 +58,16 @@ struct _GstWebRTCDataChannel
   GstWebRTCDataChannelState         ready_state;
   guint64                           buffered_amount;
   guint64                           buffered_amount_low_threshold;
+  guint64                           buffered_amount_high_threshold;
 
   GstWebRTCBin                     *webrtcbin;
   gboolean                          opened;
   gulong                            src_probe;
   GError                           *stored_error;
+  /* received messages waiting to be emitted, and whether a task to emit
+   * them is queued */
+  GQueue                            pending_messages;
+  gboolean                          messages_scheduled;
 
   gpointer                          _padding[GST_PADDING];
 };
@@ -122,6 +122,7 @@ that the demux object and its streams are not changed by anybody else.
 #include "gstadaptivedemux.h"
 #include "gst/gst-i18n-plugin.h"
 #include <gst/base/gstadapter.h>
+#include <string.h>
 
 GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define GST_CAT_DEFAULT adaptivedemux_debug
@@ -132,6 +133,11 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_BITRATE_LIMIT 0.8f
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+#define DEFAULT_PREFETCH_DEPTH 0
+#define MAX_PREFETCH_DEPTH 8
+/* prefetches waiting for a thread are downloaded directly by the stream
+ * once it reaches them */
+#define MAX_PREFETCH_THREADS 8
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -158,6 +164,7 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_DEPTH,
   PROP_LAST
 };
 
@@ -206,8 +213,44 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* number of fragments to fetch ahead of the current one on each stream */
+  guint prefetch_depth;         /* protected by manifest_lock */
+  GThreadPool *prefetch_pool;   /* MT safe */
 };
 
+/* A fragment fetched ahead of time with its own GstUriDownloader. Shared
+ * between the stream's prefetch_queue and the prefetch_pool thread doing
+ * the download */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  volatile gint ref_count;
+
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  GstUriDownloader *downloader;
+
+  GMutex lock;
+  GCond cond;
+  gboolean started;             /* protected by lock */
+  gboolean done;                /* protected by lock */
+  gboolean cancelled;           /* protected by lock */
+  GstBuffer *buffer;            /* protected by lock, NULL on failure */
+  GstClockTime download_start_time;     /* protected by lock */
+  GstClockTime download_stop_time;      /* protected by lock */
+} GstAdaptiveDemuxPrefetch;
+
+/* Download of a prefetched fragment that was pushed, in
+ * GstAdaptiveDemuxStream::prefetch_history */
+typedef struct _GstAdaptiveDemuxPrefetchStats
+{
+  GstClockTime start;
+  GstClockTime stop;
+  gsize size;
+} GstAdaptiveDemuxPrefetchStats;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -305,6 +348,10 @@ static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
 static gboolean
 gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
     * demux);
+static void gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch *
+    prefetch, GstAdaptiveDemux * demux);
+static void
+gst_adaptive_demux_stream_flush_prefetches (GstAdaptiveDemuxStream * stream);
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
  * method to get to the padtemplates */
@@ -362,6 +409,9 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->priv->prefetch_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -386,6 +436,9 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->priv->prefetch_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -431,6 +484,21 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-depth:
+   *
+   * Number of fragments to download ahead of the current one on each
+   * stream, in parallel with it. Prefetched fragments are kept in memory
+   * and pushed in order once the stream reaches them. Only used for
+   * non-live forward playback and with subclasses that can look ahead
+   * in their fragment list.
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of fragments to download ahead of the current one on each"
+          " stream (0 = disabled)", 0, MAX_PREFETCH_DEPTH,
+          DEFAULT_PREFETCH_DEPTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -510,6 +578,10 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_cond_init (&demux->priv->preroll_cond);
   g_mutex_init (&demux->priv->preroll_lock);
 
+  demux->priv->prefetch_pool =
+      g_thread_pool_new ((GFunc) gst_adaptive_demux_prefetch_func, demux,
+      MAX_PREFETCH_THREADS, FALSE, NULL);
+
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
   g_return_if_fail (pad_template != NULL);
@@ -523,6 +595,7 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->priv->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -538,6 +611,10 @@ gst_adaptive_demux_finalize (GObject * object)
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
 
+  /* all prefetches were cancelled when the streams were freed, this only
+   * waits for their threads to notice */
+  g_thread_pool_free (priv->prefetch_pool, FALSE, TRUE);
+
   g_mutex_clear (&priv->updates_timed_lock);
   g_cond_clear (&priv->updates_timed_cond);
   g_mutex_clear (&demux->priv->manifest_update_lock);
@@ -1334,6 +1411,8 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_queue_init (&stream->prefetch_queue);
+  g_queue_init (&stream->prefetch_history);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1398,6 +1477,8 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  gst_adaptive_demux_stream_flush_prefetches (stream);
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -2100,6 +2181,9 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      /* also wakes up the download loop if it waits for a prefetch */
+      gst_adaptive_demux_stream_flush_prefetches (stream);
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2532,18 +2616,17 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* Called with the data of the current fragment, either from the streaming
+ * thread of the source element or with a prefetched fragment from the
+ * download loop */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_handle_buffer (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
   GST_MANIFEST_LOCK (demux);
 
   /* do not make any changes if the stream is cancelled */
@@ -2618,7 +2701,7 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
        * and we don't have a birate from the sub-class, then see if we
        * can work it out from the fragment size and duration */
       if (stream->fragment.bitrate == 0 &&
-          stream->fragment.duration != 0 &&
+          stream->fragment.duration != 0 && stream->uri_handler != NULL &&
           gst_element_query_duration (stream->uri_handler, GST_FORMAT_BYTES,
               &chunk_size)) {
         guint bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (chunk_size,
@@ -2694,6 +2777,14 @@ error:
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstAdaptiveDemuxStream *stream = gst_pad_get_element_private (pad);
+
+  return gst_adaptive_demux_stream_handle_buffer (stream, buffer);
+}
+
 /* must be called with manifest_lock taken */
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
@@ -3323,6 +3414,394 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_new (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+  prefetch->ref_count = 1;
+  prefetch->uri = g_strdup (fragment->uri);
+  prefetch->range_start = fragment->range_start;
+  prefetch->range_end = fragment->range_end;
+  prefetch->downloader = gst_uri_downloader_new ();
+  gst_uri_downloader_set_parent (prefetch->downloader,
+      GST_ELEMENT_CAST (demux));
+  g_mutex_init (&prefetch->lock);
+  g_cond_init (&prefetch->cond);
+  prefetch->download_start_time = GST_CLOCK_TIME_NONE;
+  prefetch->download_stop_time = GST_CLOCK_TIME_NONE;
+
+  return prefetch;
+}
+
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_ref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_atomic_int_inc (&prefetch->ref_count);
+  return prefetch;
+}
+
+static void
+gst_adaptive_demux_prefetch_unref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  if (g_atomic_int_dec_and_test (&prefetch->ref_count)) {
+    g_free (prefetch->uri);
+    gst_object_unref (prefetch->downloader);
+    if (prefetch->buffer)
+      gst_buffer_unref (prefetch->buffer);
+    g_mutex_clear (&prefetch->lock);
+    g_cond_clear (&prefetch->cond);
+    g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+  }
+}
+
+static void
+gst_adaptive_demux_prefetch_cancel (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_mutex_lock (&prefetch->lock);
+  prefetch->cancelled = TRUE;
+  prefetch->done = TRUE;
+  g_cond_broadcast (&prefetch->cond);
+  g_mutex_unlock (&prefetch->lock);
+
+  gst_uri_downloader_cancel (prefetch->downloader);
+}
+
+static gboolean
+gst_adaptive_demux_prefetch_matches (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  return g_strcmp0 (prefetch->uri, fragment->uri) == 0
+      && prefetch->range_start == fragment->range_start
+      && prefetch->range_end == fragment->range_end;
+}
+
+/* runs in a prefetch_pool thread */
+static void
+gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemux * demux)
+{
+  GstFragment *download;
+  GError *err = NULL;
+
+  g_mutex_lock (&prefetch->lock);
+  if (prefetch->cancelled) {
+    g_mutex_unlock (&prefetch->lock);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+    return;
+  }
+  prefetch->started = TRUE;
+  g_mutex_unlock (&prefetch->lock);
+
+  GST_DEBUG_OBJECT (demux, "Prefetching %s, range:%" G_GINT64_FORMAT " - %"
+      G_GINT64_FORMAT, prefetch->uri, prefetch->range_start,
+      prefetch->range_end);
+
+  download = gst_uri_downloader_fetch_uri_with_range (prefetch->downloader,
+      prefetch->uri, NULL, FALSE, FALSE, TRUE, prefetch->range_start,
+      prefetch->range_end, &err);
+  if (download == NULL) {
+    GST_DEBUG_OBJECT (demux, "Failed to prefetch %s: %s", prefetch->uri,
+        err ? err->message : "cancelled");
+    g_clear_error (&err);
+  }
+
+  g_mutex_lock (&prefetch->lock);
+  if (download != NULL && !prefetch->cancelled) {
+    prefetch->buffer = gst_fragment_get_buffer (download);
+    prefetch->download_start_time = download->download_start_time;
+    prefetch->download_stop_time = download->download_stop_time;
+  }
+  prefetch->done = TRUE;
+  g_cond_broadcast (&prefetch->cond);
+  g_mutex_unlock (&prefetch->lock);
+
+  if (download != NULL)
+    g_object_unref (download);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+/* Cancels and drops all the prefetches of the stream */
+static void
+gst_adaptive_demux_stream_flush_prefetches (GstAdaptiveDemuxStream * stream)
+{
+  GQueue queue, history;
+  GstAdaptiveDemuxPrefetch *prefetch;
+  GstAdaptiveDemuxPrefetchStats *stats;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  queue = stream->prefetch_queue;
+  g_queue_init (&stream->prefetch_queue);
+  history = stream->prefetch_history;
+  g_queue_init (&stream->prefetch_history);
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  while ((prefetch = g_queue_pop_head (&queue))) {
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+  }
+  while ((stats = g_queue_pop_head (&history)))
+    g_slice_free (GstAdaptiveDemuxPrefetchStats, stats);
+}
+
+/* must be called with fragment_download_lock taken.
+ *
+ * Parallel downloads share the bandwidth, so the throughput is the size of
+ * the last prefetched fragments over the time during which at least one of
+ * them was being downloaded. Returns 0 if unknown.
+ */
+static guint64
+gst_adaptive_demux_stream_get_prefetch_bitrate (GstAdaptiveDemuxStream *
+    stream)
+{
+  GstAdaptiveDemuxPrefetchStats *sorted[MAX_PREFETCH_DEPTH + 1];
+  GstClockTime busy_time = 0, busy_end = 0;
+  guint64 bytes = 0;
+  guint i, n = 0;
+  GList *iter;
+
+  /* sort by start of the download */
+  for (iter = stream->prefetch_history.head; iter; iter = iter->next) {
+    GstAdaptiveDemuxPrefetchStats *stats = iter->data;
+
+    for (i = n; i > 0 && sorted[i - 1]->start > stats->start; i--)
+      sorted[i] = sorted[i - 1];
+    sorted[i] = stats;
+    n++;
+  }
+
+  /* length of the union of the download intervals */
+  for (i = 0; i < n; i++) {
+    bytes += sorted[i]->size;
+    if (sorted[i]->stop > busy_end) {
+      busy_time += sorted[i]->stop - MAX (sorted[i]->start, busy_end);
+      busy_end = sorted[i]->stop;
+    }
+  }
+
+  if (busy_time == 0)
+    return 0;
+
+  return gst_util_uint64_scale (bytes, 8 * GST_SECOND, busy_time);
+}
+
+/* must be called with manifest_lock taken.
+ *
+ * Makes sure the fragments following the current one are being prefetched
+ * and returns a new reference to the prefetch of the current fragment, if
+ * any. prefetch_queue holds the current fragment, if it was prefetched,
+ * followed by the next ones. Entries not matching what the subclass reports
+ * anymore, after a seek or a bitrate switch for example, are dropped.
+ */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_stream_update_prefetches (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxStreamFragment next[MAX_PREFETCH_DEPTH];
+  GstAdaptiveDemuxPrefetch *current = NULL;
+  GQueue stale = G_QUEUE_INIT;
+  GList *iter;
+  guint i, n_next = 0;
+
+  if (demux->priv->prefetch_depth > 0 && klass->stream_peek_fragment
+      && demux->segment.rate > 0 && !gst_adaptive_demux_is_live (demux)) {
+    memset (next, 0, sizeof (next));
+    while (n_next < demux->priv->prefetch_depth) {
+      next[n_next].range_end = -1;
+      next[n_next].timestamp = GST_CLOCK_TIME_NONE;
+      next[n_next].duration = GST_CLOCK_TIME_NONE;
+      if (!klass->stream_peek_fragment (stream, n_next + 1, &next[n_next])
+          || next[n_next].uri == NULL) {
+        gst_adaptive_demux_stream_fragment_clear (&next[n_next]);
+        break;
+      }
+      n_next++;
+    }
+  }
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  iter = stream->prefetch_queue.head;
+  if (iter && gst_adaptive_demux_prefetch_matches (iter->data,
+          &stream->fragment)) {
+    current = gst_adaptive_demux_prefetch_ref (iter->data);
+    iter = iter->next;
+  }
+
+  /* keep the prefetches that are still valid */
+  for (i = 0; iter && i < n_next; i++) {
+    if (!gst_adaptive_demux_prefetch_matches (iter->data, &next[i]))
+      break;
+    iter = iter->next;
+  }
+
+  while (iter) {
+    GList *stale_link = iter;
+
+    iter = iter->next;
+    g_queue_unlink (&stream->prefetch_queue, stale_link);
+    g_queue_push_tail_link (&stale, stale_link);
+  }
+
+  if (!stream->cancelled) {
+    for (; i < n_next; i++) {
+      GstAdaptiveDemuxPrefetch *prefetch;
+
+      prefetch = gst_adaptive_demux_prefetch_new (demux, &next[i]);
+      g_queue_push_tail (&stream->prefetch_queue, prefetch);
+      g_thread_pool_push (demux->priv->prefetch_pool,
+          gst_adaptive_demux_prefetch_ref (prefetch), NULL);
+    }
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (!g_queue_is_empty (&stale))
+    GST_DEBUG_OBJECT (stream->pad, "Dropping %u outdated prefetches",
+        g_queue_get_length (&stale));
+  while (!g_queue_is_empty (&stale)) {
+    GstAdaptiveDemuxPrefetch *prefetch = g_queue_pop_head (&stale);
+
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+  }
+
+  for (i = 0; i < n_next; i++)
+    gst_adaptive_demux_stream_fragment_clear (&next[i]);
+
+  return current;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Waits for the prefetch of the current fragment and pushes its data like
+ * a regular download would. Returns FALSE if the prefetch failed, in which
+ * case the fragment must be downloaded the usual way.
+ */
+static gboolean
+gst_adaptive_demux_stream_push_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstAdaptiveDemuxPrefetch * prefetch,
+    GstFlowReturn * ret)
+{
+  GstBuffer *buffer;
+  GstClockTime start, stop, download_time;
+  gsize size;
+
+  GST_DEBUG_OBJECT (stream->pad, "Using prefetched fragment %s",
+      prefetch->uri);
+
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (&prefetch->lock);
+  if (!prefetch->started && !prefetch->done) {
+    /* still waiting for a thread, downloading it right away is faster */
+    prefetch->cancelled = TRUE;
+    prefetch->done = TRUE;
+  }
+  while (!prefetch->done)
+    g_cond_wait (&prefetch->cond, &prefetch->lock);
+  buffer = prefetch->buffer;
+  prefetch->buffer = NULL;
+  start = prefetch->download_start_time;
+  stop = prefetch->download_stop_time;
+  g_mutex_unlock (&prefetch->lock);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    if (buffer)
+      gst_buffer_unref (buffer);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetch failed, downloading again");
+    return FALSE;
+  }
+
+  size = gst_buffer_get_size (buffer);
+  stream->download_start_time =
+      GST_TIME_AS_USECONDS (gst_adaptive_demux_get_monotonic_time (demux));
+  stream->fragment_bytes_downloaded = size;
+  stream->last_latency = 0;
+
+  /* Prefetches overlap, the bitrate is the aggregate throughput of the
+   * last ones while the download time is the one of this fragment */
+  download_time = 0;
+  if (GST_CLOCK_TIME_IS_VALID (start) && GST_CLOCK_TIME_IS_VALID (stop)
+      && stop > start) {
+    GstAdaptiveDemuxPrefetchStats *stats;
+    guint64 bitrate;
+
+    download_time = stop - start;
+
+    stats = g_slice_new (GstAdaptiveDemuxPrefetchStats);
+    stats->start = start;
+    stats->stop = stop;
+    stats->size = size;
+
+    g_mutex_lock (&stream->fragment_download_lock);
+    g_queue_push_tail (&stream->prefetch_history, stats);
+    while (g_queue_get_length (&stream->prefetch_history) >
+        demux->priv->prefetch_depth + 1) {
+      g_slice_free (GstAdaptiveDemuxPrefetchStats,
+          g_queue_pop_head (&stream->prefetch_history));
+    }
+    bitrate = gst_adaptive_demux_stream_get_prefetch_bitrate (stream);
+    g_mutex_unlock (&stream->fragment_download_lock);
+
+    stream->last_download_time = download_time;
+    stream->last_bitrate = bitrate;
+  }
+  GST_DEBUG_OBJECT (stream->pad, "Prefetched %" G_GSIZE_FORMAT " bytes in %"
+      GST_TIME_FORMAT " bitrate %" G_GUINT64_FORMAT " bps", size,
+      GST_TIME_ARGS (download_time), stream->last_bitrate);
+
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0
+      && GST_CLOCK_TIME_IS_VALID (stream->fragment.duration)) {
+    stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+            8 * GST_SECOND, stream->fragment.duration));
+  }
+
+  *ret = gst_adaptive_demux_stream_handle_buffer (stream, buffer);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (!stream->download_finished && *ret == GST_FLOW_OK) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_adaptive_demux_eos_handling (stream);
+  } else {
+    g_mutex_unlock (&stream->fragment_download_lock);
+  }
+  *ret = stream->last_ret;
+
+  return TRUE;
+}
+
+/* Drops the prefetch of the current fragment once it has been used */
+static void
+gst_adaptive_demux_stream_release_prefetch (GstAdaptiveDemuxStream * stream,
+    GstAdaptiveDemuxPrefetch * prefetch)
+{
+  gboolean was_head = FALSE;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (g_queue_peek_head (&stream->prefetch_queue) == prefetch) {
+    g_queue_pop_head (&stream->prefetch_queue);
+    was_head = TRUE;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (was_head)
+    gst_adaptive_demux_prefetch_unref (prefetch);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3441,9 +3920,19 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    GstAdaptiveDemuxPrefetch *prefetch;
+
+    prefetch = gst_adaptive_demux_stream_update_prefetches (demux, stream);
+    if (prefetch == NULL
+        || !gst_adaptive_demux_stream_push_prefetch (demux, stream, prefetch,
+            &ret)) {
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
+    if (prefetch)
+      gst_adaptive_demux_stream_release_prefetch (stream, prefetch);
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
@@ -191,6 +191,13 @@ struct _GstAdaptiveDemuxStream
 
   guint download_error_count;
 
+  /* fragments being fetched ahead of the current one, in playback order
+   * (protected by fragment_download_lock) */
+  GQueue prefetch_queue;
+  /* download intervals and sizes of the last prefetched fragments pushed
+   * (protected by fragment_download_lock) */
+  GQueue prefetch_history;
+
   /* TODO check if used */
   gboolean eos;
 
@@ -397,6 +404,21 @@ struct _GstAdaptiveDemuxClass
    */
   gint64        (*stream_get_fragment_waiting_time) (GstAdaptiveDemuxStream * stream);
 
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @offset: how many fragments after the current one to look at
+   * @fragment: #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Fills the uri and range fields of @fragment with the ones of
+   * the fragment @offset positions after the current one, without changing
+   * the stream position. Used to prefetch fragments when the
+   * #GstAdaptiveDemux:prefetch-depth property is set.
+   *
+   * Returns: %TRUE if the fragment is known
+   */
+  gboolean      (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint offset, GstAdaptiveDemuxStreamFragment * fragment);
+
   /**
    * start_fragment:
    * @demux: #GstAdaptiveDemux
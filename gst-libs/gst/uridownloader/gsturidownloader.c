@@ -52,6 +52,27 @@ struct _GstUriDownloaderPrivate
 static void gst_uri_downloader_finalize (GObject * object);
 static void gst_uri_downloader_dispose (GObject * object);
 
+/* Source elements are kept in READY between downloads so that they keep
+ * their HTTP keep-alive connections and TLS sessions. When a downloader
+ * switches to another server or goes away, its source element is put in a
+ * pool shared by all downloaders of the process instead of being
+ * destroyed, and picked up again by the next download from that server.
+ * The pool is emptied once the last downloader is disposed. */
+#define SRC_POOL_MAX_SIZE 8
+#define SRC_POOL_MAX_IDLE_TIME (30 * G_TIME_SPAN_SECOND)
+
+typedef struct _GstUriDownloaderPooledSrc
+{
+  gchar *key;                   /* scheme://host:port */
+  GstElement *urisrc;
+  gint64 release_time;
+} GstUriDownloaderPooledSrc;
+
+/* most recently released first */
+static GQueue src_pool = G_QUEUE_INIT;  /* protected by src_pool_lock */
+static guint src_pool_users;    /* protected by src_pool_lock */
+static GMutex src_pool_lock;
+
 static GstFlowReturn gst_uri_downloader_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
 static gboolean gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
@@ -62,6 +83,7 @@ static GstBusSyncReply gst_uri_downloader_bus_handler (GstBus * bus,
 static gboolean gst_uri_downloader_ensure_src (GstUriDownloader * downloader,
     const gchar * uri);
 static void gst_uri_downloader_destroy_src (GstUriDownloader * downloader);
+static void gst_uri_downloader_release_src (GstUriDownloader * downloader);
 
 static GstStaticPadTemplate sinkpadtemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -77,6 +99,96 @@ G_DEFINE_TYPE_WITH_CODE (GstUriDownloader, gst_uri_downloader, GST_TYPE_OBJECT,
     G_ADD_PRIVATE (GstUriDownloader)
     _do_init);
 
+static void
+gst_uri_downloader_pooled_src_free (GstUriDownloaderPooledSrc * entry)
+{
+  GST_DEBUG_OBJECT (entry->urisrc, "Dropping pooled source element for %s",
+      entry->key);
+  gst_element_set_state (entry->urisrc, GST_STATE_NULL);
+  gst_object_unref (entry->urisrc);
+  g_free (entry->key);
+  g_slice_free (GstUriDownloaderPooledSrc, entry);
+}
+
+/* Returns the key identifying the server @uri points to, which is what
+ * connections can be shared for */
+static gchar *
+gst_uri_downloader_get_src_key (const gchar * uri)
+{
+  GstUri *gst_uri;
+  gchar *key;
+
+  gst_uri = gst_uri_from_string (uri);
+  if (gst_uri == NULL)
+    return NULL;
+
+  key = g_strdup_printf ("%s://%s:%u", gst_uri_get_scheme (gst_uri),
+      GST_STR_NULL (gst_uri_get_host (gst_uri)), gst_uri_get_port (gst_uri));
+  gst_uri_unref (gst_uri);
+
+  return key;
+}
+
+/* Takes an idle source element for @key out of the pool, if any */
+static GstElement *
+gst_uri_downloader_acquire_pooled_src (const gchar * key)
+{
+  GstElement *urisrc = NULL;
+  GQueue stale = G_QUEUE_INIT;
+  GstUriDownloaderPooledSrc *entry;
+  gint64 now = g_get_monotonic_time ();
+  GList *iter;
+
+  g_mutex_lock (&src_pool_lock);
+  iter = src_pool.head;
+  while (iter) {
+    GList *next = iter->next;
+
+    entry = iter->data;
+    if (now - entry->release_time > SRC_POOL_MAX_IDLE_TIME) {
+      /* the server has most likely closed the connection by now */
+      g_queue_unlink (&src_pool, iter);
+      g_queue_push_tail_link (&stale, iter);
+    } else if (urisrc == NULL && g_str_equal (entry->key, key)) {
+      urisrc = entry->urisrc;
+      entry->urisrc = NULL;
+      g_queue_delete_link (&src_pool, iter);
+      g_free (entry->key);
+      g_slice_free (GstUriDownloaderPooledSrc, entry);
+    }
+    iter = next;
+  }
+  g_mutex_unlock (&src_pool_lock);
+
+  while ((entry = g_queue_pop_head (&stale)))
+    gst_uri_downloader_pooled_src_free (entry);
+
+  return urisrc;
+}
+
+/* Takes ownership of @urisrc and keeps it around for the next download
+ * from the same server */
+static void
+gst_uri_downloader_add_pooled_src (gchar * key, GstElement * urisrc)
+{
+  GQueue stale = G_QUEUE_INIT;
+  GstUriDownloaderPooledSrc *entry;
+
+  entry = g_slice_new (GstUriDownloaderPooledSrc);
+  entry->key = key;
+  entry->urisrc = urisrc;
+  entry->release_time = g_get_monotonic_time ();
+
+  g_mutex_lock (&src_pool_lock);
+  g_queue_push_head (&src_pool, entry);
+  while (g_queue_get_length (&src_pool) > SRC_POOL_MAX_SIZE)
+    g_queue_push_tail (&stale, g_queue_pop_tail (&src_pool));
+  g_mutex_unlock (&src_pool_lock);
+
+  while ((entry = g_queue_pop_head (&stale)))
+    gst_uri_downloader_pooled_src_free (entry);
+}
+
 static void
 gst_uri_downloader_class_init (GstUriDownloaderClass * klass)
 {
@@ -109,6 +221,10 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
 
   g_mutex_init (&downloader->priv->download_lock);
   g_cond_init (&downloader->priv->cond);
+
+  g_mutex_lock (&src_pool_lock);
+  src_pool_users++;
+  g_mutex_unlock (&src_pool_lock);
 }
 
 static void
@@ -116,7 +232,7 @@ gst_uri_downloader_dispose (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
-  gst_uri_downloader_destroy_src (downloader);
+  gst_uri_downloader_release_src (downloader);
 
   if (downloader->priv->bus != NULL) {
     gst_object_unref (downloader->priv->bus);
@@ -142,10 +258,23 @@ static void
 gst_uri_downloader_finalize (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
+  GQueue stale = G_QUEUE_INIT;
+  GstUriDownloaderPooledSrc *entry;
 
   g_mutex_clear (&downloader->priv->download_lock);
   g_cond_clear (&downloader->priv->cond);
 
+  /* nobody is going to pick up the pooled source elements anymore */
+  g_mutex_lock (&src_pool_lock);
+  if (--src_pool_users == 0) {
+    stale = src_pool;
+    g_queue_init (&src_pool);
+  }
+  g_mutex_unlock (&src_pool_lock);
+
+  while ((entry = g_queue_pop_head (&stale)))
+    gst_uri_downloader_pooled_src_free (entry);
+
   G_OBJECT_CLASS (gst_uri_downloader_parent_class)->finalize (object);
 }
 
@@ -401,35 +530,48 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
 static gboolean
 gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
 {
+  gchar *new_key;
+
+  new_key = gst_uri_downloader_get_src_key (uri);
+  if (new_key == NULL)
+    return FALSE;
+
   if (downloader->priv->urisrc) {
-    gchar *old_protocol, *new_protocol;
-    gchar *old_uri;
+    gchar *old_uri, *old_key;
 
     old_uri =
         gst_uri_handler_get_uri (GST_URI_HANDLER (downloader->priv->urisrc));
-    old_protocol = gst_uri_get_protocol (old_uri);
-    new_protocol = gst_uri_get_protocol (uri);
+    old_key = old_uri ? gst_uri_downloader_get_src_key (old_uri) : NULL;
 
-    if (!g_str_equal (old_protocol, new_protocol)) {
-      gst_uri_downloader_destroy_src (downloader);
-      GST_DEBUG_OBJECT (downloader, "Can't re-use old source element");
-    } else {
-      GError *err = NULL;
-
-      GST_DEBUG_OBJECT (downloader, "Re-using old source element");
-      if (!gst_uri_handler_set_uri
-          (GST_URI_HANDLER (downloader->priv->urisrc), uri, &err)) {
-        GST_DEBUG_OBJECT (downloader,
-            "Failed to re-use old source element: %s", err->message);
-        g_clear_error (&err);
-        gst_uri_downloader_destroy_src (downloader);
-      }
+    if (g_strcmp0 (old_key, new_key) != 0) {
+      GST_DEBUG_OBJECT (downloader, "Other server, pooling old source element");
+      gst_uri_downloader_release_src (downloader);
     }
     g_free (old_uri);
-    g_free (old_protocol);
-    g_free (new_protocol);
+    g_free (old_key);
   }
 
+  if (!downloader->priv->urisrc) {
+    downloader->priv->urisrc = gst_uri_downloader_acquire_pooled_src (new_key);
+    if (downloader->priv->urisrc)
+      GST_DEBUG_OBJECT (downloader, "Using pooled source element for %s",
+          new_key);
+  }
+
+  if (downloader->priv->urisrc) {
+    GError *err = NULL;
+
+    GST_DEBUG_OBJECT (downloader, "Re-using old source element");
+    if (!gst_uri_handler_set_uri
+        (GST_URI_HANDLER (downloader->priv->urisrc), uri, &err)) {
+      GST_DEBUG_OBJECT (downloader,
+          "Failed to re-use old source element: %s", err->message);
+      g_clear_error (&err);
+      gst_uri_downloader_destroy_src (downloader);
+    }
+  }
+  g_free (new_key);
+
   if (!downloader->priv->urisrc) {
     GST_DEBUG_OBJECT (downloader, "Creating source element for the URI:%s",
         uri);
@@ -458,6 +600,34 @@ gst_uri_downloader_destroy_src (GstUriDownloader * downloader)
   downloader->priv->urisrc = NULL;
 }
 
+/* Hands the source element over to the pool if it is still connected,
+ * i.e. the last download succeeded and left it in READY */
+static void
+gst_uri_downloader_release_src (GstUriDownloader * downloader)
+{
+  GstElement *urisrc = downloader->priv->urisrc;
+  GstState state = GST_STATE_NULL;
+  gchar *uri, *key = NULL;
+
+  if (!urisrc)
+    return;
+
+  gst_element_get_state (urisrc, &state, NULL, 0);
+  uri = gst_uri_handler_get_uri (GST_URI_HANDLER (urisrc));
+  if (uri != NULL && state == GST_STATE_READY)
+    key = gst_uri_downloader_get_src_key (uri);
+  g_free (uri);
+
+  if (key == NULL) {
+    gst_uri_downloader_destroy_src (downloader);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (downloader, "Pooling source element for %s", key);
+  downloader->priv->urisrc = NULL;
+  gst_uri_downloader_add_pooled_src (key, urisrc);
+}
+
 static gboolean
 gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
     const gchar * referer, gboolean compress,
@@ -477,6 +647,9 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
     g_object_set (downloader->priv->urisrc, "compress", compress, NULL);
   if (g_object_class_find_property (gobject_class, "keep-alive"))
     g_object_set (downloader->priv->urisrc, "keep-alive", TRUE, NULL);
+  /* the source element might come from a HEAD request */
+  if (g_object_class_find_property (gobject_class, "method"))
+    g_object_set (downloader->priv->urisrc, "method", NULL, NULL);
   if (g_object_class_find_property (gobject_class, "extra-headers")) {
     if (referer || refresh || !allow_cache) {
       GstStructure *extra_headers = gst_structure_new_empty ("headers");
@@ -33,6 +33,10 @@
  * Zorder for each input stream can be configured on the
  * #GstVideoAggregatorPad.
  *
+ * The input frames of all pads are prepared (and possibly converted) before
+ * each output frame is aggregated. This can be done in parallel for several
+ * pads, see #GstVideoAggregator:max-prepare-threads.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -42,6 +46,7 @@
 #include <string.h>
 
 #include "gstvideoaggregator.h"
+#include "gstvideotaskrunner.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_video_aggregator_debug);
 #define GST_CAT_DEFAULT gst_video_aggregator_debug
@@ -644,6 +649,13 @@ void gst_video_aggregator_convert_pad_update_conversion_info
  * GstVideoAggregator implementation  *
  **************************************/
 
+#define DEFAULT_MAX_PREPARE_THREADS 1
+enum
+{
+  PROP_0,
+  PROP_MAX_PREPARE_THREADS,
+};
+
 #define GST_VIDEO_AGGREGATOR_GET_LOCK(vagg) (&GST_VIDEO_AGGREGATOR(vagg)->priv->lock)
 
 #define GST_VIDEO_AGGREGATOR_LOCK(vagg)   G_STMT_START {       \
@@ -681,6 +693,10 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* parallel frame preparation */
+  guint max_prepare_threads;
+  GstVideoTaskRunner *prepare_runner;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1633,6 +1649,70 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
       vpad->priv->buffer, &vpad->priv->prepared_frame);
 }
 
+static void
+prepare_frame_task (gpointer task, gpointer user_data)
+{
+  GstPad *pad = GST_PAD_CAST (task);
+
+  prepare_frames (GST_ELEMENT_CAST (user_data), pad, NULL);
+  gst_object_unref (pad);
+}
+
+static void
+gst_video_aggregator_free_prepare_runner (GstVideoAggregator * vagg)
+{
+  if (vagg->priv->prepare_runner) {
+    gst_video_task_runner_free (vagg->priv->prepare_runner);
+    vagg->priv->prepare_runner = NULL;
+  }
+}
+
+/* Prepares the frames of all sink pads. The pads that have a buffer are
+ * dispatched to the preparation threads, and this only returns once all of
+ * them are done. */
+static void
+gst_video_aggregator_prepare_frames (GstVideoAggregator * vagg)
+{
+  GPtrArray *pads;
+  guint max_threads;
+  GList *l;
+
+  GST_OBJECT_LOCK (vagg);
+  max_threads = vagg->priv->max_prepare_threads;
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (max_threads == 0)
+    max_threads = g_get_num_processors ();
+
+  if (max_threads <= 1) {
+    gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+        NULL);
+    return;
+  }
+
+  pads = g_ptr_array_new ();
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT_CAST (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *vpad = l->data;
+
+    if (vpad->priv->buffer != NULL)
+      g_ptr_array_add (pads, gst_object_ref (vpad));
+    else
+      memset (&vpad->priv->prepared_frame, 0, sizeof (GstVideoFrame));
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (!vagg->priv->prepare_runner)
+    vagg->priv->prepare_runner =
+        gst_video_task_runner_new (prepare_frame_task, vagg);
+
+  /* prepare_frame_task() drops the pad references */
+  gst_video_task_runner_run (vagg->priv->prepare_runner, pads->pdata,
+      pads->len, max_threads);
+
+  g_ptr_array_free (pads, TRUE);
+}
+
 static gboolean
 clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
 {
@@ -1678,7 +1758,7 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
 
   /* Convert all the frames the subclass has before aggregating */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  gst_video_aggregator_prepare_frames (vagg);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2163,6 +2243,7 @@ gst_video_aggregator_stop (GstAggregator * agg)
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (agg);
 
   gst_video_aggregator_reset (vagg);
+  gst_video_aggregator_free_prepare_runner (vagg);
 
   return TRUE;
 }
@@ -2478,6 +2559,7 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  gst_video_aggregator_free_prepare_runner (vagg);
   g_mutex_clear (&vagg->priv->lock);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
@@ -2497,7 +2579,14 @@ static void
 gst_video_aggregator_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_MAX_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      g_value_set_uint (value, vagg->priv->max_prepare_threads);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2508,7 +2597,14 @@ static void
 gst_video_aggregator_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_MAX_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      vagg->priv->max_prepare_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2563,6 +2659,22 @@ gst_video_aggregator_class_init (GstVideoAggregatorClass * klass)
   klass->create_output_buffer = gst_video_aggregator_create_output_buffer;
   klass->update_caps = gst_video_aggregator_default_update_caps;
 
+  /**
+   * GstVideoAggregator:max-prepare-threads:
+   *
+   * Maximum number of threads used for preparing (and converting) the input
+   * frames of the sink pads before aggregating them. The frames of different
+   * pads are prepared in parallel. 0 uses one thread per CPU core.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_PREPARE_THREADS,
+      g_param_spec_uint ("max-prepare-threads", "Maximum preparation threads",
+          "Maximum number of threads preparing input frames in parallel "
+          "(0 = number of processors)", 0, G_MAXINT,
+          DEFAULT_MAX_PREPARE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Register the pad class */
   g_type_class_ref (GST_TYPE_VIDEO_AGGREGATOR_PAD);
 }
@@ -2576,6 +2688,7 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+  vagg->priv->max_prepare_threads = DEFAULT_MAX_PREPARE_THREADS;
 
   /* initialize variables */
   gst_video_aggregator_reset (vagg);
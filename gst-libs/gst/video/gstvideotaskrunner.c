@@ -0,0 +1,184 @@
+/* GStreamer
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gstvideotaskrunner
+ * @title: GstVideoTaskRunner
+ * @short_description: Runs independent pieces of per-frame work in parallel
+ *
+ * A #GstVideoTaskRunner runs a set of tasks, for example the stripes of a
+ * frame, on a lazily created thread pool and waits for all of them to be
+ * done. The calling thread processes the first task itself, so running
+ * with n threads only needs n - 1 worker threads.
+ *
+ * A runner must only be used by one thread at a time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstvideotaskrunner.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_video_task_runner_debug);
+#define GST_CAT_DEFAULT gst_video_task_runner_debug
+
+struct _GstVideoTaskRunner
+{
+  GstVideoTaskRunnerFunc func;
+  gpointer user_data;
+
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  guint pending;
+};
+
+static void
+gst_video_task_runner_thread_func (gpointer data, gpointer user_data)
+{
+  GstVideoTaskRunner *runner = user_data;
+
+  runner->func (data, runner->user_data);
+
+  g_mutex_lock (&runner->lock);
+  runner->pending--;
+  if (runner->pending == 0)
+    g_cond_signal (&runner->cond);
+  g_mutex_unlock (&runner->lock);
+}
+
+static gboolean
+gst_video_task_runner_ensure_pool (GstVideoTaskRunner * runner,
+    guint n_workers)
+{
+  GError *err = NULL;
+
+  if (!runner->pool) {
+    runner->pool = g_thread_pool_new (gst_video_task_runner_thread_func,
+        runner, n_workers, FALSE, &err);
+  } else if (g_thread_pool_get_max_threads (runner->pool) != n_workers) {
+    g_thread_pool_set_max_threads (runner->pool, n_workers, &err);
+  }
+
+  if (err) {
+    GST_WARNING ("Could not set up worker threads: %s", err->message);
+    g_clear_error (&err);
+  }
+
+  return runner->pool != NULL;
+}
+
+/**
+ * gst_video_task_runner_new:
+ * @func: the function processing each task
+ * @user_data: user data passed to @func
+ *
+ * Creates a new task runner. No threads are started until tasks are run
+ * with more than one thread.
+ *
+ * Returns: (transfer full): a new #GstVideoTaskRunner, free with
+ *     gst_video_task_runner_free()
+ */
+GstVideoTaskRunner *
+gst_video_task_runner_new (GstVideoTaskRunnerFunc func, gpointer user_data)
+{
+  GstVideoTaskRunner *runner;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  if (g_once_init_enter (&gst_video_task_runner_debug)) {
+    GstDebugCategory *cat = NULL;
+
+    GST_DEBUG_CATEGORY_INIT (cat, "videotaskrunner", 0, "video task runner");
+    g_once_init_leave (&gst_video_task_runner_debug, cat);
+  }
+
+  runner = g_new0 (GstVideoTaskRunner, 1);
+  runner->func = func;
+  runner->user_data = user_data;
+  g_mutex_init (&runner->lock);
+  g_cond_init (&runner->cond);
+
+  return runner;
+}
+
+/**
+ * gst_video_task_runner_free:
+ * @runner: a #GstVideoTaskRunner
+ *
+ * Frees @runner and stops its worker threads.
+ */
+void
+gst_video_task_runner_free (GstVideoTaskRunner * runner)
+{
+  g_return_if_fail (runner != NULL);
+
+  if (runner->pool)
+    g_thread_pool_free (runner->pool, FALSE, TRUE);
+  g_mutex_clear (&runner->lock);
+  g_cond_clear (&runner->cond);
+  g_free (runner);
+}
+
+/**
+ * gst_video_task_runner_run:
+ * @runner: a #GstVideoTaskRunner
+ * @tasks: (array length=n_tasks): the tasks to process
+ * @n_tasks: the number of tasks
+ * @n_threads: the maximum number of threads to use, including the calling one
+ *
+ * Calls the function of @runner for each of @tasks, using up to @n_threads
+ * threads, and returns once all of them are done. The first task is always
+ * processed by the calling thread. If the worker threads can not be set up
+ * all tasks are processed by the calling thread.
+ */
+void
+gst_video_task_runner_run (GstVideoTaskRunner * runner, gpointer * tasks,
+    guint n_tasks, guint n_threads)
+{
+  guint i, n_workers;
+
+  g_return_if_fail (runner != NULL);
+  g_return_if_fail (tasks != NULL || n_tasks == 0);
+
+  n_workers = MIN (n_threads, n_tasks);
+  n_workers = n_workers > 0 ? n_workers - 1 : 0;
+
+  if (n_workers == 0
+      || !gst_video_task_runner_ensure_pool (runner, n_workers)) {
+    for (i = 0; i < n_tasks; i++)
+      runner->func (tasks[i], runner->user_data);
+    return;
+  }
+
+  g_mutex_lock (&runner->lock);
+  runner->pending = n_tasks - 1;
+  g_mutex_unlock (&runner->lock);
+
+  for (i = 1; i < n_tasks; i++)
+    g_thread_pool_push (runner->pool, tasks[i], NULL);
+
+  runner->func (tasks[0], runner->user_data);
+
+  g_mutex_lock (&runner->lock);
+  while (runner->pending > 0)
+    g_cond_wait (&runner->cond, &runner->lock);
+  g_mutex_unlock (&runner->lock);
+}
@@ -0,0 +1,59 @@
+/* GStreamer
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_VIDEO_TASK_RUNNER_H__
+#define __GST_VIDEO_TASK_RUNNER_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The Video library from gst-plugins-bad is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+#include <gst/video/video-bad-prelude.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVideoTaskRunner GstVideoTaskRunner;
+
+/**
+ * GstVideoTaskRunnerFunc:
+ * @task: one of the tasks passed to gst_video_task_runner_run()
+ * @user_data: the user data passed to gst_video_task_runner_new()
+ *
+ * Processes one task, possibly from a worker thread.
+ */
+typedef void (*GstVideoTaskRunnerFunc) (gpointer task, gpointer user_data);
+
+GST_VIDEO_BAD_API
+GstVideoTaskRunner * gst_video_task_runner_new  (GstVideoTaskRunnerFunc func,
+                                                 gpointer user_data);
+
+GST_VIDEO_BAD_API
+void                 gst_video_task_runner_free (GstVideoTaskRunner * runner);
+
+GST_VIDEO_BAD_API
+void                 gst_video_task_runner_run  (GstVideoTaskRunner * runner,
+                                                 gpointer * tasks,
+                                                 guint n_tasks,
+                                                 guint n_threads);
+
+G_END_DECLS
+
+#endif /* __GST_VIDEO_TASK_RUNNER_H__ */
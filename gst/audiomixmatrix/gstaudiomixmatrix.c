@@ -33,6 +33,12 @@
  * are automatically negotiated and the transformation matrix is a truncated
  * identity matrix.
  *
+ * Zero coefficients are skipped when mixing, and output channels that only
+ * copy one input channel with a coefficient of 1 are copied directly. With
+ * floating point samples, a NaN or infinite input sample therefore only
+ * affects the output channels with a non-zero coefficient for its input
+ * channel, instead of turning every output channel into NaN.
+ *
  * ## Example matrix generation code
  * To generate the matrix using code:
  *
@@ -227,9 +233,69 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->channel_mask = 0;
   self->s16_conv_matrix = NULL;
   self->s32_conv_matrix = NULL;
+  self->nz_start = NULL;
+  self->nz_in = NULL;
+  self->nz_index = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
 }
 
+static void
+gst_audio_mix_matrix_clear_sparse_matrix (GstAudioMixMatrix * self)
+{
+  g_free (self->nz_start);
+  self->nz_start = NULL;
+  g_free (self->nz_in);
+  self->nz_in = NULL;
+  g_free (self->nz_index);
+  self->nz_index = NULL;
+}
+
+/* Builds the sparse form of the matrix, so that mixing only goes through
+ * the non-zero coefficients, and detects matrices that only route channels
+ * around */
+static void
+gst_audio_mix_matrix_convert_sparse_matrix (GstAudioMixMatrix * self)
+{
+  guint in, out, n = 0;
+
+  gst_audio_mix_matrix_clear_sparse_matrix (self);
+
+  self->nz_start = g_new (guint, self->out_channels + 1);
+  self->nz_in = g_new (guint, self->in_channels * self->out_channels);
+  self->nz_index = g_new (guint, self->in_channels * self->out_channels);
+  self->is_routing = TRUE;
+
+  for (out = 0; out < self->out_channels; out++) {
+    self->nz_start[out] = n;
+    for (in = 0; in < self->in_channels; in++) {
+      guint index = out * self->in_channels + in;
+
+      if (self->matrix[index] == 0.0)
+        continue;
+
+      self->nz_in[n] = in;
+      self->nz_index[n] = index;
+      n++;
+    }
+
+    if (n - self->nz_start[out] > 1 || (n > self->nz_start[out] &&
+            self->matrix[self->nz_index[n - 1]] != 1.0))
+      self->is_routing = FALSE;
+  }
+  self->nz_start[self->out_channels] = n;
+
+  self->is_identity = self->is_routing &&
+      self->in_channels == self->out_channels &&
+      n == self->out_channels;
+  for (out = 0; self->is_identity && out < self->out_channels; out++)
+    self->is_identity = self->nz_in[out] == out;
+
+  GST_DEBUG_OBJECT (self, "%u non-zero coefficients out of %u%s", n,
+      self->in_channels * self->out_channels,
+      self->is_identity ? ", identity" :
+      (self->is_routing ? ", routing only" : ""));
+}
+
 static void
 gst_audio_mix_matrix_dispose (GObject * object)
 {
@@ -240,6 +306,8 @@ gst_audio_mix_matrix_dispose (GObject * object)
     self->matrix = NULL;
   }
 
+  gst_audio_mix_matrix_clear_sparse_matrix (self);
+
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
@@ -292,6 +360,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
+        gst_audio_mix_matrix_convert_sparse_matrix (self);
       }
       break;
     case PROP_OUT_CHANNELS:
@@ -299,6 +368,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
+        gst_audio_mix_matrix_convert_sparse_matrix (self);
       }
       break;
     case PROP_MATRIX:{
@@ -324,6 +394,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       }
       gst_audio_mix_matrix_convert_s16_matrix (self);
       gst_audio_mix_matrix_convert_s32_matrix (self);
+      gst_audio_mix_matrix_convert_sparse_matrix (self);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -404,22 +475,70 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       g_free (self->s32_conv_matrix);
       self->s32_conv_matrix = NULL;
     }
+
+    gst_audio_mix_matrix_clear_sparse_matrix (self);
   }
 
   return s;
 }
 
 
+/* Only goes through the non-zero coefficients of each output channel. The
+ * sums are done in the same order and precision as with the full matrix, so
+ * the result is the same for finite samples. Non-finite ones differ: 0 * NaN
+ * or 0 * Inf is never added, so they don't spread to unrelated channels. */
+#define MIX_SPARSE(type, acc_type, coefs, shift) \
+  for (sample = 0; sample < n_samples; sample++) { \
+    const type *insample = inarray + sample * inchannels; \
+    type *outsample = outarray + sample * outchannels; \
+    for (out = 0; out < outchannels; out++) { \
+      acc_type outval = 0; \
+      guint k; \
+      for (k = nz_start[out]; k < nz_start[out + 1]; k++) \
+        outval += insample[nz_in[k]] * coefs[nz_index[k]]; \
+      outsample[out] = (type) (outval >> (shift)); \
+    } \
+  }
+
+#define MIX_SPARSE_FLOAT(type, acc_type, coefs) \
+  for (sample = 0; sample < n_samples; sample++) { \
+    const type *insample = inarray + sample * inchannels; \
+    type *outsample = outarray + sample * outchannels; \
+    for (out = 0; out < outchannels; out++) { \
+      acc_type outval = 0; \
+      guint k; \
+      for (k = nz_start[out]; k < nz_start[out + 1]; k++) \
+        outval += insample[nz_in[k]] * coefs[nz_index[k]]; \
+      outsample[out] = outval; \
+    } \
+  }
+
+/* All coefficients are 0 or 1 with at most one 1 per output channel */
+#define MIX_ROUTE(type) \
+  for (sample = 0; sample < n_samples; sample++) { \
+    const type *insample = inarray + sample * inchannels; \
+    type *outsample = outarray + sample * outchannels; \
+    for (out = 0; out < outchannels; out++) { \
+      if (nz_start[out] == nz_start[out + 1]) \
+        outsample[out] = 0; \
+      else \
+        outsample[out] = insample[nz_in[nz_start[out]]]; \
+    } \
+  }
+
 static GstFlowReturn
 gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     GstBuffer * inbuf, GstBuffer * outbuf)
 {
   GstMapInfo inmap, outmap;
   GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
-  gint in, out, sample;
+  gint out, sample;
   guint inchannels = self->in_channels;
   guint outchannels = self->out_channels;
   gdouble *matrix = self->matrix;
+  const guint *nz_start = self->nz_start;
+  const guint *nz_in = self->nz_in;
+  const guint *nz_index = self->nz_index;
 
   if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
     return GST_FLOW_ERROR;
@@ -429,6 +548,12 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     return GST_FLOW_ERROR;
   }
 
+  /* the same samples in the same layout */
+  if (self->is_identity) {
+    memcpy (outmap.data, inmap.data, MIN (inmap.size, outmap.size));
+    goto done;
+  }
+
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
     case GST_AUDIO_FORMAT_F32BE:{
@@ -439,16 +564,10 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gfloat *) inmap.data;
       outarray = (gfloat *) outmap.data;
 
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gfloat outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
+      if (self->is_routing) {
+        MIX_ROUTE (gfloat);
+      } else {
+        MIX_SPARSE_FLOAT (gfloat, gfloat, matrix);
       }
       break;
     }
@@ -461,16 +580,10 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gdouble *) inmap.data;
       outarray = (gdouble *) outmap.data;
 
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gdouble outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
+      if (self->is_routing) {
+        MIX_ROUTE (gdouble);
+      } else {
+        MIX_SPARSE_FLOAT (gdouble, gdouble, matrix);
       }
       break;
     }
@@ -485,15 +598,10 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gint16 *) inmap.data;
       outarray = (gint16 *) outmap.data;
 
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint32 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint32) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint16) (outval >> n);
-        }
+      if (self->is_routing) {
+        MIX_ROUTE (gint16);
+      } else {
+        MIX_SPARSE (gint16, gint32, conv_matrix, n);
       }
       break;
     }
@@ -508,15 +616,10 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gint32 *) inmap.data;
       outarray = (gint32 *) outmap.data;
 
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint64 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint64) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint32) (outval >> n);
-        }
+      if (self->is_routing) {
+        MIX_ROUTE (gint32);
+      } else {
+        MIX_SPARSE (gint32, gint64, conv_matrix, n);
       }
       break;
     }
@@ -527,11 +630,16 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
 
   }
 
+done:
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
   return GST_FLOW_OK;
 }
 
+#undef MIX_SPARSE
+#undef MIX_SPARSE_FLOAT
+#undef MIX_ROUTE
+
 static gboolean
 gst_audio_mix_matrix_get_unit_size (GstBaseTransform * trans,
     GstCaps * caps, gsize * size)
@@ -596,6 +704,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     default:
       break;
   }
+  gst_audio_mix_matrix_convert_sparse_matrix (self);
   return TRUE;
 }
 
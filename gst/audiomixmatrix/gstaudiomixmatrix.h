@@ -62,6 +62,16 @@ struct _GstAudioMixMatrix
   gint64 *s32_conv_matrix;
   gint shift_bytes;
 
+  /* sparse form of the matrix: the non-zero coefficients of output channel
+   * out are the entries nz_start[out] to nz_start[out + 1] - 1 of nz_in
+   * (input channel) and nz_index (index in the matrices) */
+  guint *nz_start;
+  guint *nz_in;
+  guint *nz_index;
+  /* every output channel is either silent or a copy of one input channel */
+  gboolean is_routing;
+  gboolean is_identity;
+
   GstAudioFormat format;
 };
 
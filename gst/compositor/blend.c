@@ -27,6 +27,7 @@
 #endif
 
 #include "blend.h"
+#include "blendavx2.h"
 #include "compositororc.h"
 
 #include <string.h>
@@ -36,6 +37,15 @@
 GST_DEBUG_CATEGORY_STATIC (gst_compositor_blend_debug);
 #define GST_CAT_DEFAULT gst_compositor_blend_debug
 
+typedef void (*BlendKernel) (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m);
+
+/* The hot ORC kernels, replaced by gst_compositor_init_blend() with faster
+ * versions if the CPU has them */
+static BlendKernel compositor_blend_u8 = compositor_orc_blend_u8;
+static BlendKernel compositor_overlay_argb = compositor_orc_overlay_argb;
+static BlendKernel compositor_overlay_bgra = compositor_orc_overlay_bgra;
+
 /* Below are the implementations of everything */
 
 /* A32 is for AYUV, ARGB and BGRA */
@@ -101,7 +111,7 @@ _overlay_loop_##name (guint8 * dest, const guint8 * src, gint src_height, \
   s_alpha = MIN (255, s_alpha); \
   switch (mode) { \
     case COMPOSITOR_BLEND_MODE_NORMAL:\
-      compositor_orc_overlay_##name (dest, dest_stride, src, src_stride, \
+      compositor_overlay_##name (dest, dest_stride, src, src_stride, \
         s_alpha, src_width, src_height); \
         break;\
     case COMPOSITOR_BLEND_MODE_ADDITIVE:\
@@ -146,33 +156,28 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
   gint i, j; \
   gint val; \
   static const gint tab[] = { 80, 160, 80, 160 }; \
-  gint width, height; \
-  guint8 *dest; \
+  gint width, height, stride; \
+  guint8 *first, *dest; \
   \
-  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
+  first = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
-  if (!RGB) { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        dest[A] = 0xff; \
-        dest[C1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[C2] = 128; \
-        dest[C3] = 128; \
-        dest += 4; \
-      } \
+  for (i = 0; i < height; i++) { \
+    dest = first + i * stride; \
+    /* Only the first row of each phase of the pattern is generated */ \
+    if (i != 0 && i != 8) { \
+      memcpy (dest, first + (i & 0x8) * stride, width * 4); \
+      continue; \
     } \
-  } else { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[A] = 0xFF; \
-        dest[C1] = val; \
-        dest[C2] = val; \
-        dest[C3] = val; \
-        dest += 4; \
-      } \
+    for (j = 0; j < width; j++) { \
+      val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+      dest[A] = 0xff; \
+      dest[C1] = val; \
+      dest[C2] = RGB ? val : 128; \
+      dest[C3] = RGB ? val : 128; \
+      dest += 4; \
     } \
   } \
 }
@@ -191,12 +196,13 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
 { \
   gint c1, c2, c3; \
   guint32 val; \
-  gint width, height; \
+  gint i, width, height, dest_stride; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   if (RGB) { \
     c1 = YUV_TO_R (Y, U, V); \
@@ -209,7 +215,10 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
   } \
   val = GUINT32_FROM_BE ((0xff << A) | (c1 << C1) | (c2 << C2) | (c3 << C3)); \
   \
-  compositor_orc_splat_u32 ((guint32 *) dest, val, height * width); \
+  for (i = 0; i < height; i++) { \
+    compositor_orc_splat_u32 ((guint32 *) dest, val, width); \
+    dest += dest_stride; \
+  } \
 }
 
 A32_COLOR (argb, TRUE, 24, 16, 8, 0);
@@ -365,20 +374,25 @@ fill_checker_##format_name (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  guint8 *p; \
+  guint8 *first, *p; \
   gint comp_width, comp_height; \
   gint rowstride; \
   \
-  p = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
+  first = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   for (i = 0; i < comp_height; i++) { \
+    p = first + i * rowstride; \
+    /* Only the first row of each phase of the pattern is generated */ \
+    if (i != 0 && i != 8) { \
+      memcpy (p, first + (i & 0x8) * rowstride, comp_width); \
+      continue; \
+    } \
     for (j = 0; j < comp_width; j++) { \
       *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
     } \
-    p += rowstride - comp_width; \
   } \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 1); \
@@ -446,20 +460,20 @@ fill_color_##format_name (GstVideoFrame * frame, \
 #define GST_ROUND_UP_1(x) (x)
 
 PLANAR_YUV_BLEND (i420, GST_VIDEO_FORMAT_I420, GST_ROUND_UP_2,
-    GST_ROUND_UP_2, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_2, memcpy, compositor_blend_u8);
 PLANAR_YUV_FILL_CHECKER (i420, GST_VIDEO_FORMAT_I420, memset);
 PLANAR_YUV_FILL_COLOR (i420, GST_VIDEO_FORMAT_I420, memset);
 PLANAR_YUV_FILL_COLOR (yv12, GST_VIDEO_FORMAT_YV12, memset);
 PLANAR_YUV_BLEND (y444, GST_VIDEO_FORMAT_Y444, GST_ROUND_UP_1,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, compositor_blend_u8);
 PLANAR_YUV_FILL_CHECKER (y444, GST_VIDEO_FORMAT_Y444, memset);
 PLANAR_YUV_FILL_COLOR (y444, GST_VIDEO_FORMAT_Y444, memset);
 PLANAR_YUV_BLEND (y42b, GST_VIDEO_FORMAT_Y42B, GST_ROUND_UP_2,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, compositor_blend_u8);
 PLANAR_YUV_FILL_CHECKER (y42b, GST_VIDEO_FORMAT_Y42B, memset);
 PLANAR_YUV_FILL_COLOR (y42b, GST_VIDEO_FORMAT_Y42B, memset);
 PLANAR_YUV_BLEND (y41b, GST_VIDEO_FORMAT_Y41B, GST_ROUND_UP_4,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, compositor_blend_u8);
 PLANAR_YUV_FILL_CHECKER (y41b, GST_VIDEO_FORMAT_Y41B, memset);
 PLANAR_YUV_FILL_COLOR (y41b, GST_VIDEO_FORMAT_Y41B, memset);
 
@@ -539,18 +553,18 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     ypos = 0; \
   } \
   /* If x or y offset are larger then the source it's outside of the picture */ \
-  if (xoffset > src_width || yoffset > src_height) { \
+  if (xoffset >= src_width || yoffset >= src_height) { \
     return; \
   } \
   \
   /* adjust width/height if the src is bigger than dest */ \
-  if (xpos + src_width > dest_width) { \
+  if (xpos + b_src_width > dest_width) { \
     b_src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
+  if (ypos + b_src_height > dest_height) { \
     b_src_height = dest_height - ypos; \
   } \
-  if (b_src_width < 0 || b_src_height < 0) { \
+  if (b_src_width <= 0 || b_src_height <= 0) { \
     return; \
   } \
   \
@@ -594,20 +608,25 @@ fill_checker_##format_name (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  guint8 *p; \
+  guint8 *first, *p; \
   gint comp_width, comp_height; \
   gint rowstride; \
   \
-  p = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
+  first = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   for (i = 0; i < comp_height; i++) { \
+    p = first + i * rowstride; \
+    /* Only the first row of each phase of the pattern is generated */ \
+    if (i != 0 && i != 8) { \
+      memcpy (p, first + (i & 0x8) * rowstride, comp_width); \
+      continue; \
+    } \
     for (j = 0; j < comp_width; j++) { \
       *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
     } \
-    p += rowstride - comp_width; \
   } \
   \
   p = GST_VIDEO_FRAME_PLANE_DATA (frame, 1); \
@@ -657,10 +676,10 @@ fill_color_##format_name (GstVideoFrame * frame, \
   } \
 }
 
-NV_YUV_BLEND (nv12, memcpy, compositor_orc_blend_u8);
+NV_YUV_BLEND (nv12, memcpy, compositor_blend_u8);
 NV_YUV_FILL_CHECKER (nv12, memset);
 NV_YUV_FILL_COLOR (nv12, memset);
-NV_YUV_BLEND (nv21, memcpy, compositor_orc_blend_u8);
+NV_YUV_BLEND (nv21, memcpy, compositor_blend_u8);
 NV_YUV_FILL_CHECKER (nv21, memset);
 
 /* RGB, BGR, xRGB, xBGR, RGBx, BGRx */
@@ -710,6 +729,9 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_height = dest_height - ypos; \
   } \
   \
+  if (src_height <= 0 || src_width <= 0) \
+    return; \
+  \
   dest = dest + bpp * xpos + (ypos * dest_stride); \
   /* If it's completely transparent... we just return */ \
   if (G_UNLIKELY (src_alpha == 0.0)) { \
@@ -737,23 +759,27 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  gint stride, dest_add, width, height; \
-  guint8 *dest; \
+  gint stride, width, height; \
+  guint8 *first, *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   height = GST_VIDEO_FRAME_HEIGHT (frame); \
-  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
+  first = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
-  dest_add = stride - width * bpp; \
   \
   for (i = 0; i < height; i++) { \
+    dest = first + i * stride; \
+    /* Only the first row of each phase of the pattern is generated */ \
+    if (i != 0 && i != 8) { \
+      memcpy (dest, first + (i & 0x8) * stride, width * bpp); \
+      continue; \
+    } \
     for (j = 0; j < width; j++) { \
       dest[r] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* red */ \
       dest[g] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* green */ \
       dest[b] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* blue */ \
       dest += bpp; \
     } \
-    dest += dest_add; \
   } \
 }
 
@@ -766,19 +792,25 @@ fill_color_##name (GstVideoFrame * frame, \
   gint i; \
   gint dest_stride; \
   gint width, height; \
-  guint8 *dest; \
+  guint8 *first, *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   height = GST_VIDEO_FRAME_HEIGHT (frame); \
-  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
+  first = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   red = YUV_TO_R (colY, colU, colV); \
   green = YUV_TO_G (colY, colU, colV); \
   blue = YUV_TO_B (colY, colU, colV); \
   \
-  for (i = 0; i < height; i++) { \
-    MEMSET_RGB (dest, red, green, blue, width); \
+  if (height == 0) \
+    return; \
+  \
+  /* Fill the first row, which is then copied as a whole */ \
+  MEMSET_RGB (first, red, green, blue, width); \
+  dest = first + dest_stride; \
+  for (i = 1; i < height; i++) { \
+    memcpy (dest, first, width * bpp); \
     dest += dest_stride; \
   } \
 }
@@ -807,7 +839,7 @@ _memset_##name (guint8* dest, gint red, gint green, gint blue, gint width) { \
 
 #define _orc_memcpy_u32(dest,src,len) compositor_orc_memcpy_u32((guint32 *) dest, (const guint32 *) src, len/4)
 
-RGB_BLEND (rgb, 3, memcpy, compositor_orc_blend_u8);
+RGB_BLEND (rgb, 3, memcpy, compositor_blend_u8);
 RGB_FILL_CHECKER_C (rgb, 3, 0, 1, 2);
 MEMSET_RGB_C (rgb, 0, 1, 2);
 RGB_FILL_COLOR (rgb_c, 3, _memset_rgb_c);
@@ -815,7 +847,7 @@ RGB_FILL_COLOR (rgb_c, 3, _memset_rgb_c);
 MEMSET_RGB_C (bgr, 2, 1, 0);
 RGB_FILL_COLOR (bgr_c, 3, _memset_bgr_c);
 
-RGB_BLEND (xrgb, 4, _orc_memcpy_u32, compositor_orc_blend_u8);
+RGB_BLEND (xrgb, 4, _orc_memcpy_u32, compositor_blend_u8);
 RGB_FILL_CHECKER_C (xrgb, 4, 1, 2, 3);
 MEMSET_XRGB (xrgb, 24, 16, 0);
 RGB_FILL_COLOR (xrgb, 4, _memset_xrgb);
@@ -879,6 +911,9 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_height = dest_height - ypos; \
   } \
   \
+  if (src_height <= 0 || src_width <= 0) \
+    return; \
+  \
   dest = dest + 2 * xpos + (ypos * dest_stride); \
   /* If it's completely transparent... we just return */ \
   if (G_UNLIKELY (src_alpha == 0.0)) { \
@@ -906,18 +941,24 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  gint dest_add; \
+  gint stride; \
   gint width, height; \
-  guint8 *dest; \
+  guint8 *first, *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   width = GST_ROUND_UP_2 (width); \
   height = GST_VIDEO_FRAME_HEIGHT (frame); \
-  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
-  dest_add = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) - width * 2; \
+  first = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   width /= 2; \
   \
   for (i = 0; i < height; i++) { \
+    dest = first + i * stride; \
+    /* Only the first row of each phase of the pattern is generated */ \
+    if (i != 0 && i != 8) { \
+      memcpy (dest, first + (i & 0x8) * stride, width * 4); \
+      continue; \
+    } \
     for (j = 0; j < width; j++) { \
       dest[Y1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
       dest[Y2] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
@@ -925,7 +966,6 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
       dest[V] = 128; \
       dest += 4; \
     } \
-    dest += dest_add; \
   } \
 }
 
@@ -955,7 +995,7 @@ fill_color_##name (GstVideoFrame * frame, \
   } \
 }
 
-PACKED_422_BLEND (yuy2, memcpy, compositor_orc_blend_u8);
+PACKED_422_BLEND (yuy2, memcpy, compositor_blend_u8);
 PACKED_422_FILL_CHECKER_C (yuy2, 0, 1, 2, 3);
 PACKED_422_FILL_CHECKER_C (uyvy, 1, 0, 3, 2);
 PACKED_422_FILL_COLOR (yuy2, 24, 16, 8, 0);
@@ -1029,6 +1069,15 @@ gst_compositor_init_blend (void)
   GST_DEBUG_CATEGORY_INIT (gst_compositor_blend_debug, "compositor_blend", 0,
       "video compositor blending functions");
 
+#ifdef COMPOSITOR_HAVE_AVX2
+  if (compositor_avx2_supported ()) {
+    GST_INFO ("using AVX2 blending kernels");
+    compositor_blend_u8 = compositor_avx2_blend_u8;
+    compositor_overlay_argb = compositor_avx2_overlay_argb;
+    compositor_overlay_bgra = compositor_avx2_overlay_bgra;
+  }
+#endif
+
   gst_compositor_blend_argb = GST_DEBUG_FUNCPTR (blend_argb);
   gst_compositor_blend_bgra = GST_DEBUG_FUNCPTR (blend_bgra);
   gst_compositor_overlay_argb = GST_DEBUG_FUNCPTR (overlay_argb);
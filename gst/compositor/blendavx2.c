@@ -0,0 +1,208 @@
+/* Video compositor
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "blendavx2.h"
+
+#ifdef COMPOSITOR_HAVE_AVX2
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__ ((target ("avx2")))
+
+gboolean
+compositor_avx2_supported (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+
+/* The scalar helpers below follow the ORC opcodes used in compositororc.orc
+ * step by step, including their 16 bit wrap-around, so that the columns left
+ * over after the vector loop come out exactly as ORC would produce them. */
+
+static inline guint16
+div255w (guint16 x)
+{
+  guint16 t = x + 128;
+
+  return (guint16) (t + (t >> 8)) >> 8;
+}
+
+static inline guint8
+blend_u8_scalar (guint8 d, guint8 s, guint16 p1)
+{
+  guint16 t = (guint16) ((guint16) (s - d) * p1);
+  gint16 v = (gint16) ((guint16) ((d << 8) + t) >> 8);
+
+  return CLAMP (v, 0, 255);
+}
+
+static inline void
+overlay_scalar (guint8 * d, const guint8 * s, guint16 p1, gint a)
+{
+  guint16 as, ad, ad2;
+  gint c;
+
+  as = div255w (s[a] * p1);
+  ad = div255w (d[a] * (guint16) (255 - as));
+  ad2 = ad + as;
+
+  for (c = 0; c < 4; c++) {
+    guint16 dw = (guint16) (d[c] * ad) + (guint16) (s[c] * as);
+
+    if (c != a)
+      d[c] = (ad2 & 0xff) == 0 ? 255 : MIN (dw / (ad2 & 0xff), 255);
+  }
+  d[a] = ad2;
+}
+
+static inline AVX2 __m256i
+div255_epi16 (__m256i x)
+{
+  x = _mm256_add_epi16 (x, _mm256_set1_epi16 (128));
+  return _mm256_srli_epi16 (_mm256_add_epi16 (x, _mm256_srli_epi16 (x, 8)), 8);
+}
+
+/* Unsigned 16 bit n / d clamped to 255, and 255 where d is 0, like ORC's
+ * divluw. n < 65536 and d <= 255 are exact in single precision and the
+ * quotient never rounds up across an integer, so truncating the float
+ * division gives the integer result. */
+static inline AVX2 __m256i
+divluw_epi16 (__m256i n, __m256i d)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi32 (1);
+  __m256i lo, hi, q;
+
+  lo = _mm256_cvttps_epi32 (_mm256_div_ps (_mm256_cvtepi32_ps
+          (_mm256_unpacklo_epi16 (n, zero)),
+          _mm256_cvtepi32_ps (_mm256_max_epi32 (_mm256_unpacklo_epi16 (d,
+                      zero), one))));
+  hi = _mm256_cvttps_epi32 (_mm256_div_ps (_mm256_cvtepi32_ps
+          (_mm256_unpackhi_epi16 (n, zero)),
+          _mm256_cvtepi32_ps (_mm256_max_epi32 (_mm256_unpackhi_epi16 (d,
+                      zero), one))));
+  q = _mm256_min_epu16 (_mm256_packus_epi32 (lo, hi), _mm256_set1_epi16 (255));
+
+  return _mm256_blendv_epi8 (q, _mm256_set1_epi16 (255),
+      _mm256_cmpeq_epi16 (d, zero));
+}
+
+/* One half (4 pixels) of the overlay, widened to 16 bits. sa and da hold the
+ * source and destination alpha repeated over each pixel's 4 channels.
+ * Returns the blended channels, the new alpha goes to *ad2. */
+static inline AVX2 __m256i
+overlay_words (__m256i s, __m256i d, __m256i sa, __m256i da, __m256i p1,
+    __m256i * ad2)
+{
+  __m256i as, ad;
+
+  as = div255_epi16 (_mm256_mullo_epi16 (sa, p1));
+  ad = div255_epi16 (_mm256_mullo_epi16 (da,
+          _mm256_sub_epi16 (_mm256_set1_epi16 (255), as)));
+  *ad2 = _mm256_add_epi16 (ad, as);
+
+  return divluw_epi16 (_mm256_add_epi16 (_mm256_mullo_epi16 (d, ad),
+          _mm256_mullo_epi16 (s, as)), *ad2);
+}
+
+void AVX2
+compositor_avx2_blend_u8 (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i alpha = _mm256_set1_epi16 (p1);
+  gint i, j;
+
+  for (j = 0; j < m; j++) {
+    guint8 *d = d1 + j * d1_stride;
+    const guint8 *s = s1 + j * s1_stride;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+      __m256i dv = _mm256_loadu_si256 ((const __m256i *) (d + i));
+      __m256i sv = _mm256_loadu_si256 ((const __m256i *) (s + i));
+      __m256i dl = _mm256_unpacklo_epi8 (dv, zero);
+      __m256i dh = _mm256_unpackhi_epi8 (dv, zero);
+      __m256i sl = _mm256_unpacklo_epi8 (sv, zero);
+      __m256i sh = _mm256_unpackhi_epi8 (sv, zero);
+
+      /* d = ((d << 8) + (s - d) * alpha) >> 8, all in 16 bits */
+      dl = _mm256_srli_epi16 (_mm256_add_epi16 (_mm256_slli_epi16 (dl, 8),
+              _mm256_mullo_epi16 (_mm256_sub_epi16 (sl, dl), alpha)), 8);
+      dh = _mm256_srli_epi16 (_mm256_add_epi16 (_mm256_slli_epi16 (dh, 8),
+              _mm256_mullo_epi16 (_mm256_sub_epi16 (sh, dh), alpha)), 8);
+      _mm256_storeu_si256 ((__m256i *) (d + i), _mm256_packus_epi16 (dl, dh));
+    }
+    for (; i < n; i++)
+      d[i] = blend_u8_scalar (d[i], s[i], p1);
+  }
+}
+
+/* A is the byte offset of alpha inside a pixel, MASK selects the alpha
+ * words of each 128 bit lane for _mm256_blend_epi16() */
+#define OVERLAY_AVX2(name, A, MASK) \
+void AVX2 \
+compositor_avx2_overlay_##name (guint8 * d1, int d1_stride, \
+    const guint8 * s1, int s1_stride, int p1, int n, int m) \
+{ \
+  const __m256i zero = _mm256_setzero_si256 (); \
+  const __m256i alpha = _mm256_set1_epi16 (p1); \
+  const __m256i amask = _mm256_setr_epi8 (A, A, A, A, 4 + A, 4 + A, 4 + A, \
+      4 + A, 8 + A, 8 + A, 8 + A, 8 + A, 12 + A, 12 + A, 12 + A, 12 + A, \
+      A, A, A, A, 4 + A, 4 + A, 4 + A, 4 + A, 8 + A, 8 + A, 8 + A, 8 + A, \
+      12 + A, 12 + A, 12 + A, 12 + A); \
+  gint i, j; \
+  \
+  for (j = 0; j < m; j++) { \
+    guint8 *d = d1 + j * d1_stride; \
+    const guint8 *s = s1 + j * s1_stride; \
+    \
+    for (i = 0; i + 8 <= n; i += 8) { \
+      __m256i dv = _mm256_loadu_si256 ((const __m256i *) (d + 4 * i)); \
+      __m256i sv = _mm256_loadu_si256 ((const __m256i *) (s + 4 * i)); \
+      __m256i sa = _mm256_shuffle_epi8 (sv, amask); \
+      __m256i da = _mm256_shuffle_epi8 (dv, amask); \
+      __m256i lo, hi, alo, ahi; \
+      \
+      lo = overlay_words (_mm256_unpacklo_epi8 (sv, zero), \
+          _mm256_unpacklo_epi8 (dv, zero), _mm256_unpacklo_epi8 (sa, zero), \
+          _mm256_unpacklo_epi8 (da, zero), alpha, &alo); \
+      hi = overlay_words (_mm256_unpackhi_epi8 (sv, zero), \
+          _mm256_unpackhi_epi8 (dv, zero), _mm256_unpackhi_epi8 (sa, zero), \
+          _mm256_unpackhi_epi8 (da, zero), alpha, &ahi); \
+      lo = _mm256_blend_epi16 (lo, alo, MASK); \
+      hi = _mm256_blend_epi16 (hi, ahi, MASK); \
+      _mm256_storeu_si256 ((__m256i *) (d + 4 * i), \
+          _mm256_packus_epi16 (lo, hi)); \
+    } \
+    for (; i < n; i++) \
+      overlay_scalar (d + 4 * i, s + 4 * i, p1, A); \
+  } \
+}
+
+/* x86 is little endian, ORC's ARGB alpha is the first byte in memory and
+ * BGRA's the last one */
+OVERLAY_AVX2 (argb, 0, 0x11);
+OVERLAY_AVX2 (bgra, 3, 0x88);
+
+#endif /* COMPOSITOR_HAVE_AVX2 */
@@ -0,0 +1,47 @@
+/* Video compositor
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLEND_AVX2_H__
+#define __BLEND_AVX2_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* AVX2 versions of the ORC blending kernels the compositor spends most of
+ * its time in. They take the same arguments as their compositor_orc_*
+ * counterparts and produce bit-identical output, so blend.c can switch to
+ * them at runtime when compositor_avx2_supported() returns TRUE. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#define COMPOSITOR_HAVE_AVX2 1
+
+gboolean compositor_avx2_supported (void);
+
+void compositor_avx2_blend_u8 (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m);
+void compositor_avx2_overlay_argb (guint8 * d1, int d1_stride,
+    const guint8 * s1, int s1_stride, int p1, int n, int m);
+void compositor_avx2_overlay_bgra (guint8 * d1, int d1_stride,
+    const guint8 * s1, int s1_stride, int p1, int n, int m);
+#endif
+
+G_END_DECLS
+
+#endif /* __BLEND_AVX2_H__ */
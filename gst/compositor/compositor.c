@@ -42,6 +42,16 @@
  *   is a simple copy when fully-transparent (0.0) and fully-opaque (1.0). (#gdouble)
  * * "zorder": The z-order position of the picture in the composition (#guint)
  *
+ * The output frame can be blended by several threads in parallel, see the
+ * #GstCompositor:max-threads property. The frame is then split into horizontal
+ * stripes and every stripe is filled and blended independently, keeping the
+ * z-order of the inputs.
+ *
+ * With #GstCompositor:incremental enabled, only the areas of the output frame
+ * that changed since the previous frame are redrawn, i.e. the areas of inputs
+ * that got a new buffer or that were moved, resized, faded or restacked. The
+ * rest is kept from the previous output frame.
+ *
  * ## Sample pipelines
  * |[
  * gst-launch-1.0 \
@@ -290,6 +300,130 @@ clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
   return clamped;
 }
 
+/* Tests whether @rect is completely covered by the union of the @n_rects
+ * rectangles in @rects. @budget bounds the number of rectangles that are
+ * looked at for pathological layouts, in which case @rect is considered to
+ * be visible. */
+static gboolean
+is_rectangle_covered (GstVideoRectangle rect, const GstVideoRectangle * rects,
+    guint n_rects, guint * budget)
+{
+  GstVideoRectangle parts[4];
+  guint i, n_parts = 0;
+  gint x1, y1, x2, y2;
+
+  if (rect.w <= 0 || rect.h <= 0)
+    return TRUE;
+
+  if (n_rects == 0 || *budget == 0)
+    return FALSE;
+  (*budget)--;
+
+  if (is_rectangle_contained (rect, rects[0]))
+    return TRUE;
+
+  x1 = MAX (rect.x, rects[0].x);
+  y1 = MAX (rect.y, rects[0].y);
+  x2 = MIN (rect.x + rect.w, rects[0].x + rects[0].w);
+  y2 = MIN (rect.y + rect.h, rects[0].y + rects[0].h);
+
+  if (x1 >= x2 || y1 >= y2)
+    return is_rectangle_covered (rect, rects + 1, n_rects - 1, budget);
+
+  /* Split the part of rect that is not covered by the first rectangle into
+   * the bands above and below it and the pieces left and right of it */
+  if (y1 > rect.y) {
+    parts[n_parts].x = rect.x;
+    parts[n_parts].y = rect.y;
+    parts[n_parts].w = rect.w;
+    parts[n_parts++].h = y1 - rect.y;
+  }
+  if (y2 < rect.y + rect.h) {
+    parts[n_parts].x = rect.x;
+    parts[n_parts].y = y2;
+    parts[n_parts].w = rect.w;
+    parts[n_parts++].h = rect.y + rect.h - y2;
+  }
+  if (x1 > rect.x) {
+    parts[n_parts].x = rect.x;
+    parts[n_parts].y = y1;
+    parts[n_parts].w = x1 - rect.x;
+    parts[n_parts++].h = y2 - y1;
+  }
+  if (x2 < rect.x + rect.w) {
+    parts[n_parts].x = x2;
+    parts[n_parts].y = y1;
+    parts[n_parts].w = rect.x + rect.w - x2;
+    parts[n_parts++].h = y2 - y1;
+  }
+
+  for (i = 0; i < n_parts; i++) {
+    if (!is_rectangle_covered (parts[i], rects + 1, n_rects - 1, budget))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Maximum number of rectangles looked at per visibility test */
+#define VISIBILITY_BUDGET 1024
+
+/* WITH GST_OBJECT_LOCK !!
+ * Walks the pads from the highest to the lowest zorder and marks the ones
+ * that are completely hidden behind opaque higher-zorder pads, and whether
+ * the background is hidden by all of them together. */
+static void
+gst_compositor_update_visibility (GstCompositor * self)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoRectangle out_rect;
+  GArray *opaque_rects;
+  guint budget;
+  GList *l;
+
+  opaque_rects = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+
+  for (l = g_list_last (GST_ELEMENT (vagg)->sinkpads); l; l = l->prev) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+    GstVideoRectangle frame_rect;
+    gboolean crossfading;
+    gint width, height;
+
+    /* Crossfaded pads are blended with each other first, so they can
+     * neither be skipped nor hide anything */
+    crossfading = cpad->crossfade > 0.0 || (l->prev
+        && GST_COMPOSITOR_PAD (l->prev->data)->crossfade > 0.0);
+
+    _mixer_pad_get_output_size (self, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
+        GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
+    frame_rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+        GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
+
+    budget = VISIBILITY_BUDGET;
+    cpad->obscured = !crossfading && frame_rect.w > 0 && frame_rect.h > 0
+        && is_rectangle_covered (frame_rect,
+        (GstVideoRectangle *) opaque_rects->data, opaque_rects->len, &budget);
+
+    /* Check if there's a buffer to be aggregated, ensure it can't have an
+     * alpha channel, then check opacity */
+    if (!cpad->obscured && !crossfading && frame_rect.w > 0 && frame_rect.h > 0
+        && gst_video_aggregator_pad_has_current_buffer (pad)
+        && cpad->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad->info))
+      g_array_append_val (opaque_rects, frame_rect);
+  }
+
+  out_rect.x = out_rect.y = 0;
+  out_rect.w = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  out_rect.h = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  budget = VISIBILITY_BUDGET;
+  self->background_obscured = is_rectangle_covered (out_rect,
+      (GstVideoRectangle *) opaque_rects->data, opaque_rects->len, &budget);
+
+  g_array_free (opaque_rects, TRUE);
+}
+
 static gboolean
 gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg, GstBuffer * buffer,
@@ -298,8 +432,7 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstCompositor *comp = GST_COMPOSITOR (vagg);
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
   gint width, height;
-  gboolean frame_obscured = FALSE;
-  GList *l;
+  gboolean frame_obscured;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
   GstVideoRectangle frame_rect;
@@ -333,56 +466,23 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     goto done;
   }
 
+  /* The visibility of all pads is computed once per output frame, by
+   * whichever pad is prepared first */
   GST_OBJECT_LOCK (vagg);
-  /* Check if we are crossfading the pad one way or another */
-  l = g_list_find (GST_ELEMENT (vagg)->sinkpads, pad);
-  if ((l->prev && GST_COMPOSITOR_PAD (l->prev->data)->crossfade > 0.0) ||
-      (GST_COMPOSITOR_PAD (pad)->crossfade > 0.0)) {
-    GST_DEBUG_OBJECT (pad, "Is being crossfaded with previous pad");
-    l = NULL;
-  } else {
-    l = l->next;
-  }
-
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
-   * higher-zorder frames */
-  for (; l; l = l->next) {
-    GstVideoRectangle frame2_rect;
-    GstVideoAggregatorPad *pad2 = l->data;
-    GstCompositorPad *cpad2 = GST_COMPOSITOR_PAD (pad2);
-    gint pad2_width, pad2_height;
-
-    _mixer_pad_get_output_size (comp, cpad2, GST_VIDEO_INFO_PAR_N (&vagg->info),
-        GST_VIDEO_INFO_PAR_D (&vagg->info), &pad2_width, &pad2_height);
-
-    /* We don't need to clamp the coords of the second rectangle */
-    frame2_rect.x = cpad2->xpos;
-    frame2_rect.y = cpad2->ypos;
-    /* This is effectively what set_info and the above conversion
-     * code do to calculate the desired width/height */
-    frame2_rect.w = pad2_width;
-    frame2_rect.h = pad2_height;
-
-    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
-     * channel, then check opacity and frame boundaries */
-    if (gst_video_aggregator_pad_has_current_buffer (pad2)
-        && cpad2->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad2->info)
-        && is_rectangle_contained (frame_rect, frame2_rect)) {
-      frame_obscured = TRUE;
-      GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %s %ix%i@(%i,%i) "
-          "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
-          frame_rect.x, frame_rect.y, GST_PAD_NAME (pad2), frame2_rect.w,
-          frame2_rect.h, frame2_rect.x, frame2_rect.y,
-          GST_VIDEO_INFO_WIDTH (&vagg->info),
-          GST_VIDEO_INFO_HEIGHT (&vagg->info));
-      break;
-    }
+  if (!comp->visibility_valid) {
+    gst_compositor_update_visibility (comp);
+    comp->visibility_valid = TRUE;
   }
+  frame_obscured = cpad->obscured;
   GST_OBJECT_UNLOCK (vagg);
 
-  if (frame_obscured)
+  if (frame_obscured) {
+    GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by higher-zorder pads "
+        "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
+        frame_rect.x, frame_rect.y, GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
     goto done;
+  }
 
   return
       GST_VIDEO_AGGREGATOR_PAD_CLASS
@@ -437,6 +537,16 @@ gst_compositor_pad_create_conversion_info (GstVideoAggregatorConvertPad * pad,
   }
 }
 
+static void
+gst_compositor_pad_finalize (GObject * object)
+{
+  GstCompositorPad *pad = GST_COMPOSITOR_PAD (object);
+
+  gst_buffer_replace (&pad->drawn_buffer, NULL);
+
+  G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -448,6 +558,7 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   gobject_class->set_property = gst_compositor_pad_set_property;
   gobject_class->get_property = gst_compositor_pad_get_property;
+  gobject_class->finalize = gst_compositor_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
       g_param_spec_int ("xpos", "X Position", "X Position of the picture",
@@ -494,10 +605,14 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_MAX_THREADS 1
+#define DEFAULT_INCREMENTAL FALSE
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_MAX_THREADS,
+  PROP_INCREMENTAL,
 };
 
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
@@ -523,6 +638,26 @@ gst_compositor_background_get_type (void)
   return compositor_background_type;
 }
 
+/* WITH GST_OBJECT_LOCK !!
+ * Forgets the previous output frame and what was drawn into it, so that the
+ * next frame is drawn completely */
+static void
+gst_compositor_reset_damage (GstCompositor * self)
+{
+  GList *l;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (l->data);
+
+    cpad->drawn = FALSE;
+    gst_buffer_replace (&cpad->drawn_buffer, NULL);
+  }
+
+  gst_buffer_replace (&self->retained_buffer, NULL);
+  self->reuse_output = FALSE;
+  self->full_redraw = TRUE;
+}
+
 static void
 gst_compositor_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
@@ -533,6 +668,16 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_INCREMENTAL:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->incremental);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -547,7 +692,21 @@ gst_compositor_set_property (GObject * object,
 
   switch (prop_id) {
     case PROP_BACKGROUND:
+      GST_OBJECT_LOCK (self);
       self->background = g_value_get_enum (value);
+      self->full_redraw = TRUE;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->max_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_INCREMENTAL:
+      GST_OBJECT_LOCK (self);
+      self->incremental = g_value_get_boolean (value);
+      gst_compositor_reset_damage (self);
+      GST_OBJECT_UNLOCK (self);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -816,6 +975,10 @@ _negotiated_caps (GstAggregator * agg, GstCaps * caps)
     return FALSE;
   }
 
+  GST_OBJECT_LOCK (agg);
+  gst_compositor_reset_damage (GST_COMPOSITOR (agg));
+  GST_OBJECT_UNLOCK (agg);
+
   return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
 }
 
@@ -950,6 +1113,331 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
   return all_crossfading;
 }
 
+static void
+gst_compositor_fill_background (GstCompositor * self, GstVideoFrame * frame)
+{
+  switch (self->background) {
+    case COMPOSITOR_BACKGROUND_CHECKER:
+      self->fill_checker (frame);
+      break;
+    case COMPOSITOR_BACKGROUND_BLACK:
+      self->fill_color (frame, 16, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_WHITE:
+      self->fill_color (frame, 240, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_TRANSPARENT:
+      gst_compositor_fill_transparent (self, frame, NULL);
+      break;
+  }
+}
+
+/* Stripes are a multiple of the checker pattern size so that the background
+ * looks the same as when filled at once. This is also a multiple of the
+ * vertical chroma subsampling of all supported formats. */
+#define STRIPE_ALIGN 16
+/* Same for the horizontal position of redrawn regions, where the checker
+ * pattern of the packed 4:2:2 formats repeats every 32 pixels */
+#define REGION_X_ALIGN 32
+
+/* A prepared input frame and where to put it in the output frame */
+typedef struct
+{
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gdouble alpha;
+} CompositorLayer;
+
+/* A horizontal band of (a region of) the output frame, processed by one
+ * thread */
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  gint x, width;
+  gint y_start, height;
+
+  /* If NULL, the stripe is filled with the background */
+  GArray *layers;
+  BlendFunction composite;
+} CompositorStripe;
+
+/* Sets up @sub as a view on the @width x @height rectangle at (@x, @y) of
+ * @frame, so that the blend and fill functions can work on it unchanged.
+ * @x and @y have to be aligned to the chroma subsampling. */
+static void
+gst_compositor_get_sub_frame (GstVideoFrame * frame, gint x, gint y,
+    gint width, gint height, GstVideoFrame * sub)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint i;
+
+  *sub = *frame;
+  GST_VIDEO_INFO_WIDTH (&sub->info) = width;
+  GST_VIDEO_INFO_HEIGHT (&sub->info) = height;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    guint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, i);
+
+    sub->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i, x) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, i);
+  }
+}
+
+static void
+gst_compositor_process_stripe (CompositorStripe * stripe)
+{
+  GstVideoFrame frame;
+  guint i;
+
+  gst_compositor_get_sub_frame (stripe->outframe, stripe->x, stripe->y_start,
+      stripe->width, stripe->height, &frame);
+
+  if (!stripe->layers) {
+    gst_compositor_fill_background (stripe->self, &frame);
+    return;
+  }
+
+  /* Layers are sorted by zorder, the blend functions take care of clipping
+   * them to the stripe. Layers not touching the stripe at all are skipped,
+   * not all blend functions cope with an empty clipped area. */
+  for (i = 0; i < stripe->layers->len; i++) {
+    CompositorLayer *layer =
+        &g_array_index (stripe->layers, CompositorLayer, i);
+
+    if (layer->xpos >= stripe->x + stripe->width
+        || layer->ypos >= stripe->y_start + stripe->height
+        || layer->xpos + GST_VIDEO_FRAME_WIDTH (layer->frame) <= stripe->x
+        || layer->ypos + GST_VIDEO_FRAME_HEIGHT (layer->frame) <=
+        stripe->y_start)
+      continue;
+
+    stripe->composite (layer->frame, layer->xpos - stripe->x,
+        layer->ypos - stripe->y_start, layer->alpha, &frame,
+        COMPOSITOR_BLEND_MODE_NORMAL);
+  }
+}
+
+static void
+gst_compositor_blend_task (gpointer task, gpointer user_data)
+{
+  gst_compositor_process_stripe ((CompositorStripe *) task);
+}
+
+/* Returns the number of stripes @height rows are split into for @n_threads
+ * threads, with all but the last one being @stripe_height rows high */
+static guint
+gst_compositor_get_n_stripes (gint height, guint n_threads,
+    gint * stripe_height)
+{
+  *stripe_height = GST_ROUND_UP_N (height / n_threads, STRIPE_ALIGN);
+  if (*stripe_height < STRIPE_ALIGN)
+    *stripe_height = STRIPE_ALIGN;
+
+  return (height + *stripe_height - 1) / *stripe_height;
+}
+
+/* Fills @region of @outframe (or all of it if %NULL) with the background if
+ * @layers is NULL, otherwise blends @layers into it. The region is split into
+ * stripes, using the blend threads if there is more than one stripe.
+ * Returns once all stripes are done. */
+static void
+gst_compositor_blend_stripes (GstCompositor * self, GstVideoFrame * outframe,
+    const GstVideoRectangle * region, guint n_threads, GArray * layers,
+    BlendFunction composite)
+{
+  CompositorStripe *stripes;
+  gpointer *tasks;
+  GstVideoRectangle full;
+  gint stripe_height;
+  guint i, n_stripes;
+
+  if (!region) {
+    full.x = full.y = 0;
+    full.w = GST_VIDEO_FRAME_WIDTH (outframe);
+    full.h = GST_VIDEO_FRAME_HEIGHT (outframe);
+    region = &full;
+  }
+
+  n_stripes = gst_compositor_get_n_stripes (region->h, n_threads,
+      &stripe_height);
+  stripes = g_newa (CompositorStripe, n_stripes);
+  tasks = g_newa (gpointer, n_stripes);
+
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].self = self;
+    stripes[i].outframe = outframe;
+    stripes[i].x = region->x;
+    stripes[i].width = region->w;
+    stripes[i].y_start = region->y + i * stripe_height;
+    stripes[i].height = MIN (stripe_height, region->h - i * stripe_height);
+    stripes[i].layers = layers;
+    stripes[i].composite = composite;
+    tasks[i] = &stripes[i];
+  }
+
+  if (!self->blend_runner)
+    self->blend_runner = gst_video_task_runner_new (gst_compositor_blend_task,
+        self);
+
+  /* The first stripe is handled by the aggregator thread itself */
+  gst_video_task_runner_run (self->blend_runner, tasks, n_stripes, n_threads);
+}
+
+/* Adds @rect, clamped to the output frame and aligned to the stripes and the
+ * checker pattern, to the regions in @damage. Overlapping regions are merged
+ * so that nothing is drawn twice. */
+static void
+gst_compositor_add_damage (GArray * damage, const GstVideoRectangle * rect,
+    gint width, gint height)
+{
+  GstVideoRectangle region;
+  gint x2, y2;
+  guint i;
+
+  region = clamp_rectangle (rect->x, rect->y, rect->w, rect->h, width, height);
+  if (region.w == 0 || region.h == 0)
+    return;
+
+  x2 = MIN (GST_ROUND_UP_N (region.x + region.w, REGION_X_ALIGN), width);
+  y2 = MIN (GST_ROUND_UP_N (region.y + region.h, STRIPE_ALIGN), height);
+  region.x = GST_ROUND_DOWN_N (region.x, REGION_X_ALIGN);
+  region.y = GST_ROUND_DOWN_N (region.y, STRIPE_ALIGN);
+  region.w = x2 - region.x;
+  region.h = y2 - region.y;
+
+  i = 0;
+  while (i < damage->len) {
+    GstVideoRectangle *r = &g_array_index (damage, GstVideoRectangle, i);
+
+    if (r->x < region.x + region.w && region.x < r->x + r->w &&
+        r->y < region.y + region.h && region.y < r->y + r->h) {
+      x2 = MAX (r->x + r->w, region.x + region.w);
+      y2 = MAX (r->y + r->h, region.y + region.h);
+      region.x = MIN (r->x, region.x);
+      region.y = MIN (r->y, region.y);
+      region.w = x2 - region.x;
+      region.h = y2 - region.y;
+
+      /* The merged region might overlap regions that were checked already */
+      g_array_remove_index_fast (damage, i);
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+
+  g_array_append_val (damage, region);
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Compares what every pad is going to draw with what it drew into the
+ * previous output frame, and remembers the former for the next frame.
+ * Returns: the regions of the output frame that have to be redrawn, or %NULL
+ * if the whole frame has to be redrawn
+ */
+static GArray *
+gst_compositor_get_damage (GstCompositor * self)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  gint width = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  gint height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  gboolean full_redraw = self->full_redraw;
+  GArray *damage;
+  guint index = 0;
+  GList *l;
+
+  self->full_redraw = FALSE;
+  damage = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next, index++) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+    GstVideoFrame *prepared_frame =
+        gst_video_aggregator_pad_get_prepared_frame (pad);
+    GstVideoRectangle rect = { 0, };
+    GstBuffer *buffer = NULL;
+    gboolean visible = prepared_frame != NULL;
+
+    /* Crossfaded pads are not drawn at their position, so don't bother and
+     * redraw everything, also in the next frame */
+    if (cpad->crossfade > 0.0) {
+      full_redraw = TRUE;
+      self->full_redraw = TRUE;
+    }
+
+    if (visible) {
+      rect.x = cpad->xpos;
+      rect.y = cpad->ypos;
+      rect.w = GST_VIDEO_FRAME_WIDTH (prepared_frame);
+      rect.h = GST_VIDEO_FRAME_HEIGHT (prepared_frame);
+      buffer = gst_video_aggregator_pad_get_current_buffer (pad);
+    }
+
+    /* The reference kept on the drawn buffer makes sure that upstream can't
+     * reuse it for different content */
+    if (!full_redraw && (visible != cpad->drawn || (visible &&
+                (buffer != cpad->drawn_buffer ||
+                    rect.x != cpad->drawn_rect.x ||
+                    rect.y != cpad->drawn_rect.y ||
+                    rect.w != cpad->drawn_rect.w ||
+                    rect.h != cpad->drawn_rect.h ||
+                    cpad->alpha != cpad->drawn_alpha ||
+                    index != cpad->drawn_index)))) {
+      GST_LOG_OBJECT (pad, "Changed since the previous frame");
+
+      if (cpad->drawn)
+        gst_compositor_add_damage (damage, &cpad->drawn_rect, width, height);
+      if (visible)
+        gst_compositor_add_damage (damage, &rect, width, height);
+    }
+
+    cpad->drawn = visible;
+    cpad->drawn_rect = rect;
+    cpad->drawn_alpha = cpad->alpha;
+    cpad->drawn_index = index;
+    gst_buffer_replace (&cpad->drawn_buffer, buffer);
+  }
+
+  if (full_redraw) {
+    g_array_free (damage, TRUE);
+    return NULL;
+  }
+
+  return damage;
+}
+
+static GstFlowReturn
+gst_compositor_create_output_buffer (GstVideoAggregator * vagg,
+    GstBuffer ** outbuf)
+{
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstBuffer *retained = NULL;
+
+  GST_OBJECT_LOCK (vagg);
+  /* Draw into the previous output frame again if downstream released it */
+  if (self->incremental && self->retained_buffer &&
+      gst_buffer_is_writable (self->retained_buffer) &&
+      gst_buffer_is_all_memory_writable (self->retained_buffer)) {
+    retained = self->retained_buffer;
+    self->retained_buffer = NULL;
+    self->reuse_output = TRUE;
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (retained) {
+    GST_LOG_OBJECT (self, "Reusing previous output buffer");
+    *outbuf = retained;
+    return GST_FLOW_OK;
+  }
+
+  return GST_VIDEO_AGGREGATOR_CLASS (parent_class)->create_output_buffer (vagg,
+      outbuf);
+}
+
 static GstFlowReturn
 gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 {
@@ -957,37 +1445,95 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
   GstVideoFrame out_frame, *outframe;
+  GstBuffer *previous = NULL;
+  GArray *damage = NULL;
+  GstVideoRectangle *regions = NULL;
+  gboolean draw_background, incremental, reused;
+  guint i, n_regions, n_threads;
+
+  GST_OBJECT_LOCK (vagg);
+  /* The visibility was computed while preparing the frames */
+  draw_background = !self->visibility_valid || !self->background_obscured;
+  self->visibility_valid = FALSE;
+  n_threads = self->max_threads;
+  incremental = self->incremental;
+  /* outbuf is either the previous output frame or a new buffer, in which case
+   * the previous frame is copied into it */
+  reused = self->reuse_output;
+  self->reuse_output = FALSE;
+  previous = self->retained_buffer;
+  self->retained_buffer = NULL;
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
+    if (previous)
+      gst_buffer_unref (previous);
     return GST_FLOW_ERROR;
   }
 
   outframe = &out_frame;
+
+  if (incremental) {
+    GST_OBJECT_LOCK (vagg);
+    if (!reused && !previous)
+      self->full_redraw = TRUE;
+    damage = gst_compositor_get_damage (self);
+    GST_OBJECT_UNLOCK (vagg);
+  }
+
+  if (damage && !reused) {
+    GstVideoFrame prev_frame;
+
+    if (gst_video_frame_map (&prev_frame, &vagg->info, previous,
+            GST_MAP_READ)) {
+      gst_video_frame_copy (outframe, &prev_frame);
+      gst_video_frame_unmap (&prev_frame);
+    } else {
+      GST_WARNING_OBJECT (vagg, "Could not map previous output buffer");
+      g_array_free (damage, TRUE);
+      damage = NULL;
+    }
+  }
+
+  if (previous)
+    gst_buffer_unref (previous);
+
+  if (damage) {
+    GST_LOG_OBJECT (self, "Redrawing %u regions", damage->len);
+    regions = (GstVideoRectangle *) damage->data;
+    n_regions = damage->len;
+  } else {
+    n_regions = 1;
+  }
+
   /* default to blending */
   composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
-   * don't bother drawing the background at all. */
-  switch (self->background) {
-    case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
-      break;
-    case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_TRANSPARENT:
-      gst_compositor_fill_transparent (self, outframe, NULL);
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
-      break;
+  /* use overlay to keep background transparent */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+
+  /* If the frames to be composited completely obscure the background,
+   * don't bother drawing the background at all */
+  if (draw_background) {
+    for (i = 0; i < n_regions; i++)
+      gst_compositor_blend_stripes (self, outframe,
+          regions ? &regions[i] : NULL, n_threads, NULL, NULL);
+  } else {
+    GST_LOG_OBJECT (self, "Background is obscured, not drawing it");
   }
 
   GST_OBJECT_LOCK (vagg);
   /* First mix the crossfade frames as required */
   if (!gst_compositor_crossfade_frames (self, outframe)) {
+    GArray *layers;
+
+    layers = g_array_sized_new (FALSE, FALSE, sizeof (CompositorLayer),
+        GST_ELEMENT (vagg)->numsinkpads);
+
     for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
       GstVideoAggregatorPad *pad = l->data;
       GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
@@ -995,18 +1541,46 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
           gst_video_aggregator_pad_get_prepared_frame (pad);
 
       if (prepared_frame != NULL) {
-        composite (prepared_frame,
-            compo_pad->crossfaded ? 0 : compo_pad->xpos,
-            compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
-            outframe, COMPOSITOR_BLEND_MODE_NORMAL);
+        CompositorLayer layer;
+
+        layer.frame = prepared_frame;
+        layer.xpos = compo_pad->crossfaded ? 0 : compo_pad->xpos;
+        layer.ypos = compo_pad->crossfaded ? 0 : compo_pad->ypos;
+        layer.alpha = compo_pad->alpha;
+
+        /* Draw the pads exactly like the damage was computed for, even if
+         * their properties were changed in the meantime */
+        if (damage) {
+          layer.xpos = compo_pad->drawn_rect.x;
+          layer.ypos = compo_pad->drawn_rect.y;
+          layer.alpha = compo_pad->drawn_alpha;
+        }
+
+        g_array_append_val (layers, layer);
+
         compo_pad->crossfaded = FALSE;
       }
     }
+
+    if (layers->len > 0) {
+      for (i = 0; i < n_regions; i++)
+        gst_compositor_blend_stripes (self, outframe,
+            regions ? &regions[i] : NULL, n_threads, layers, composite);
+    }
+
+    g_array_free (layers, TRUE);
   }
+
+  /* Keep the frame to only draw the changes into it next time */
+  if (self->incremental)
+    gst_buffer_replace (&self->retained_buffer, outbuf);
   GST_OBJECT_UNLOCK (vagg);
 
   gst_video_frame_unmap (outframe);
 
+  if (damage)
+    g_array_free (damage, TRUE);
+
   return GST_FLOW_OK;
 }
 
@@ -1047,6 +1621,11 @@ gst_compositor_release_pad (GstElement * element, GstPad * pad)
   gst_child_proxy_child_removed (GST_CHILD_PROXY (compositor), G_OBJECT (pad),
       GST_OBJECT_NAME (pad));
 
+  /* Whatever the pad covered has to be redrawn */
+  GST_OBJECT_LOCK (compositor);
+  compositor->full_redraw = TRUE;
+  GST_OBJECT_UNLOCK (compositor);
+
   GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
 }
 
@@ -1092,6 +1671,35 @@ _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
   }
 }
 
+static gboolean
+_stop (GstAggregator * agg)
+{
+  GstCompositor *self = GST_COMPOSITOR (agg);
+
+  if (self->blend_runner) {
+    gst_video_task_runner_free (self->blend_runner);
+    self->blend_runner = NULL;
+  }
+
+  GST_OBJECT_LOCK (self);
+  gst_compositor_reset_damage (self);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_AGGREGATOR_CLASS (parent_class)->stop (agg);
+}
+
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  if (self->blend_runner)
+    gst_video_task_runner_free (self->blend_runner);
+  gst_buffer_replace (&self->retained_buffer, NULL);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 /* GObject boilerplate */
 static void
 gst_compositor_class_init (GstCompositorClass * klass)
@@ -1104,6 +1712,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_compositor_request_new_pad);
@@ -1112,6 +1721,9 @@ gst_compositor_class_init (GstCompositorClass * klass)
   agg_class->sink_query = _sink_query;
   agg_class->fixate_src_caps = _fixate_caps;
   agg_class->negotiated_src_caps = _negotiated_caps;
+  agg_class->stop = _stop;
+  videoaggregator_class->create_output_buffer =
+      gst_compositor_create_output_buffer;
   videoaggregator_class->aggregate_frames = gst_compositor_aggregate_frames;
 
   g_object_class_install_property (gobject_class, PROP_BACKGROUND,
@@ -1119,6 +1731,32 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:max-threads:
+   *
+   * Maximum number of threads used for filling the background and blending
+   * the inputs. The output frame is split into horizontal stripes of which
+   * each is handled by one thread. 0 uses one thread per CPU core.
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of blending threads (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:incremental:
+   *
+   * Only redraw the areas of the output frame that changed since the previous
+   * frame. The previous output buffer is kept and drawn into again once
+   * downstream released it, or copied otherwise. This saves most of the work
+   * if only some of the inputs change per frame, e.g. for static overlays.
+   */
+  g_object_class_install_property (gobject_class, PROP_INCREMENTAL,
+      g_param_spec_boolean ("incremental", "Incremental",
+          "Only redraw the changed areas of the output frame",
+          DEFAULT_INCREMENTAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1135,6 +1773,9 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  self->max_threads = DEFAULT_MAX_THREADS;
+  self->incremental = DEFAULT_INCREMENTAL;
+  self->full_redraw = TRUE;
 }
 
 /* GstChildProxy implementation */
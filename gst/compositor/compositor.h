@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoaggregator.h>
+#include <gst/video/gstvideotaskrunner.h>
 
 #include "blend.h"
 
@@ -72,6 +73,20 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* occlusion of the current output frame, protected by the object lock */
+  gboolean visibility_valid;
+  gboolean background_obscured;
+
+  /* parallel blending */
+  guint max_threads;
+  GstVideoTaskRunner *blend_runner;
+
+  /* incremental compositing, protected by the object lock */
+  gboolean incremental;
+  gboolean full_redraw;
+  gboolean reuse_output;
+  GstBuffer *retained_buffer;
 };
 
 struct _GstCompositorClass
@@ -55,6 +55,17 @@ struct _GstCompositorPad
   gdouble crossfade;
 
   gboolean crossfaded;
+
+  /* completely hidden behind higher-zorder pads in the current frame */
+  gboolean obscured;
+
+  /* what was drawn for this pad into the retained output frame, with the
+   * unclamped position and size of the frame */
+  gboolean drawn;
+  GstVideoRectangle drawn_rect;
+  gdouble drawn_alpha;
+  guint drawn_index;
+  GstBuffer *drawn_buffer;
 };
 
 struct _GstCompositorPadClass
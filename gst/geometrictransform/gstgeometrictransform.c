@@ -49,7 +49,9 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_INTERPOLATION,
+  PROP_MAX_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -74,23 +76,365 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
   return method_type;
 }
 
+#define GST_GT_INTERPOLATION_METHOD_TYPE ( \
+    gst_geometric_transform_interpolation_method_get_type())
+static GType
+gst_geometric_transform_interpolation_method_get_type (void)
+{
+  static GType method_type = 0;
+
+  static const GEnumValue method_types[] = {
+    {GST_GT_INTERPOLATION_NEAREST, "Nearest neighbour", "nearest"},
+    {GST_GT_INTERPOLATION_BILINEAR, "Bilinear", "bilinear"},
+    {0, NULL, NULL}
+  };
+
+  if (!method_type) {
+    method_type =
+        g_enum_register_static ("GstGeometricTransformInterpolationMethod",
+        method_types);
+  }
+  return method_type;
+}
+
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_INTERPOLATION GST_GT_INTERPOLATION_NEAREST
+#define DEFAULT_MAX_THREADS 1
+
+/* Frames are not split into stripes of less rows than this for the worker
+ * threads */
+#define MIN_STRIPE_HEIGHT 16
+
+/* A range of rows of the map to generate, or of the output frame to map,
+ * processed by one thread */
+typedef struct
+{
+  GstGeometricTransform *gt;
+  gint y_start, height;
+
+  /* If NULL, the rows of the map are generated */
+  GstVideoFrame *in_frame;
+  GstVideoFrame *out_frame;
+
+  gboolean ret;
+} GstGeometricTransformStripe;
+
+/* Computes the map entry of the input position (@in_x, @in_y), after
+ * applying the off edge pixels method. @frac may be NULL when not
+ * interpolating. Must be called with the object lock */
+static void
+gst_geometric_transform_get_map_entry (GstGeometricTransform * gt,
+    gdouble in_x, gdouble in_y, gint32 * offset, guint16 * frac)
+{
+  gint trunc_x, trunc_y;
+  guint fx, fy;
+
+  /* operate on out of edge pixels */
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      in_x = CLAMP (in_x, 0, gt->width - 1);
+      in_y = CLAMP (in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      in_x = gst_gm_mod_float (in_x, gt->width);
+      in_y = gst_gm_mod_float (in_y, gt->height);
+      if (in_x < 0)
+        in_x += gt->width;
+      if (in_y < 0)
+        in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  /* positions are truncated, so anything above -1 still maps to the first
+   * row or column */
+  if (!(in_x > -1.0 && in_x < gt->width && in_y > -1.0 && in_y < gt->height)) {
+    *offset = -1;
+    if (frac)
+      *frac = 0;
+    return;
+  }
+
+  in_x = MAX (in_x, 0);
+  in_y = MAX (in_y, 0);
+  trunc_x = (gint) in_x;
+  trunc_y = (gint) in_y;
+
+  *offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+
+  if (frac) {
+    /* never interpolate with pixels past the last column or row */
+    fx = trunc_x < gt->width - 1 ? (guint) ((in_x - trunc_x) * 256) : 0;
+    fy = trunc_y < gt->height - 1 ? (guint) ((in_y - trunc_y) * 256) : 0;
+    *frac = (MIN (fx, 255) << 8) | MIN (fy, 255);
+  }
+}
+
+#define BILINEAR(v00, v01, v10, v11) \
+  ((((v00) * (256 - fx) + (v01) * fx) * (256 - fy) + \
+    ((v10) * (256 - fx) + (v11) * fx) * fy + 32768) >> 16)
+
+static void
+gst_geometric_transform_interpolate_row (GstGeometricTransform * gt,
+    const guint8 * in_data, guint8 * out_row, const gint32 * map,
+    const guint16 * map_frac)
+{
+  gint pixel_stride = gt->pixel_stride;
+  gint row_stride = gt->row_stride;
+  gint x, c;
+
+  for (x = 0; x < gt->width; x++, out_row += pixel_stride) {
+    const guint8 *p00, *p01, *p10, *p11;
+    guint fx, fy;
+
+    if (map[x] < 0)
+      continue;
+
+    p00 = in_data + map[x];
+    if (map_frac[x] == 0) {
+      memcpy (out_row, p00, pixel_stride);
+      continue;
+    }
+
+    fx = map_frac[x] >> 8;
+    fy = map_frac[x] & 0xff;
+    p01 = fx ? p00 + pixel_stride : p00;
+    p10 = fy ? p00 + row_stride : p00;
+    p11 = fy ? p01 + row_stride : p01;
+
+    switch (gt->format) {
+      case GST_VIDEO_FORMAT_GRAY16_LE:
+        GST_WRITE_UINT16_LE (out_row, BILINEAR (GST_READ_UINT16_LE (p00),
+                GST_READ_UINT16_LE (p01), GST_READ_UINT16_LE (p10),
+                GST_READ_UINT16_LE (p11)));
+        break;
+      case GST_VIDEO_FORMAT_GRAY16_BE:
+        GST_WRITE_UINT16_BE (out_row, BILINEAR (GST_READ_UINT16_BE (p00),
+                GST_READ_UINT16_BE (p01), GST_READ_UINT16_BE (p10),
+                GST_READ_UINT16_BE (p11)));
+        break;
+      default:
+        for (c = 0; c < pixel_stride; c++)
+          out_row[c] = BILINEAR (p00[c], p01[c], p10[c], p11[c]);
+        break;
+    }
+  }
+}
+
+#undef BILINEAR
+
+#define MAP_ROW_NEAREST(pstride) \
+  for (x = 0; x < gt->width; x++) \
+    if (map[x] >= 0) \
+      memcpy (out_row + x * (pstride), in_data + map[x], (pstride));
+
+/* Fills @out_row from @in_data using one row of map entries */
+static void
+gst_geometric_transform_map_row (GstGeometricTransform * gt,
+    const guint8 * in_data, guint8 * out_row, const gint32 * map,
+    const guint16 * map_frac)
+{
+  gint x;
+
+  if (map_frac) {
+    gst_geometric_transform_interpolate_row (gt, in_data, out_row, map,
+        map_frac);
+    return;
+  }
+
+  /* constant sizes let the compiler turn the copies into plain loads and
+   * stores */
+  switch (gt->pixel_stride) {
+    case 1:
+      MAP_ROW_NEAREST (1);
+      break;
+    case 2:
+      MAP_ROW_NEAREST (2);
+      break;
+    case 3:
+      MAP_ROW_NEAREST (3);
+      break;
+    case 4:
+      MAP_ROW_NEAREST (4);
+      break;
+    default:
+      MAP_ROW_NEAREST (gt->pixel_stride);
+      break;
+  }
+}
+
+#undef MAP_ROW_NEAREST
+
+/* Generates the map entries of @height rows starting at @y_start */
+static gboolean
+gst_geometric_transform_generate_rows (GstGeometricTransform * gt,
+    gint y_start, gint height)
+{
+  GstGeometricTransformClass *klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
+  gint32 *map = gt->map + y_start * gt->width;
+  guint16 *map_frac = NULL;
+  gdouble in_x, in_y;
+  gint x, y;
+
+  if (gt->map_frac)
+    map_frac = gt->map_frac + y_start * gt->width;
+
+  for (y = y_start; y < y_start + height; y++) {
+    for (x = 0; x < gt->width; x++) {
+      if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
+        /* child should have warned */
+        return FALSE;
+      }
+
+      gst_geometric_transform_get_map_entry (gt, in_x, in_y, map, map_frac);
+      map++;
+      if (map_frac)
+        map_frac++;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Maps @height rows of @out_frame starting at @y_start, from the precalculated
+ * map or by calling the map function for each pixel */
+static gboolean
+gst_geometric_transform_transform_rows (GstGeometricTransform * gt,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame, gint y_start,
+    gint height)
+{
+  GstGeometricTransformClass *klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
+  const guint8 *in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
+  guint8 *out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
+  gint out_stride = GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0);
+  gint32 *row_map;
+  guint16 *row_frac = NULL;
+  gboolean ret = TRUE;
+  gint x, y;
+
+  if (gt->precalc_map) {
+    for (y = y_start; y < y_start + height; y++) {
+      gst_geometric_transform_map_row (gt, in_data, out_data + y * out_stride,
+          gt->map + y * gt->width,
+          gt->map_frac ? gt->map_frac + y * gt->width : NULL);
+    }
+    return TRUE;
+  }
+
+  row_map = g_new (gint32, gt->width);
+  if (gt->interpolation == GST_GT_INTERPOLATION_BILINEAR)
+    row_frac = g_new (guint16, gt->width);
+
+  for (y = y_start; y < y_start + height; y++) {
+    for (x = 0; x < gt->width; x++) {
+      gdouble in_x, in_y;
+
+      if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
+        GST_WARNING_OBJECT (gt, "Failed to do mapping for %d %d", x, y);
+        ret = FALSE;
+        goto end;
+      }
+
+      gst_geometric_transform_get_map_entry (gt, in_x, in_y, &row_map[x],
+          row_frac ? &row_frac[x] : NULL);
+    }
+
+    gst_geometric_transform_map_row (gt, in_data, out_data + y * out_stride,
+        row_map, row_frac);
+  }
+
+end:
+  g_free (row_map);
+  g_free (row_frac);
+  return ret;
+}
+
+static void
+gst_geometric_transform_process_stripe (GstGeometricTransformStripe * stripe)
+{
+  if (stripe->in_frame)
+    stripe->ret = gst_geometric_transform_transform_rows (stripe->gt,
+        stripe->in_frame, stripe->out_frame, stripe->y_start, stripe->height);
+  else
+    stripe->ret = gst_geometric_transform_generate_rows (stripe->gt,
+        stripe->y_start, stripe->height);
+}
+
+static void
+gst_geometric_transform_stripe_task (gpointer task, gpointer user_data)
+{
+  gst_geometric_transform_process_stripe ((GstGeometricTransformStripe *)
+      task);
+}
+
+/* Generates the map if @in_frame is NULL, otherwise maps @in_frame into
+ * @out_frame. The rows are split into stripes, using the worker threads if
+ * there is more than one stripe. Must be called with the object lock */
+static gboolean
+gst_geometric_transform_process_stripes (GstGeometricTransform * gt,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  GstGeometricTransformStripe *stripes;
+  gpointer *tasks;
+  gint stripe_height;
+  guint i, n_stripes, n_threads;
+  gboolean ret = TRUE;
+
+  n_threads = gt->max_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  /* without a precalculated map the map function might not be thread-safe,
+   * or rely on locked state like the random generator of diffuse */
+  if (in_frame && !gt->precalc_map)
+    n_threads = 1;
+
+  stripe_height = (gt->height + n_threads - 1) / n_threads;
+  stripe_height = MAX (stripe_height, MIN_STRIPE_HEIGHT);
+  n_stripes = (gt->height + stripe_height - 1) / stripe_height;
+  stripes = g_newa (GstGeometricTransformStripe, n_stripes);
+  tasks = g_newa (gpointer, n_stripes);
+
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].gt = gt;
+    stripes[i].y_start = i * stripe_height;
+    stripes[i].height = MIN (stripe_height, gt->height - i * stripe_height);
+    stripes[i].in_frame = in_frame;
+    stripes[i].out_frame = out_frame;
+    stripes[i].ret = FALSE;
+    tasks[i] = &stripes[i];
+  }
+
+  if (!gt->runner)
+    gt->runner =
+        gst_video_task_runner_new (gst_geometric_transform_stripe_task, gt);
+
+  /* The first stripe is handled by the streaming thread itself */
+  gst_video_task_runner_run (gt->runner, tasks, n_stripes, n_threads);
+
+  for (i = 0; i < n_stripes; i++)
+    ret &= stripes[i].ret;
+
+  return ret;
+}
 
 /* must be called with the object lock */
 static gboolean
 gst_geometric_transform_generate_map (GstGeometricTransform * gt)
 {
-  gint x, y;
-  gdouble in_x, in_y;
   gboolean ret = TRUE;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
 
   GST_INFO_OBJECT (gt, "Generating new transform map");
 
   /* cleanup old map */
   g_free (gt->map);
   gt->map = NULL;
+  g_free (gt->map_frac);
+  gt->map_frac = NULL;
 
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
@@ -98,30 +442,20 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   g_return_val_if_fail (klass->map_func, FALSE);
 
   /*
-   * (x,y) pairs of the inverse mapping
+   * input pixel offsets (and fractions) of the inverse mapping
    */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
-  ptr = gt->map;
+  gt->map = g_malloc (sizeof (gint32) * gt->width * gt->height);
+  if (gt->interpolation == GST_GT_INTERPOLATION_BILINEAR)
+    gt->map_frac = g_malloc (sizeof (guint16) * gt->width * gt->height);
 
-  for (y = 0; y < gt->height; y++) {
-    for (x = 0; x < gt->width; x++) {
-      if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
-        /* child should have warned */
-        ret = FALSE;
-        goto end;
-      }
+  ret = gst_geometric_transform_process_stripes (gt, NULL, NULL);
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
-    }
-  }
-
-end:
   if (!ret) {
     GST_WARNING_OBJECT (gt, "Generating transform map failed");
     g_free (gt->map);
     gt->map = NULL;
+    g_free (gt->map_frac);
+    gt->map_frac = NULL;
   } else
     gt->needs_remap = FALSE;
   return ret;
@@ -135,6 +469,8 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gboolean ret = TRUE;
   gint old_width;
   gint old_height;
+  gint old_row_stride;
+  gint old_pixel_stride;
   GstGeometricTransformClass *klass;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
@@ -142,14 +478,28 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
 
   old_width = gt->width;
   old_height = gt->height;
+  old_row_stride = gt->row_stride;
+  old_pixel_stride = gt->pixel_stride;
+
+  /* the map holds 32 bit offsets into the input frame */
+  if ((gint64) in_info->stride[0] * in_info->height > G_MAXINT32) {
+    GST_ERROR_OBJECT (gt, "Frames of %dx%d are too large", in_info->width,
+        in_info->height);
+    return FALSE;
+  }
 
+  /* regenerate the map */
+  GST_OBJECT_LOCK (gt);
   gt->width = in_info->width;
   gt->height = in_info->height;
+  gt->format = GST_VIDEO_INFO_FORMAT (in_info);
   gt->row_stride = in_info->stride[0];
   gt->pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (in_info, 0);
 
-  /* regenerate the map */
-  GST_OBJECT_LOCK (gt);
+  /* the map holds byte offsets, so also depends on the strides */
+  if (gt->row_stride != old_row_stride || gt->pixel_stride != old_pixel_stride)
+    gst_geometric_transform_set_need_remap (gt);
+
   if (gt->map == NULL || old_width == 0 || old_height == 0
       || gt->width != old_width || gt->height != old_height) {
     if (klass->prepare_func)
@@ -164,48 +514,6 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   return ret;
 }
 
-static void
-gst_geometric_transform_do_map (GstGeometricTransform * gt, guint8 * in_data,
-    guint8 * out_data, gint x, gint y, gdouble in_x, gdouble in_y)
-{
-  gint in_offset;
-  gint out_offset;
-
-  out_offset = y * gt->row_stride + x * gt->pixel_stride;
-
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
-      break;
-
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = gst_gm_mod_float (in_x, gt->width);
-      in_y = gst_gm_mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
-      break;
-
-    default:
-      break;
-  }
-
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
-
-      memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
-    }
-  }
-}
-
 static void
 gst_geometric_transform_before_transform (GstBaseTransform * trans,
     GstBuffer * outbuf)
@@ -229,16 +537,13 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
 {
   GstGeometricTransform *gt;
   GstGeometricTransformClass *klass;
-  gint x, y, i;
+  gint i;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
-  guint8 *in_data;
   guint8 *out_data;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
-  in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
   out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
 
   if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
@@ -252,6 +557,12 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
   }
 
   GST_OBJECT_LOCK (gt);
+  /* the map holds offsets into the input frame, so it depends on its stride */
+  if (GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0) != gt->row_stride) {
+    gt->row_stride = GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0);
+    gt->needs_remap = TRUE;
+  }
+
   if (gt->precalc_map) {
     if (gt->needs_remap) {
       if (klass->prepare_func)
@@ -261,32 +572,15 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
         }
       gst_geometric_transform_generate_map (gt);
     }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, in_data, out_data, x, y, ptr[0],
-            ptr[1]);
-        ptr += 2;
-      }
-    }
-  } else {
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        gdouble in_x, in_y;
-
-        if (klass->map_func (gt, x, y, &in_x, &in_y)) {
-          gst_geometric_transform_do_map (gt, in_data, out_data, x, y, in_x,
-              in_y);
-        } else {
-          GST_WARNING_OBJECT (gt, "Failed to do mapping for %d %d", x, y);
-          ret = GST_FLOW_ERROR;
-          goto end;
-        }
-      }
+    if (!gt->map) {
+      ret = GST_FLOW_ERROR;
+      goto end;
     }
   }
+
+  if (!gst_geometric_transform_process_stripes (gt, in_frame, out_frame))
+    ret = GST_FLOW_ERROR;
+
 end:
   GST_OBJECT_UNLOCK (gt);
   return ret;
@@ -303,7 +597,23 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_OFF_EDGE_PIXELS:
       GST_OBJECT_LOCK (gt);
-      gt->off_edge_pixels = g_value_get_enum (value);
+      if (gt->off_edge_pixels != g_value_get_enum (value)) {
+        gt->off_edge_pixels = g_value_get_enum (value);
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    case PROP_INTERPOLATION:
+      GST_OBJECT_LOCK (gt);
+      if (gt->interpolation != g_value_get_enum (value)) {
+        gt->interpolation = g_value_get_enum (value);
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (gt);
+      gt->max_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -324,6 +634,12 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_INTERPOLATION:
+      g_value_set_enum (value, gt->interpolation);
+      break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, gt->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -343,10 +659,30 @@ gst_geometric_transform_stop (GstBaseTransform * trans)
 
   g_free (gt->map);
   gt->map = NULL;
+  g_free (gt->map_frac);
+  gt->map_frac = NULL;
+
+  if (gt->runner) {
+    gst_video_task_runner_free (gt->runner);
+    gt->runner = NULL;
+  }
 
   return TRUE;
 }
 
+static void
+gst_geometric_transform_finalize (GObject * object)
+{
+  GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
+
+  if (gt->runner)
+    gst_video_task_runner_free (gt->runner);
+  g_free (gt->map);
+  g_free (gt->map_frac);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_geometric_transform_base_init (gpointer g_class)
 {
@@ -373,6 +709,7 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
 
   obj_class->set_property = gst_geometric_transform_set_property;
   obj_class->get_property = gst_geometric_transform_get_property;
+  obj_class->finalize = gst_geometric_transform_finalize;
 
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_geometric_transform_stop);
   trans_class->before_transform =
@@ -388,6 +725,19 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           "What to do with off edge pixels",
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (obj_class, PROP_INTERPOLATION,
+      g_param_spec_enum ("interpolation", "Interpolation",
+          "How to compute output pixels falling between input pixels",
+          GST_GT_INTERPOLATION_METHOD_TYPE, DEFAULT_INTERPOLATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (obj_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of threads generating the map and transforming "
+          "frames (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -396,6 +746,8 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (instance);
 
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
+  gt->interpolation = DEFAULT_INTERPOLATION;
+  gt->max_threads = DEFAULT_MAX_THREADS;
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
 }
@@ -22,6 +22,7 @@
 
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <gst/video/gstvideotaskrunner.h>
 
 G_BEGIN_DECLS
 
@@ -46,6 +47,12 @@ enum
   GST_GT_OFF_EDGES_PIXELS_WRAP
 };
 
+enum
+{
+  GST_GT_INTERPOLATION_NEAREST = 0,
+  GST_GT_INTERPOLATION_BILINEAR
+};
+
 typedef struct _GstGeometricTransform GstGeometricTransform;
 typedef struct _GstGeometricTransformClass GstGeometricTransformClass;
 
@@ -99,8 +106,16 @@ struct _GstGeometricTransform {
 
   /* properties */
   gint off_edge_pixels;
+  gint interpolation;
+  guint max_threads;
+
+  /* byte offset of the input pixel for each output pixel, -1 if there is
+   * none, and the 8 bit x (high byte) and y (low byte) fractions of the
+   * input position when interpolating */
+  gint32 *map;
+  guint16 *map_frac;
 
-  gdouble *map;
+  GstVideoTaskRunner *runner;
 };
 
 struct _GstGeometricTransformClass {
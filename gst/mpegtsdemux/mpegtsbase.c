@@ -177,23 +177,22 @@ mpegts_base_reset (MpegTSBase * base)
   MpegTSBaseClass *klass = GST_MPEGTS_BASE_GET_CLASS (base);
 
   mpegts_packetizer_clear (base->packetizer);
-  memset (base->is_pes, 0, 1024);
-  memset (base->known_psi, 0, 1024);
+  memset (base->pid_action, MPEGTS_BASE_PID_DROP, 0x2000);
 
   /* FIXME : Actually these are not *always* know SI streams
    * depending on the variant of mpeg-ts being used. */
 
   /* Known PIDs : PAT, TSDT, IPMP CIT */
-  MPEGTS_BIT_SET (base->known_psi, 0);
-  MPEGTS_BIT_SET (base->known_psi, 2);
-  MPEGTS_BIT_SET (base->known_psi, 3);
+  base->pid_action[0] = MPEGTS_BASE_PID_SECTION;
+  base->pid_action[2] = MPEGTS_BASE_PID_SECTION;
+  base->pid_action[3] = MPEGTS_BASE_PID_SECTION;
   /* TDT, TOT, ST */
-  MPEGTS_BIT_SET (base->known_psi, 0x14);
+  base->pid_action[0x14] = MPEGTS_BASE_PID_SECTION;
   /* network synchronization */
-  MPEGTS_BIT_SET (base->known_psi, 0x15);
+  base->pid_action[0x15] = MPEGTS_BASE_PID_SECTION;
 
   /* ATSC */
-  MPEGTS_BIT_SET (base->known_psi, 0x1ffb);
+  base->pid_action[0x1ffb] = MPEGTS_BASE_PID_SECTION;
 
   if (base->pat) {
     g_ptr_array_unref (base->pat);
@@ -236,8 +235,7 @@ mpegts_base_init (MpegTSBase * base)
       NULL, (GDestroyNotify) mpegts_base_free_program);
 
   base->parse_private_sections = FALSE;
-  base->is_pes = g_new0 (guint8, 1024);
-  base->known_psi = g_new0 (guint8, 1024);
+  base->pid_action = g_new0 (guint8, 0x2000);
   base->program_size = sizeof (MpegTSBaseProgram);
   base->stream_size = sizeof (MpegTSBaseStream);
 
@@ -255,8 +253,7 @@ mpegts_base_dispose (GObject * object)
   if (!base->disposed) {
     g_object_unref (base->packetizer);
     base->disposed = TRUE;
-    g_free (base->known_psi);
-    g_free (base->is_pes);
+    g_free (base->pid_action);
   }
 
   if (G_OBJECT_CLASS (parent_class)->dispose)
@@ -322,6 +319,32 @@ mpegts_pid_in_active_programs (MpegTSBase * base, guint16 pid)
   return lookup.res;
 }
 
+static void
+foreach_pmt_pid (gpointer key, MpegTSBaseProgram * program,
+    PIDLookup * lookup)
+{
+  if (program->pmt_pid == lookup->pid)
+    lookup->res = TRUE;
+}
+
+/* Called when @pid lost one of its uses. Its packets are only dropped if
+ * neither an active program nor the PMT of a known program still uses it */
+static void
+mpegts_base_release_pid (MpegTSBase * base, guint16 pid)
+{
+  PIDLookup lookup;
+
+  if (mpegts_pid_in_active_programs (base, pid))
+    return;
+
+  lookup.res = FALSE;
+  lookup.pid = pid;
+  g_hash_table_foreach (base->programs, (GHFunc) foreach_pmt_pid, &lookup);
+
+  base->pid_action[pid] =
+      lookup.res ? MPEGTS_BASE_PID_SECTION : MPEGTS_BASE_PID_DROP;
+}
+
 /* returns NULL if no matching descriptor found *
  * otherwise returns a descriptor that needs to *
  * be freed */
@@ -411,11 +434,11 @@ mpegts_base_add_program (MpegTSBase * base,
   program = mpegts_base_new_program (base, program_number, pmt_pid);
 
   /* Mark the PMT PID as being a known PSI PID */
-  if (G_UNLIKELY (MPEGTS_BIT_IS_SET (base->known_psi, pmt_pid))) {
+  if (G_UNLIKELY (base->pid_action[pmt_pid] == MPEGTS_BASE_PID_SECTION)) {
     GST_FIXME ("Refcounting. Setting twice a PID (0x%04x) as known PSI",
         pmt_pid);
   }
-  MPEGTS_BIT_SET (base->known_psi, pmt_pid);
+  base->pid_action[pmt_pid] = MPEGTS_BASE_PID_SECTION;
 
   g_hash_table_insert (base->programs,
       GINT_TO_POINTER (program_number), program);
@@ -845,23 +868,16 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
 
       mpegts_base_program_remove_stream (base, program, stream->pid);
 
-      /* Only unset the is_pes/known_psi bit if the PID isn't used in any other active
-       * program */
-      if (!mpegts_pid_in_active_programs (base, stream->pid)) {
-        if (_stream_is_private_section (stream)) {
-          if (base->parse_private_sections)
-            MPEGTS_BIT_UNSET (base->known_psi, stream->pid);
-        } else {
-          MPEGTS_BIT_UNSET (base->is_pes, stream->pid);
-        }
-      }
+      if (!_stream_is_private_section (stream)
+          || base->parse_private_sections)
+        mpegts_base_release_pid (base, stream->pid);
     }
 
     /* remove pcr stream */
     /* FIXME : This might actually be shared with another stream ? */
     mpegts_base_program_remove_stream (base, program, program->pcr_pid);
-    if (!mpegts_pid_in_active_programs (base, program->pcr_pid))
-      MPEGTS_BIT_UNSET (base->is_pes, program->pcr_pid);
+    if (base->pid_action[program->pcr_pid] == MPEGTS_BASE_PID_PCR)
+      mpegts_base_release_pid (base, program->pcr_pid);
 
     GST_DEBUG ("program stream_list is now %p", program->stream_list);
   }
@@ -903,19 +919,18 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
     GstMpegtsPMTStream *stream = g_ptr_array_index (pmt->streams, i);
     if (_stream_is_private_section (stream)) {
       if (base->parse_private_sections)
-        MPEGTS_BIT_SET (base->known_psi, stream->pid);
+        base->pid_action[stream->pid] = MPEGTS_BASE_PID_SECTION;
     } else {
-      if (G_UNLIKELY (MPEGTS_BIT_IS_SET (base->is_pes, stream->pid)))
+      if (G_UNLIKELY (base->pid_action[stream->pid] == MPEGTS_BASE_PID_PES))
         GST_FIXME
             ("Refcounting issue. Setting twice a PID (0x%04x) as known PES",
             stream->pid);
-      if (G_UNLIKELY (MPEGTS_BIT_IS_SET (base->known_psi, stream->pid))) {
+      if (G_UNLIKELY (base->pid_action[stream->pid] ==
+              MPEGTS_BASE_PID_SECTION))
         GST_FIXME
             ("Refcounting issue. Setting a known PSI PID (0x%04x) as known PES",
             stream->pid);
-        MPEGTS_BIT_UNSET (base->known_psi, stream->pid);
-      }
-      MPEGTS_BIT_SET (base->is_pes, stream->pid);
+      base->pid_action[stream->pid] = MPEGTS_BASE_PID_PES;
     }
     mpegts_base_program_add_stream (base, program,
         stream->pid, stream->stream_type, stream);
@@ -923,7 +938,8 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
   /* We add the PCR pid last. If that PID is already used by one of the media
    * streams above, no new stream will be created */
   mpegts_base_program_add_stream (base, program, pmt->pcr_pid, -1, NULL);
-  MPEGTS_BIT_SET (base->is_pes, pmt->pcr_pid);
+  if (base->pid_action[pmt->pcr_pid] != MPEGTS_BASE_PID_PES)
+    base->pid_action[pmt->pcr_pid] = MPEGTS_BASE_PID_PCR;
 
   program->active = TRUE;
   program->initial_program = initial_program;
@@ -969,20 +985,20 @@ mpegts_base_apply_pat (MpegTSBase * base, GstMpegtsSection * section)
     if (program) {
       /* IF the program already existed, just check if the PMT PID changed */
       if (program->pmt_pid != patp->network_or_program_map_PID) {
-        if (program->pmt_pid != G_MAXUINT16) {
-          /* pmt pid changed */
-          /* FIXME: when this happens it may still be pmt pid of another
-           * program, so setting to False may make it go through expensive
-           * path in is_psi unnecessarily */
-          MPEGTS_BIT_UNSET (base->known_psi, program->pmt_pid);
-        }
+        guint16 old_pmt_pid = program->pmt_pid;
 
         program->pmt_pid = patp->network_or_program_map_PID;
-        if (G_UNLIKELY (MPEGTS_BIT_IS_SET (base->known_psi, program->pmt_pid)))
+        if (G_UNLIKELY (base->pid_action[program->pmt_pid] ==
+                MPEGTS_BASE_PID_SECTION))
           GST_FIXME
               ("Refcounting issue. Setting twice a PMT PID (0x%04x) as know PSI",
               program->pmt_pid);
-        MPEGTS_BIT_SET (base->known_psi, patp->network_or_program_map_PID);
+        base->pid_action[patp->network_or_program_map_PID] =
+            MPEGTS_BASE_PID_SECTION;
+
+        /* pmt pid changed, the old one may still be used elsewhere */
+        if (old_pmt_pid != G_MAXUINT16)
+          mpegts_base_release_pid (base, old_pmt_pid);
       }
     } else {
       /* Create a new program */
@@ -1025,16 +1041,8 @@ mpegts_base_apply_pat (MpegTSBase * base, GstMpegtsSection * section)
         g_hash_table_steal (base->programs,
             GINT_TO_POINTER ((gint) patp->program_number));
       }
-      /* FIXME: when this happens it may still be pmt pid of another
-       * program, so setting to False may make it go through expensive
-       * path in is_psi unnecessarily */
-      if (G_UNLIKELY (MPEGTS_BIT_IS_SET (base->known_psi,
-                  patp->network_or_program_map_PID))) {
-        GST_FIXME
-            ("Program refcounting : Setting twice a pid (0x%04x) as known PSI",
-            patp->network_or_program_map_PID);
-      }
-      MPEGTS_BIT_SET (base->known_psi, patp->network_or_program_map_PID);
+      /* The PMT PID may still be used by another program */
+      mpegts_base_release_pid (base, patp->network_or_program_map_PID);
       mpegts_packetizer_remove_stream (base->packetizer,
           patp->network_or_program_map_PID);
     }
@@ -1198,7 +1206,7 @@ mpegts_base_parse_atsc_mgt (MpegTSBase * base, GstMpegtsSection * section)
             table->table_type <= GST_MPEGTS_ATSC_MGT_TABLE_TYPE_EIT127) ||
         (table->table_type >= GST_MPEGTS_ATSC_MGT_TABLE_TYPE_ETT0 &&
             table->table_type <= GST_MPEGTS_ATSC_MGT_TABLE_TYPE_ETT127)) {
-      MPEGTS_BIT_SET (base->known_psi, table->pid);
+      base->pid_action[table->pid] = MPEGTS_BASE_PID_SECTION;
     }
   }
 
@@ -1356,6 +1364,28 @@ mpegts_base_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+/* Whether the packet needs to be fully parsed, only a table lookup and the
+ * already extracted header are needed to decide */
+static inline gboolean
+mpegts_base_wants_packet (MpegTSBase * base,
+    const MpegTSPacketizerHeader * header)
+{
+  switch (base->pid_action[header->pid]) {
+    case MPEGTS_BASE_PID_PES:
+      return TRUE;
+    case MPEGTS_BASE_PID_SECTION:
+      if (FLAGS_HAS_PAYLOAD (header->scram_afc_cc))
+        return TRUE;
+      break;
+    default:
+      break;
+  }
+
+  /* PCR-carrying packets are always kept since they feed the packetizer's
+   * clock observations, including those of programs that aren't active */
+  return (header->afc_flags & MPEGTS_AFC_PCR_FLAG) != 0;
+}
+
 static GstFlowReturn
 mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1365,6 +1395,7 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   MpegTSPacketizer2 *packetizer;
   MpegTSPacketizerPacket packet;
   MpegTSBaseClass *klass;
+  guint8 action;
 
   base = GST_MPEGTS_BASE (parent);
   klass = GST_MPEGTS_BASE_GET_CLASS (base);
@@ -1395,6 +1426,16 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   mpegts_packetizer_push (base->packetizer, buf);
 
   while (res == GST_FLOW_OK) {
+    const MpegTSPacketizerHeader *header;
+
+    /* Discard packets on PIDs we don't handle from their header only,
+     * unless the subclass wants to see every packet */
+    if (!klass->inspect_packet) {
+      while ((header = mpegts_packetizer_peek_header (packetizer))
+          && !mpegts_base_wants_packet (base, header))
+        mpegts_packetizer_skip_packet (packetizer);
+    }
+
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
     /* If we don't have enough data, return */
@@ -1410,13 +1451,14 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     if (klass->inspect_packet)
       klass->inspect_packet (base, &packet);
 
-    /* If it's a known PES, push it */
-    if (MPEGTS_BIT_IS_SET (base->is_pes, packet.pid)) {
+    action = base->pid_action[packet.pid];
+
+    /* If it's a known PES (or the PCR PID of a program), push it */
+    if (action == MPEGTS_BASE_PID_PES || action == MPEGTS_BASE_PID_PCR) {
       /* push the packet downstream */
       if (base->push_data)
         res = klass->push (base, &packet, NULL);
-    } else if (packet.payload
-        && MPEGTS_BIT_IS_SET (base->known_psi, packet.pid)) {
+    } else if (packet.payload && action == MPEGTS_BASE_PID_SECTION) {
       /* base PSI data */
       GList *others, *tmp;
       GstMpegtsSection *section;
@@ -50,6 +50,17 @@ G_BEGIN_DECLS
 
 #define MPEG_TS_BASE_PACKETIZER(b) (((MpegTSBase*)b)->packetizer)
 
+/* What to do with the packets of a given PID */
+typedef enum {
+  MPEGTS_BASE_PID_DROP = 0,
+  /* PSI sections, parsed and handed to the subclass */
+  MPEGTS_BASE_PID_SECTION,
+  /* PES data of an active program */
+  MPEGTS_BASE_PID_PES,
+  /* PCR PID of an active program not carrying any other stream */
+  MPEGTS_BASE_PID_PCR
+} MpegTSBasePIDAction;
+
 typedef struct _MpegTSBase MpegTSBase;
 typedef struct _MpegTSBaseClass MpegTSBaseClass;
 typedef struct _MpegTSBaseStream MpegTSBaseStream;
@@ -127,10 +138,9 @@ struct _MpegTSBase {
   GPtrArray  *pat;
   MpegTSPacketizer2 *packetizer;
 
-  /* arrays that say whether a pid is a known psi pid or a pes pid */
-  /* Use MPEGTS_BIT_* to set/unset/check the values */
-  guint8 *known_psi;
-  guint8 *is_pes;
+  /* MpegTSBasePIDAction for each of the 0x2000 pids, checked for each
+   * packet right after the header */
+  guint8 *pid_action;
 
   gboolean disposed;
 
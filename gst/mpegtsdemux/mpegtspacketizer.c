@@ -261,6 +261,8 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -577,6 +579,8 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   packetizer->need_sync = FALSE;
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
   packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
@@ -617,6 +621,8 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
   packetizer->need_sync = FALSE;
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
   packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
@@ -689,6 +695,8 @@ mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
 
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
   packetizer->map_offset = 0;
 }
 
@@ -722,8 +730,8 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
-  guint8 *data;
-  gsize size, i, j;
+  guint8 *data, *sync;
+  gsize size, end, i, j;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -738,10 +746,16 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+  end = size - 3 * MPEGTS_MAX_PACKETSIZE;
+
+  for (i = 0; i < end; i++) {
+    /* find a sync byte, memchr() is much faster than a byte-wise loop */
+    sync = memchr (data + i, PACKET_SYNC_BYTE, end - i);
+    if (!sync) {
+      i = end;
+      break;
+    }
+    i = sync - data;
 
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
@@ -779,9 +793,9 @@ static gboolean
 mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
 {
   gboolean found = FALSE;
-  guint8 *data;
+  guint8 *data, *sync;
   guint packet_size;
-  gsize size, sync_offset, i;
+  gsize size, sync_offset, end, i;
 
   packet_size = packetizer->packet_size;
 
@@ -796,9 +810,17 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+  end = size - 2 * packet_size;
+
+  for (i = sync_offset; i < end; i++) {
+    sync = memchr (data + i, PACKET_SYNC_BYTE, end - i);
+    if (!sync) {
+      i = end;
+      break;
+    }
+    i = sync - data;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -846,26 +868,119 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
 
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
-    /* Check sync byte */
-    if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
+    /* Check sync byte, unless it was already validated by
+     * mpegts_packetizer_peek_header() */
+    if (packetizer->header_idx < packetizer->n_headers) {
+      packetizer->header_idx++;
+    } else if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
       GST_DEBUG ("lost sync");
       packetizer->need_sync = TRUE;
-    } else {
-      /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
-       * packet sizes contain either extra data (timesync, FEC, ..) either
-       * before or after the data */
-      packet->data_start = packet_data;
-      packet->data_end = packet->data_start + 188;
-      packet->offset = packetizer->offset;
-      GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
-      packetizer->offset += packet_size;
-      GST_MEMDUMP ("data_start", packet->data_start, 16);
-
-      return mpegts_packetizer_parse_packet (packetizer, packet);
+      continue;
     }
+
+    /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
+     * packet sizes contain either extra data (timesync, FEC, ..) either
+     * before or after the data */
+    packet->data_start = packet_data;
+    packet->data_end = packet->data_start + 188;
+    packet->offset = packetizer->offset;
+    GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
+    packetizer->offset += packet_size;
+    GST_MEMDUMP ("data_start", packet->data_start, 16);
+
+    return mpegts_packetizer_parse_packet (packetizer, packet);
   }
 }
 
+/**
+ * mpegts_packetizer_peek_header:
+ * @packetizer: a #MpegTSPacketizer2
+ *
+ * Get the header of the packet mpegts_packetizer_next_packet() would return
+ * next. The sync bytes and headers of all complete packets in the mapped
+ * region are validated and extracted in one go, so that callers can cheaply
+ * discard packets with mpegts_packetizer_skip_packet() without fully parsing
+ * them.
+ *
+ * Returns: (nullable): the header, or %NULL if more data is needed or if the
+ * packetizer isn't synchronised, in which case
+ * mpegts_packetizer_next_packet() should be used.
+ */
+const MpegTSPacketizerHeader *
+mpegts_packetizer_peek_header (MpegTSPacketizer2 * packetizer)
+{
+  guint8 *data;
+  guint packet_size, n, i;
+  gsize sync_offset;
+
+  if (packetizer->header_idx < packetizer->n_headers)
+    return &packetizer->headers[packetizer->header_idx];
+
+  /* Packet size discovery and resyncing are done in next_packet() */
+  packet_size = packetizer->packet_size;
+  if (G_UNLIKELY (!packet_size || packetizer->need_sync))
+    return NULL;
+
+  if (!mpegts_packetizer_map (packetizer, packet_size))
+    return NULL;
+
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    sync_offset = 4;
+  else
+    sync_offset = 0;
+
+  data = packetizer->map_data + packetizer->map_offset + sync_offset;
+  n = MIN ((packetizer->map_size - packetizer->map_offset) / packet_size,
+      MPEGTS_PACKETIZER_MAX_HEADERS);
+
+  for (i = 0; i < n; i++, data += packet_size) {
+    MpegTSPacketizerHeader *header = &packetizer->headers[i];
+
+    /* Stop at the first lost sync, next_packet() will deal with it */
+    if (G_UNLIKELY (data[0] != PACKET_SYNC_BYTE))
+      break;
+
+    header->pid = GST_READ_UINT16_BE (data + 1) & 0x1FFF;
+    header->payload_unit_start_indicator = data[1] & 0x40;
+    header->scram_afc_cc = data[3];
+    if (FLAGS_HAS_AFC (data[3]) && data[4])
+      header->afc_flags = data[5];
+    else
+      header->afc_flags = 0;
+  }
+
+  packetizer->n_headers = i;
+  packetizer->header_idx = 0;
+
+  if (i == 0)
+    return NULL;
+
+  GST_LOG ("validated %u packet headers", i);
+
+  return &packetizer->headers[0];
+}
+
+/**
+ * mpegts_packetizer_skip_packet:
+ * @packetizer: a #MpegTSPacketizer2
+ *
+ * Drop the packet whose header was returned by the last call to
+ * mpegts_packetizer_peek_header() without parsing it.
+ */
+void
+mpegts_packetizer_skip_packet (MpegTSPacketizer2 * packetizer)
+{
+  guint packet_size = packetizer->packet_size;
+
+  g_return_if_fail (packetizer->header_idx < packetizer->n_headers);
+
+  packetizer->header_idx++;
+  packetizer->offset += packet_size;
+  packetizer->map_offset += packet_size;
+  if (packetizer->map_size - packetizer->map_offset < packet_size)
+    mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
 {
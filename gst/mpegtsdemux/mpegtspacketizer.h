@@ -241,6 +241,20 @@ typedef struct _MpegTSPCR
   PCROffsetCurrent *current;
 } MpegTSPCR;
 
+/* Maximum number of packet headers validated in one go */
+#define MPEGTS_PACKETIZER_MAX_HEADERS 64
+
+/* Compact view of a packet header, filled for a whole run of packets of
+ * the mapped region at once */
+typedef struct
+{
+  guint16 pid;
+  guint8  payload_unit_start_indicator;
+  guint8  scram_afc_cc;
+  /* adaptation field flags, 0 if there's no (or an empty) adaptation field */
+  guint8  afc_flags;
+} MpegTSPacketizerHeader;
+
 struct _MpegTSPacketizer2 {
   GObject     parent;
 
@@ -269,6 +283,12 @@ struct _MpegTSPacketizer2 {
   gsize map_size;
   gboolean need_sync;
 
+  /* Headers of the packets following map_offset whose sync byte has
+   * already been validated */
+  MpegTSPacketizerHeader headers[MPEGTS_PACKETIZER_MAX_HEADERS];
+  guint n_headers;
+  guint header_idx;
+
   /* Reference offset */
   guint64 refoffset;
 
@@ -348,6 +368,9 @@ G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
+G_GNUC_INTERNAL const MpegTSPacketizerHeader *
+mpegts_packetizer_peek_header (MpegTSPacketizer2 *packetizer);
+G_GNUC_INTERNAL void mpegts_packetizer_skip_packet (MpegTSPacketizer2 *packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
@@ -217,25 +217,25 @@ mpegts_parse_reset (MpegTSBase * base)
   /* Set the various know PIDs we are interested in */
 
   /* CAT */
-  MPEGTS_BIT_SET (base->known_psi, 1);
+  base->pid_action[1] = MPEGTS_BASE_PID_SECTION;
   /* NIT, ST */
-  MPEGTS_BIT_SET (base->known_psi, 0x10);
+  base->pid_action[0x10] = MPEGTS_BASE_PID_SECTION;
   /* SDT, BAT, ST */
-  MPEGTS_BIT_SET (base->known_psi, 0x11);
+  base->pid_action[0x11] = MPEGTS_BASE_PID_SECTION;
   /* EIT, ST, CIT (TS 102 323) */
-  MPEGTS_BIT_SET (base->known_psi, 0x12);
+  base->pid_action[0x12] = MPEGTS_BASE_PID_SECTION;
   /* RST, ST */
-  MPEGTS_BIT_SET (base->known_psi, 0x13);
+  base->pid_action[0x13] = MPEGTS_BASE_PID_SECTION;
   /* RNT (TS 102 323) */
-  MPEGTS_BIT_SET (base->known_psi, 0x16);
+  base->pid_action[0x16] = MPEGTS_BASE_PID_SECTION;
   /* inband signalling */
-  MPEGTS_BIT_SET (base->known_psi, 0x1c);
+  base->pid_action[0x1c] = MPEGTS_BASE_PID_SECTION;
   /* measurement */
-  MPEGTS_BIT_SET (base->known_psi, 0x1d);
+  base->pid_action[0x1d] = MPEGTS_BASE_PID_SECTION;
   /* DIT */
-  MPEGTS_BIT_SET (base->known_psi, 0x1e);
+  base->pid_action[0x1e] = MPEGTS_BASE_PID_SECTION;
   /* SIT */
-  MPEGTS_BIT_SET (base->known_psi, 0x1f);
+  base->pid_action[0x1f] = MPEGTS_BASE_PID_SECTION;
 
   parse->first = TRUE;
   parse->have_group_id = FALSE;
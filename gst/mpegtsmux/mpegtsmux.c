@@ -115,11 +115,16 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BITRATE      0
+
+/* packets per output chunk when no alignment is configured */
+#define MPEGTSMUX_DEFAULT_CHUNK_PACKETS 64
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -177,11 +182,11 @@ static void alloc_packet_cb (GstBuffer ** _buf, void *user_data);
 static gboolean new_packet_cb (GstBuffer * buf, void *user_data,
     gint64 new_pcr);
 static void release_buffer_cb (guint8 * data, void *user_data);
-static GstFlowReturn mpegtsmux_collect_packet (MpegTsMux * mux,
-    GstBuffer * buf);
+static gboolean mpegtsmux_collect_packets (MpegTsMux * mux,
+    const guint8 * data, gsize size, GstClockTime ts, GstBufferFlags flags);
 static GstFlowReturn mpegtsmux_push_packets (MpegTsMux * mux, gboolean force);
-static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
-    gint64 new_pcr);
+static gboolean new_packet_m2ts (MpegTsMux * mux, guint8 * data,
+    GstBufferFlags flags, gint64 new_pcr);
 
 static void mpegtsmux_prepare_srcpad (MpegTsMux * mux);
 GstFlowReturn mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
@@ -305,6 +310,14 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target mux rate. Gaps are stuffed with null packets, the "
+          "PCR follows the output position and output buffers are timestamped "
+          "for constant bitrate playout (0 = variable bitrate)",
+          0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -328,8 +341,7 @@ mpegtsmux_init (MpegTsMux * mux)
   gst_collect_pads_set_clip_function (mux->collect, (GstCollectPadsClipFunction)
       GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
 
-  mux->adapter = gst_adapter_new ();
-  mux->out_adapter = gst_adapter_new ();
+  mux->m2ts_pending = g_byte_array_new ();
 
   /* properties */
   mux->m2ts_mode = MPEGTSMUX_DEFAULT_M2TS;
@@ -338,6 +350,7 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
 
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
@@ -387,6 +400,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   mux->last_ts = 0;
   mux->is_delta = TRUE;
   mux->is_header = FALSE;
+  mux->late_warned = FALSE;
 
   mux->streamheader_sent = FALSE;
   mux->pending_key_unit_ts = GST_CLOCK_TIME_NONE;
@@ -399,10 +413,11 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->element_index = NULL;
   }
 #endif
-  if (mux->adapter)
-    gst_adapter_clear (mux->adapter);
-  if (mux->out_adapter)
-    gst_adapter_clear (mux->out_adapter);
+  if (mux->m2ts_pending)
+    g_byte_array_set_size (mux->m2ts_pending, 0);
+  mux->m2ts_pending_ts = GST_CLOCK_TIME_NONE;
+  mux->m2ts_pending_flags =
+      GST_BUFFER_FLAG_DELTA_UNIT | GST_BUFFER_FLAG_HEADER;
 
   if (mux->tsmux) {
     tsmux_free (mux->tsmux);
@@ -418,7 +433,22 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     gst_buffer_unref (buf);
 
   gst_event_replace (&mux->force_key_unit_event, NULL);
-  gst_buffer_replace (&mux->out_buffer, NULL);
+  if (mux->out_buffer) {
+    gst_buffer_unmap (mux->out_buffer, &mux->out_map);
+    gst_buffer_unref (mux->out_buffer);
+    mux->out_buffer = NULL;
+  }
+  mux->out_offset = 0;
+  if (mux->out_list) {
+    gst_buffer_list_unref (mux->out_list);
+    mux->out_list = NULL;
+  }
+  if (mux->out_pool) {
+    gst_buffer_pool_set_active (mux->out_pool, FALSE);
+    gst_object_unref (mux->out_pool);
+    mux->out_pool = NULL;
+  }
+  gst_buffer_replace (&mux->packet_buffer, NULL);
 
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
@@ -431,6 +461,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_bitrate (mux->tsmux, mux->bitrate);
   }
 }
 
@@ -441,13 +472,9 @@ mpegtsmux_dispose (GObject * object)
 
   mpegtsmux_reset (mux, FALSE);
 
-  if (mux->adapter) {
-    g_object_unref (mux->adapter);
-    mux->adapter = NULL;
-  }
-  if (mux->out_adapter) {
-    g_object_unref (mux->out_adapter);
-    mux->out_adapter = NULL;
+  if (mux->m2ts_pending) {
+    g_byte_array_unref (mux->m2ts_pending);
+    mux->m2ts_pending = NULL;
   }
   if (mux->collect) {
     gst_object_unref (mux->collect);
@@ -511,6 +538,11 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      mux->bitrate = g_value_get_uint64 (value);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -542,6 +574,9 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1350,7 +1385,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     /* EOS */
     GST_INFO_OBJECT (mux, "EOS");
     /* drain some possibly cached data */
-    new_packet_m2ts (mux, NULL, -1);
+    new_packet_m2ts (mux, NULL, 0, -1);
     mpegtsmux_push_packets (mux, TRUE);
     gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
 
@@ -1489,6 +1524,24 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
       goto write_fail;
     }
   }
+
+  if (mux->bitrate > 0) {
+    gint64 late = tsmux_get_late_time (mux->tsmux);
+
+    /* warn once each time the input starts exceeding the mux rate */
+    if (late > 0 && !mux->late_warned) {
+      GST_ELEMENT_WARNING (mux, STREAM, MUX,
+          ("Input data rate exceeds the configured bitrate"),
+          ("Output is %" GST_TIME_FORMAT " behind the bitrate of %"
+              G_GUINT64_FORMAT " bits per second",
+              GST_TIME_ARGS (gst_util_uint64_scale (late, GST_SECOND,
+                      TSMUX_SYS_CLOCK_FREQ)), mux->bitrate));
+      mux->late_warned = TRUE;
+    } else if (late == 0) {
+      mux->late_warned = FALSE;
+    }
+  }
+
   /* flush packet cache */
   return mpegtsmux_push_packets (mux, FALSE);
 
@@ -1583,25 +1636,26 @@ mpegtsmux_release_pad (GstElement * element, GstPad * pad)
   gst_element_remove_pad (element, pad);
 }
 
-static void
-new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
-    guint len)
+/* Collects PAT/PMT packets into the streamheader and returns the flags
+ * the packet should carry downstream */
+static GstBufferFlags
+new_packet_common_init (MpegTsMux * mux, const guint8 * data, guint len)
 {
+  GstBufferFlags flags = 0;
+
   /* Packets should be at least 188 bytes, but check anyway */
-  g_assert (len >= 2 || !data);
+  g_assert (len >= NORMAL_TS_PACKET_LENGTH);
 
-  if (!mux->streamheader_sent && data) {
-    guint pid = ((data[1] & 0x1f) << 8) | data[2];
+  if (!mux->streamheader_sent) {
+    /* skip the m2ts timestamp prefix, if any */
+    const guint8 *packet = data + len - NORMAL_TS_PACKET_LENGTH;
+    guint pid = ((packet[1] & 0x1f) << 8) | packet[2];
     /* if it's a PAT or a PMT */
     if (pid == 0x00 || (pid >= TSMUX_START_PMT_PID && pid < TSMUX_START_ES_PID)) {
       GstBuffer *hbuf;
 
-      if (!buf) {
-        hbuf = gst_buffer_new_and_alloc (len);
-        gst_buffer_fill (hbuf, 0, data, len);
-      } else {
-        hbuf = gst_buffer_copy (buf);
-      }
+      hbuf = gst_buffer_new_and_alloc (len);
+      gst_buffer_fill (hbuf, 0, data, len);
       GST_LOG_OBJECT (mux,
           "Collecting packet with pid 0x%04x into streamheaders", pid);
 
@@ -1612,154 +1666,257 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
     }
   }
 
-  if (buf) {
-    if (mux->is_header) {
-      GST_LOG_OBJECT (mux, "marking as header buffer");
-      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_HEADER);
-    }
-    if (mux->is_delta) {
-      GST_LOG_OBJECT (mux, "marking as delta unit");
-      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
-    } else {
-      GST_DEBUG_OBJECT (mux, "marking as non-delta unit");
-      mux->is_delta = TRUE;
-    }
+  if (mux->is_header) {
+    GST_LOG_OBJECT (mux, "marking as header packet");
+    flags |= GST_BUFFER_FLAG_HEADER;
+  }
+  if (mux->is_delta) {
+    GST_LOG_OBJECT (mux, "marking as delta unit");
+    flags |= GST_BUFFER_FLAG_DELTA_UNIT;
+  } else {
+    GST_DEBUG_OBJECT (mux, "marking as non-delta unit");
+    mux->is_delta = TRUE;
   }
+
+  return flags;
 }
 
-static GstFlowReturn
-mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+/* Timestamp for the packet about to be output */
+static GstClockTime
+mpegtsmux_get_packet_ts (MpegTsMux * mux)
 {
-  GstBufferList *buffer_list;
-  gint align = mux->alignment;
-  gint av, packet_size;
+  gint64 ts;
 
-  if (mux->m2ts_mode) {
-    packet_size = M2TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 32;
-  } else {
-    packet_size = NORMAL_TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 0;
+  if (mux->bitrate == 0)
+    return mux->last_ts;
+
+  /* with a constant bitrate, packets are timestamped by their position in
+   * the output so that a synchronizing sink paces them evenly */
+  ts = tsmux_get_current_ts (mux->tsmux);
+  if (ts == -1)
+    return mux->last_ts;
+
+  return ts > 0 ? MPEG_SYS_TIME_TO_GSTTIME (ts) : 0;
+}
+
+static gint
+mpegtsmux_get_alignment (MpegTsMux * mux)
+{
+  if (mux->alignment >= 0)
+    return mux->alignment;
+
+  return mux->m2ts_mode ? 32 : 0;
+}
+
+static gboolean
+mpegtsmux_start_chunk (MpegTsMux * mux, GstClockTime ts, GstBufferFlags flags)
+{
+  GstFlowReturn ret;
+  gint align, packet_size;
+  guint chunk_size;
+
+  packet_size = mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH;
+  align = mpegtsmux_get_alignment (mux);
+  if (align == 0)
+    align = MPEGTSMUX_DEFAULT_CHUNK_PACKETS;
+  chunk_size = MIN (align, G_MAXINT / packet_size) * packet_size;
+
+  if (mux->out_pool && mux->out_chunk_size != chunk_size) {
+    gst_buffer_pool_set_active (mux->out_pool, FALSE);
+    gst_object_unref (mux->out_pool);
+    mux->out_pool = NULL;
   }
 
-  av = gst_adapter_available (mux->out_adapter);
-  GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
+  if (!mux->out_pool) {
+    GstStructure *config;
 
-  if (av == 0)
-    return GST_FLOW_OK;
+    GST_DEBUG_OBJECT (mux, "output chunks of %u bytes", chunk_size);
 
-  /* no alignment, just push all available data */
-  if (align == 0) {
-    buffer_list = gst_adapter_take_buffer_list (mux->out_adapter, av);
-    return gst_pad_push_list (mux->srcpad, buffer_list);
+    mux->out_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (mux->out_pool);
+    gst_buffer_pool_config_set_params (config, NULL, chunk_size, 0, 0);
+    if (!gst_buffer_pool_set_config (mux->out_pool, config) ||
+        !gst_buffer_pool_set_active (mux->out_pool, TRUE)) {
+      GST_ERROR_OBJECT (mux, "Failed to set up output buffer pool");
+      gst_object_unref (mux->out_pool);
+      mux->out_pool = NULL;
+      return FALSE;
+    }
+    mux->out_chunk_size = chunk_size;
   }
 
-  align *= packet_size;
+  ret = gst_buffer_pool_acquire_buffer (mux->out_pool, &mux->out_buffer, NULL);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    GST_DEBUG_OBJECT (mux, "Failed to acquire output buffer: %s",
+        gst_flow_get_name (ret));
+    mux->last_flow_ret = ret;
+    return FALSE;
+  }
 
-  if (!force && align > av)
-    return GST_FLOW_OK;
+  gst_buffer_map (mux->out_buffer, &mux->out_map, GST_MAP_WRITE);
+  mux->out_offset = 0;
 
-  buffer_list = gst_buffer_list_new_sized ((av / align) + 1);
+  GST_BUFFER_PTS (mux->out_buffer) = ts;
+  GST_BUFFER_FLAG_SET (mux->out_buffer, flags);
 
-  GST_LOG_OBJECT (mux, "aligning to %d bytes", align);
-  while (align <= av) {
-    GstBuffer *buf;
-    GstClockTime pts;
+  return TRUE;
+}
 
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_adapter_take_buffer (mux->out_adapter, align);
+static void
+mpegtsmux_finish_chunk (MpegTsMux * mux)
+{
+  GstBuffer *buf = mux->out_buffer;
 
-    GST_BUFFER_PTS (buf) = pts;
+  gst_buffer_unmap (buf, &mux->out_map);
+  mux->out_buffer = NULL;
 
-    gst_buffer_list_add (buffer_list, buf);
-    av -= align;
-  }
+  if (mux->out_offset < gst_buffer_get_size (buf))
+    gst_buffer_set_size (buf, mux->out_offset);
 
-  if (av > 0 && force) {
-    GstBuffer *buf;
-    GstClockTime pts;
-    guint8 *data;
-    guint32 header;
-    gint dummy;
-    GstMapInfo map;
+  GST_LOG_OBJECT (mux, "finished buffer of size %" G_GSIZE_FORMAT,
+      mux->out_offset);
+  mux->out_offset = 0;
 
-    GST_LOG_OBJECT (mux, "handling %d leftover bytes", av);
+  if (!mux->out_list)
+    mux->out_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->out_list, buf);
+}
+
+static GstFlowReturn
+mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list;
+  gint align = mpegtsmux_get_alignment (mux);
 
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_buffer_new_and_alloc (align);
+  GST_LOG_OBJECT (mux, "align %d, av %" G_GSIZE_FORMAT, align,
+      mux->out_offset);
 
-    GST_BUFFER_PTS (buf) = pts;
+  if (mux->out_buffer) {
+    if (align == 0) {
+      /* no alignment, just push all available data */
+      mpegtsmux_finish_chunk (mux);
+    } else if (force) {
+      gint packet_size, dummy;
+      guint8 *data;
+      guint32 header;
 
-    gst_buffer_map (buf, &map, GST_MAP_READ);
-    data = map.data;
+      packet_size = mux->m2ts_mode ? M2TS_PACKET_LENGTH :
+          NORMAL_TS_PACKET_LENGTH;
 
-    gst_adapter_copy (mux->out_adapter, data, 0, av);
-    gst_adapter_clear (mux->out_adapter);
+      GST_LOG_OBJECT (mux, "handling %" G_GSIZE_FORMAT " leftover bytes",
+          mux->out_offset);
 
-    data += av;
-    header = GST_READ_UINT32_BE (data - packet_size);
+      data = mux->out_map.data + mux->out_offset;
+      header = GST_READ_UINT32_BE (data - packet_size);
 
-    dummy = (map.size - av) / packet_size;
-    GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
+      dummy = (mux->out_map.size - mux->out_offset) / packet_size;
+      GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
 
-    for (; dummy > 0; dummy--) {
-      gint offset;
+      for (; dummy > 0; dummy--) {
+        gint offset;
 
-      if (packet_size > NORMAL_TS_PACKET_LENGTH) {
-        GST_WRITE_UINT32_BE (data, header);
-        /* simply increase header a bit and never mind too much */
-        header++;
-        offset = 4;
-      } else {
-        offset = 0;
+        if (packet_size > NORMAL_TS_PACKET_LENGTH) {
+          GST_WRITE_UINT32_BE (data, header);
+          /* simply increase header a bit and never mind too much */
+          header++;
+          offset = 4;
+        } else {
+          offset = 0;
+        }
+        GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
+        /* null packet PID */
+        GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
+        /* no adaptation field exists | continuity counter undefined */
+        GST_WRITE_UINT8 (data + offset + 3, 0x10);
+        /* payload */
+        memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
+        data += packet_size;
+        mux->out_offset += packet_size;
       }
-      GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
-      /* null packet PID */
-      GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
-      /* no adaptation field exists | continuity counter undefined */
-      GST_WRITE_UINT8 (data + offset + 3, 0x10);
-      /* payload */
-      memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
-      data += packet_size;
-    }
 
-    gst_buffer_unmap (buf, &map);
-    gst_buffer_list_add (buffer_list, buf);
+      mpegtsmux_finish_chunk (mux);
+    }
   }
 
+  if (!mux->out_list)
+    return GST_FLOW_OK;
+
+  buffer_list = mux->out_list;
+  mux->out_list = NULL;
+
   return gst_pad_push_list (mux->srcpad, buffer_list);
 }
 
-static GstFlowReturn
-mpegtsmux_collect_packet (MpegTsMux * mux, GstBuffer * buf)
+/* Copies whole packets into the current output buffer, starting a new one
+ * from the pool whenever it fills up. Return FALSE on error */
+static gboolean
+mpegtsmux_collect_packets (MpegTsMux * mux, const guint8 * data, gsize size,
+    GstClockTime ts, GstBufferFlags flags)
 {
-  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT,
-      gst_buffer_get_size (buf));
-  gst_adapter_push (mux->out_adapter, buf);
+  GST_LOG_OBJECT (mux, "collecting packets size %" G_GSIZE_FORMAT, size);
+
+  /* without alignment, start a new buffer at key units and header
+   * boundaries so the flags apply to whole buffers as before */
+  if (mux->out_buffer && mpegtsmux_get_alignment (mux) == 0 &&
+      (!(flags & GST_BUFFER_FLAG_DELTA_UNIT) ||
+          (flags & GST_BUFFER_FLAG_HEADER) !=
+          (GST_BUFFER_FLAGS (mux->out_buffer) & GST_BUFFER_FLAG_HEADER)))
+    mpegtsmux_finish_chunk (mux);
+
+  while (size > 0) {
+    gsize n;
+
+    if (!mux->out_buffer && !mpegtsmux_start_chunk (mux, ts, flags))
+      return FALSE;
+
+    n = MIN (size, mux->out_map.size - mux->out_offset);
+    memcpy (mux->out_map.data + mux->out_offset, data, n);
+    mux->out_offset += n;
+    data += n;
+    size -= n;
+
+    /* a buffer is only delta or header if all of its packets are */
+    if (!(flags & GST_BUFFER_FLAG_DELTA_UNIT))
+      GST_BUFFER_FLAG_UNSET (mux->out_buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (!(flags & GST_BUFFER_FLAG_HEADER))
+      GST_BUFFER_FLAG_UNSET (mux->out_buffer, GST_BUFFER_FLAG_HEADER);
+
+    if (mux->out_offset == mux->out_map.size)
+      mpegtsmux_finish_chunk (mux);
+  }
 
-  return GST_FLOW_OK;
+  return TRUE;
+}
+
+static void
+new_packet_m2ts_accumulate (MpegTsMux * mux, const guint8 * data,
+    GstBufferFlags flags)
+{
+  GST_LOG_OBJECT (mux, "Accumulating non-PCR packet");
+
+  if (mux->m2ts_pending->len == 0)
+    mux->m2ts_pending_ts = mpegtsmux_get_packet_ts (mux);
+  mux->m2ts_pending_flags &= flags;
+  g_byte_array_append (mux->m2ts_pending, data, M2TS_PACKET_LENGTH);
 }
 
 static gboolean
-new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
+new_packet_m2ts (MpegTsMux * mux, guint8 * data, GstBufferFlags flags,
+    gint64 new_pcr)
 {
-  GstBuffer *out_buf;
-  int chunk_bytes;
-  GstMapInfo map;
+  GByteArray *pending = mux->m2ts_pending;
+  gint64 chunk_bytes;
 
-  GST_LOG_OBJECT (mux, "Have buffer %p with new_pcr=%" G_GINT64_FORMAT,
-      buf, new_pcr);
+  GST_LOG_OBJECT (mux, "Have packet %p with new_pcr=%" G_GINT64_FORMAT,
+      data, new_pcr);
 
-  chunk_bytes = gst_adapter_available (mux->adapter);
+  chunk_bytes = pending->len;
 
-  if (G_LIKELY (buf)) {
+  if (G_LIKELY (data)) {
     if (new_pcr < 0) {
-      /* If there is no pcr in current ts packet then just add the packet
-         to the adapter for later output when we see a PCR */
-      GST_LOG_OBJECT (mux, "Accumulating non-PCR packet");
-      gst_adapter_push (mux->adapter, buf);
+      /* If there is no pcr in current ts packet then just keep the packet
+         for later output when we see a PCR */
+      new_packet_m2ts_accumulate (mux, data, flags);
       goto exit;
     }
 
@@ -1768,8 +1925,7 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
     if (mux->previous_pcr < 0 && chunk_bytes) {
       mux->previous_pcr = new_pcr;
       mux->previous_offset = chunk_bytes;
-      GST_LOG_OBJECT (mux, "Accumulating non-PCR packet");
-      gst_adapter_push (mux->adapter, buf);
+      new_packet_m2ts_accumulate (mux, data, flags);
       goto exit;
     }
   } else {
@@ -1794,10 +1950,10 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
     }
 
     while (offset < chunk_bytes) {
-      guint64 cur_pcr, ts;
+      guint64 cur_pcr;
 
-      /* Loop, pulling packets of the adapter, updating their 4 byte
-       * timestamp header and pushing */
+      /* Loop over the pending packets, updating their 4 byte
+       * timestamp header in place */
 
       /* interpolate PCR */
       if (G_LIKELY (offset >= mux->previous_offset))
@@ -1809,41 +1965,38 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
             gst_util_uint64_scale (mux->previous_offset - offset,
             mux->pcr_rate_num, mux->pcr_rate_den);
 
-      /* FIXME: what about DTS here? */
-      ts = gst_adapter_prev_pts (mux->adapter, NULL);
-      out_buf = gst_adapter_take_buffer (mux->adapter, M2TS_PACKET_LENGTH);
-      g_assert (out_buf);
-      offset += M2TS_PACKET_LENGTH;
-
-      GST_BUFFER_PTS (out_buf) = ts;
-
-      gst_buffer_map (out_buf, &map, GST_MAP_WRITE);
-
       /* The header is the bottom 30 bits of the PCR, apparently not
        * encoded into base + ext as in the packets themselves */
-      GST_WRITE_UINT32_BE (map.data, cur_pcr & 0x3FFFFFFF);
-      gst_buffer_unmap (out_buf, &map);
+      GST_WRITE_UINT32_BE (pending->data + offset, cur_pcr & 0x3FFFFFFF);
 
       GST_LOG_OBJECT (mux, "Outputting a packet of length %d PCR %"
           G_GUINT64_FORMAT, M2TS_PACKET_LENGTH, cur_pcr);
-      mpegtsmux_collect_packet (mux, out_buf);
+      offset += M2TS_PACKET_LENGTH;
     }
+
+    /* FIXME: what about DTS here? */
+    if (!mpegtsmux_collect_packets (mux, pending->data, chunk_bytes,
+            mux->m2ts_pending_ts, mux->m2ts_pending_flags))
+      return FALSE;
+
+    g_byte_array_set_size (pending, 0);
+    mux->m2ts_pending_ts = GST_CLOCK_TIME_NONE;
+    mux->m2ts_pending_flags =
+        GST_BUFFER_FLAG_DELTA_UNIT | GST_BUFFER_FLAG_HEADER;
   }
 
-  if (G_UNLIKELY (!buf))
+  if (G_UNLIKELY (!data))
     goto exit;
 
-  gst_buffer_map (buf, &map, GST_MAP_WRITE);
-
   /* Finally, output the passed in packet */
   /* Only write the bottom 30 bits of the PCR */
-  GST_WRITE_UINT32_BE (map.data, new_pcr & 0x3FFFFFFF);
-
-  gst_buffer_unmap (buf, &map);
+  GST_WRITE_UINT32_BE (data, new_pcr & 0x3FFFFFFF);
 
   GST_LOG_OBJECT (mux, "Outputting a packet of length %d PCR %"
       G_GUINT64_FORMAT, M2TS_PACKET_LENGTH, new_pcr);
-  mpegtsmux_collect_packet (mux, buf);
+  if (!mpegtsmux_collect_packets (mux, data, M2TS_PACKET_LENGTH,
+          mpegtsmux_get_packet_ts (mux), flags))
+    return FALSE;
 
   if (new_pcr != mux->previous_pcr) {
     mux->previous_pcr = new_pcr;
@@ -1854,62 +2007,75 @@ exit:
   return TRUE;
 }
 
+/* Keeps the packet @buf to be handed out again by alloc_packet_cb */
+static void
+mpegtsmux_recycle_packet (MpegTsMux * mux, GstBuffer * buf)
+{
+  if (!mux->packet_buffer && gst_buffer_is_writable (buf))
+    mux->packet_buffer = buf;
+  else
+    gst_buffer_unref (buf);
+}
+
 /* Called when the TsMux has prepared a packet for output. Return FALSE
  * on error */
 static gboolean
 new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  gint offset = 0;
+  GstBufferFlags flags;
   GstMapInfo map;
+  gboolean ret;
 
 #if 0
   GST_LOG_OBJECT (mux, "handling packet %d", mux->spn_count);
   mux->spn_count++;
 #endif
 
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  g_assert (map.size >= NORMAL_TS_PACKET_LENGTH);
+
   if (mux->m2ts_mode) {
-    offset = 4;
-    gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH + offset);
-  }
+    guint8 packet[M2TS_PACKET_LENGTH];
+
+    /* the timestamp prefix is written once the PCR is known */
+    memset (packet, 0, 4);
+    memcpy (packet + 4, map.data, NORMAL_TS_PACKET_LENGTH);
+    gst_buffer_unmap (buf, &map);
+    mpegtsmux_recycle_packet (mux, buf);
 
-  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+    /* do common init (flags and streamheaders) */
+    flags = new_packet_common_init (mux, packet, M2TS_PACKET_LENGTH);
 
-  if (offset) {
-    /* there should be a better way to do this */
-    memmove (map.data + offset, map.data, map.size - offset);
+    /* all is meant for downstream, including any prefix */
+    return new_packet_m2ts (mux, packet, flags, new_pcr);
   }
 
-  GST_BUFFER_PTS (buf) = mux->last_ts;
-  /* do common init (flags and streamheaders) */
-  new_packet_common_init (mux, buf, map.data + offset, map.size);
+  flags = new_packet_common_init (mux, map.data, NORMAL_TS_PACKET_LENGTH);
+  ret = mpegtsmux_collect_packets (mux, map.data, NORMAL_TS_PACKET_LENGTH,
+      mpegtsmux_get_packet_ts (mux), flags);
 
   gst_buffer_unmap (buf, &map);
+  mpegtsmux_recycle_packet (mux, buf);
 
-  /* all is meant for downstream, including any prefix */
-  if (offset)
-    return new_packet_m2ts (mux, buf, new_pcr);
-  else
-    mpegtsmux_collect_packet (mux, buf);
-
-  return TRUE;
+  return ret;
 }
 
-/* called when TsMux needs new packet to write into */
+/* called when TsMux needs new packet to write into. Packets are copied
+ * into the output buffer right away in new_packet_cb, which gives the
+ * scratch buffer back to be handed out again. TsMux owns it exclusively
+ * in between, so that it can be mapped writable */
 static void
 alloc_packet_cb (GstBuffer ** _buf, void *user_data)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  GstBuffer *buf;
-  gint offset = 0;
-
-  if (mux->m2ts_mode == TRUE)
-    offset = 4;
 
-  buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
-  gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH);
-
-  *_buf = buf;
+  if (mux->packet_buffer) {
+    *_buf = mux->packet_buffer;
+    mux->packet_buffer = NULL;
+  } else {
+    *_buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH);
+  }
 }
 
 static void
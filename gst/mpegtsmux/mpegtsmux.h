@@ -139,6 +139,7 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint64 bitrate;
 
   /* state */
   gboolean first;
@@ -152,17 +153,30 @@ struct MpegTsMux {
   gboolean is_delta;
   gboolean is_header;
   GstClockTime last_ts;
+  /* output fell behind the constant bitrate and this was reported */
+  gboolean late_warned;
 
   /* m2ts specific */
   gint64 previous_pcr;
   gint64 previous_offset;
   gint64 pcr_rate_num;
   gint64 pcr_rate_den;
-  GstAdapter *adapter;
-
-  /* output buffer aggregation */
-  GstAdapter *out_adapter;
+  GByteArray *m2ts_pending;
+  GstClockTime m2ts_pending_ts;
+  GstBufferFlags m2ts_pending_flags;
+
+  /* scratch packet handed to tsmux for every packet, kept here while
+   * tsmux doesn't own it */
+  GstBuffer *packet_buffer;
+
+  /* output buffer aggregation: packets are copied straight into
+   * pooled chunks of alignment * packet size bytes */
+  GstBufferPool *out_pool;
+  guint out_chunk_size;
   GstBuffer *out_buffer;
+  GstMapInfo out_map;
+  gsize out_offset;
+  GstBufferList *out_list;
 
 #if 0
   /* SPN/PTS index handling */
@@ -109,6 +109,12 @@
 /* Times per second to write PCR */
 #define TSMUX_DEFAULT_PCR_FREQ (25)
 
+/* In CBR mode, gaps larger than this between the output position and the
+ * next packet's PCR are not stuffed but skipped (e.g. after a stall) */
+#define TSMUX_CBR_MAX_GAP (TSMUX_SYS_CLOCK_FREQ * 2)
+
+#define TSMUX_NULL_PID 0x1FFF
+
 /* Base for all written PCR and DTS/PTS,
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
@@ -150,6 +156,8 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -323,6 +331,97 @@ tsmux_add_mpegts_si_section (TsMux * mux, GstMpegtsSection * section)
   return TRUE;
 }
 
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the mux rate in bits per second, or 0
+ *
+ * Make @mux produce a constant bitrate stream of @bitrate bits per second.
+ * Gaps between packets are filled with NULL packets and the PCR is derived
+ * from the output position. A @bitrate of 0 produces variable bitrate output.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  if (mux->bitrate != bitrate) {
+    mux->bitrate = bitrate;
+    mux->first_pcr = -1;
+    mux->late = 0;
+  }
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured mux rate of @mux.
+ *
+ * Returns: the mux rate in bits per second, 0 for variable bitrate output.
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
+/**
+ * tsmux_get_late_time:
+ * @mux: a #TsMux
+ *
+ * Get how far the output of @mux is behind the schedule of its streams
+ * because more data than the mux rate allows was written. This is only
+ * updated in constant bitrate mode, when a stream packet is written.
+ *
+ * Returns: the delay in 27MHz clock ticks, 0 if the output is on time.
+ */
+gint64
+tsmux_get_late_time (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->late;
+}
+
+static gint64
+tsmux_get_current_pcr (TsMux * mux)
+{
+  if (mux->bitrate == 0 || mux->first_pcr == -1)
+    return -1;
+
+  return mux->first_pcr + gst_util_uint64_scale (mux->n_bytes * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
+/**
+ * tsmux_get_current_ts:
+ * @mux: a #TsMux
+ *
+ * Get the time at which the next packet of a constant bitrate stream is due,
+ * in 27MHz clock ticks on the same time line as the stream timestamps.
+ *
+ * Returns: the time of the next packet, or -1 for variable bitrate output
+ * or when the time is not known yet.
+ */
+gint64
+tsmux_get_current_ts (TsMux * mux)
+{
+  gint64 pcr;
+
+  g_return_val_if_fail (mux != NULL, -1);
+
+  pcr = tsmux_get_current_pcr (mux);
+  if (pcr == -1)
+    return -1;
+
+  /* undo the offsets applied when deriving the PCR from the PTS */
+  return pcr - (CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+}
+
 /**
  * tsmux_free:
  * @mux: a #TsMux
@@ -628,13 +727,18 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
 static gboolean
 tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  gboolean res = TRUE;
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
-    return TRUE;
+  } else {
+    res = mux->write_func (buf, mux->write_func_data, pcr);
   }
 
-  return mux->write_func (buf, mux->write_func_data, pcr);
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
+  return res;
 }
 
 /*
@@ -896,7 +1000,6 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   gsize data_size = 0;
   gsize payload_written;
   guint len = 0, offset = 0, payload_len = 0;
-  guint extra_alloc_bytes = 0;
 
   g_return_val_if_fail (section != NULL, FALSE);
   g_return_val_if_fail (mux != NULL, FALSE);
@@ -951,35 +1054,12 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
     TS_DEBUG ("Creating packet buffer at offset "
         "%" G_GSIZE_FORMAT " with length %u", payload_written, payload_len);
 
-    /* If in M2TS mode, we will need to resize to 4 bytes after the end
-       of the buffer. For performance reasons, we will now try to include
-       4 extra bytes from the source buffer, then resize down, to avoid
-       having an extra 4 byte GstMemory appended. If the source buffer
-       does not have enough data for this, a new GstMemory will be used */
-    if (gst_buffer_get_size (section_buffer) - (payload_written +
-            payload_len) >= 4) {
-      /* enough space */
-      extra_alloc_bytes = 4;
-    }
     packet_buffer = gst_buffer_copy_region (section_buffer, GST_BUFFER_COPY_ALL,
-        payload_written, payload_len + extra_alloc_bytes);
+        payload_written, payload_len);
 
     /* Prepend the header to the section data */
     gst_buffer_prepend_memory (packet_buffer, mem);
 
-    /* add an extra 4 bytes if it could not be reserved already */
-    if (extra_alloc_bytes == 4) {
-      /* we allocated those already, resize */
-      gst_buffer_set_size (packet_buffer,
-          gst_buffer_get_size (packet_buffer) - extra_alloc_bytes);
-    } else {
-      void *ptr = g_malloc (4);
-      GstMemory *extra =
-          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ptr, 4, 0, 0, ptr,
-          g_free);
-      gst_buffer_append_memory (packet_buffer, extra);
-    }
-
     TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
         len, section->pi.stream_avail - len);
 
@@ -1019,6 +1099,140 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint8 *tmp;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  map.data[0] = TSMUX_SYNC_BYTE;
+  tmp = map.data + 1;
+  tsmux_put16 (&tmp, TSMUX_NULL_PID);
+  /* payload only, continuity counter undefined */
+  map.data[3] = 0x10;
+  memset (map.data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  gst_buffer_unmap (buf, &map);
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
+/* Write an adaptation field only packet carrying the PCR on the PID
+ * of @stream. Such packets don't advance the continuity counter, so they
+ * repeat the one of the last packet written on the PID */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  TsMuxPacketInfo pi = { 0, };
+  guint payload_len, payload_offs;
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  pi.pid = stream->pi.pid;
+  pi.packet_count = stream->pi.packet_count - 1;
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  pi.pcr = pcr;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  if (!tsmux_write_ts_header (map.data, &pi, &payload_len, &payload_offs)) {
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  TS_DEBUG ("Writing PCR-only packet on PID 0x%04x", pi.pid);
+  stream->last_pcr = pcr;
+
+  return tsmux_packet_out (mux, buf, pcr);
+}
+
+/* In CBR mode, stuff the output up to the time the next packet of @stream
+ * is due, keeping the PCR interval of every program while doing so */
+static gboolean
+tsmux_pad_stream (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 cur_pts = tsmux_stream_get_pts (stream);
+  gint64 target_pcr, cur_pcr;
+
+  if (cur_pts == G_MININT64) {
+    /* nothing to pace against, start the clock at the base if needed */
+    if (mux->first_pcr == -1) {
+      mux->first_pcr = (CLOCK_BASE - TSMUX_PCR_OFFSET) *
+          (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+      mux->n_bytes = 0;
+    }
+    return TRUE;
+  }
+
+  /* the same relation to the PTS as for VBR output */
+  target_pcr = (cur_pts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+
+  if (mux->first_pcr == -1) {
+    mux->first_pcr = target_pcr;
+    mux->n_bytes = 0;
+    return TRUE;
+  }
+
+  cur_pcr = tsmux_get_current_pcr (mux);
+
+  if (cur_pcr > target_pcr) {
+    TS_DEBUG ("Output is %" G_GINT64_FORMAT " ticks late for the mux rate",
+        cur_pcr - target_pcr);
+    mux->late = cur_pcr - target_pcr;
+    return TRUE;
+  }
+  mux->late = 0;
+
+  if (target_pcr - cur_pcr > TSMUX_CBR_MAX_GAP) {
+    TS_DEBUG ("Skipping gap of %" G_GINT64_FORMAT " ticks",
+        target_pcr - cur_pcr);
+    mux->first_pcr += target_pcr - cur_pcr;
+    return TRUE;
+  }
+
+  while (cur_pcr < target_pcr) {
+    TsMuxStream *pcr_stream = NULL;
+    GList *cur;
+
+    for (cur = mux->programs; cur; cur = cur->next) {
+      TsMuxProgram *program = (TsMuxProgram *) cur->data;
+
+      if (program->pcr_stream && (program->pcr_stream->last_pcr == -1 ||
+              cur_pcr - program->pcr_stream->last_pcr >
+              (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
+        pcr_stream = program->pcr_stream;
+        break;
+      }
+    }
+
+    if (pcr_stream) {
+      if (!tsmux_write_pcr_packet (mux, pcr_stream, cur_pcr))
+        return FALSE;
+    } else if (!tsmux_write_null_packet (mux)) {
+      return FALSE;
+    }
+
+    cur_pcr = tsmux_get_current_pcr (mux);
+  }
+
+  return TRUE;
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -1041,6 +1255,9 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
+  if (mux->bitrate && !tsmux_pad_stream (mux, stream))
+    return FALSE;
+
   if (tsmux_stream_is_pcr (stream)) {
     gint64 cur_pts = tsmux_stream_get_pts (stream);
     gboolean write_pat;
@@ -1061,6 +1278,10 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
           (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
     }
 
+    /* in CBR mode the PCR follows the output position */
+    if (mux->bitrate)
+      cur_pcr = tsmux_get_current_pcr (mux);
+
     /* Need to decide whether to write a new PCR in this packet */
     if (stream->last_pcr == -1 ||
         (cur_pcr - stream->last_pcr >
@@ -1132,11 +1353,22 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
+  /* PAT, PMT and SI may have moved the output position since the PCR
+   * was decided on */
+  if (mux->bitrate && (pi->flags & TSMUX_PACKET_FLAG_WRITE_PCR)) {
+    cur_pcr = tsmux_get_current_pcr (mux);
+    pi->pcr = cur_pcr;
+    stream->last_pcr = cur_pcr;
+  }
+
   /* obtain buffer */
   if (!tsmux_get_buffer (mux, &buf))
     return FALSE;
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
 
   if (!tsmux_write_ts_header (map.data, pi, &payload_len, &payload_offs))
     goto fail;
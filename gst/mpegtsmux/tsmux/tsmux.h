@@ -169,6 +169,15 @@ struct TsMux {
   /* last time SIT written in MPEG PTS clock time */
   gint64   last_si_ts;
 
+  /* mux rate in bits per second for CBR output, 0 for VBR */
+  guint64  bitrate;
+  /* bytes written since the first packet */
+  guint64  n_bytes;
+  /* PCR of the first packet in CBR mode, -1 if not known yet */
+  gint64   first_pcr;
+  /* how far the output is behind the mux rate, in 27MHz ticks */
+  gint64   late;
+
   /* callback to write finished packet */
   TsMuxWriteFunc write_func;
   void *write_func_data;
@@ -205,6 +214,12 @@ guint           tsmux_get_si_interval           (TsMux *mux);
 void            tsmux_resend_si                 (TsMux *mux);
 gboolean        tsmux_add_mpegts_si_section     (TsMux * mux, GstMpegtsSection * section);
 
+/* constant bitrate output */
+void            tsmux_set_bitrate               (TsMux *mux, guint64 bitrate);
+guint64         tsmux_get_bitrate               (TsMux *mux);
+gint64          tsmux_get_late_time             (TsMux *mux);
+gint64          tsmux_get_current_ts            (TsMux *mux);
+
 /* stream management */
 TsMuxStream *	tsmux_create_stream 		(TsMux *mux, TsMuxStreamType stream_type, guint16 pid, gchar *language);
 TsMuxStream *	tsmux_find_stream 		(TsMux *mux, guint16 pid);
@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
 #include "gstipcpipelinecomm.h"
@@ -35,6 +36,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 #define GST_CAT_DEFAULT gst_ipc_pipeline_comm_debug
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_MAX_BUFFERS_IN_FLIGHT 1
+
+/* Buffers with more memories than this are mapped as a whole (merging
+ * them) instead of writing each memory separately */
+#define MAX_WRITE_MEMORIES 16
 
 GQuark QUARK_ID;
 
@@ -212,6 +218,74 @@ gst_ipc_pipeline_comm_sync_fd (GstIpcPipelineComm * comm, guint32 id,
   return !comm_error;
 }
 
+/* Gets the results of the buffers in flight that were already acked, and
+ * waits for the oldest ones until at most @max_in_flight are left. Returns
+ * the first result that is not GST_FLOW_OK. Must be called with the mutex */
+static GstFlowReturn
+gst_ipc_pipeline_comm_collect_buffers_in_flight (GstIpcPipelineComm * comm,
+    guint max_in_flight)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (!g_queue_is_empty (&comm->buffers_in_flight)) {
+    gpointer id = g_queue_peek_head (&comm->buffers_in_flight);
+    CommRequest *req;
+    guint32 ret32;
+
+    req = g_hash_table_lookup (comm->waiting_ids, id);
+    g_assert (req);
+
+    if (!req->replied
+        && g_queue_get_length (&comm->buffers_in_flight) <= max_in_flight)
+      break;
+
+    /* taken out of the queue first, so that cancelling doesn't free the
+     * request while waiting for it */
+    g_queue_pop_head (&comm->buffers_in_flight);
+
+    if (req->replied) {
+      ret32 = req->ret;
+      g_hash_table_remove (comm->waiting_ids, id);
+    } else {
+      GHashTable *waiting_ids = g_hash_table_ref (comm->waiting_ids);
+
+      ret32 = comm_request_wait (comm, req, ACK_TYPE_BLOCKING);
+      g_hash_table_remove (waiting_ids, id);
+      g_hash_table_unref (waiting_ids);
+    }
+
+    if (ret32 != GST_FLOW_OK && ret == GST_FLOW_OK) {
+      GST_DEBUG_OBJECT (comm->element, "Buffer %u in flight returned %s",
+          GPOINTER_TO_UINT (id), gst_flow_get_name (ret32));
+      ret = ret32;
+    }
+  }
+
+  return ret;
+}
+
+/* Forgets about the buffers in flight, their acks will be ignored. Must be
+ * called with the mutex */
+static void
+gst_ipc_pipeline_comm_drop_buffers_in_flight (GstIpcPipelineComm * comm)
+{
+  gpointer id;
+
+  while ((id = g_queue_pop_head (&comm->buffers_in_flight)))
+    g_hash_table_remove (comm->waiting_ids, id);
+}
+
+/* Forgets about the buffers in flight once the streaming stopped, so that
+ * their results are not reported when streaming again. Waiting for them
+ * could block forever, as a prerolled peer doesn't ack them. */
+void
+gst_ipc_pipeline_comm_reset_buffers_in_flight (GstIpcPipelineComm * comm)
+{
+  g_mutex_lock (&comm->mutex);
+  gst_ipc_pipeline_comm_drop_buffers_in_flight (comm);
+  g_mutex_unlock (&comm->mutex);
+}
+
 static gboolean
 write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
 {
@@ -239,6 +313,40 @@ done:
   return ret;
 }
 
+/* Writes all of @iov, modifying it to track partial writes */
+static gboolean
+write_vectors_to_fd (GstIpcPipelineComm * comm, struct iovec *iov, int n_iov)
+{
+  gboolean ret = TRUE;
+
+  GST_TRACE_OBJECT (comm->element, "Writing %d vectors to fdout", n_iov);
+  while (n_iov) {
+    ssize_t written = writev (comm->fdout, iov, n_iov);
+    if (written < 0) {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+      GST_ERROR_OBJECT (comm->element, "Failed to write to fd: %s",
+          strerror (errno));
+      ret = FALSE;
+      goto done;
+    }
+
+    /* skip what was written, which may end in the middle of a vector */
+    while (n_iov && (size_t) written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      n_iov--;
+    }
+    if (n_iov) {
+      iov->iov_base = (guint8 *) iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+
+done:
+  return ret;
+}
+
 static gboolean
 write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
 {
@@ -501,15 +609,29 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
   const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
-  GstMapInfo map;
+  GstMapInfo maps[MAX_WRITE_MEMORIES];
+  struct iovec iov[MAX_WRITE_MEMORIES + 2];
+  guint8 *header = NULL, *meta_data = NULL;
   guint32 ret32 = GST_FLOW_OK;
-  guint32 size, n;
+  guint32 size, n, n_maps = 0, n_mem = 0;
   CommBufferMetadata meta;
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  gboolean windowed;
 
   g_mutex_lock (&comm->mutex);
+
+  /* make room for this buffer, reporting errors of the previous ones. This
+   * also collects the ones left over if the window was made smaller */
+  windowed = comm->max_buffers_in_flight > 1;
+  ret = gst_ipc_pipeline_comm_collect_buffers_in_flight (comm,
+      comm->max_buffers_in_flight - 1);
+  if (ret != GST_FLOW_OK) {
+    g_mutex_unlock (&comm->mutex);
+    return ret;
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
@@ -541,15 +663,28 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   size = gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
+  iov[0].iov_len = gst_byte_writer_get_size (&bw);
+  iov[0].iov_base = header = gst_byte_writer_reset_and_get_data (&bw);
+  if (!header)
     goto write_failed;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  /* the memories are written as they are, without merging them first */
+  n_mem = gst_buffer_n_memory (buffer);
+  if (n_mem <= MAX_WRITE_MEMORIES) {
+    for (n_maps = 0; n_maps < n_mem; n_maps++) {
+      if (!gst_memory_map (gst_buffer_peek_memory (buffer, n_maps),
+              &maps[n_maps], GST_MAP_READ))
+        goto map_failed;
+    }
+  } else {
+    if (!gst_buffer_map (buffer, &maps[0], GST_MAP_READ))
+      goto map_failed;
+    n_maps = 1;
+  }
+  for (n = 0; n < n_maps; n++) {
+    iov[n + 1].iov_base = maps[n].data;
+    iov[n + 1].iov_len = maps[n].size;
+  }
 
   /* meta */
   gst_byte_writer_init (&bw);
@@ -584,18 +719,41 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
       if (!gst_byte_writer_put_data (&bw, (const guint8 *) s, len))
         goto write_failed;
   }
+  iov[n_maps + 1].iov_len = gst_byte_writer_get_size (&bw);
+  iov[n_maps + 1].iov_base = meta_data = gst_byte_writer_reset_and_get_data (&bw);
+  if (!meta_data)
+    goto write_failed;
 
-  if (!write_byte_writer_to_fd (comm, &bw))
+  /* header, data and meta all go out in a single call */
+  if (!write_vectors_to_fd (comm, iov, n_maps + 2))
     goto write_failed;
 
+  if (windowed) {
+    /* the result is reported when sending one of the next buffers */
+    g_hash_table_insert (comm->waiting_ids, GINT_TO_POINTER (comm->send_id),
+        comm_request_new (comm->send_id, COMM_REQUEST_TYPE_BUFFER, NULL));
+    g_queue_push_tail (&comm->buffers_in_flight,
+        GINT_TO_POINTER (comm->send_id));
+    ret = GST_FLOW_OK;
+    goto done;
+  }
+
   if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
           ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
     goto wait_failed;
   ret = ret32;
 
 done:
+  if (n_mem <= MAX_WRITE_MEMORIES) {
+    for (n = 0; n < n_maps; n++)
+      gst_memory_unmap (gst_buffer_peek_memory (buffer, n), &maps[n]);
+  } else if (n_maps) {
+    gst_buffer_unmap (buffer, &maps[0]);
+  }
   g_mutex_unlock (&comm->mutex);
   gst_byte_writer_reset (&bw);
+  g_free (header);
+  g_free (meta_data);
   for (n = 0; n < repr.n_meta; ++n)
     g_free (repr.info[n].str);
   g_free (repr.info);
@@ -908,6 +1066,19 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
     return gst_ipc_pipeline_comm_write_sink_message_event_to_fd (comm, event);
 
   g_mutex_lock (&comm->mutex);
+
+  /* the buffers in flight must all be handled before EOS, their results
+   * can't be returned anymore, but errors of the peer are posted on its bus
+   * and forwarded anyway */
+  if (!upstream && GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    GstFlowReturn fret =
+        gst_ipc_pipeline_comm_collect_buffers_in_flight (comm, 0);
+
+    if (fret != GST_FLOW_OK)
+      GST_WARNING_OBJECT (comm->element, "Buffers in flight before EOS "
+          "returned %s", gst_flow_get_name (fret));
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing event %u: %" GST_PTR_FORMAT,
@@ -969,6 +1140,11 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
     goto write_failed;
   ret = ret32;
 
+  /* the buffers in flight were flushed, their results must not be reported
+   * after the flush */
+  if (!upstream && GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    gst_ipc_pipeline_comm_drop_buffers_in_flight (comm);
+
 done:
   g_mutex_unlock (&comm->mutex);
   g_free (str);
@@ -1601,6 +1777,8 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->element = element;
   comm->fdin = comm->fdout = -1;
   comm->ack_time = DEFAULT_ACK_TIME;
+  comm->max_buffers_in_flight = DEFAULT_MAX_BUFFERS_IN_FLIGHT;
+  g_queue_init (&comm->buffers_in_flight);
   comm->waiting_ids =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       (GDestroyNotify) comm_request_free);
@@ -1613,6 +1791,7 @@ void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
   g_hash_table_destroy (comm->waiting_ids);
+  g_queue_clear (&comm->buffers_in_flight);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
   g_mutex_clear (&comm->mutex);
@@ -1646,6 +1825,9 @@ void
 gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
 {
   g_mutex_lock (&comm->mutex);
+  /* nobody waits for the results of the buffers in flight anymore, they
+   * must not be reported for the next buffers */
+  gst_ipc_pipeline_comm_drop_buffers_in_flight (comm);
   g_hash_table_foreach (comm->waiting_ids, cancel_request_error, comm);
   if (cleanup) {
     g_hash_table_unref (comm->waiting_ids);
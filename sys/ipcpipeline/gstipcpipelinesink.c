@@ -55,7 +55,11 @@
  * Communication with ipcpipelinesrc on the slave happens via a socket, using a
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
- * performs a blocking wait for a reply, if a return code is needed.
+ * performs a blocking wait for a reply, if a return code is needed. For
+ * buffers, this round-trip can be avoided by letting several buffers be in
+ * flight at once, see the #GstIpcPipelineSink:max-buffers-in-flight
+ * property; the flow return of a buffer is then reported when sending one
+ * of the next buffers.
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -98,11 +102,13 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_MAX_BUFFERS_IN_FLIGHT,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_MAX_BUFFERS_IN_FLIGHT 1
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -174,6 +180,13 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           "Maximum time to wait for a response to a message",
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_BUFFERS_IN_FLIGHT,
+      g_param_spec_uint ("max-buffers-in-flight", "Max buffers in flight",
+          "Maximum number of buffers sent before waiting for the flow return "
+          "of the oldest one (1 = wait for each buffer). Flow returns of "
+          "buffers in flight are reported when sending the next ones",
+          1, G_MAXINT, DEFAULT_MAX_BUFFERS_IN_FLIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
@@ -210,6 +223,7 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.max_buffers_in_flight = DEFAULT_MAX_BUFFERS_IN_FLIGHT;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -271,6 +285,11 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_MAX_BUFFERS_IN_FLIGHT:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.max_buffers_in_flight = g_value_get_uint (value);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +315,11 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_MAX_BUFFERS_IN_FLIGHT:
+      g_mutex_lock (&sink->comm.mutex);
+      g_value_set_uint (value, sink->comm.max_buffers_in_flight);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -713,6 +737,11 @@ gst_ipc_pipeline_sink_change_state (GstElement * element,
     return GST_STATE_CHANGE_FAILURE;
   }
 
+  /* streaming stopped, the results of the buffers still in flight are not
+   * wanted anymore */
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    gst_ipc_pipeline_comm_reset_buffers_in_flight (&sink->comm);
+
   /* the parent's (GstElement) state change func won't return ASYNC or
    * NO_PREROLL, so unless it has returned FAILURE, which we have catched above,
    * we are not interested in its return code... just return the peer's */
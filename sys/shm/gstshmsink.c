@@ -32,6 +32,8 @@
  * ]| Send video to shm buffers.
  *
  */
+#define _GNU_SOURCE             /* memfd_create */
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -39,8 +41,13 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 /* signals */
 enum
@@ -58,7 +65,8 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_FD_PASSING
 };
 
 struct GstShmClient
@@ -69,6 +77,7 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_FD_PASSING (FALSE)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -93,6 +102,8 @@ static void gst_shm_sink_get_property (GObject * object, guint prop_id,
 static gboolean gst_shm_sink_start (GstBaseSink * bsink);
 static gboolean gst_shm_sink_stop (GstBaseSink * bsink);
 static GstFlowReturn gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf);
+static GstFlowReturn gst_shm_sink_render_list (GstBaseSink * bsink,
+    GstBufferList * list);
 
 static gboolean gst_shm_sink_event (GstBaseSink * bsink, GstEvent * event);
 static gboolean gst_shm_sink_unlock (GstBaseSink * bsink);
@@ -343,6 +354,94 @@ gst_shm_sink_allocator_new (GstShmSink * sink)
 }
 
 
+/*******************
+ * MEMFD ALLOCATOR *
+ *******************/
+
+/* Proposed upstream with fd-passing, its memory reaches the clients as a
+ * file descriptor without being copied into the shm area */
+
+#define GST_TYPE_SHM_SINK_FD_ALLOCATOR \
+  (gst_shm_sink_fd_allocator_get_type())
+
+typedef struct _GstShmSinkFdAllocator
+{
+  GstFdAllocator parent;
+} GstShmSinkFdAllocator;
+
+typedef struct _GstShmSinkFdAllocatorClass
+{
+  GstFdAllocatorClass parent;
+} GstShmSinkFdAllocatorClass;
+
+GType gst_shm_sink_fd_allocator_get_type (void);
+
+G_DEFINE_TYPE (GstShmSinkFdAllocator, gst_shm_sink_fd_allocator,
+    GST_TYPE_FD_ALLOCATOR);
+
+static gint
+gst_shm_sink_fd_allocator_create_fd (void)
+{
+#ifdef HAVE_MEMFD_CREATE
+  return memfd_create ("gst-shmsink", MFD_CLOEXEC);
+#else
+  gchar name[32];
+  gint fd, i = 0;
+
+  /* An unlinked shm object is as anonymous as a memfd */
+  do {
+    g_snprintf (name, sizeof (name), "/gst-shmsink.%d.%d", (gint) getpid (),
+        i++);
+    fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  } while (fd < 0 && errno == EEXIST);
+
+  if (fd >= 0)
+    shm_unlink (name);
+
+  return fd;
+#endif
+}
+
+static GstMemory *
+gst_shm_sink_fd_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  GstMemory *memory;
+  gsize maxsize = size + params->prefix + params->padding;
+  gint fd;
+
+  /* The mapping is page aligned and the file starts out zeroed, which
+   * covers all the alignment and zeroing flags */
+  fd = gst_shm_sink_fd_allocator_create_fd ();
+  if (fd < 0 || ftruncate (fd, maxsize) < 0) {
+    GST_WARNING_OBJECT (allocator, "Could not create a memfd of %"
+        G_GSIZE_FORMAT " bytes: %s", maxsize, g_strerror (errno));
+    if (fd >= 0)
+      close (fd);
+    return gst_allocator_alloc (NULL, size, params);
+  }
+
+  memory = gst_fd_allocator_alloc (allocator, fd, maxsize,
+      GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (memory, params->prefix, size);
+
+  return memory;
+}
+
+static void
+gst_shm_sink_fd_allocator_init (GstShmSinkFdAllocator * self)
+{
+}
+
+static void
+gst_shm_sink_fd_allocator_class_init (GstShmSinkFdAllocatorClass * klass)
+{
+  GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS (klass);
+
+  allocator_class->alloc = gst_shm_sink_fd_allocator_alloc;
+}
+
+
 /***************
  * MAIN OBJECT *
  ***************/
@@ -355,6 +454,7 @@ gst_shm_sink_init (GstShmSink * self)
   self->unlock = FALSE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->fd_passing = DEFAULT_FD_PASSING;
 
   gst_allocation_params_init (&self->params);
 }
@@ -377,6 +477,8 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_shm_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_shm_sink_stop);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_shm_sink_render);
+  gstbasesink_class->render_list =
+      GST_DEBUG_FUNCPTR (gst_shm_sink_render_list);
   gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_shm_sink_event);
   gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_shm_sink_unlock);
   gstbasesink_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_shm_sink_unlock_stop);
@@ -417,6 +519,13 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing",
+          "Pass file descriptors",
+          "Send the file descriptor of fd backed memory (memfd, dmabuf) to "
+          "the clients instead of copying the data into the shm area",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -476,7 +585,8 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_SHM_SIZE:
       GST_OBJECT_LOCK (object);
-      if (self->pipe) {
+      /* An area that wasn't created yet gets the new size when it is */
+      if (self->pipe && sp_writer_get_max_buf_size (self->pipe) > 0) {
         if (sp_writer_resize (self->pipe, g_value_get_uint (value)) < 0) {
           /* Swap allocators, so we can know immediately if the memory is
            * ours */
@@ -505,6 +615,11 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -534,6 +649,9 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, self->fd_passing);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -561,7 +679,10 @@ gst_shm_sink_start (GstBaseSink * bsink)
   GST_DEBUG_OBJECT (self, "Creating new socket at %s"
       " with shared memory of %d bytes", self->socket_path, self->size);
 
-  self->pipe = sp_writer_create (self->socket_path, self->size, self->perms);
+  /* With fd-passing the shm area may never be needed, it is only created
+   * once a buffer has to be copied into it */
+  self->pipe = sp_writer_create (self->socket_path,
+      self->fd_passing ? 0 : self->size, self->perms);
 
   if (!self->pipe) {
     GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
@@ -658,8 +779,18 @@ gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
   return TRUE;
 }
 
+/* The commands queued for the clients have to go out before waiting, they
+ * can't release buffers they didn't receive */
+static void
+gst_shm_sink_wait_locked (GstShmSink * self)
+{
+  sp_writer_flush (self->pipe);
+  g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+}
+
+/* Queues @buf for the clients, the caller sends it with sp_writer_flush() */
 static GstFlowReturn
-gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
+gst_shm_sink_queue_buffer (GstBaseSink * bsink, GstBuffer * buf)
 {
   GstShmSink *self = GST_SHM_SINK (bsink);
   int rv = 0;
@@ -677,7 +808,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
   while (self->wait_for_connection && !self->clients) {
-    g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+    gst_shm_sink_wait_locked (self);
     if (self->unlock) {
       GST_OBJECT_UNLOCK (self);
       ret = gst_base_sink_wait_preroll (bsink);
@@ -689,7 +820,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
-    g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+    gst_shm_sink_wait_locked (self);
     if (self->unlock) {
       GST_OBJECT_UNLOCK (self);
       ret = gst_base_sink_wait_preroll (bsink);
@@ -700,6 +831,39 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
   }
 
+  if (self->fd_passing && gst_buffer_n_memory (buf) == 1 &&
+      gst_is_fd_memory (gst_buffer_peek_memory (buf, 0))) {
+    gsize offset, size;
+
+    memory = gst_buffer_peek_memory (buf, 0);
+    size = gst_memory_get_sizes (memory, &offset, NULL);
+
+    GST_LOG_OBJECT (self, "Passing fd of memory %p in buffer %p", memory, buf);
+
+    /* The buffer is kept until all clients acked it, so the producer can't
+     * reuse the memory underneath them */
+    sendbuf = gst_buffer_ref (buf);
+    rv = sp_writer_send_fd (self->pipe, gst_fd_memory_get_fd (memory),
+        offset, size, sendbuf);
+    GST_OBJECT_UNLOCK (self);
+
+    if (rv == 0) {
+      GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
+      gst_buffer_unref (sendbuf);
+    }
+
+    return ret;
+  }
+
+  if (sp_writer_get_max_buf_size (self->pipe) == 0) {
+    GST_DEBUG_OBJECT (self, "Creating shared memory area of %u bytes",
+        self->size);
+    if (sp_writer_resize (self->pipe, self->size) < 0) {
+      GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE, (NULL),
+          ("Could not create shared memory area of %u bytes", self->size));
+      goto error;
+    }
+  }
 
   if (gst_buffer_n_memory (buf) > 1) {
     GST_LOG_OBJECT (self, "Buffer %p has %d GstMemory, we only support a single"
@@ -728,7 +892,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     while ((memory =
             gst_shm_sink_allocator_alloc_locked (self->allocator,
                 gst_buffer_get_size (buf), &self->params)) == NULL) {
-      g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      gst_shm_sink_wait_locked (self);
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
         ret = gst_base_sink_wait_preroll (bsink);
@@ -740,7 +904,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
 
     while (self->wait_for_connection && !self->clients) {
-      g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      gst_shm_sink_wait_locked (self);
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
         ret = gst_base_sink_wait_preroll (bsink);
@@ -812,6 +976,41 @@ error:
   return GST_FLOW_ERROR;
 }
 
+static GstFlowReturn
+gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
+{
+  GstShmSink *self = GST_SHM_SINK (bsink);
+  GstFlowReturn ret;
+
+  ret = gst_shm_sink_queue_buffer (bsink, buf);
+
+  GST_OBJECT_LOCK (self);
+  sp_writer_flush (self->pipe);
+  GST_OBJECT_UNLOCK (self);
+
+  return ret;
+}
+
+/* The buffers of a list reach each client with a single send(), unless the
+ * sink had to wait for the clients in between */
+static GstFlowReturn
+gst_shm_sink_render_list (GstBaseSink * bsink, GstBufferList * list)
+{
+  GstShmSink *self = GST_SHM_SINK (bsink);
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+    ret = gst_shm_sink_queue_buffer (bsink, gst_buffer_list_get (list, i));
+
+  GST_OBJECT_LOCK (self);
+  sp_writer_flush (self->pipe);
+  GST_OBJECT_UNLOCK (self);
+
+  return ret;
+}
+
 static void
 free_buffer_locked (GstBuffer * buffer, void *data)
 {
@@ -908,22 +1107,35 @@ pollthread_func (gpointer data)
 
       if (gst_poll_fd_can_read (self->poll, &gclient->pollfd)) {
         int rv;
-        gpointer tag = NULL;
-
-        GST_OBJECT_LOCK (self);
-        rv = sp_writer_recv (self->pipe, gclient->client, &tag);
-        GST_OBJECT_UNLOCK (self);
 
-        if (rv < 0) {
+        /* The socket is read without the object lock, only this thread
+         * uses the queue of received commands of the client */
+        if (sp_writer_read (gclient->client) < 0) {
           GST_WARNING_OBJECT (self, "One client has read error,"
-              " closing (retval: %d errno: %d)", rv, errno);
+              " closing (errno: %d)", errno);
           goto close_client;
         }
 
-        g_assert (rv == 0 || tag == NULL);
+        /* Acks received together are all handled at once, as the socket
+         * doesn't become readable again for them */
+        while (sp_writer_has_pending_commands (gclient->client)) {
+          gpointer tag = NULL;
+
+          GST_OBJECT_LOCK (self);
+          rv = sp_writer_recv (self->pipe, gclient->client, &tag);
+          GST_OBJECT_UNLOCK (self);
+
+          if (rv < 0) {
+            GST_WARNING_OBJECT (self, "One client has read error,"
+                " closing (retval: %d errno: %d)", rv, errno);
+            goto close_client;
+          }
+
+          g_assert (rv == 0 || tag == NULL);
 
-        if (rv == 0)
-          gst_buffer_unref (tag);
+          if (rv == 0)
+            gst_buffer_unref (tag);
+        }
       }
       continue;
     close_client:
@@ -962,7 +1174,7 @@ gst_shm_sink_event (GstBaseSink * bsink, GstEvent * event)
       GST_OBJECT_LOCK (self);
       while (self->wait_for_connection && sp_writer_pending_writes (self->pipe)
           && !self->unlock)
-        g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+        gst_shm_sink_wait_locked (self);
       GST_OBJECT_UNLOCK (self);
       break;
     default:
@@ -1002,10 +1214,21 @@ static gboolean
 gst_shm_sink_propose_allocation (GstBaseSink * sink, GstQuery * query)
 {
   GstShmSink *self = GST_SHM_SINK (sink);
+  GstAllocator *allocator = NULL;
 
-  if (self->allocator)
-    gst_query_add_allocation_param (query, GST_ALLOCATOR (self->allocator),
-        NULL);
+  GST_OBJECT_LOCK (self);
+  if (self->fd_passing) {
+    allocator = g_object_new (GST_TYPE_SHM_SINK_FD_ALLOCATOR, NULL);
+    gst_object_ref_sink (allocator);
+  } else if (self->allocator) {
+    allocator = gst_object_ref (self->allocator);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (allocator) {
+    gst_query_add_allocation_param (query, allocator, NULL);
+    gst_object_unref (allocator);
+  }
 
   return TRUE;
 }
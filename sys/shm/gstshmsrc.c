@@ -311,6 +311,8 @@ free_buffer (gpointer data)
 
   GST_OBJECT_LOCK (gsb->pipe->src);
   sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
+  if (!gsb->pipe->src->defer_acks || gsb->pipe != gsb->pipe->src->pipe)
+    sp_client_flush (gsb->pipe->pipe);
   GST_OBJECT_UNLOCK (gsb->pipe->src);
 
   gst_shm_pipe_dec (gsb->pipe);
@@ -318,6 +320,17 @@ free_buffer (gpointer data)
   g_slice_free (struct GstShmBuffer, gsb);
 }
 
+/* Acks for buffers released while create() handles commands are queued,
+ * and sent together once it handled all that the writer sent so far */
+static void
+gst_shm_src_flush_acks (GstShmSrc * self, GstShmPipe * pipe)
+{
+  GST_OBJECT_LOCK (self);
+  sp_client_flush (pipe->pipe);
+  self->defer_acks = FALSE;
+  GST_OBJECT_UNLOCK (self);
+}
+
 static GstFlowReturn
 gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -340,41 +353,62 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   GST_OBJECT_UNLOCK (self);
 
   do {
-    if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
-      if (errno == EBUSY)
+    /* Buffers that were received together with earlier ones don't make the
+     * socket readable again. The queue of received commands is only used
+     * from here, so it is checked and filled without the object lock. */
+    if (!sp_client_has_pending_commands (pipe->pipe)) {
+      /* The writer may be waiting for these */
+      gst_shm_src_flush_acks (self, pipe);
+
+      if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
+        if (errno == EBUSY)
+          goto flushing;
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Poll failed on fd: %s",
+                strerror (errno)));
+        goto error;
+      }
+
+      if (self->unlocked)
         goto flushing;
-      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Poll failed on fd: %s", strerror (errno)));
-      goto error;
+
+      if (gst_poll_fd_has_closed (self->poll, &self->pollfd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Control socket has closed"));
+        goto error;
+      }
+
+      if (gst_poll_fd_has_error (self->poll, &self->pollfd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Control socket has error"));
+        goto error;
+      }
+
+      if (!gst_poll_fd_can_read (self->poll, &self->pollfd))
+        continue;
+
+      if (sp_client_read (pipe->pipe) < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Error reading control data: %s",
+                strerror (errno)));
+        goto error;
+      }
     }
 
     if (self->unlocked)
       goto flushing;
 
-    if (gst_poll_fd_has_closed (self->poll, &self->pollfd)) {
-      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Control socket has closed"));
-      goto error;
-    }
-
-    if (gst_poll_fd_has_error (self->poll, &self->pollfd)) {
+    buf = NULL;
+    GST_LOG_OBJECT (self, "Reading from pipe");
+    GST_OBJECT_LOCK (self);
+    self->defer_acks = TRUE;
+    rv = sp_client_recv (pipe->pipe, &buf);
+    GST_OBJECT_UNLOCK (self);
+    if (rv < 0) {
       GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Control socket has error"));
+          ("Error reading control data: %d", rv));
       goto error;
     }
-
-    if (gst_poll_fd_can_read (self->poll, &self->pollfd)) {
-      buf = NULL;
-      GST_LOG_OBJECT (self, "Reading from pipe");
-      GST_OBJECT_LOCK (self);
-      rv = sp_client_recv (pipe->pipe, &buf);
-      GST_OBJECT_UNLOCK (self);
-      if (rv < 0) {
-        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-            ("Error reading control data: %d", rv));
-        goto error;
-      }
-    }
   } while (buf == NULL);
 
   GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
@@ -386,12 +420,21 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
       buf, rv, 0, rv, gsb, free_buffer);
 
+  /* If more buffers are queued already, the next call sends the acks */
+  GST_OBJECT_LOCK (self);
+  if (!sp_client_has_pending_commands (pipe->pipe))
+    sp_client_flush (pipe->pipe);
+  self->defer_acks = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
   return GST_FLOW_OK;
 
 error:
+  gst_shm_src_flush_acks (self, pipe);
   gst_shm_pipe_dec (pipe);
   return GST_FLOW_ERROR;
 flushing:
+  gst_shm_src_flush_acks (self, pipe);
   gst_shm_pipe_dec (pipe);
   return GST_FLOW_FLUSHING;
 }
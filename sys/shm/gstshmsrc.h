@@ -56,6 +56,9 @@ struct _GstShmSrc
 
   GstFlowReturn flow_return;
   gboolean unlocked;
+
+  /* TRUE while create() handles commands and sends the acks itself */
+  gboolean defer_acks;
 };
 
 struct _GstShmSrcClass
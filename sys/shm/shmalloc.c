@@ -33,14 +33,44 @@
 #include <string.h>
 #include <assert.h>
 
+/* The space is split into granules of a power of two size, so that all
+ * blocks start on a granule boundary. The granule index only points to a
+ * block from its first and its last granule (boundary tags), the entries of
+ * the granules in between are NULL. This way blocks are split and merged in
+ * constant time, and the neighbours of a block are found next to its tags.
+ * The granule size only grows for very large spaces, to bound the size of
+ * the index. The index is allocated zeroed and only written at block
+ * boundaries, so most of it is never touched. */
+#define SHM_ALLOC_MIN_GRANULE_SHIFT 6
+#define SHM_ALLOC_MAX_GRANULES (1UL << 20)
+
+/* Free blocks are kept in segregated lists, class n holding the blocks of
+ * [2^n, 2^(n+1)) granules */
+#define SHM_ALLOC_N_CLASSES 32
+
 /* This is the allocated space to hold multiple blocks */
 struct _ShmAllocSpace
 {
   /* The total size of this space */
   size_t size;
 
-  /* chained list of the blocks contained in this space */
-  ShmAllocBlock *blocks;
+  /* log2 of the granule size and the number of granules in the space, the
+   * last one can be partial */
+  unsigned int granule_shift;
+  unsigned long n_granules;
+
+  /* The block starting or ending at each granule, NULL for the granules
+   * inside of a block. The space is always completely covered by allocated
+   * and free blocks */
+  ShmAllocBlock **index;
+
+  /* Lists of free blocks per size class, and a bitmask of the non-empty
+   * lists */
+  ShmAllocBlock *free_lists[SHM_ALLOC_N_CLASSES];
+  unsigned int free_classes;
+
+  /* The number of allocated blocks */
+  unsigned int n_blocks;
 };
 
 /* A single block of data */
@@ -55,12 +85,89 @@ struct _ShmAllocBlock
   unsigned long offset;
   /* The size of the block */
   unsigned long size;
+  /* The number of granules of the block */
+  unsigned long n_granules;
 
-  /* Pointer to the next block in the chain */
-  ShmAllocBlock *next;
+  /* Links in the free list of its size class while the block is free */
+  int free;
+  ShmAllocBlock *prev_free;
+  ShmAllocBlock *next_free;
 };
 
 
+static unsigned int
+shm_alloc_space_size_class (unsigned long n_granules)
+{
+  unsigned int class = 0;
+
+  while (n_granules >>= 1)
+    class++;
+
+  return class < SHM_ALLOC_N_CLASSES ? class : SHM_ALLOC_N_CLASSES - 1;
+}
+
+/* Makes @block cover @n_granules granules starting at @offset and tags its
+ * first and last granule */
+static void
+shm_alloc_space_set_block (ShmAllocSpace * self, ShmAllocBlock * block,
+    unsigned long offset, unsigned long n_granules)
+{
+  unsigned long first = offset >> self->granule_shift;
+
+  block->offset = offset;
+  block->n_granules = n_granules;
+  block->size = n_granules << self->granule_shift;
+  if (block->offset + block->size > self->size)
+    block->size = self->size - block->offset;
+
+  self->index[first] = block;
+  self->index[first + n_granules - 1] = block;
+}
+
+/* Removes the tags of @block, before it gets merged into another one */
+static void
+shm_alloc_space_clear_block (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned long first = block->offset >> self->granule_shift;
+
+  self->index[first] = NULL;
+  self->index[first + block->n_granules - 1] = NULL;
+}
+
+static void
+shm_alloc_space_insert_free (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int class = shm_alloc_space_size_class (block->n_granules);
+
+  block->free = 1;
+  block->use_count = 0;
+  block->prev_free = NULL;
+  block->next_free = self->free_lists[class];
+  if (block->next_free)
+    block->next_free->prev_free = block;
+  self->free_lists[class] = block;
+  self->free_classes |= 1U << class;
+}
+
+static void
+shm_alloc_space_remove_free (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int class = shm_alloc_space_size_class (block->n_granules);
+
+  if (block->prev_free)
+    block->prev_free->next_free = block->next_free;
+  else
+    self->free_lists[class] = block->next_free;
+  if (block->next_free)
+    block->next_free->prev_free = block->prev_free;
+
+  if (!self->free_lists[class])
+    self->free_classes &= ~(1U << class);
+
+  block->free = 0;
+  block->prev_free = block->next_free = NULL;
+}
+
 ShmAllocSpace *
 shm_alloc_space_new (size_t size)
 {
@@ -70,13 +177,39 @@ shm_alloc_space_new (size_t size)
 
   self->size = size;
 
+  self->granule_shift = SHM_ALLOC_MIN_GRANULE_SHIFT;
+  while ((size >> self->granule_shift) > SHM_ALLOC_MAX_GRANULES)
+    self->granule_shift++;
+  self->n_granules = (size + (1UL << self->granule_shift) - 1) >>
+      self->granule_shift;
+
+  if (self->n_granules > 0) {
+    ShmAllocBlock *block;
+
+    self->index = calloc (self->n_granules, sizeof (ShmAllocBlock *));
+
+    /* Initially the whole space is one free block */
+    block = spalloc_new (ShmAllocBlock);
+    memset (block, 0, sizeof (ShmAllocBlock));
+    block->space = self;
+    shm_alloc_space_set_block (self, block, 0, self->n_granules);
+    shm_alloc_space_insert_free (self, block);
+  }
+
   return self;
 }
 
 void
 shm_alloc_space_free (ShmAllocSpace * self)
 {
-  assert (self && self->blocks == NULL);
+  assert (self && self->n_blocks == 0);
+
+  /* All blocks got merged back into a single free one */
+  if (self->n_granules > 0) {
+    spalloc_free (ShmAllocBlock, self->index[0]);
+    free (self->index);
+  }
+
   spalloc_free (ShmAllocSpace, self);
 }
 
@@ -84,43 +217,52 @@ shm_alloc_space_free (ShmAllocSpace * self)
 ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
 {
-  ShmAllocBlock *block;
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
-  unsigned long prev_end_offset = 0;
+  ShmAllocBlock *block = NULL;
+  unsigned long n_granules;
+  unsigned int class;
+
+  n_granules = (size + (1UL << self->granule_shift) - 1) >>
+      self->granule_shift;
+  if (n_granules == 0)
+    n_granules = 1;
+
+  /* Only blocks of the same size class can be too small, while any block of
+   * a larger class is big enough. The only exception is the last block if
+   * the space ends with a partial granule. */
+  for (class = shm_alloc_space_size_class (n_granules);
+      !block && class < SHM_ALLOC_N_CLASSES; class++) {
+    if (!(self->free_classes & (1U << class)))
+      continue;
+
+    for (block = self->free_lists[class]; block; block = block->next_free) {
+      if (block->n_granules >= n_granules && block->offset + size <= self->size)
+        break;
+    }
+  }
 
+  /* Return NULL if there is no big enough space */
+  if (!block)
+    return NULL;
 
-  for (item = self->blocks; item; item = item->next) {
-    unsigned long max_size = 0;
+  shm_alloc_space_remove_free (self, block);
 
-    max_size = item->offset - prev_end_offset;
+  /* Give back the rest as a new free block, it takes over the tag of the
+   * last granule */
+  if (block->n_granules > n_granules) {
+    ShmAllocBlock *rest = spalloc_new (ShmAllocBlock);
 
-    if (max_size >= size)
-      break;
+    memset (rest, 0, sizeof (ShmAllocBlock));
+    rest->space = self;
+    shm_alloc_space_set_block (self, rest,
+        block->offset + (n_granules << self->granule_shift),
+        block->n_granules - n_granules);
+    shm_alloc_space_insert_free (self, rest);
 
-    prev_end_offset = item->offset + item->size;
-    prev_item = item;
+    shm_alloc_space_set_block (self, block, block->offset, n_granules);
   }
 
-  /* Return NULL if there is no big enough space, otherwise, there is space
-   * at the end */
-  assert (prev_end_offset <= self->size);
-  if (!item && self->size - prev_end_offset < size)
-    return NULL;
-
-  block = spalloc_new (ShmAllocBlock);
-  memset (block, 0, sizeof (ShmAllocBlock));
-  block->offset = prev_end_offset;
-  block->size = size;
   block->use_count = 1;
-  block->space = self;
-
-  if (prev_item)
-    prev_item->next = block;
-  else
-    self->blocks = block;
-
-  block->next = item;
+  self->n_blocks++;
 
   return block;
 }
@@ -134,35 +276,64 @@ shm_alloc_space_alloc_block_get_offset (ShmAllocBlock * block)
 static void
 shm_alloc_space_free_block (ShmAllocBlock * block)
 {
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
   ShmAllocSpace *self = block->space;
+  unsigned long first = block->offset >> self->granule_shift;
+  unsigned long offset = block->offset;
+  unsigned long n_granules = block->n_granules;
+  ShmAllocBlock *prev = NULL, *next = NULL;
+
+  self->n_blocks--;
+
+  /* Merge with the free neighbours, so that free space is never split into
+   * adjacent blocks */
+  if (first > 0 && self->index[first - 1]->free)
+    prev = self->index[first - 1];
+  if (first + n_granules < self->n_granules &&
+      self->index[first + n_granules]->free)
+    next = self->index[first + n_granules];
+
+  /* The tags between the merged blocks end up inside of the new block */
+  shm_alloc_space_clear_block (self, block);
+  if (prev) {
+    shm_alloc_space_remove_free (self, prev);
+    shm_alloc_space_clear_block (self, prev);
+    offset = prev->offset;
+    n_granules += prev->n_granules;
+  }
+  if (next) {
+    shm_alloc_space_remove_free (self, next);
+    shm_alloc_space_clear_block (self, next);
+    n_granules += next->n_granules;
+    spalloc_free (ShmAllocBlock, next);
+  }
 
-  for (item = self->blocks; item; item = item->next) {
-    if (item == block) {
-      if (prev_item)
-        prev_item->next = item->next;
-      else
-        self->blocks = item->next;
-      break;
-    }
-    prev_item = item;
+  if (prev) {
+    spalloc_free (ShmAllocBlock, block);
+    block = prev;
   }
 
-  spalloc_free (ShmAllocBlock, block);
+  shm_alloc_space_set_block (self, block, offset, n_granules);
+  shm_alloc_space_insert_free (self, block);
 }
 
+/* Offsets are normally the start of a block, which is found right away.
+ * For an offset inside of a block, walk back to the closest tag, which
+ * can only be one of that block. */
 ShmAllocBlock *
 shm_alloc_space_block_get (ShmAllocSpace * self, unsigned long offset)
 {
-  ShmAllocBlock *block = NULL;
+  unsigned long granule;
+  ShmAllocBlock *block;
 
-  for (block = self->blocks; block; block = block->next) {
-    if (block->offset <= offset && (block->offset + block->size) > offset)
-      return block;
-  }
+  if (offset >= self->size)
+    return NULL;
+
+  granule = offset >> self->granule_shift;
+  while (!self->index[granule])
+    granule--;
+  block = self->index[granule];
 
-  return NULL;
+  return block->free ? NULL : block;
 }
 
 
@@ -67,6 +67,13 @@
  * type 4: ack buffer
  * offset
  *
+ * type 5: fd buffer
+ * offset
+ * bufsize
+ * The file descriptor holding the data is passed along as SCM_RIGHTS
+ * ancillary data. The negative area id identifies the buffer, and is sent
+ * back in its ack with an offset of 0.
+ *
  * Type 4 goes from the client to the server
  * The rest are from the server to the client
  * The client should never write in the SHM
@@ -75,15 +82,71 @@
 
 #define LISTEN_BACKLOG 10
 
+/* Maximum number of commands read from a socket at once, and of commands
+ * queued before they are sent */
+#define COMMAND_BATCH 32
+
 enum
 {
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_FD_BUFFER = 5
 };
 
 typedef struct _ShmArea ShmArea;
+typedef struct _CommandQueue CommandQueue;
+typedef struct _ShmFdBuffer ShmFdBuffer;
+
+struct CommandBuffer
+{
+  unsigned int type;
+  int area_id;
+
+  union
+  {
+    struct
+    {
+      size_t size;
+      unsigned int path_size;
+      /* Followed by path */
+    } new_shm_area;
+    struct
+    {
+      unsigned long offset;
+      unsigned long size;
+    } buffer;
+    struct
+    {
+      unsigned long offset;
+    } ack_buffer;
+  } payload;
+};
+
+/* Commands that were received from a socket but not handled yet, or that
+ * are waiting to be sent. Reading or writing all of them at once saves a
+ * syscall per command when several of them queued up. */
+struct _CommandQueue
+{
+  char data[COMMAND_BATCH * sizeof (struct CommandBuffer)];
+  size_t pos;
+  size_t len;
+
+  /* File descriptors received along with the commands, in order */
+  int fds[COMMAND_BATCH];
+  unsigned int n_fds;
+};
+
+/* A buffer received as a file descriptor, mapped by the client */
+struct _ShmFdBuffer
+{
+  int id;
+  char *map;
+  size_t map_len;
+
+  ShmFdBuffer *next;
+};
 
 struct _ShmArea
 {
@@ -108,7 +171,10 @@ struct _ShmBuffer
 {
   int use_count;
 
+  /* NULL for buffers sent as a file descriptor, identified by fd_id */
   ShmArea *shm_area;
+  int fd_id;
+
   unsigned long offset;
   size_t size;
 
@@ -141,12 +207,30 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  /* Commands received from the writer, only used by clients */
+  CommandQueue queue;
+
+  /* Acks waiting for sp_client_flush(), only used by clients */
+  CommandQueue acks;
+
+  /* Last id given to a buffer sent as file descriptor */
+  int last_fd_id;
+
+  /* The buffers received as file descriptors, only used by clients */
+  ShmFdBuffer *fd_buffers;
 };
 
 struct _ShmClient
 {
   int fd;
 
+  /* Commands received from this client */
+  CommandQueue queue;
+
+  /* Commands waiting for sp_writer_flush() */
+  CommandQueue out;
+
   ShmClient *next;
 };
 
@@ -157,30 +241,6 @@ struct _ShmBlock
   ShmAllocBlock *ablock;
 };
 
-struct CommandBuffer
-{
-  unsigned int type;
-  int area_id;
-
-  union
-  {
-    struct
-    {
-      size_t size;
-      unsigned int path_size;
-      /* Followed by path */
-    } new_shm_area;
-    struct
-    {
-      unsigned long offset;
-      unsigned long size;
-    } buffer;
-    struct
-    {
-      unsigned long offset;
-    } ack_buffer;
-  } payload;
-};
 
 static ShmArea *sp_open_shm (char *path, int id, mode_t perms, size_t size);
 static void sp_close_shm (ShmArea * area);
@@ -244,10 +304,14 @@ sp_writer_create (const char *path, size_t size, mode_t perms)
   if (listen (self->main_socket, LISTEN_BACKLOG) < 0)
     RETURN_ERROR ("listen() failed (%d): %s\n", errno, strerror (errno));
 
-  self->shm_area = sp_open_shm (NULL, ++self->next_area_id, perms, size);
-
   self->perms = perms;
 
+  /* Without a size the area is only created by sp_writer_resize() */
+  if (size == 0)
+    return self;
+
+  self->shm_area = sp_open_shm (NULL, ++self->next_area_id, perms, size);
+
   if (!self->shm_area)
     RETURN_ERROR ("Could not open shm area (%d): %s", errno, strerror (errno));
 
@@ -433,6 +497,20 @@ void
 sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
     void *user_data)
 {
+  unsigned int i;
+
+  for (i = 0; i < self->queue.n_fds; i++)
+    close (self->queue.fds[i]);
+  self->queue.n_fds = 0;
+
+  while (self->fd_buffers) {
+    ShmFdBuffer *fdbuf = self->fd_buffers;
+
+    self->fd_buffers = fdbuf->next;
+    munmap (fdbuf->map, fdbuf->map_len);
+    spalloc_free (ShmFdBuffer, fdbuf);
+  }
+
   if (self->main_socket >= 0) {
     shutdown (self->main_socket, SHUT_RDWR);
     close (self->main_socket);
@@ -485,6 +563,109 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_with_fd (int fd, struct CommandBuffer *cb, unsigned short int type,
+    int area_id, int passfd)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  memset (&control, 0, sizeof (control));
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &passfd, sizeof (int));
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
+/* Sends everything in @queue, returns 0 if that failed. The queue is
+ * empty afterwards in both cases. */
+static int
+send_queue (int fd, CommandQueue * queue)
+{
+  ssize_t retval;
+  int ok;
+
+  while (queue->pos < queue->len) {
+    retval = send (fd, queue->data + queue->pos, queue->len - queue->pos,
+        MSG_NOSIGNAL);
+    if (retval < 0 && errno == EINTR)
+      continue;
+    if (retval <= 0)
+      break;
+    queue->pos += retval;
+  }
+
+  ok = queue->pos == queue->len;
+  queue->pos = queue->len = 0;
+
+  return ok;
+}
+
+/* Appends a command to @queue, sending the queue first if it is full.
+ * Returns 0 if that failed. */
+static int
+queue_command (int fd, CommandQueue * queue, struct CommandBuffer *cb,
+    unsigned short int type, int area_id)
+{
+  cb->type = type;
+  cb->area_id = area_id;
+
+  if (queue->len + sizeof (struct CommandBuffer) > sizeof (queue->data) &&
+      !send_queue (fd, queue))
+    return 0;
+
+  memcpy (queue->data + queue->len, cb, sizeof (struct CommandBuffer));
+  queue->len += sizeof (struct CommandBuffer);
+
+  return 1;
+}
+
+/* Commands that couldn't be sent are lost, and so are the acks for the
+ * buffers in them. Shut the client down so that its owner sees it hang up
+ * and closes it, which releases its buffers. */
+static int
+flush_client (ShmClient * client)
+{
+  if (send_queue (client->fd, &client->out))
+    return 1;
+
+  shutdown (client->fd, SHUT_RDWR);
+  return 0;
+}
+
+static int
+queue_client_command (ShmClient * client, struct CommandBuffer *cb,
+    unsigned short int type, int area_id)
+{
+  if (client->out.len + sizeof (struct CommandBuffer) >
+      sizeof (client->out.data) && !flush_client (client))
+    return 0;
+
+  return queue_command (client->fd, &client->out, cb, type, area_id);
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -494,7 +675,7 @@ sp_writer_resize (ShmPipe * self, size_t size)
   int c = 0;
   int pathlen;
 
-  if (self->shm_area->shm_area_len == size)
+  if (self->shm_area && self->shm_area->shm_area_len == size)
     return 0;
 
   newarea = sp_open_shm (NULL, ++self->next_area_id, self->perms, size);
@@ -511,8 +692,12 @@ sp_writer_resize (ShmPipe * self, size_t size)
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
 
-    if (!send_command (client->fd, &cb, COMMAND_CLOSE_SHM_AREA,
-            old_current->id))
+    /* Buffers in the old area must arrive before it is closed */
+    if (!flush_client (client))
+      continue;
+
+    if (old_current && !send_command (client->fd, &cb,
+            COMMAND_CLOSE_SHM_AREA, old_current->id))
       continue;
 
     cb.payload.new_shm_area.size = newarea->shm_area_len;
@@ -526,7 +711,8 @@ sp_writer_resize (ShmPipe * self, size_t size)
     c++;
   }
 
-  sp_shm_area_dec (self, old_current);
+  if (old_current)
+    sp_shm_area_dec (self, old_current);
 
 
   return c;
@@ -536,9 +722,12 @@ ShmBlock *
 sp_writer_alloc_block (ShmPipe * self, size_t size)
 {
   ShmBlock *block;
-  ShmAllocBlock *ablock =
-      shm_alloc_space_alloc_block (self->shm_area->allocspace, size);
+  ShmAllocBlock *ablock;
+
+  if (!self->shm_area)
+    return NULL;
 
+  ablock = shm_alloc_space_alloc_block (self->shm_area->allocspace, size);
   if (!ablock)
     return NULL;
 
@@ -573,7 +762,8 @@ sp_writer_free_block (ShmBlock * block)
   spalloc_free (ShmBlock, block);
 }
 
-/* Returns the number of client this has successfully been sent to */
+/* Returns the number of clients this has successfully been queued for,
+ * sp_writer_flush() sends it */
 
 int
 sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
@@ -617,7 +807,8 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
     struct CommandBuffer cb = { 0 };
     cb.payload.buffer.offset = offset;
     cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
+    if (!queue_client_command (client, &cb, COMMAND_NEW_BUFFER,
+            self->shm_area->id))
       continue;
     sb->clients[i++] = client->fd;
     c++;
@@ -639,17 +830,153 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+/* Sends the commands queued for each client with one send() per client */
+void
+sp_writer_flush (ShmPipe * self)
+{
+  ShmClient *client;
+
+  for (client = self->clients; client; client = client->next)
+    flush_client (client);
+}
+
+/* Copies the next command of @queue into @cb without taking it out. Returns
+ * 0 if it wasn't received completely yet, including the path following a
+ * NEW_SHM_AREA command. */
 static int
-recv_command (int fd, struct CommandBuffer *cb)
+peek_command (CommandQueue * queue, struct CommandBuffer *cb)
 {
-  int retval;
+  size_t queued = queue->len - queue->pos;
 
-  retval = recv (fd, cb, sizeof (struct CommandBuffer), MSG_DONTWAIT);
-  if (retval == sizeof (struct CommandBuffer)) {
-    return 1;
-  } else {
+  if (queued < sizeof (struct CommandBuffer))
+    return 0;
+
+  memcpy (cb, queue->data + queue->pos, sizeof (struct CommandBuffer));
+  if (cb->type == COMMAND_NEW_SHM_AREA &&
+      queued - sizeof (struct CommandBuffer) < cb->payload.new_shm_area.path_size)
     return 0;
+
+  return 1;
+}
+
+static int
+has_queued_command (CommandQueue * queue)
+{
+  struct CommandBuffer cb;
+
+  return peek_command (queue, &cb);
+}
+
+/* Returns the number of client this has successfully been sent to */
+
+int
+sp_writer_send_fd (ShmPipe * self, int fd, size_t offset, size_t size,
+    void *tag)
+{
+  ShmBuffer *sb;
+  ShmClient *client = NULL;
+  int i = 0;
+  int c = 0;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
+  memset (sb, 0, sizeof (ShmBuffer));
+  memset (sb->clients, -1, sizeof (int) * self->num_clients);
+  sb->offset = offset;
+  sb->size = size;
+  sb->num_clients = self->num_clients;
+  sb->tag = tag;
+
+  if (self->last_fd_id == INT_MAX)
+    self->last_fd_id = 0;
+  sb->fd_id = ++self->last_fd_id;
+
+  for (client = self->clients; client; client = client->next) {
+    struct CommandBuffer cb = { 0 };
+    cb.payload.buffer.offset = offset;
+    cb.payload.buffer.size = size;
+    /* Keep the order with the buffers queued before */
+    if (!flush_client (client))
+      continue;
+    if (!send_command_with_fd (client->fd, &cb, COMMAND_NEW_FD_BUFFER,
+            -sb->fd_id, fd))
+      continue;
+    sb->clients[i++] = client->fd;
+    c++;
   }
+
+  if (c == 0) {
+    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
+    return 0;
+  }
+
+  sb->use_count = c;
+
+  sb->next = self->buffers;
+  self->buffers = sb;
+
+  return c;
+}
+
+/* Reads all available data into the free space of @queue without blocking,
+ * keeping the file descriptors sent along. Returns -1 if the socket was
+ * closed or failed, 0 otherwise. */
+static int
+recv_queue (int fd, CommandQueue * queue)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  ssize_t retval;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * COMMAND_BATCH)];
+    struct cmsghdr align;
+  } control;
+
+  memmove (queue->data, queue->data + queue->pos, queue->len - queue->pos);
+  queue->len -= queue->pos;
+  queue->pos = 0;
+
+  /* The queue only fills up if the caller didn't handle the commands in
+   * it, or with a command that doesn't fit at all */
+  if (queue->len == sizeof (queue->data))
+    return has_queued_command (queue) ? 0 : -1;
+
+  iov.iov_base = queue->data + queue->len;
+  iov.iov_len = sizeof (queue->data) - queue->len;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  retval = recvmsg (fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+  if (retval < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return 0;
+  if (retval <= 0)
+    return -1;
+
+  queue->len += retval;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    int *fds = (int *) CMSG_DATA (cmsg);
+    unsigned int i, n_fds;
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    for (i = 0; i < n_fds; i++) {
+      if (queue->n_fds < COMMAND_BATCH)
+        queue->fds[queue->n_fds++] = fds[i];
+      else
+        close (fds[i]);
+    }
+  }
+
+  return 0;
 }
 
 long int
@@ -659,25 +986,24 @@ sp_client_recv (ShmPipe * self, char **buf)
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
-  int retval;
+  unsigned int path_size;
 
-  if (!recv_command (self->main_socket, &cb))
-    return -1;
+  /* Wait for sp_client_read() to receive the rest */
+  if (!peek_command (&self->queue, &cb))
+    return 0;
+  self->queue.pos += sizeof (struct CommandBuffer);
 
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
       assert (cb.payload.new_shm_area.size > 0);
 
-      area_name = malloc (cb.payload.new_shm_area.path_size + 1);
-      retval = recv (self->main_socket, area_name,
-          cb.payload.new_shm_area.path_size, 0);
-      if (retval != cb.payload.new_shm_area.path_size) {
-        free (area_name);
-        return -3;
-      }
+      path_size = cb.payload.new_shm_area.path_size;
+      area_name = malloc (path_size + 1);
+      memcpy (area_name, self->queue.data + self->queue.pos, path_size);
+      self->queue.pos += path_size;
       /* Ensure area_name is NULL terminated */
-      area_name[retval] = 0;
+      area_name[path_size] = 0;
 
       newarea = sp_open_shm (area_name, cb.area_id, 0,
           cb.payload.new_shm_area.size);
@@ -709,6 +1035,37 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_FD_BUFFER:{
+      ShmFdBuffer *fdbuf;
+      int fd;
+
+      assert (buf);
+      if (self->queue.n_fds == 0)
+        return -24;
+
+      fd = self->queue.fds[0];
+      self->queue.n_fds--;
+      memmove (self->queue.fds, self->queue.fds + 1,
+          sizeof (int) * self->queue.n_fds);
+
+      fdbuf = spalloc_new (ShmFdBuffer);
+      fdbuf->id = -cb.area_id;
+      fdbuf->map_len = cb.payload.buffer.offset + cb.payload.buffer.size;
+      fdbuf->map = mmap (NULL, fdbuf->map_len, PROT_READ, MAP_SHARED, fd, 0);
+      close (fd);
+
+      if (fdbuf->map == MAP_FAILED) {
+        spalloc_free (ShmFdBuffer, fdbuf);
+        return -25;
+      }
+
+      fdbuf->next = self->fd_buffers;
+      self->fd_buffers = fdbuf;
+
+      *buf = fdbuf->map + cb.payload.buffer.offset;
+      return cb.payload.buffer.size;
+    }
+
     default:
       return -99;
   }
@@ -722,15 +1079,17 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   ShmBuffer *buf = NULL, *prev_buf = NULL;
   struct CommandBuffer cb;
 
-  if (!recv_command (client->fd, &cb))
+  if (!peek_command (&client->queue, &cb))
     return -1;
+  client->queue.pos += sizeof (struct CommandBuffer);
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
 
       for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
-            buf->offset == cb.payload.ack_buffer.offset) {
+        if (buf->shm_area ? (buf->shm_area->id == cb.area_id &&
+                buf->offset == cb.payload.ack_buffer.offset) :
+            buf->fd_id == -cb.area_id) {
           return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
         }
         prev_buf = buf;
@@ -748,9 +1107,27 @@ int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
   ShmArea *shm_area = NULL;
+  ShmFdBuffer *fdbuf, *prev_fdbuf = NULL;
   unsigned long offset;
   struct CommandBuffer cb = { 0 };
 
+  for (fdbuf = self->fd_buffers; fdbuf; fdbuf = fdbuf->next) {
+    if (buf >= fdbuf->map && buf <= fdbuf->map + fdbuf->map_len) {
+      int id = fdbuf->id;
+
+      if (prev_fdbuf)
+        prev_fdbuf->next = fdbuf->next;
+      else
+        self->fd_buffers = fdbuf->next;
+      munmap (fdbuf->map, fdbuf->map_len);
+      spalloc_free (ShmFdBuffer, fdbuf);
+
+      return queue_command (self->main_socket, &self->acks, &cb,
+          COMMAND_ACK_BUFFER, -id);
+    }
+    prev_fdbuf = fdbuf;
+  }
+
   for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
     if (buf >= shm_area->shm_area_buf &&
         buf < shm_area->shm_area_buf + shm_area->shm_area_len)
@@ -764,8 +1141,41 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
   sp_shm_area_dec (self, shm_area);
 
   cb.payload.ack_buffer.offset = offset;
-  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER,
-      self->shm_area->id);
+  return queue_command (self->main_socket, &self->acks, &cb,
+      COMMAND_ACK_BUFFER, self->shm_area->id);
+}
+
+/* Sends all the acks queued by sp_client_recv_finish() in one go */
+int
+sp_client_flush (ShmPipe * self)
+{
+  return send_queue (self->main_socket, &self->acks);
+}
+
+/* The socket reads only touch the queue of the connection and never block,
+ * so they don't need to be serialized with the other calls on the pipe */
+int
+sp_writer_read (ShmClient * client)
+{
+  return recv_queue (client->fd, &client->queue);
+}
+
+int
+sp_writer_has_pending_commands (ShmClient * client)
+{
+  return has_queued_command (&client->queue);
+}
+
+int
+sp_client_read (ShmPipe * self)
+{
+  return recv_queue (self->main_socket, &self->queue);
+}
+
+int
+sp_client_has_pending_commands (ShmPipe * self)
+{
+  return has_queued_command (&self->queue);
 }
 
 ShmPipe *
@@ -811,7 +1221,7 @@ sp_writer_accept_client (ShmPipe * self)
   ShmClient *client = NULL;
   int fd;
   struct CommandBuffer cb = { 0 };
-  int pathlen = strlen (self->shm_area->shm_area_name) + 1;
+  int pathlen;
 
 
   fd = accept (self->main_socket, NULL, NULL);
@@ -821,6 +1231,10 @@ sp_writer_accept_client (ShmPipe * self)
     return NULL;
   }
 
+  if (!self->shm_area)
+    goto done;
+
+  pathlen = strlen (self->shm_area->shm_area_name) + 1;
   cb.payload.new_shm_area.size = self->shm_area->shm_area_len;
   cb.payload.new_shm_area.path_size = pathlen;
   if (!send_command (fd, &cb, COMMAND_NEW_SHM_AREA, self->shm_area->id)) {
@@ -834,7 +1248,9 @@ sp_writer_accept_client (ShmPipe * self)
     goto error;
   }
 
+done:
   client = spalloc_new (ShmClient);
+  memset (client, 0, sizeof (ShmClient));
   client->fd = fd;
 
   /* Prepend ot linked list */
@@ -883,8 +1299,10 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
-    sp_shm_area_dec (self, buf->shm_area);
+    if (buf->shm_area) {
+      shm_alloc_space_block_dec (buf->ablock);
+      sp_shm_area_dec (self, buf->shm_area);
+    }
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
     return 0;
   }
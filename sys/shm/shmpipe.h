@@ -97,6 +97,9 @@ int sp_writer_get_client_fd (ShmClient * client);
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
+void sp_writer_flush (ShmPipe * self);
+int sp_writer_send_fd (ShmPipe * self, int fd, size_t offset, size_t size,
+    void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
@@ -104,7 +107,9 @@ size_t sp_writer_get_max_buf_size (ShmPipe * self);
 ShmClient * sp_writer_accept_client (ShmPipe * self);
 void sp_writer_close_client (ShmPipe *self, ShmClient * client,
     sp_buffer_free_callback callback, void * user_data);
+int sp_writer_read (ShmClient * client);
 int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
+int sp_writer_has_pending_commands (ShmClient * client);
 
 int sp_writer_pending_writes (ShmPipe * self);
 
@@ -113,8 +118,11 @@ ShmBuffer *sp_writer_get_next_buffer (ShmBuffer * buffer);
 void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 
 ShmPipe *sp_client_open (const char *path);
+int sp_client_read (ShmPipe * self);
 long int sp_client_recv (ShmPipe * self, char **buf);
+int sp_client_has_pending_commands (ShmPipe * self);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+int sp_client_flush (ShmPipe * self);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
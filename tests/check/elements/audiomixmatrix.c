@@ -0,0 +1,379 @@
+/* GStreamer
+ *
+ * unit test for audiomixmatrix
+ *
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+#define N_FRAMES 256
+
+static const GstAudioFormat formats[] = {
+  GST_AUDIO_FORMAT_F32,
+  GST_AUDIO_FORMAT_F64,
+  GST_AUDIO_FORMAT_S16,
+  GST_AUDIO_FORMAT_S32
+};
+
+static void
+set_matrix (GstElement * element, guint in_channels, guint out_channels,
+    const gdouble * matrix)
+{
+  GValue rows = G_VALUE_INIT;
+  guint in, out;
+
+  g_value_init (&rows, GST_TYPE_ARRAY);
+  for (out = 0; out < out_channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < in_channels; in++) {
+      GValue v = G_VALUE_INIT;
+
+      g_value_init (&v, G_TYPE_DOUBLE);
+      g_value_set_double (&v, matrix[out * in_channels + in]);
+      gst_value_array_append_and_take_value (&row, &v);
+    }
+    gst_value_array_append_and_take_value (&rows, &row);
+  }
+
+  g_object_set (element, "in-channels", in_channels, "out-channels",
+      out_channels, NULL);
+  g_object_set_property (G_OBJECT (element), "matrix", &rows);
+  g_value_unset (&rows);
+}
+
+static GstBuffer *
+create_input (GstAudioFormat format, guint channels)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GRand *rand;
+  guint i, n = N_FRAMES * channels;
+
+  buf = gst_buffer_new_allocate (NULL,
+      n * GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info (format)) / 8,
+      NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  rand = g_rand_new_with_seed (0xa0d10);
+
+  for (i = 0; i < n; i++) {
+    switch (format) {
+      case GST_AUDIO_FORMAT_F32:
+        ((gfloat *) map.data)[i] = g_rand_double_range (rand, -1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_F64:
+        ((gdouble *) map.data)[i] = g_rand_double_range (rand, -1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_S16:
+        ((gint16 *) map.data)[i] = g_rand_int_range (rand, G_MININT16,
+            G_MAXINT16 + 1);
+        break;
+      case GST_AUDIO_FORMAT_S32:
+        ((gint32 *) map.data)[i] = (gint32) g_rand_int (rand);
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+  }
+
+  g_rand_free (rand);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+/* Mixes with the full matrix, every input channel times every coefficient,
+ * using the same integer conversion as the element */
+static void
+reference_mix (GstAudioFormat format, guint in_channels, guint out_channels,
+    const gdouble * matrix, gconstpointer in_data, gpointer out_data)
+{
+  guint sample, in, out;
+
+  for (sample = 0; sample < N_FRAMES; sample++) {
+    for (out = 0; out < out_channels; out++) {
+      const gdouble *row = matrix + out * in_channels;
+      guint i = sample * in_channels, o = sample * out_channels + out;
+
+      switch (format) {
+        case GST_AUDIO_FORMAT_F32:{
+          const gfloat *src = in_data;
+          gfloat acc = 0;
+
+          for (in = 0; in < in_channels; in++)
+            acc += src[i + in] * row[in];
+          ((gfloat *) out_data)[o] = acc;
+          break;
+        }
+        case GST_AUDIO_FORMAT_F64:{
+          const gdouble *src = in_data;
+          gdouble acc = 0;
+
+          for (in = 0; in < in_channels; in++)
+            acc += src[i + in] * row[in];
+          ((gdouble *) out_data)[o] = acc;
+          break;
+        }
+        case GST_AUDIO_FORMAT_S16:{
+          const gint16 *src = in_data;
+          guint shift = 32 - 16 - 1 - ceil (log (in_channels) / log (2));
+          gint32 acc = 0;
+
+          for (in = 0; in < in_channels; in++)
+            acc += (gint32) (src[i + in] *
+                (gint32) (row[in] * (1 << shift)));
+          ((gint16 *) out_data)[o] = (gint16) (acc >> shift);
+          break;
+        }
+        case GST_AUDIO_FORMAT_S32:{
+          const gint32 *src = in_data;
+          guint shift = 64 - 32 - 1 - (gint) (log (in_channels) / log (2));
+          gint64 acc = 0;
+
+          for (in = 0; in < in_channels; in++)
+            acc += (gint64) (src[i + in] *
+                (gint64) (row[in] * (1 << shift)));
+          ((gint32 *) out_data)[o] = (gint32) (acc >> shift);
+          break;
+        }
+        default:
+          g_assert_not_reached ();
+      }
+    }
+  }
+}
+
+static GstBuffer *
+run_matrix (GstAudioFormat format, guint in_channels, guint out_channels,
+    const gdouble * matrix, GstBuffer * input)
+{
+  GstHarness *h;
+  GstElement *element;
+  GstBuffer *out;
+  gchar *caps;
+
+  h = gst_harness_new ("audiomixmatrix");
+  element = gst_harness_find_element (h, "audiomixmatrix");
+  set_matrix (element, in_channels, out_channels, matrix);
+  gst_object_unref (element);
+
+  caps = g_strdup_printf ("audio/x-raw,format=%s,rate=48000,channels=%u,"
+      "layout=interleaved,channel-mask=(bitmask)0x0",
+      gst_audio_format_to_string (format), in_channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (input)),
+      GST_FLOW_OK);
+  out = gst_harness_pull (h);
+  fail_unless (out != NULL);
+
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+static void
+check_matrix (guint in_channels, guint out_channels, const gdouble * matrix)
+{
+  guint f;
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    GstAudioFormat format = formats[f];
+    GstBuffer *input, *output;
+    GstMapInfo in_map, out_map;
+    gpointer expected;
+    guint i, n = N_FRAMES * out_channels;
+
+    input = create_input (format, in_channels);
+    output = run_matrix (format, in_channels, out_channels, matrix, input);
+
+    gst_buffer_map (input, &in_map, GST_MAP_READ);
+    gst_buffer_map (output, &out_map, GST_MAP_READ);
+    fail_unless_equals_int (out_map.size, in_map.size / in_channels *
+        out_channels);
+
+    expected = g_malloc (out_map.size);
+    reference_mix (format, in_channels, out_channels, matrix, in_map.data,
+        expected);
+
+    /* Floats are compared by value: routed channels keep the sign of a
+     * zero input sample where the full sum turned it into +0.0 */
+    for (i = 0; i < n; i++) {
+      switch (format) {
+        case GST_AUDIO_FORMAT_F32:
+          fail_unless (((gfloat *) out_map.data)[i] ==
+              ((gfloat *) expected)[i], "%s sample %u: %f != %f",
+              gst_audio_format_to_string (format), i,
+              ((gfloat *) out_map.data)[i], ((gfloat *) expected)[i]);
+          break;
+        case GST_AUDIO_FORMAT_F64:
+          fail_unless (((gdouble *) out_map.data)[i] ==
+              ((gdouble *) expected)[i], "%s sample %u: %f != %f",
+              gst_audio_format_to_string (format), i,
+              ((gdouble *) out_map.data)[i], ((gdouble *) expected)[i]);
+          break;
+        case GST_AUDIO_FORMAT_S16:
+          fail_unless_equals_int (((gint16 *) out_map.data)[i],
+              ((gint16 *) expected)[i]);
+          break;
+        case GST_AUDIO_FORMAT_S32:
+          fail_unless_equals_int (((gint32 *) out_map.data)[i],
+              ((gint32 *) expected)[i]);
+          break;
+        default:
+          g_assert_not_reached ();
+      }
+    }
+
+    g_free (expected);
+    gst_buffer_unmap (input, &in_map);
+    gst_buffer_unmap (output, &out_map);
+    gst_buffer_unref (input);
+    gst_buffer_unref (output);
+  }
+}
+
+GST_START_TEST (test_identity)
+{
+  const gdouble matrix[] = {
+    1, 0, 0, 0,
+    0, 1, 0, 0,
+    0, 0, 1, 0,
+    0, 0, 0, 1
+  };
+
+  check_matrix (4, 4, matrix);
+}
+
+GST_END_TEST;
+
+/* Swaps channels, duplicates one, drops one and leaves one silent */
+GST_START_TEST (test_routing)
+{
+  const gdouble matrix[] = {
+    0, 0, 1, 0,
+    1, 0, 0, 0,
+    1, 0, 0, 0,
+    0, 0, 0, 0,
+    0, 0, 0, 1
+  };
+
+  check_matrix (4, 5, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sparse)
+{
+  gdouble matrix[6 * 8] = { 0, };
+
+  matrix[0 * 8 + 0] = 0.5;
+  matrix[0 * 8 + 7] = 0.5;
+  matrix[1 * 8 + 3] = -0.25;
+  matrix[2 * 8 + 1] = 1.0;
+  matrix[2 * 8 + 2] = 0.125;
+  matrix[4 * 8 + 5] = 0.75;
+  matrix[5 * 8 + 6] = -1.0;
+
+  check_matrix (8, 6, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_dense)
+{
+  gdouble matrix[3 * 5];
+  GRand *rand;
+  guint i;
+
+  rand = g_rand_new_with_seed (0xde45e);
+  for (i = 0; i < G_N_ELEMENTS (matrix); i++)
+    matrix[i] = g_rand_double_range (rand, -1.0, 1.0);
+  g_rand_free (rand);
+
+  check_matrix (5, 3, matrix);
+}
+
+GST_END_TEST;
+
+/* Zero coefficients are skipped, so a NaN input sample only reaches the
+ * output channels that actually mix its input channel */
+GST_START_TEST (test_nan_only_reaches_mixed_channels)
+{
+  const gdouble matrix[] = {
+    0.5, 0.5,
+    0, 1,
+    0, 0.5
+  };
+  GstBuffer *input, *output;
+  GstMapInfo map;
+  guint i;
+
+  input = create_input (GST_AUDIO_FORMAT_F32, 2);
+  gst_buffer_map (input, &map, GST_MAP_WRITE);
+  for (i = 0; i < N_FRAMES; i++)
+    ((gfloat *) map.data)[i * 2] = NAN;
+  gst_buffer_unmap (input, &map);
+
+  output = run_matrix (GST_AUDIO_FORMAT_F32, 2, 3, matrix, input);
+
+  gst_buffer_map (output, &map, GST_MAP_READ);
+  for (i = 0; i < N_FRAMES; i++) {
+    const gfloat *frame = (const gfloat *) map.data + i * 3;
+
+    fail_unless (isnan (frame[0]));
+    fail_if (isnan (frame[1]));
+    fail_if (isnan (frame[2]));
+  }
+  gst_buffer_unmap (output, &map);
+
+  gst_buffer_unref (input);
+  gst_buffer_unref (output);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_identity);
+  tcase_add_test (tc_chain, test_routing);
+  tcase_add_test (tc_chain, test_sparse);
+  tcase_add_test (tc_chain, test_dense);
+  tcase_add_test (tc_chain, test_nan_only_reaches_mixed_channels);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix);
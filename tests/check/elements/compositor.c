@@ -30,6 +30,7 @@
 #endif
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
@@ -1740,6 +1741,49 @@ GST_START_TEST (test_obscured_skipped)
 
 GST_END_TEST;
 
+/* sink_0 is hidden by sink_1 and sink_2 together, but by neither alone */
+GST_START_TEST (test_obscured_by_combination)
+{
+  GstElement *pipeline, *sink, *cfilter0;
+  GstSample *sample;
+  GstPad *srcpad;
+
+  pipeline = gst_parse_launch ("compositor name=mix sink_2::xpos=160 ! "
+      "video/x-raw,width=320,height=240 ! appsink name=sink "
+      "videotestsrc num-buffers=5 ! capsfilter name=cf0 "
+      "caps=video/x-raw,width=320,height=240 ! mix.sink_0 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=160,height=240 ! "
+      "mix.sink_1 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=160,height=240 ! "
+      "mix.sink_2", NULL);
+  fail_unless (pipeline != NULL);
+
+  cfilter0 = gst_bin_get_by_name (GST_BIN (pipeline), "cf0");
+  srcpad = gst_element_get_static_pad (cfilter0, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_obscured_pad_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (cfilter0);
+
+  buffer_mapped = FALSE;
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  do {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (sample)
+      gst_sample_unref (sample);
+  } while (sample != NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  fail_unless (buffer_mapped == FALSE);
+}
+
+GST_END_TEST;
+
 static void
 _pipeline_eos (GstBus * bus, GstMessage * message, GstPipeline * bin)
 {
@@ -2075,6 +2119,134 @@ GST_START_TEST (test_start_time_first_live_drop_3_unlinked_1)
 
 GST_END_TEST;
 
+static void
+handoff_collect_cb (GstElement * fakesink, GstBuffer * buffer, GstPad * pad,
+    GList ** buffers)
+{
+  /* Copy, so that the compositor can keep drawing into its output buffer */
+  *buffers = g_list_append (*buffers, gst_buffer_copy_deep (buffer));
+}
+
+/* Composites a static background, a moving ball and a static layer away from
+ * the ball with the compositor properties @props. Returns all the output
+ * buffers if @collect_all, or only the last one */
+static GList *
+run_blend_pipeline (const gchar * format, const gchar * props,
+    gboolean collect_all)
+{
+  GstElement *bin, *sink;
+  GstMessage *msg;
+  GList *buffers = NULL;
+  GstBus *bus;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=320,height=240 ! "
+      "compositor name=c %s sink_0::repeat-after-eos=true "
+      "sink_1::xpos=101 sink_1::ypos=45 sink_1::alpha=0.7 "
+      "sink_2::xpos=240 sink_2::ypos=176 sink_2::repeat-after-eos=true ! "
+      "fakesink name=sink signal-handoffs=true "
+      "videotestsrc num-buffers=5 pattern=ball ! "
+      "video/x-raw,format=%s,width=64,height=64 ! c. "
+      "videotestsrc num-buffers=1 pattern=snow ! "
+      "video/x-raw,format=NV12,width=48,height=48 ! c.", format, props,
+      format);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  if (collect_all)
+    g_signal_connect (sink, "handoff", (GCallback) handoff_collect_cb,
+        &buffers);
+  else
+    g_signal_connect (sink, "handoff", (GCallback) handoff_buffer_cb, NULL);
+  gst_object_unref (sink);
+
+  main_loop = NULL;
+  ck_assert_int_ne (gst_element_set_state (bin, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (bin);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  ck_assert_int_eq (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+
+  if (!collect_all) {
+    fail_unless (handoff_buffer != NULL);
+    buffers = g_list_append (buffers, handoff_buffer);
+    handoff_buffer = NULL;
+  }
+
+  return buffers;
+}
+
+/* Checks that the compositor properties @props and @other_props give the
+ * same output */
+static void
+check_same_output (const gchar * format, const gchar * props,
+    const gchar * other_props, gboolean collect_all)
+{
+  GList *expected, *output, *l, *m;
+
+  expected = run_blend_pipeline (format, props, collect_all);
+  output = run_blend_pipeline (format, other_props, collect_all);
+
+  ck_assert_int_eq (g_list_length (expected), g_list_length (output));
+  fail_unless (expected != NULL);
+
+  for (l = expected, m = output; l && m; l = l->next, m = m->next) {
+    GstMapInfo expected_map, map;
+
+    fail_unless (gst_buffer_map (l->data, &expected_map, GST_MAP_READ));
+    fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+    ck_assert_int_eq (expected_map.size, map.size);
+    fail_unless (memcmp (expected_map.data, map.data, map.size) == 0,
+        "%s output differs with %s", format, other_props);
+    gst_buffer_unmap (l->data, &expected_map);
+    gst_buffer_unmap (m->data, &map);
+  }
+
+  g_list_free_full (expected, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (output, (GDestroyNotify) gst_buffer_unref);
+}
+
+#define SERIAL "max-threads=1 max-prepare-threads=1"
+#define THREADED "max-threads=4 max-prepare-threads=4"
+
+/* Blending in stripes and converting the inputs in parallel must give the
+ * same output as doing everything in one go */
+GST_START_TEST (test_max_threads)
+{
+  check_same_output ("AYUV", SERIAL, THREADED, FALSE);
+  check_same_output ("BGRA", SERIAL, THREADED, FALSE);
+  check_same_output ("I420", SERIAL, THREADED, FALSE);
+  check_same_output ("NV12", SERIAL, THREADED, FALSE);
+  check_same_output ("YUY2", SERIAL, THREADED, FALSE);
+  check_same_output ("RGB", SERIAL, THREADED, FALSE);
+}
+
+GST_END_TEST;
+
+/* Only redrawing the changed areas must give the same output as drawing
+ * every frame completely */
+GST_START_TEST (test_incremental)
+{
+  check_same_output ("AYUV", "incremental=false", "incremental=true", TRUE);
+  check_same_output ("BGRA", "incremental=false", "incremental=true", TRUE);
+  check_same_output ("I420", "incremental=false", "incremental=true", TRUE);
+  check_same_output ("NV12", "incremental=false", "incremental=true", TRUE);
+  check_same_output ("YUY2", "incremental=false", "incremental=true", TRUE);
+  check_same_output ("RGB", "incremental=false", "incremental=true", TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -2099,6 +2271,7 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_flush_start_flush_stop);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
+  tcase_add_test (tc_chain, test_obscured_by_combination);
   tcase_add_test (tc_chain, test_repeat_after_eos);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
@@ -2108,6 +2281,8 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_start_time_first_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3_unlinked_1);
+  tcase_add_test (tc_chain, test_max_threads);
+  tcase_add_test (tc_chain, test_incremental);
 
   return s;
 }
@@ -0,0 +1,142 @@
+/*
+ * Unittest for curlhttpsrc
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#define BODY_SIZE 100000
+
+/* Serves a single request with a BODY_SIZE body */
+static gpointer
+run_server (GSocketListener * listener)
+{
+  GSocketConnection *conn;
+  GInputStream *in;
+  GOutputStream *out;
+  GString *request;
+  gchar *header, *body;
+  gchar c;
+
+  conn = g_socket_listener_accept (listener, NULL, NULL, NULL);
+  fail_unless (conn != NULL);
+  in = g_io_stream_get_input_stream (G_IO_STREAM (conn));
+  out = g_io_stream_get_output_stream (G_IO_STREAM (conn));
+
+  request = g_string_new (NULL);
+  while (!g_str_has_suffix (request->str, "\r\n\r\n")
+      && g_input_stream_read (in, &c, 1, NULL, NULL) == 1)
+    g_string_append_c (request, c);
+  g_string_free (request, TRUE);
+
+  header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/octet-stream\r\n"
+      "Content-Length: %u\r\n" "Connection: close\r\n\r\n", BODY_SIZE);
+  body = g_malloc (BODY_SIZE);
+  memset (body, 0x5a, BODY_SIZE);
+  fail_unless (g_output_stream_write_all (out, header, strlen (header), NULL,
+          NULL, NULL));
+  fail_unless (g_output_stream_write_all (out, body, BODY_SIZE, NULL, NULL,
+          NULL));
+  g_free (header);
+  g_free (body);
+
+  g_io_stream_close (G_IO_STREAM (conn), NULL, NULL);
+  g_object_unref (conn);
+
+  return NULL;
+}
+
+static void
+check_stats (GstElement * src, guint64 bytes, guint requests)
+{
+  GstStructure *stats = NULL;
+  guint64 received, ttfb, transfer_time, connect_time;
+  guint n_requests;
+
+  g_object_get (src, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get (stats,
+          "bytes-received", G_TYPE_UINT64, &received,
+          "requests", G_TYPE_UINT, &n_requests,
+          "connect-time", G_TYPE_UINT64, &connect_time,
+          "time-to-first-byte", G_TYPE_UINT64, &ttfb,
+          "transfer-time", G_TYPE_UINT64, &transfer_time, NULL));
+  fail_unless_equals_uint64 (received, bytes);
+  fail_unless_equals_int (n_requests, requests);
+
+  if (requests > 0) {
+    fail_unless (GST_CLOCK_TIME_IS_VALID (connect_time));
+    fail_unless (GST_CLOCK_TIME_IS_VALID (ttfb));
+    fail_unless (GST_CLOCK_TIME_IS_VALID (transfer_time));
+    fail_unless (connect_time <= ttfb);
+    fail_unless (ttfb <= transfer_time);
+  }
+
+  gst_structure_free (stats);
+}
+
+GST_START_TEST (test_stats)
+{
+  GSocketListener *listener;
+  GThread *server;
+  GstElement *pipeline, *src, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *uri;
+  guint16 port;
+
+  listener = g_socket_listener_new ();
+  port = g_socket_listener_add_any_inet_port (listener, NULL, NULL);
+  fail_unless (port != 0);
+  server = g_thread_new ("server", (GThreadFunc) run_server, listener);
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("curlhttpsrc", NULL);
+  fail_unless (src != NULL);
+  uri = g_strdup_printf ("http://127.0.0.1:%u/data", port);
+  g_object_set (src, "location", uri, NULL);
+  g_free (uri);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  check_stats (src, 0, 0);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  check_stats (src, BODY_SIZE, 1);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_thread_join (server);
+  g_socket_listener_close (listener);
+  g_object_unref (listener);
+}
+
+GST_END_TEST;
+
+static Suite *
+curlhttpsrc_suite (void)
+{
+  Suite *s = suite_create ("curlhttpsrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 20);
+  tcase_add_test (tc_chain, test_stats);
+
+  return s;
+}
+
+GST_CHECK_MAIN (curlhttpsrc);
@@ -472,6 +472,9 @@ setAndTestDashParams (GstAdaptiveDemuxTestEngine * engine, gpointer user_data)
 
   test_int_prop (dashdemux, "max-bitrate", 1000);
   test_invalid_int_prop (dashdemux, "max-bitrate", 10);
+
+  test_int_prop (dashdemux, "prefetch-depth", 2);
+  test_invalid_int_prop (dashdemux, "prefetch-depth", 100);
 }
 
 /*
@@ -545,6 +548,147 @@ GST_START_TEST (testParameters)
 
 GST_END_TEST;
 
+#define PREFETCH_FRAGMENTS 4
+#define PREFETCH_FRAGMENT_SIZE 1000
+
+static struct
+{
+  GMutex lock;
+  GCond cond;
+  guint started[PREFETCH_FRAGMENTS];
+  gboolean parallel;
+} prefetch_test;
+
+static void
+setPrefetchDepth (GstAdaptiveDemuxTestEngine * engine, gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-depth", 2, NULL);
+}
+
+/* Keeps the download of the first fragment going until the second one was
+ * requested, which only happens if it is prefetched */
+static gboolean
+testPrefetchSrcStart (GstTestHTTPSrc * src, const gchar * uri,
+    GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  guint i;
+
+  for (i = 0; i < PREFETCH_FRAGMENTS; i++) {
+    gchar *frag_uri = g_strdup_printf ("http://unit.test/frag%u.webm", i + 1);
+    gboolean match = g_strcmp0 (uri, frag_uri) == 0;
+
+    g_free (frag_uri);
+    if (!match)
+      continue;
+
+    g_mutex_lock (&prefetch_test.lock);
+    prefetch_test.started[i]++;
+    g_cond_broadcast (&prefetch_test.cond);
+    if (i == 0) {
+      gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+      while (prefetch_test.started[1] == 0
+          && g_cond_wait_until (&prefetch_test.cond, &prefetch_test.lock,
+              end_time));
+      prefetch_test.parallel = prefetch_test.started[1] > 0;
+    }
+    g_mutex_unlock (&prefetch_test.lock);
+    break;
+  }
+
+  return gst_dashdemux_http_src_start (src, uri, input_data, user_data);
+}
+
+/*
+ * Test prefetching fragments
+ *
+ * The fragments following the current one must be downloaded in parallel
+ * with it, each only once, and pushed in order.
+ */
+GST_START_TEST (testPrefetch)
+{
+  const gchar *mpd =
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+      "     xmlns=\"urn:mpeg:DASH:schema:MPD:2011\""
+      "     xsi:schemaLocation=\"urn:mpeg:DASH:schema:MPD:2011 DASH-MPD.xsd\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"static\""
+      "     minBufferTime=\"PT1.500S\""
+      "     mediaPresentationDuration=\"PT4S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"audio/webm\">"
+      "      <Representation id=\"171\""
+      "                      codecs=\"vorbis\""
+      "                      audioSamplingRate=\"44100\""
+      "                      startWithSAP=\"1\""
+      "                      bandwidth=\"129553\">"
+      "        <SegmentList duration=\"1\">"
+      "          <SegmentURL media=\"frag1.webm\" />"
+      "          <SegmentURL media=\"frag2.webm\" />"
+      "          <SegmentURL media=\"frag3.webm\" />"
+      "          <SegmentURL media=\"frag4.webm\" />"
+      "        </SegmentList>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+  static guint8 data[PREFETCH_FRAGMENTS * PREFETCH_FRAGMENT_SIZE];
+  GstDashDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/test.mpd", (guint8 *) mpd, 0},
+    {"http://unit.test/frag1.webm", data, PREFETCH_FRAGMENT_SIZE},
+    {"http://unit.test/frag2.webm", data + PREFETCH_FRAGMENT_SIZE,
+        PREFETCH_FRAGMENT_SIZE},
+    {"http://unit.test/frag3.webm", data + 2 * PREFETCH_FRAGMENT_SIZE,
+        PREFETCH_FRAGMENT_SIZE},
+    {"http://unit.test/frag4.webm", data + 3 * PREFETCH_FRAGMENT_SIZE,
+        PREFETCH_FRAGMENT_SIZE},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"audio_00", sizeof (data), data},
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstTestHTTPSrcTestData http_src_test_data = { 0 };
+  GstAdaptiveDemuxTestCallbacks test_callbacks = { 0 };
+  GstDashDemuxTestCase *testData;
+  guint i;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i * 7 + i / PREFETCH_FRAGMENT_SIZE;
+  memset (&prefetch_test, 0, sizeof (prefetch_test));
+  g_mutex_init (&prefetch_test.lock);
+  g_cond_init (&prefetch_test.cond);
+
+  http_src_callbacks.src_start = testPrefetchSrcStart;
+  http_src_callbacks.src_create = gst_dashdemux_http_src_create;
+  http_src_test_data.input = inputTestData;
+  gst_test_http_src_install_callbacks (&http_src_callbacks,
+      &http_src_test_data);
+
+  test_callbacks.pre_test = setPrefetchDepth;
+  test_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  test_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  testData = gst_dash_demux_test_case_new ();
+  COPY_OUTPUT_TEST_DATA (outputTestData, testData);
+
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME, "http://unit.test/test.mpd",
+      &test_callbacks, testData);
+
+  fail_unless (prefetch_test.parallel,
+      "second fragment not requested during the first one");
+  for (i = 0; i < PREFETCH_FRAGMENTS; i++)
+    fail_unless_equals_int (prefetch_test.started[i], 1);
+
+  g_object_unref (testData);
+  if (http_src_test_data.data)
+    gst_structure_free (http_src_test_data.data);
+  g_mutex_clear (&prefetch_test.lock);
+  g_cond_clear (&prefetch_test.cond);
+}
+
+GST_END_TEST;
+
 /*
  * Test seeking
  *
@@ -1529,6 +1673,7 @@ dash_demux_suite (void)
   tcase_add_test (tc_basicTest, simpleTest);
   tcase_add_test (tc_basicTest, testTwoPeriods);
   tcase_add_test (tc_basicTest, testParameters);
+  tcase_add_test (tc_basicTest, testPrefetch);
   tcase_add_test (tc_basicTest, testSeek);
   tcase_add_test (tc_basicTest, testSeekKeyUnitPosition);
   tcase_add_test (tc_basicTest, testSeekPosition);
@@ -4843,6 +4843,221 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
 
 GST_END_TEST;
 
+/*
+ * Test that updating a SegmentTimeline manifest reuses the segments that
+ * did not change
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_update)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstActiveStream *newActiveStream;
+  GstMediaSegment *segment;
+  GstMediaFragmentInfo fragment;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period id=\"P0\" start=\"P0Y0M0DT0H0M0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate timescale=\"10\" startNumber=\"1\""
+      "                         media=\"TestMedia$Number$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\"  d=\"10\"></S>"
+      "            <S d=\"10\"></S>"
+      "            <S d=\"20\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  /* first entry dropped, one new entry appended */
+  const gchar *xml_update =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period id=\"P0\" start=\"P0Y0M0DT0H0M0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate timescale=\"10\" startNumber=\"2\""
+      "                         media=\"TestMedia$Number$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"10\" d=\"10\"></S>"
+      "            <S d=\"20\"></S>"
+      "            <S d=\"30\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+  GstMpdClient *new_mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+  assert_equals_int (activeStream->segments->len, 3);
+
+  ret = gst_mpd_parse (new_mpdclient, xml_update, (gint) strlen (xml_update));
+  assert_equals_int (ret, TRUE);
+  ret =
+      gst_mpd_client_setup_media_presentation (new_mpdclient,
+      GST_CLOCK_TIME_NONE, -1, NULL);
+  assert_equals_int (ret, TRUE);
+  adaptationSets = gst_mpd_client_get_adaptation_sets (new_mpdclient);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  new_mpdclient->previous = mpdclient;
+  ret = gst_mpd_client_setup_streaming (new_mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+  new_mpdclient->previous = NULL;
+  newActiveStream =
+      gst_mpdparser_get_active_stream_by_index (new_mpdclient, 0);
+  fail_if (newActiveStream == NULL);
+  assert_equals_int (newActiveStream->segments->len, 3);
+
+  /* the two entries still in the timeline are shared */
+  fail_unless (g_ptr_array_index (newActiveStream->segments, 0) ==
+      g_ptr_array_index (activeStream->segments, 1));
+  fail_unless (g_ptr_array_index (newActiveStream->segments, 1) ==
+      g_ptr_array_index (activeStream->segments, 2));
+
+  /* the appended one is new */
+  segment = g_ptr_array_index (newActiveStream->segments, 2);
+  assert_equals_int (segment->number, 4);
+  assert_equals_uint64 (segment->scale_start, 40);
+  assert_equals_uint64 (segment->start, 4 * GST_SECOND);
+  assert_equals_uint64 (segment->duration, 3 * GST_SECOND);
+
+  /* the new client stays valid once the previous one is gone */
+  gst_mpd_client_free (mpdclient);
+
+  segment = g_ptr_array_index (newActiveStream->segments, 0);
+  assert_equals_int (segment->number, 2);
+  assert_equals_uint64 (segment->start, 1 * GST_SECOND);
+  ret = gst_mpd_client_get_next_fragment (new_mpdclient, 0, &fragment);
+  assert_equals_int (ret, TRUE);
+  assert_equals_string (fragment.uri, "/TestMedia2");
+  assert_equals_uint64 (fragment.timestamp, 1 * GST_SECOND);
+  assert_equals_uint64 (fragment.duration, 1 * GST_SECOND);
+  gst_media_fragment_info_clear (&fragment);
+
+  gst_mpd_client_free (new_mpdclient);
+}
+
+GST_END_TEST;
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_ (x)
+#define REMOTEDIR STRINGIFY (DASH_MPD_DATADIR)
+#define TIMELINE_LIVE_FILENAME REMOTEDIR "/segment_timeline_live.mpd"
+#define TIMELINE_LIVE_UPDATE_FILENAME \
+    REMOTEDIR "/segment_timeline_live_update.mpd"
+
+/* Returns a client with the first stream of @xml set up, reusing the
+ * segments of @previous if not NULL. The time it took to set up the stream
+ * is added to @elapsed */
+static GstMpdClient *
+setup_timeline_client (const gchar * xml, gsize size, GstMpdClient * previous,
+    gint64 * elapsed)
+{
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+  GstAdaptationSetNode *adapt_set;
+  gint64 start;
+  gboolean ret;
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) size);
+  assert_equals_int (ret, TRUE);
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+  adapt_set = g_list_nth_data (gst_mpd_client_get_adaptation_sets (mpdclient),
+      0);
+  fail_if (adapt_set == NULL);
+
+  mpdclient->previous = previous;
+  start = g_get_monotonic_time ();
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  *elapsed += g_get_monotonic_time () - start;
+  mpdclient->previous = NULL;
+  assert_equals_int (ret, TRUE);
+
+  return mpdclient;
+}
+
+/*
+ * Compare the time to set up the streams of a long live SegmentTimeline
+ * update with and without reusing the segments of the previous manifest
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_update_timing)
+{
+  GstMpdClient *mpdclient, *new_mpdclient;
+  GstActiveStream *stream, *new_stream;
+  gchar *xml, *xml_update;
+  gsize size, size_update;
+  gint64 elapsed = 0, elapsed_reuse = 0, elapsed_build = 0;
+  guint i, n;
+
+  fail_unless (g_file_get_contents (TIMELINE_LIVE_FILENAME, &xml, &size,
+          NULL));
+  fail_unless (g_file_get_contents (TIMELINE_LIVE_UPDATE_FILENAME,
+          &xml_update, &size_update, NULL));
+
+  mpdclient = setup_timeline_client (xml, size, NULL, &elapsed);
+  stream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (stream == NULL);
+  assert_equals_int (stream->segments->len, 1000);
+
+  for (n = 0; n < 20; n++) {
+    new_mpdclient =
+        setup_timeline_client (xml_update, size_update, NULL, &elapsed_build);
+    gst_mpd_client_free (new_mpdclient);
+
+    new_mpdclient = setup_timeline_client (xml_update, size_update, mpdclient,
+        &elapsed_reuse);
+    new_stream = gst_mpdparser_get_active_stream_by_index (new_mpdclient, 0);
+    fail_if (new_stream == NULL);
+    assert_equals_int (new_stream->segments->len, 1000);
+
+    /* all but the appended entry are taken over */
+    for (i = 0; i < 999; i++)
+      fail_unless (g_ptr_array_index (new_stream->segments, i) ==
+          g_ptr_array_index (stream->segments, i + 1));
+    fail_unless (g_ptr_array_index (new_stream->segments, 999) !=
+        g_ptr_array_index (stream->segments, 999));
+    gst_mpd_client_free (new_mpdclient);
+  }
+
+  GST_INFO ("Setting up the updated streams took %" G_GINT64_FORMAT
+      " us when building all segments and %" G_GINT64_FORMAT
+      " us when reusing them", elapsed_build, elapsed_reuse);
+
+  gst_mpd_client_free (mpdclient);
+  g_free (xml);
+  g_free (xml_update);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple inherited segmentURLs
  *
@@ -5671,9 +5886,6 @@ GST_END_TEST;
  * Test parsing of Perioud using @xlink:href attribute
  */
 
-#define STRINGIFY_(x) #x
-#define STRINGIFY(x) STRINGIFY_ (x)
-#define REMOTEDIR STRINGIFY (DASH_MPD_DATADIR)
 #define XLINK_SINGLE_PERIOD_FILENAME REMOTEDIR "/xlink_single_period.period"
 #define XLINK_DOUBLE_PERIOD_FILENAME REMOTEDIR "/xlink_double_period.period"
 
@@ -6001,6 +6213,9 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline_update);
+  tcase_add_test (tc_complexMPD,
+      dash_mpdparser_segment_timeline_update_timing);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
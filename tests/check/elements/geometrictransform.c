@@ -0,0 +1,349 @@
+/* GStreamer
+ *
+ * unit test for the geometrictransform elements
+ *
+ * Copyright (C) 2026 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define WIDTH 64
+#define HEIGHT 96
+
+/* Same values as GstGeometricTransformOffEdgesPixelsMethod */
+enum
+{
+  OFF_EDGES_IGNORE,
+  OFF_EDGES_CLAMP,
+  OFF_EDGES_WRAP
+};
+
+static const gdouble perspective_matrix[9] = {
+  1.1, 0.15, -6.0,
+  -0.05, 0.9, 4.5,
+  0.0008, 0.0003, 1.0
+};
+
+/* The inverse mappings of fisheye and perspective, as in the elements */
+typedef void (*MapFunc) (gint x, gint y, gdouble * in_x, gdouble * in_y);
+
+static void
+fisheye_map (gint x, gint y, gdouble * in_x, gdouble * in_y)
+{
+  gdouble norm_x = 2.0 * x / WIDTH - 1.0;
+  gdouble norm_y = 2.0 * y / HEIGHT - 1.0;
+  gdouble r = sqrt ((norm_x * norm_x + norm_y * norm_y) / 2.0);
+
+  norm_x *= (0.33 + 0.1 * r * r + 0.57 * pow (r, 6.0));
+  norm_y *= (0.33 + 0.1 * r * r + 0.57 * pow (r, 6.0));
+
+  *in_x = 0.5 * (norm_x + 1.0) * WIDTH;
+  *in_y = 0.5 * (norm_y + 1.0) * HEIGHT;
+}
+
+static void
+perspective_map (gint x, gint y, gdouble * in_x, gdouble * in_y)
+{
+  const gdouble *m = perspective_matrix;
+  gdouble w = m[6] * x + m[7] * y + m[8];
+
+  *in_x = (m[0] * x + m[1] * y + m[2]) / w;
+  *in_y = (m[3] * x + m[4] * y + m[5]) / w;
+}
+
+static gdouble
+mod_float (gdouble a, gdouble b)
+{
+  gint n = (gint) (a / b);
+
+  a -= n * b;
+  if (a < 0)
+    return a + b;
+  return a;
+}
+
+/* Nearest neighbour mapping as geometrictransform did it before the map
+ * was turned into byte offsets: one pair of doubles per pixel, truncated
+ * after applying the off edge pixels method */
+static void
+reference_transform (MapFunc map, gint off_edges, const guint8 * in,
+    guint8 * out, gint pixel_stride)
+{
+  gint row_stride = WIDTH * pixel_stride;
+  gint x, y;
+
+  memset (out, 0, row_stride * HEIGHT);
+
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      gdouble in_x, in_y;
+      gint trunc_x, trunc_y;
+
+      map (x, y, &in_x, &in_y);
+
+      switch (off_edges) {
+        case OFF_EDGES_CLAMP:
+          in_x = CLAMP (in_x, 0, WIDTH - 1);
+          in_y = CLAMP (in_y, 0, HEIGHT - 1);
+          break;
+        case OFF_EDGES_WRAP:
+          in_x = mod_float (in_x, WIDTH);
+          in_y = mod_float (in_y, HEIGHT);
+          if (in_x < 0)
+            in_x += WIDTH;
+          if (in_y < 0)
+            in_y += HEIGHT;
+          break;
+        default:
+          break;
+      }
+
+      trunc_x = (gint) in_x;
+      trunc_y = (gint) in_y;
+      if (trunc_x >= 0 && trunc_x < WIDTH && trunc_y >= 0 && trunc_y < HEIGHT)
+        memcpy (out + y * row_stride + x * pixel_stride,
+            in + trunc_y * row_stride + trunc_x * pixel_stride, pixel_stride);
+    }
+  }
+}
+
+static GstBuffer *
+create_pattern (gint pixel_stride)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, WIDTH * HEIGHT * pixel_stride, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = (i * 7 + (i / (WIDTH * pixel_stride)) * 13) & 0xff;
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static void
+set_perspective_matrix (GstElement * element, const gdouble * matrix)
+{
+  GValueArray *va;
+  GValue v = G_VALUE_INIT;
+  guint i;
+
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+  va = g_value_array_new (9);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < 9; i++) {
+    g_value_set_double (&v, matrix[i]);
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+  g_object_set (element, "matrix", va, NULL);
+  g_value_array_free (va);
+  G_GNUC_END_IGNORE_DEPRECATIONS;
+}
+
+/* Runs @input through @element_name and returns the output buffer */
+static GstBuffer *
+run_transform (const gchar * element_name, const gchar * format,
+    gint off_edges, gint interpolation, guint max_threads, GstBuffer * input)
+{
+  GstHarness *h;
+  GstElement *element;
+  GstBuffer *out;
+  gchar *caps;
+
+  h = gst_harness_new (element_name);
+  element = gst_harness_find_element (h, element_name);
+  g_object_set (element, "off-edge-pixels", off_edges, "interpolation",
+      interpolation, "max-threads", max_threads, NULL);
+  if (g_str_equal (element_name, "perspective"))
+    set_perspective_matrix (element, perspective_matrix);
+  gst_object_unref (element);
+
+  caps = g_strdup_printf ("video/x-raw,format=%s,width=%d,height=%d,"
+      "framerate=25/1", format, WIDTH, HEIGHT);
+  gst_harness_set_caps_str (h, caps, caps);
+  g_free (caps);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (input)),
+      GST_FLOW_OK);
+  out = gst_harness_pull (h);
+  fail_unless (out != NULL);
+
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+static void
+check_nearest (const gchar * element_name, MapFunc map, gint off_edges)
+{
+  GstBuffer *in, *out;
+  GstMapInfo in_map, out_map;
+  guint8 *expected;
+
+  in = create_pattern (4);
+  out = run_transform (element_name, "RGBx", off_edges, 0, 1, in);
+
+  gst_buffer_map (in, &in_map, GST_MAP_READ);
+  gst_buffer_map (out, &out_map, GST_MAP_READ);
+  fail_unless_equals_int (out_map.size, WIDTH * HEIGHT * 4);
+
+  expected = g_malloc (out_map.size);
+  reference_transform (map, off_edges, in_map.data, expected, 4);
+  fail_unless (memcmp (out_map.data, expected, out_map.size) == 0,
+      "%s output differs from the reference with off-edge-pixels=%d",
+      element_name, off_edges);
+  g_free (expected);
+
+  gst_buffer_unmap (in, &in_map);
+  gst_buffer_unmap (out, &out_map);
+  gst_buffer_unref (in);
+  gst_buffer_unref (out);
+}
+
+GST_START_TEST (test_nearest_matches_reference)
+{
+  gint off_edges;
+
+  for (off_edges = OFF_EDGES_IGNORE; off_edges <= OFF_EDGES_WRAP; off_edges++) {
+    check_nearest ("fisheye", fisheye_map, off_edges);
+    check_nearest ("perspective", perspective_map, off_edges);
+  }
+}
+
+GST_END_TEST;
+
+static void
+check_threads (const gchar * element_name, const gchar * format,
+    gint pixel_stride, gint interpolation)
+{
+  GstBuffer *in, *out1, *out4;
+  GstMapInfo map;
+
+  in = create_pattern (pixel_stride);
+  out1 = run_transform (element_name, format, OFF_EDGES_CLAMP, interpolation,
+      1, in);
+  out4 = run_transform (element_name, format, OFF_EDGES_CLAMP, interpolation,
+      4, in);
+
+  gst_buffer_map (out1, &map, GST_MAP_READ);
+  fail_unless_equals_int (gst_buffer_get_size (out4), map.size);
+  fail_unless (gst_buffer_memcmp (out4, 0, map.data, map.size) == 0,
+      "%s %s output differs between 1 and 4 threads", element_name, format);
+  gst_buffer_unmap (out1, &map);
+
+  gst_buffer_unref (in);
+  gst_buffer_unref (out1);
+  gst_buffer_unref (out4);
+}
+
+GST_START_TEST (test_threads_identical)
+{
+  gint interpolation;
+
+  for (interpolation = 0; interpolation <= 1; interpolation++) {
+    check_threads ("fisheye", "RGBx", 4, interpolation);
+    check_threads ("perspective", "RGBx", 4, interpolation);
+    check_threads ("fisheye", "GRAY16_LE", 2, interpolation);
+    check_threads ("perspective", "RGB", 3, interpolation);
+  }
+}
+
+GST_END_TEST;
+
+/* Shifting a horizontal ramp by half a pixel must average neighbouring
+ * 16 bit samples, including the carries across their low bytes */
+GST_START_TEST (test_bilinear_gray16)
+{
+  GstHarness *h;
+  GstElement *perspective;
+  GstBuffer *in, *out;
+  GstMapInfo map;
+  const gdouble shift[9] = { 1, 0, 0.5, 0, 1, 0, 0, 0, 1 };
+  gint x, y;
+
+  in = gst_buffer_new_allocate (NULL, WIDTH * HEIGHT * 2, NULL);
+  gst_buffer_map (in, &map, GST_MAP_WRITE);
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      GST_WRITE_UINT16_LE (map.data + (y * WIDTH + x) * 2, x * 1021 + 7);
+  gst_buffer_unmap (in, &map);
+
+  h = gst_harness_new ("perspective");
+  perspective = gst_harness_find_element (h, "perspective");
+  g_object_set (perspective, "interpolation", 1, "max-threads", 2, NULL);
+  set_perspective_matrix (perspective, shift);
+  gst_object_unref (perspective);
+
+  gst_harness_set_caps_str (h,
+      "video/x-raw,format=GRAY16_LE,width=64,height=96,framerate=25/1",
+      "video/x-raw,format=GRAY16_LE,width=64,height=96,framerate=25/1");
+  fail_unless_equals_int (gst_harness_push (h, in), GST_FLOW_OK);
+  out = gst_harness_pull (h);
+  fail_unless (out != NULL);
+
+  gst_buffer_map (out, &map, GST_MAP_READ);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      guint v00 = x * 1021 + 7;
+      guint expected;
+
+      /* the last column has no right neighbour and is copied */
+      if (x == WIDTH - 1)
+        expected = v00;
+      else
+        expected = (v00 + (v00 + 1021) + 1) / 2;
+
+      fail_unless_equals_int (GST_READ_UINT16_LE (map.data + (y * WIDTH +
+                  x) * 2), expected);
+    }
+  }
+  gst_buffer_unmap (out, &map);
+  gst_buffer_unref (out);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+geometrictransform_suite (void)
+{
+  Suite *s = suite_create ("geometrictransform");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_nearest_matches_reference);
+  tcase_add_test (tc_chain, test_threads_identical);
+  tcase_add_test (tc_chain, test_bilinear_gray16);
+
+  return s;
+}
+
+GST_CHECK_MAIN (geometrictransform);
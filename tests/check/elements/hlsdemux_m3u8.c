@@ -300,6 +300,19 @@ http://media.example.com/mid/video-only-004.ts\n\
 http://media.example.com/mid/video-only-005.ts\n\
 #EXT-X-ENDLIST";
 
+static const gchar *SAMPLE_AES_ENCRYPTED_PLAYLIST = "#EXTM3U \n\
+#EXT-X-TARGETDURATION:10\n\
+#EXT-X-KEY:METHOD=SAMPLE-AES,URI=\"https://priv.example.com/key.bin\",IV=0x00000000000000000000000000000001\n\
+#EXTINF:10,Test\n\
+http://media.example.com/mid/video-only-001.ts\n\
+#EXT-X-KEY:METHOD=AES-128,URI=\"https://priv.example.com/key2.bin\"\n\
+#EXTINF:10,Test\n\
+http://media.example.com/mid/video-only-002.ts\n\
+#EXT-X-KEY:METHOD=NONE\n\
+#EXTINF:10,Test\n\
+http://media.example.com/mid/video-only-003.ts\n\
+#EXT-X-ENDLIST";
+
 static const gchar *WINDOWS_LINE_ENDINGS_PLAYLIST = "#EXTM3U \r\n\
 #EXT-X-TARGETDURATION:10\r\n\
 #EXTINF:10,Test\r\n\
@@ -648,6 +661,39 @@ GST_START_TEST (test_playlist_with_encryption)
 GST_END_TEST;
 
 
+GST_START_TEST (test_playlist_with_sample_aes_encryption)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  guint8 iv[16] = { 0, };
+
+  iv[15] = 1;
+
+  master = load_playlist (SAMPLE_AES_ENCRYPTED_PLAYLIST);
+  pl = master->default_variant->m3u8;
+
+  assert_equals_int (g_list_length (pl->files), 3);
+
+  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  fail_unless (file->key != NULL);
+  assert_equals_string (file->key, "https://priv.example.com/key.bin");
+  assert_equals_int (file->key_method, GST_M3U8_KEY_METHOD_SAMPLE_AES);
+  fail_unless (memcmp (&file->iv, iv, 16) == 0);
+
+  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  fail_unless (file->key != NULL);
+  assert_equals_string (file->key, "https://priv.example.com/key2.bin");
+  assert_equals_int (file->key_method, GST_M3U8_KEY_METHOD_AES_128);
+
+  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  fail_unless (file->key == NULL);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_update_invalid_playlist)
 {
   GstHLSMasterPlaylist *master;
@@ -1419,6 +1465,7 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_live_playlist_rotated);
   tcase_add_test (tc_m3u8, test_playlist_with_doubles_duration);
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
+  tcase_add_test (tc_m3u8, test_playlist_with_sample_aes_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
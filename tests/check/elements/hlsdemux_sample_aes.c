@@ -0,0 +1,651 @@
+/* GStreamer
+ *
+ * unit test for the hlsdemux SAMPLE-AES reader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "gsthlsdemux-util.c"
+
+GST_DEBUG_CATEGORY (gst_hls_demux_debug);
+
+#define TS_PACKET_SIZE 188
+
+#define PMT_PID 0x100
+#define VIDEO_PID 0x101
+#define AAC_PID 0x102
+#define AC3_PID 0x103
+#define CLEAR_PID 0x1ff
+
+/* The fake cipher flips bits, so it encrypts and decrypts alike */
+#define FAKE_KEY 0xa5
+
+static gboolean
+fake_decrypt (guint8 * data, gsize length, gpointer user_data)
+{
+  gsize *decrypted = user_data;
+  gsize i;
+
+  fail_unless (length % 16 == 0);
+  for (i = 0; i < length; i++)
+    data[i] ^= FAKE_KEY;
+  *decrypted += length;
+
+  return TRUE;
+}
+
+static guint32
+crc32_mpeg (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gint i;
+
+  while (size--) {
+    crc ^= (guint32) (*data++) << 24;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static guint8 cc[0x2000];
+
+static gint
+payload_offset (const guint8 * p)
+{
+  if ((p[3] & 0x10) == 0)
+    return -1;
+  return (p[3] & 0x20) ? 5 + p[4] : 4;
+}
+
+static guint16
+packet_pid (const guint8 * p)
+{
+  return GST_READ_UINT16_BE (p + 1) & 0x1fff;
+}
+
+static void
+add_section (GByteArray * ts, guint16 pid, guint8 * section, gsize size)
+{
+  guint8 p[TS_PACKET_SIZE];
+
+  GST_WRITE_UINT32_BE (section + size - 4, crc32_mpeg (section, size - 4));
+
+  memset (p, 0xff, TS_PACKET_SIZE);
+  p[0] = 0x47;
+  p[1] = 0x40 | pid >> 8;
+  p[2] = pid & 0xff;
+  p[3] = 0x10 | (cc[pid]++ & 0xf);
+  p[4] = 0x00;                  /* pointer_field */
+  memcpy (p + 5, section, size);
+  g_byte_array_append (ts, p, TS_PACKET_SIZE);
+}
+
+static void
+add_pat (GByteArray * ts)
+{
+  guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | PMT_PID >> 8, PMT_PID & 0xff,
+    0x00, 0x00, 0x00, 0x00
+  };
+
+  add_section (ts, 0, pat, sizeof (pat));
+}
+
+static void
+add_pmt (GByteArray * ts)
+{
+  guint8 pmt[] = {
+    0x02, 0xb0, 0x1c, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | VIDEO_PID >> 8, VIDEO_PID & 0xff, 0xf0, 0x00,
+    0xdb, 0xe0 | VIDEO_PID >> 8, VIDEO_PID & 0xff, 0xf0, 0x00,
+    0xcf, 0xe0 | AAC_PID >> 8, AAC_PID & 0xff, 0xf0, 0x00,
+    0xc1, 0xe0 | AC3_PID >> 8, AC3_PID & 0xff, 0xf0, 0x00,
+    0x00, 0x00, 0x00, 0x00
+  };
+
+  add_section (ts, PMT_PID, pmt, sizeof (pmt));
+}
+
+static void
+add_clear_packet (GByteArray * ts, guint8 id)
+{
+  guint8 p[TS_PACKET_SIZE];
+
+  memset (p, id, TS_PACKET_SIZE);
+  p[0] = 0x47;
+  p[1] = CLEAR_PID >> 8;
+  p[2] = CLEAR_PID & 0xff;
+  p[3] = 0x10 | (cc[CLEAR_PID]++ & 0xf);
+  g_byte_array_append (ts, p, TS_PACKET_SIZE);
+}
+
+/* Splits @pes in TS packets, the first one carrying a PCR and the last one
+ * padded with adaptation field stuffing */
+static GByteArray *
+packetize (guint16 pid, const guint8 * pes, gsize size)
+{
+  GByteArray *ts = g_byte_array_new ();
+  gsize pos = 0;
+
+  while (pos < size) {
+    guint8 p[TS_PACKET_SIZE];
+    guint af_size = 0, n;
+
+    p[0] = 0x47;
+    p[1] = (pos == 0 ? 0x40 : 0x00) | pid >> 8;
+    p[2] = pid & 0xff;
+    p[3] = 0x10 | (cc[pid]++ & 0xf);
+
+    if (pos == 0) {
+      af_size = 8;
+      p[5] = 0x10;
+      memset (p + 6, 0x00, 6);
+      p[10] = 0x7e;
+    }
+    n = MIN (size - pos, 184 - af_size);
+    if (n + af_size < 184) {
+      if (af_size == 0) {
+        af_size = 1;
+        if (n + af_size < 184) {
+          af_size = 2;
+          p[5] = 0x00;
+        }
+      }
+      memset (p + 4 + af_size, 0xff, 184 - af_size - n);
+      af_size = 184 - n;
+    }
+    if (af_size > 0) {
+      p[3] |= 0x20;
+      p[4] = af_size - 1;
+    }
+
+    memcpy (p + 4 + af_size, pes + pos, n);
+    pos += n;
+    g_byte_array_append (ts, p, TS_PACKET_SIZE);
+  }
+
+  return ts;
+}
+
+static GByteArray *
+make_pes (guint8 stream_id, const guint8 * es, gsize size)
+{
+  GByteArray *pes = g_byte_array_new ();
+  guint8 header[] = {
+    0x00, 0x00, 0x01, stream_id, 0x00, 0x00, 0x80, 0x80, 0x05,
+    0x21, 0x00, 0x01, 0x00, 0x01
+  };
+
+  GST_WRITE_UINT16_BE (header + 4, sizeof (header) - 6 + size);
+  g_byte_array_append (pes, header, sizeof (header));
+  g_byte_array_append (pes, es, size);
+
+  return pes;
+}
+
+/* Collects the payload of the TS packets of @pid, checking the continuity
+ * counters on the way */
+static GByteArray *
+depacketize (GstBuffer * buf, guint16 pid, guint * n_packets)
+{
+  GByteArray *payload = g_byte_array_new ();
+  GstMapInfo map;
+  gint last_cc = -1;
+  gsize i;
+
+  *n_packets = 0;
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless (map.size % TS_PACKET_SIZE == 0);
+  for (i = 0; i < map.size; i += TS_PACKET_SIZE) {
+    const guint8 *p = map.data + i;
+    gint offset;
+
+    fail_unless_equals_int (p[0], 0x47);
+    if (packet_pid (p) != pid)
+      continue;
+    (*n_packets)++;
+
+    offset = payload_offset (p);
+    if (offset < 0) {
+      fail_unless_equals_int (p[3] & 0xf, last_cc);
+      continue;
+    }
+    if (last_cc >= 0)
+      fail_unless_equals_int (p[3] & 0xf, (last_cc + 1) & 0xf);
+    last_cc = p[3] & 0xf;
+    g_byte_array_append (payload, p + offset, TS_PACKET_SIZE - offset);
+  }
+  gst_buffer_unmap (buf, &map);
+
+  return payload;
+}
+
+static void
+check_pes (GstBuffer * buf, guint16 pid, const guint8 * es, gsize size)
+{
+  GByteArray *expected, *pes;
+  guint n_packets;
+
+  expected = make_pes (0xc0, es, size);
+  pes = depacketize (buf, pid, &n_packets);
+  fail_unless_equals_int (pes->len, expected->len);
+  fail_unless (memcmp (pes->data, expected->data, pes->len) == 0);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (pes);
+}
+
+static void
+init_reader (GstHLSSampleAesReader * r, gsize * decrypted)
+{
+  memset (cc, 0, sizeof (cc));
+  *decrypted = 0;
+  gst_hlsdemux_sample_aes_reader_init (r, fake_decrypt, decrypted);
+}
+
+static GstBuffer *
+push_all (GstHLSSampleAesReader * r, GByteArray * ts)
+{
+  GstBuffer *buf;
+  guint len = ts->len;
+
+  fail_unless (gst_hlsdemux_sample_aes_reader_push (r,
+          gst_buffer_new_wrapped (g_byte_array_free (ts, FALSE), len), TRUE,
+          &buf));
+  fail_unless (buf != NULL);
+
+  return buf;
+}
+
+GST_START_TEST (test_pmt_rewrite)
+{
+  GstHLSSampleAesReader r;
+  GByteArray *ts = g_byte_array_new ();
+  GstBuffer *buf;
+  GstMapInfo map;
+  const guint8 *section;
+  guint section_size;
+  gsize decrypted;
+
+  init_reader (&r, &decrypted);
+  add_pat (ts);
+  add_pmt (ts);
+  buf = push_all (&r, ts);
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, 2 * TS_PACKET_SIZE);
+  section = map.data + TS_PACKET_SIZE + 5;
+  section_size = 3 + (GST_READ_UINT16_BE (section + 1) & 0x0fff);
+  /* the PMT now announces the clear stream types, with a valid CRC */
+  fail_unless_equals_int (section[12], 0x1b);
+  fail_unless_equals_int (section[17], 0x0f);
+  fail_unless_equals_int (section[22], 0x81);
+  fail_unless_equals_int (crc32_mpeg (section, section_size), 0);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  fail_unless_equals_int (r.n_streams, 3);
+  fail_unless_equals_int (decrypted, 0);
+  gst_hlsdemux_sample_aes_reader_clear (&r);
+}
+
+GST_END_TEST;
+
+#define NAL_BLOCKS 60
+#define NAL_SIZE (32 + 160 * NAL_BLOCKS)
+
+/* Inserts emulation prevention bytes */
+static void
+escape (GByteArray * out, const guint8 * data, gsize size)
+{
+  guint zeros = 0;
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && data[i] <= 0x03) {
+      g_byte_array_append (out, (const guint8 *) "\x03", 1);
+      zeros = 0;
+    }
+    g_byte_array_append (out, data + i, 1);
+    zeros = data[i] == 0x00 ? zeros + 1 : 0;
+  }
+}
+
+GST_START_TEST (test_h264_shrink)
+{
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0,
+    0x00, 0x00, 0x00, 0x01
+  };
+  GstHLSSampleAesReader r;
+  GByteArray *ts = g_byte_array_new ();
+  GByteArray *es, *clear_es, *pes, *next, *video_ts, *payload;
+  guint8 nal[NAL_SIZE];
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize decrypted, i, v;
+  guint n_packets;
+  guint8 id = 0, expected_id = 0;
+
+  init_reader (&r, &decrypted);
+
+  /* a slice NAL unit whose encrypted blocks turn into zeros, so the
+   * emulation prevention bytes make the encrypted data grow */
+  nal[0] = 0x65;
+  for (i = 1; i < NAL_SIZE; i++)
+    nal[i] = 0x10 | (i & 0x3f);
+  for (i = 32; i + 16 < NAL_SIZE; i += 160)
+    memset (nal + i, FAKE_KEY, 16);
+
+  clear_es = g_byte_array_new ();
+  g_byte_array_append (clear_es, aud, sizeof (aud));
+  g_byte_array_append (clear_es, nal, NAL_SIZE);
+
+  for (i = 32; i + 16 < NAL_SIZE; i += 160)
+    memset (nal + i, 0x00, 16);
+  es = g_byte_array_new ();
+  g_byte_array_append (es, aud, sizeof (aud));
+  escape (es, nal, NAL_SIZE);
+  /* enough to make the PES lose at least a whole TS packet, wherever it
+   * ends in its last packet */
+  fail_unless (es->len - clear_es->len >= 2 * 184);
+
+  pes = make_pes (0xe0, es->data, es->len);
+  video_ts = packetize (VIDEO_PID, pes->data, pes->len);
+  g_byte_array_unref (pes);
+
+  /* interleave the video with clear packets, followed by the start of the
+   * next PES that completes the first one */
+  add_pat (ts);
+  add_pmt (ts);
+  for (v = 0; v < video_ts->len; v += TS_PACKET_SIZE) {
+    g_byte_array_append (ts, video_ts->data + v, TS_PACKET_SIZE);
+    add_clear_packet (ts, id++);
+  }
+  g_byte_array_unref (video_ts);
+  pes = make_pes (0xe0, aud, sizeof (aud));
+  video_ts = packetize (VIDEO_PID, pes->data, pes->len);
+  g_byte_array_append (ts, video_ts->data, video_ts->len);
+  g_byte_array_unref (video_ts);
+  g_byte_array_unref (pes);
+  add_clear_packet (ts, id++);
+
+  buf = push_all (&r, ts);
+  fail_unless_equals_int (decrypted, 16 * NAL_BLOCKS);
+
+  /* the clear packets come out in order and unchanged, and each video
+   * packet that is left is still followed by the same clear packet */
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (packet_pid (map.data), 0);
+  fail_unless_equals_int (packet_pid (map.data + TS_PACKET_SIZE), PMT_PID);
+  for (i = 2 * TS_PACKET_SIZE; i < map.size; i += TS_PACKET_SIZE) {
+    const guint8 *p = map.data + i;
+
+    if (packet_pid (p) == CLEAR_PID) {
+      fail_unless_equals_int (p[4], expected_id);
+      fail_unless_equals_int (p[TS_PACKET_SIZE - 1], expected_id);
+      expected_id++;
+    } else {
+      fail_unless_equals_int (packet_pid (p), VIDEO_PID);
+      fail_unless (i + TS_PACKET_SIZE < map.size);
+      fail_unless_equals_int (packet_pid (p + TS_PACKET_SIZE), CLEAR_PID);
+      fail_unless_equals_int (p[TS_PACKET_SIZE + 4], expected_id);
+    }
+  }
+  fail_unless_equals_int (expected_id, id);
+  /* the PCR of the first video packet is kept */
+  fail_unless_equals_int (map.data[2 * TS_PACKET_SIZE + 5], 0x10);
+  fail_unless_equals_int (map.data[2 * TS_PACKET_SIZE + 10], 0x7e);
+  gst_buffer_unmap (buf, &map);
+
+  /* the first PES lost at least one packet, and its length was updated */
+  payload = depacketize (buf, VIDEO_PID, &n_packets);
+  fail_unless (n_packets < id);
+  pes = make_pes (0xe0, clear_es->data, clear_es->len);
+  next = make_pes (0xe0, aud, sizeof (aud));
+  g_byte_array_append (pes, next->data, next->len);
+  g_byte_array_unref (next);
+  fail_unless_equals_int (payload->len, pes->len);
+  fail_unless (memcmp (payload->data, pes->data, pes->len) == 0);
+  g_byte_array_unref (payload);
+  g_byte_array_unref (pes);
+
+  gst_buffer_unref (buf);
+  g_byte_array_unref (clear_es);
+  g_byte_array_unref (es);
+  gst_hlsdemux_sample_aes_reader_clear (&r);
+}
+
+GST_END_TEST;
+
+static void
+make_adts_frame (GByteArray * es, guint frame_size, gboolean encrypt)
+{
+  guint8 frame[512];
+  guint i;
+
+  fail_unless (frame_size <= sizeof (frame));
+  frame[0] = 0xff;
+  frame[1] = 0xf1;
+  frame[2] = 0x50;
+  frame[3] = 0x80 | ((frame_size >> 11) & 0x03);
+  frame[4] = (frame_size >> 3) & 0xff;
+  frame[5] = ((frame_size & 0x07) << 5) | 0x1f;
+  frame[6] = 0xfc;
+  for (i = 7; i < frame_size; i++)
+    frame[i] = i & 0xff;
+
+  /* everything after the header and 16 clear bytes, in whole blocks */
+  if (encrypt) {
+    for (i = 0; i < ((frame_size - 7 - 16) & ~0xf); i++)
+      frame[7 + 16 + i] ^= FAKE_KEY;
+  }
+
+  g_byte_array_append (es, frame, frame_size);
+}
+
+static void
+make_ac3_frame (GByteArray * es, gboolean encrypt)
+{
+  /* 48 kHz, 32 kbit/s: 64 words */
+  guint8 frame[128];
+  guint i;
+
+  frame[0] = 0x0b;
+  frame[1] = 0x77;
+  frame[2] = 0x00;
+  frame[3] = 0x00;
+  frame[4] = 0x00;
+  frame[5] = 0x40;
+  for (i = 6; i < sizeof (frame); i++)
+    frame[i] = i & 0xff;
+
+  if (encrypt) {
+    for (i = 16; i < sizeof (frame); i++)
+      frame[i] ^= FAKE_KEY;
+  }
+
+  g_byte_array_append (es, frame, sizeof (frame));
+}
+
+static void
+add_pes (GByteArray * ts, guint16 pid, GByteArray * es)
+{
+  GByteArray *pes, *packets;
+
+  pes = make_pes (0xc0, es->data, es->len);
+  packets = packetize (pid, pes->data, pes->len);
+  g_byte_array_append (ts, packets->data, packets->len);
+  g_byte_array_unref (packets);
+  g_byte_array_unref (pes);
+}
+
+GST_START_TEST (test_audio)
+{
+  GstHLSSampleAesReader r;
+  GByteArray *ts = g_byte_array_new ();
+  GByteArray *aac, *clear_aac, *ac3, *clear_ac3;
+  GstBuffer *buf;
+  gsize decrypted;
+
+  init_reader (&r, &decrypted);
+
+  aac = g_byte_array_new ();
+  clear_aac = g_byte_array_new ();
+  make_adts_frame (aac, 100, TRUE);
+  make_adts_frame (aac, 300, TRUE);
+  make_adts_frame (clear_aac, 100, FALSE);
+  make_adts_frame (clear_aac, 300, FALSE);
+
+  ac3 = g_byte_array_new ();
+  clear_ac3 = g_byte_array_new ();
+  make_ac3_frame (ac3, TRUE);
+  make_ac3_frame (ac3, TRUE);
+  make_ac3_frame (clear_ac3, FALSE);
+  make_ac3_frame (clear_ac3, FALSE);
+
+  add_pat (ts);
+  add_pmt (ts);
+  add_pes (ts, AAC_PID, aac);
+  add_pes (ts, AC3_PID, ac3);
+  buf = push_all (&r, ts);
+
+  fail_unless_equals_int (decrypted,
+      ((100 - 23) & ~0xf) + ((300 - 23) & ~0xf) + 2 * (128 - 16));
+  check_pes (buf, AAC_PID, clear_aac->data, clear_aac->len);
+  check_pes (buf, AC3_PID, clear_ac3->data, clear_ac3->len);
+
+  gst_buffer_unref (buf);
+  g_byte_array_unref (aac);
+  g_byte_array_unref (clear_aac);
+  g_byte_array_unref (ac3);
+  g_byte_array_unref (clear_ac3);
+  gst_hlsdemux_sample_aes_reader_clear (&r);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_audio_frame_split)
+{
+  GstHLSSampleAesReader r;
+  GByteArray *ts = g_byte_array_new ();
+  GByteArray *aac;
+  GstBuffer *buf;
+  gsize decrypted;
+  guint len;
+
+  init_reader (&r, &decrypted);
+
+  /* the second frame continues in a PES packet that isn't there */
+  aac = g_byte_array_new ();
+  make_adts_frame (aac, 100, TRUE);
+  make_adts_frame (aac, 300, TRUE);
+  g_byte_array_set_size (aac, 250);
+
+  add_pat (ts);
+  add_pmt (ts);
+  add_pes (ts, AAC_PID, aac);
+  g_byte_array_unref (aac);
+
+  len = ts->len;
+  fail_if (gst_hlsdemux_sample_aes_reader_push (&r,
+          gst_buffer_new_wrapped (g_byte_array_free (ts, FALSE), len), TRUE,
+          &buf));
+  fail_unless (buf == NULL);
+
+  gst_hlsdemux_sample_aes_reader_clear (&r);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_eos_flush)
+{
+  GstHLSSampleAesReader r;
+  GByteArray *ts = g_byte_array_new ();
+  GByteArray *aac;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize decrypted;
+  guint len;
+
+  init_reader (&r, &decrypted);
+
+  aac = g_byte_array_new ();
+  make_adts_frame (aac, 200, TRUE);
+
+  add_pat (ts);
+  add_pmt (ts);
+  add_pes (ts, AAC_PID, aac);
+  add_clear_packet (ts, 0);
+
+  /* the PES and the packet after it wait for the next PES start */
+  len = ts->len;
+  fail_unless (gst_hlsdemux_sample_aes_reader_push (&r,
+          gst_buffer_new_wrapped (g_byte_array_free (ts, FALSE), len), FALSE,
+          &buf));
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buf), 2 * TS_PACKET_SIZE);
+  gst_buffer_unref (buf);
+  fail_unless_equals_int (decrypted, 0);
+
+  fail_unless (gst_hlsdemux_sample_aes_reader_push (&r, NULL, TRUE, &buf));
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (decrypted, (200 - 23) & ~0xf);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, 3 * TS_PACKET_SIZE);
+  fail_unless_equals_int (packet_pid (map.data), AAC_PID);
+  fail_unless_equals_int (packet_pid (map.data + 2 * TS_PACKET_SIZE),
+      CLEAR_PID);
+  gst_buffer_unmap (buf, &map);
+
+  g_byte_array_set_size (aac, 0);
+  make_adts_frame (aac, 200, FALSE);
+  check_pes (buf, AAC_PID, aac->data, aac->len);
+  gst_buffer_unref (buf);
+  g_byte_array_unref (aac);
+
+  /* nothing is left behind */
+  fail_unless (gst_hlsdemux_sample_aes_reader_push (&r, NULL, TRUE, &buf));
+  fail_unless (buf == NULL);
+
+  gst_hlsdemux_sample_aes_reader_clear (&r);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsdemux_sample_aes_suite (void)
+{
+  Suite *s = suite_create ("hlsdemux_sample_aes");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (gst_hls_demux_debug, "hlsdemux", 0,
+      "hlsdemux element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pmt_rewrite);
+  tcase_add_test (tc_chain, test_h264_shrink);
+  tcase_add_test (tc_chain, test_audio);
+  tcase_add_test (tc_chain, test_audio_frame_split);
+  tcase_add_test (tc_chain, test_eos_flush);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsdemux_sample_aes);
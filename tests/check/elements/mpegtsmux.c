@@ -803,6 +803,147 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+GST_START_TEST (test_cbr)
+{
+  GstElement *mux;
+  GstCaps *caps;
+  GstClockTime ts, last_ts = 0;
+  gchar *padname;
+  GList *l;
+  guint i, n_packets = 0, n_null = 0, n_af_only = 0;
+  gint last_cc[0x2000];
+  guint64 expected;
+
+  for (i = 0; i < G_N_ELEMENTS (last_cc); i++)
+    last_cc[i] = -1;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", (guint64) 2000000, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  ts = 0;
+  for (i = 0; i < 25; ++i) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (1000);
+
+    GST_BUFFER_PTS (inbuffer) = GST_BUFFER_DTS (inbuffer) = ts;
+    if (i != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+    gsize offset;
+
+    /* output is timestamped by its position in the stream */
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    fail_unless (GST_BUFFER_PTS (buf) >= last_ts);
+    last_ts = GST_BUFFER_PTS (buf);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless (map.size % 188 == 0);
+    for (offset = 0; offset < map.size; offset += 188) {
+      guint pid = GST_READ_UINT16_BE (map.data + offset + 1) & 0x1FFF;
+      guint afc = (map.data[offset + 3] >> 4) & 0x3;
+      gint cc = map.data[offset + 3] & 0xf;
+
+      fail_unless (map.data[offset] == 0x47);
+      n_packets++;
+      if (pid == 0x1FFF) {
+        n_null++;
+        continue;
+      }
+
+      /* the continuity counter only advances for packets with a payload,
+       * adaptation field only packets (PCR) repeat the previous one */
+      if (last_cc[pid] != -1) {
+        if (afc & 0x1)
+          fail_unless_equals_int (cc, (last_cc[pid] + 1) & 0xf);
+        else
+          fail_unless_equals_int (cc, last_cc[pid]);
+      }
+      if (afc == 0x2)
+        n_af_only++;
+      last_cc[pid] = cc;
+    }
+    gst_buffer_unmap (buf, &map);
+  }
+
+  /* the stream has to cover the 24 frame intervals at the mux rate */
+  expected = gst_util_uint64_scale (24 * 40 * GST_MSECOND, 2000000,
+      8 * 188 * GST_SECOND);
+  GST_LOG ("%u packets, %u null packets", n_packets, n_null);
+  fail_unless (n_packets >= expected);
+  fail_unless (n_null > 0);
+  fail_unless (n_af_only > 0);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cbr_overrun)
+{
+  GstElement *mux;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  GstClockTime ts;
+  gchar *padname;
+  guint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  /* 25 frames of 1000 bytes per second need more than 200 kbit/s */
+  g_object_set (mux, "bitrate", (guint64) 100000, NULL);
+
+  bus = gst_bus_new ();
+  gst_element_set_bus (mux, bus);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  ts = 0;
+  for (i = 0; i < 25; ++i) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (1000);
+
+    GST_BUFFER_PTS (inbuffer) = GST_BUFFER_DTS (inbuffer) = ts;
+    if (i != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+
+  /* the overrun is reported once, not for every late buffer */
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_WARNING);
+  fail_unless (msg != NULL);
+  gst_message_unref (msg);
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_WARNING) == NULL);
+
+  gst_check_drop_buffers ();
+  gst_element_set_bus (mux, NULL);
+  gst_object_unref (bus);
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +960,8 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_cbr);
+  tcase_add_test (tc_chain, test_cbr_overrun);
 
   return s;
 }
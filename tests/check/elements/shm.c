@@ -24,8 +24,13 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -42,7 +47,7 @@ GstElement *src, *sink;
 GstPad *sinkpad, *srcpad;
 
 static void
-setup_shm (void)
+setup_shm_full (gboolean fd_passing)
 {
   gchar *socket_path = NULL;
 
@@ -52,7 +57,8 @@ setup_shm (void)
   srcpad = gst_check_setup_src_pad (sink, &src_template);
   sinkpad = gst_check_setup_sink_pad (src, &sink_template);
 
-  g_object_set (sink, "socket-path", "shm-unit-test", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "fd-passing",
+      fd_passing, NULL);
 
   fail_unless (gst_element_set_state (sink, GST_STATE_PLAYING) ==
       GST_STATE_CHANGE_ASYNC);
@@ -69,6 +75,18 @@ setup_shm (void)
       GST_STATE_CHANGE_SUCCESS);
 }
 
+static void
+setup_shm (void)
+{
+  setup_shm_full (FALSE);
+}
+
+static void
+setup_shm_fd_passing (void)
+{
+  setup_shm_full (TRUE);
+}
+
 static void
 teardown_shm (void)
 {
@@ -169,6 +187,142 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_fd_passing)
+{
+  GstBuffer *buf;
+  GstAllocator *alloc;
+  GstSegment segment;
+  GstMemory *mem;
+  GstMapInfo map;
+  gchar *filename = NULL;
+  guint8 data[1000];
+  guint i;
+  gint fd;
+
+  g_object_set (sink, "fd-passing", TRUE, NULL);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i % 251;
+
+  fd = g_file_open_tmp (NULL, &filename, NULL);
+  fail_unless (fd >= 0);
+  g_unlink (filename);
+  g_free (filename);
+  fail_unless (write (fd, data, 24) == 24);
+  fail_unless (write (fd, data, sizeof (data)) == sizeof (data));
+
+  alloc = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (alloc, fd, 24 + sizeof (data),
+      GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, 24, sizeof (data));
+  gst_object_unref (alloc);
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  fail_unless (g_list_length (buffers) == 1);
+
+  buf = buffers->data;
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless (map.size == sizeof (data));
+  fail_unless (memcmp (map.data, data, sizeof (data)) == 0);
+  gst_buffer_unmap (buf, &map);
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+pop_buffer (void)
+{
+  GstBuffer *buf;
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  buf = buffers->data;
+  buffers = g_list_delete_link (buffers, buffers);
+  g_mutex_unlock (&check_mutex);
+
+  return buf;
+}
+
+/* With fd-passing the sink proposes memfd backed memory, which is passed
+ * without a copy, and only creates the shm area for other buffers */
+GST_START_TEST (test_shm_fd_alloc)
+{
+  GstBuffer *buf;
+  GstQuery *query;
+  GstCaps *caps = gst_caps_new_empty_simple ("application/x-test");
+  GstAllocator *alloc;
+  GstAllocationParams params;
+  GstSegment segment;
+  GstMapInfo map;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  query = gst_query_new_allocation (caps, FALSE);
+  gst_caps_unref (caps);
+  fail_unless (gst_pad_peer_query (srcpad, query));
+  fail_unless (gst_query_get_n_allocation_params (query) == 1);
+  gst_query_parse_nth_allocation_param (query, 0, &alloc, &params);
+  fail_unless (alloc != NULL);
+  fail_unless (GST_IS_FD_ALLOCATOR (alloc));
+  gst_query_unref (query);
+
+  buf = gst_buffer_new_allocate (alloc, 5000, &params);
+  gst_object_unref (alloc);
+  fail_unless (gst_is_fd_memory (gst_buffer_peek_memory (buf, 0)));
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  for (i = 0; i < map.size; i++)
+    map.data[i] = i % 251;
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  buf = pop_buffer ();
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, 5000);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], i % 251);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  /* A system memory buffer still goes through the shm area, which is
+   * created for it */
+  buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+  gst_buffer_memset (buf, 0, 0x5a, 1000);
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  buf = pop_buffer ();
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, 1000);
+  fail_unless_equals_int (map.data[0], 0x5a);
+  fail_unless_equals_int (map.data[999], 0x5a);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_shm_live)
 {
   GstElement *producer, *consumer;
@@ -239,6 +393,12 @@ shm_suite (void)
   tcase_add_checked_fixture (tc, setup_shm, NULL);
   tcase_add_test (tc, test_shm_sysmem_alloc);
   tcase_add_test (tc, test_shm_alloc);
+  tcase_add_test (tc, test_shm_fd_passing);
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("shm-fd-passing");
+  tcase_add_checked_fixture (tc, setup_shm_fd_passing, NULL);
+  tcase_add_test (tc, test_shm_fd_alloc);
   suite_add_tcase (s, tc);
 
   tc = tcase_create ("shm2");
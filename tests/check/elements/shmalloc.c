@@ -0,0 +1,207 @@
+/* GStreamer
+ *
+ * unit test for the shm allocator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#define SHM_PIPE_USE_GLIB
+#include "../../../sys/shm/shmalloc.c"
+
+/* Every block must be tagged at its first and last granule, with nothing
+ * in between, and the blocks must cover the whole space */
+static void
+check_index (ShmAllocSpace * space)
+{
+  unsigned long granule = 0, i;
+
+  while (granule < space->n_granules) {
+    ShmAllocBlock *block = space->index[granule];
+    unsigned long last;
+
+    fail_unless (block != NULL);
+    assert_equals_uint64 (block->offset, granule << space->granule_shift);
+    last = granule + block->n_granules - 1;
+    fail_unless (space->index[last] == block);
+    for (i = granule + 1; i < last; i++)
+      fail_unless (space->index[i] == NULL);
+    granule = last + 1;
+  }
+}
+
+GST_START_TEST (test_alloc_free)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (64 * 1024);
+  ShmAllocBlock *a, *b, *c;
+
+  a = shm_alloc_space_alloc_block (space, 1000);
+  b = shm_alloc_space_alloc_block (space, 1000);
+  c = shm_alloc_space_alloc_block (space, 1000);
+  fail_unless (a && b && c);
+  fail_unless (a->offset + 1000 <= b->offset);
+  fail_unless (b->offset + 1000 <= c->offset);
+  check_index (space);
+
+  /* The freed middle block is merged with each neighbour in turn */
+  shm_alloc_space_block_dec (b);
+  check_index (space);
+  shm_alloc_space_block_dec (a);
+  check_index (space);
+  shm_alloc_space_block_dec (c);
+  check_index (space);
+
+  /* and everything ends up as a single free block again */
+  fail_unless (space->index[0]->free);
+  assert_equals_uint64 (space->index[0]->n_granules, space->n_granules);
+
+  a = shm_alloc_space_alloc_block (space, 64 * 1024);
+  fail_unless (a != NULL);
+  fail_unless (shm_alloc_space_alloc_block (space, 1) == NULL);
+  shm_alloc_space_block_dec (a);
+
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_block_get)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (64 * 1024);
+  ShmAllocBlock *a, *b;
+
+  a = shm_alloc_space_alloc_block (space, 5000);
+  b = shm_alloc_space_alloc_block (space, 100);
+
+  fail_unless (shm_alloc_space_block_get (space, a->offset) == a);
+  fail_unless (shm_alloc_space_block_get (space, a->offset + 4321) == a);
+  fail_unless (shm_alloc_space_block_get (space, a->offset + 4999) == a);
+  fail_unless (shm_alloc_space_block_get (space, b->offset) == b);
+  fail_unless (shm_alloc_space_block_get (space, b->offset + 99) == b);
+  fail_unless (shm_alloc_space_block_get (space, 64 * 1024) == NULL);
+
+  /* Free space doesn't belong to any block */
+  shm_alloc_space_block_dec (a);
+  fail_unless (shm_alloc_space_block_get (space, 0) == NULL);
+  fail_unless (shm_alloc_space_block_get (space, 4000) == NULL);
+
+  shm_alloc_space_block_dec (b);
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+/* Small buffers in a large space must not take much more than their size */
+GST_START_TEST (test_small_blocks)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (64 * 1024 * 1024);
+  ShmAllocBlock *a, *b;
+
+  a = shm_alloc_space_alloc_block (space, 100);
+  b = shm_alloc_space_alloc_block (space, 100);
+  fail_unless (a && b);
+  fail_unless (b->offset - a->offset <= 256);
+
+  shm_alloc_space_block_dec (a);
+  shm_alloc_space_block_dec (b);
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+/* The last granule of the space is only partially usable */
+GST_START_TEST (test_partial_granule)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (1000);
+  ShmAllocBlock *a, *b;
+
+  a = shm_alloc_space_alloc_block (space, 960);
+  fail_unless (a != NULL);
+  fail_unless (shm_alloc_space_alloc_block (space, 41) == NULL);
+  b = shm_alloc_space_alloc_block (space, 40);
+  fail_unless (b != NULL);
+  assert_equals_uint64 (b->offset + b->size, 1000);
+  check_index (space);
+
+  shm_alloc_space_block_dec (a);
+  shm_alloc_space_block_dec (b);
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_random)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (100000);
+  ShmAllocBlock *blocks[64] = { NULL, };
+  GRand *rand = g_rand_new_with_seed (1);
+  guint i, n;
+
+  for (n = 0; n < 20000; n++) {
+    i = g_rand_int_range (rand, 0, G_N_ELEMENTS (blocks));
+
+    if (blocks[i]) {
+      shm_alloc_space_block_dec (blocks[i]);
+      blocks[i] = NULL;
+    } else {
+      gulong size = g_rand_int_range (rand, 1, 5000);
+
+      blocks[i] = shm_alloc_space_alloc_block (space, size);
+      if (blocks[i]) {
+        fail_unless (blocks[i]->offset + size <= 100000);
+        fail_unless (shm_alloc_space_block_get (space,
+                blocks[i]->offset + size - 1) == blocks[i]);
+      }
+    }
+
+    if (n % 100 == 0)
+      check_index (space);
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (blocks); i++) {
+    if (blocks[i])
+      shm_alloc_space_block_dec (blocks[i]);
+  }
+  check_index (space);
+
+  g_rand_free (rand);
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+static Suite *
+shmalloc_suite (void)
+{
+  Suite *s = suite_create ("shmalloc");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_alloc_free);
+  tcase_add_test (tc, test_block_get);
+  tcase_add_test (tc, test_small_blocks);
+  tcase_add_test (tc, test_partial_granule);
+  tcase_add_test (tc, test_random);
+
+  return s;
+}
+
+GST_CHECK_MAIN (shmalloc);
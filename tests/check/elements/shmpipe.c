@@ -0,0 +1,285 @@
+/* GStreamer
+ *
+ * unit test for the shm pipe control protocol
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#define SHM_PIPE_USE_GLIB
+#include "../../../sys/shm/shmalloc.c"
+#include "../../../sys/shm/shmpipe.c"
+
+#define N_BUFFERS 10
+
+static gchar *socket_path;
+static ShmPipe *writer;
+static ShmPipe *reader;
+static ShmClient *client;
+
+static void
+setup_pipe (void)
+{
+  socket_path = g_strdup_printf ("%s/shmpipe-test-%d", g_get_tmp_dir (),
+      (gint) getpid ());
+
+  writer = sp_writer_create (socket_path, 64 * 1024, 0700);
+  fail_unless (writer != NULL);
+  reader = sp_client_open (sp_writer_get_path (writer));
+  fail_unless (reader != NULL);
+  client = sp_writer_accept_client (writer);
+  fail_unless (client != NULL);
+}
+
+static void
+teardown_pipe (void)
+{
+  sp_writer_close_client (writer, client, NULL, NULL);
+  sp_client_close (reader);
+  sp_writer_close (writer, NULL, NULL);
+  g_free (socket_path);
+}
+
+/* Handles all the commands received so far, returns the number of
+ * buffers */
+static gint
+client_recv_all (gchar ** bufs, gint n_bufs)
+{
+  while (sp_client_has_pending_commands (reader)) {
+    gchar *buf = NULL;
+    long int size = sp_client_recv (reader, &buf);
+
+    fail_unless (size >= 0);
+    if (buf) {
+      fail_unless_equals_int (size, 100);
+      bufs[n_bufs++] = buf;
+    }
+  }
+
+  return n_bufs;
+}
+
+GST_START_TEST (test_batched_buffers)
+{
+  ShmBlock *blocks[N_BUFFERS];
+  gchar *bufs[N_BUFFERS];
+  gint i, n_bufs, n_acked;
+
+  for (i = 0; i < N_BUFFERS; i++) {
+    gchar *data;
+
+    blocks[i] = sp_writer_alloc_block (writer, 100);
+    fail_unless (blocks[i] != NULL);
+    data = sp_writer_block_get_buf (blocks[i]);
+    memset (data, i, 100);
+    fail_unless_equals_int (sp_writer_send_buf (writer, data, 100,
+            blocks[i]), 1);
+  }
+
+  /* The buffers are sent together by the flush, and the new area and all
+   * buffers are received with a single read */
+  sp_writer_flush (writer);
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  n_bufs = client_recv_all (bufs, 0);
+  fail_unless_equals_int (n_bufs, N_BUFFERS);
+  fail_if (sp_client_has_pending_commands (reader));
+
+  /* Nothing else was sent, this must not block */
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_if (sp_client_has_pending_commands (reader));
+
+  for (i = 0; i < N_BUFFERS; i++) {
+    fail_unless_equals_int (bufs[i][0], i);
+    fail_unless_equals_int (bufs[i][99], i);
+    fail_unless (sp_client_recv_finish (reader, bufs[i]));
+  }
+
+  /* and so are all the acks */
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  fail_if (sp_writer_has_pending_commands (client));
+  fail_unless (sp_client_flush (reader));
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  n_acked = 0;
+  while (sp_writer_has_pending_commands (client)) {
+    gpointer tag = NULL;
+
+    fail_unless_equals_int (sp_writer_recv (writer, client, &tag), 0);
+    fail_unless (tag == blocks[n_acked]);
+    sp_writer_free_block (tag);
+    n_acked++;
+  }
+  fail_unless_equals_int (n_acked, N_BUFFERS);
+  fail_unless_equals_int (sp_writer_pending_writes (writer), 0);
+}
+
+GST_END_TEST;
+
+/* A command that was only partially received is kept until the rest of it
+ * arrives, without blocking */
+GST_START_TEST (test_partial_command)
+{
+  ShmBlock *block;
+  struct CommandBuffer cb = { 0 };
+  gint fd = sp_writer_get_client_fd (client);
+  gchar *bufs[2];
+  gchar *data;
+  gsize half = sizeof (cb) / 2;
+  gpointer tag = NULL;
+
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_unless_equals_int (client_recv_all (bufs, 0), 0);
+
+  block = sp_writer_alloc_block (writer, 100);
+  data = sp_writer_block_get_buf (block);
+  memset (data, 0x42, 100);
+
+  /* Send the buffer by hand, split in two */
+  cb.type = COMMAND_NEW_BUFFER;
+  cb.area_id = writer->shm_area->id;
+  cb.payload.buffer.offset = data - writer->shm_area->shm_area_buf;
+  cb.payload.buffer.size = 100;
+  fail_unless_equals_int (send (fd, &cb, half, MSG_NOSIGNAL), half);
+
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_if (sp_client_has_pending_commands (reader));
+  bufs[0] = NULL;
+  fail_unless_equals_int (sp_client_recv (reader, &bufs[0]), 0);
+  fail_unless (bufs[0] == NULL);
+
+  fail_unless_equals_int (send (fd, (gchar *) & cb + half, sizeof (cb) - half,
+          MSG_NOSIGNAL), sizeof (cb) - half);
+
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_unless (sp_client_has_pending_commands (reader));
+  fail_unless_equals_int (client_recv_all (bufs, 0), 1);
+  fail_unless_equals_int (bufs[0][0], 0x42);
+
+  /* The same holds for acks on the writer side */
+  fail_unless_equals_int (sp_writer_send_buf (writer, data, 100, block), 1);
+  sp_writer_flush (writer);
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_unless_equals_int (client_recv_all (bufs, 1), 2);
+
+  memset (&cb, 0, sizeof (cb));
+  cb.type = COMMAND_ACK_BUFFER;
+  cb.area_id = reader->shm_area->id;
+  cb.payload.ack_buffer.offset = bufs[1] - reader->shm_area->shm_area_buf;
+  fail_unless_equals_int (send (reader->main_socket, &cb, half, MSG_NOSIGNAL),
+      half);
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  fail_if (sp_writer_has_pending_commands (client));
+
+  fail_unless_equals_int (send (reader->main_socket, (gchar *) & cb + half,
+          sizeof (cb) - half, MSG_NOSIGNAL), sizeof (cb) - half);
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  fail_unless (sp_writer_has_pending_commands (client));
+  fail_unless_equals_int (sp_writer_recv (writer, client, &tag), 0);
+  fail_unless (tag == block);
+  sp_writer_free_block (block);
+}
+
+GST_END_TEST;
+
+/* Queued commands are sent without waiting for a flush once the queue is
+ * full */
+GST_START_TEST (test_full_queue)
+{
+  ShmBlock *blocks[COMMAND_BATCH + 1];
+  gchar *bufs[COMMAND_BATCH + 1];
+  gpointer tag;
+  gint i, n_bufs;
+
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_unless_equals_int (client_recv_all (bufs, 0), 0);
+
+  for (i = 0; i < COMMAND_BATCH + 1; i++) {
+    blocks[i] = sp_writer_alloc_block (writer, 100);
+    fail_unless (blocks[i] != NULL);
+    fail_unless_equals_int (sp_writer_send_buf (writer,
+            sp_writer_block_get_buf (blocks[i]), 100, blocks[i]), 1);
+  }
+
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  n_bufs = client_recv_all (bufs, 0);
+  fail_unless_equals_int (n_bufs, COMMAND_BATCH);
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_if (sp_client_has_pending_commands (reader));
+
+  sp_writer_flush (writer);
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  n_bufs = client_recv_all (bufs, n_bufs);
+  fail_unless_equals_int (n_bufs, COMMAND_BATCH + 1);
+
+  /* Same for the acks */
+  for (i = 0; i < COMMAND_BATCH + 1; i++)
+    fail_unless (sp_client_recv_finish (reader, bufs[i]));
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  for (i = 0; i < COMMAND_BATCH; i++) {
+    tag = NULL;
+    fail_unless_equals_int (sp_writer_recv (writer, client, &tag), 0);
+    fail_unless (tag == blocks[i]);
+    sp_writer_free_block (tag);
+  }
+  fail_if (sp_writer_has_pending_commands (client));
+
+  fail_unless (sp_client_flush (reader));
+  fail_unless_equals_int (sp_writer_read (client), 0);
+  fail_unless (sp_writer_has_pending_commands (client));
+  tag = NULL;
+  fail_unless_equals_int (sp_writer_recv (writer, client, &tag), 0);
+  fail_unless (tag == blocks[COMMAND_BATCH]);
+  sp_writer_free_block (tag);
+  fail_unless_equals_int (sp_writer_pending_writes (writer), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_closed_socket)
+{
+  fail_unless_equals_int (sp_client_read (reader), 0);
+  fail_unless (sp_client_has_pending_commands (reader));
+
+  shutdown (sp_writer_get_client_fd (client), SHUT_RDWR);
+
+  /* The commands already received are still handled */
+  fail_unless (sp_client_recv (reader, NULL) == 0);
+  fail_unless (sp_client_read (reader) < 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+shmpipe_suite (void)
+{
+  Suite *s = suite_create ("shmpipe");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_checked_fixture (tc, setup_pipe, teardown_pipe);
+  tcase_add_test (tc, test_batched_buffers);
+  tcase_add_test (tc, test_partial_command);
+  tcase_add_test (tc, test_full_queue);
+  tcase_add_test (tc, test_closed_socket);
+
+  return s;
+}
+
+GST_CHECK_MAIN (shmpipe);
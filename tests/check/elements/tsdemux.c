@@ -0,0 +1,326 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/mpegts/mpegts.h>
+#include <string.h>
+
+#define TS_PACKET_SIZE 188
+#define PMT_PID 0x100
+#define VIDEO_PID 0x101
+
+/* Number of TS packets each PES spans */
+#define PES_PACKETS 21
+/* PES header with PTS and DTS */
+#define PES_HEADER_SIZE 19
+/* Adaptation field carrying a PCR */
+#define PCR_FIELD_SIZE 8
+#define PES_PAYLOAD_SIZE \
+    ((TS_PACKET_SIZE - 4) * PES_PACKETS - PCR_FIELD_SIZE - PES_HEADER_SIZE)
+#define FRAME_DURATION 3600     /* 40ms in 90kHz */
+
+static guint8 cc[0x2000];
+
+static guint32
+crc32_mpeg (const guint8 * data, guint size)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < size; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static guint8 *
+write_header (guint8 * p, guint16 pid, gboolean pusi, guint8 afc)
+{
+  p[0] = 0x47;
+  p[1] = (pusi ? 0x40 : 0) | (pid >> 8);
+  p[2] = pid & 0xff;
+  p[3] = (afc << 4) | (cc[pid]++ & 0xf);
+
+  return p + 4;
+}
+
+/* A packet with a complete section, @section without CRC */
+static GstBuffer *
+make_section_packet (guint16 pid, const guint8 * section, guint size)
+{
+  guint8 *data = g_malloc (TS_PACKET_SIZE);
+  guint8 *p;
+  guint32 crc;
+
+  memset (data, 0xff, TS_PACKET_SIZE);
+  p = write_header (data, pid, TRUE, 1);
+  *p++ = 0;                     /* pointer_field */
+  memcpy (p, section, size);
+  crc = crc32_mpeg (p, size);
+  GST_WRITE_UINT32_BE (p + size, crc);
+
+  return gst_buffer_new_wrapped (data, TS_PACKET_SIZE);
+}
+
+/* @programs holds @n_programs pairs of program number and PMT PID */
+static GstBuffer *
+make_pat (guint8 version, const guint16 * programs, guint n_programs)
+{
+  guint8 section[8 + 4 * 4] = {
+    0x00, 0xb0, 9 + 4 * n_programs, 0x00, 0x01, 0xc1 | (version << 1),
+    0x00, 0x00
+  };
+  guint i;
+
+  g_assert (n_programs <= 4);
+  for (i = 0; i < n_programs; i++) {
+    guint8 *p = section + 8 + 4 * i;
+
+    GST_WRITE_UINT16_BE (p, programs[2 * i]);
+    GST_WRITE_UINT16_BE (p + 2, 0xe000 | programs[2 * i + 1]);
+  }
+
+  return make_section_packet (0, section, 8 + 4 * n_programs);
+}
+
+static GstBuffer *
+make_pmt (guint16 pmt_pid, guint16 program, guint16 pcr_pid, guint16 pid)
+{
+  guint8 section[17] = {
+    0x02, 0xb0, 18, program >> 8, program & 0xff, 0xc1, 0x00, 0x00,
+    0xe0 | (pcr_pid >> 8), pcr_pid & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (pid >> 8), pid & 0xff, 0xf0, 0x00
+  };
+
+  return make_section_packet (pmt_pid, section, sizeof (section));
+}
+
+static void
+write_timestamp (guint8 * p, guint8 prefix, guint64 ts)
+{
+  p[0] = (prefix << 4) | ((ts >> 29) & 0x0e) | 1;
+  p[1] = (ts >> 22) & 0xff;
+  p[2] = ((ts >> 14) & 0xfe) | 1;
+  p[3] = (ts >> 7) & 0xff;
+  p[4] = ((ts << 1) & 0xfe) | 1;
+}
+
+/* A H.264 PES with an unbounded length, spread over PES_PACKETS packets
+ * each in its own buffer. The first packet carries a PCR 100ms before
+ * @dts */
+static void
+push_pes (GstHarness * h, guint16 pid, guint64 pts, guint64 dts, guint8 fill)
+{
+  guint i;
+
+  for (i = 0; i < PES_PACKETS; i++) {
+    guint8 *data = g_malloc (TS_PACKET_SIZE);
+    guint8 *p, *end = data + TS_PACKET_SIZE;
+
+    if (i == 0) {
+      guint64 pcr = dts - 9000;
+
+      p = write_header (data, pid, TRUE, 3);
+      *p++ = PCR_FIELD_SIZE - 1;
+      *p++ = 0x10;
+      *p++ = pcr >> 25;
+      *p++ = pcr >> 17;
+      *p++ = pcr >> 9;
+      *p++ = pcr >> 1;
+      *p++ = ((pcr & 1) << 7) | 0x7e;
+      *p++ = 0;
+
+      *p++ = 0x00;
+      *p++ = 0x00;
+      *p++ = 0x01;
+      *p++ = 0xe0;
+      *p++ = 0x00;
+      *p++ = 0x00;
+      *p++ = 0x80;
+      *p++ = 0xc0;
+      *p++ = 10;
+      write_timestamp (p, 0x3, pts);
+      write_timestamp (p + 5, 0x1, dts);
+      p += 10;
+    } else {
+      p = write_header (data, pid, FALSE, 1);
+    }
+    memset (p, fill, end - p);
+
+    fail_unless_equals_int (gst_harness_push (h,
+            gst_buffer_new_wrapped (data, TS_PACKET_SIZE)), GST_FLOW_OK);
+  }
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstHarness * h)
+{
+  gst_harness_add_element_src_pad (h, pad);
+}
+
+static GstHarness *
+setup_tsdemux (void)
+{
+  GstHarness *h = gst_harness_new_with_padnames ("tsdemux", "sink", NULL);
+  GstSegment segment;
+
+  g_signal_connect (h->element, "pad-added", G_CALLBACK (pad_added_cb), h);
+  gst_harness_set_src_caps_str (h,
+      "video/mpegts, systemstream=(boolean)true, packetsize=(int)188");
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  fail_unless (gst_harness_push_event (h, gst_event_new_segment (&segment)));
+
+  return h;
+}
+
+static void
+check_pes_buffers (GstHarness * h, guint n_pes, guint8 first_fill)
+{
+  GstClockTime first_pts = GST_CLOCK_TIME_NONE;
+  guint i;
+
+  fail_unless_equals_int (gst_harness_buffers_received (h), n_pes);
+
+  for (i = 0; i < n_pes; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    GstMapInfo map;
+    guint j;
+
+    /* Each PES comes out as one buffer carrying its own timestamps */
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    fail_unless (GST_BUFFER_DTS_IS_VALID (buf));
+    if (i == 0)
+      first_pts = GST_BUFFER_PTS (buf);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf) - first_pts,
+        i * gst_util_uint64_scale (FRAME_DURATION, GST_SECOND, 90000));
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf) - GST_BUFFER_DTS (buf),
+        gst_util_uint64_scale (FRAME_DURATION, GST_SECOND, 90000));
+
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, PES_PAYLOAD_SIZE);
+    for (j = 0; j < map.size; j++)
+      fail_unless_equals_int (map.data[j], (guint8) (first_fill + i));
+    gst_buffer_unmap (buf, &map);
+
+    gst_buffer_unref (buf);
+  }
+}
+
+GST_START_TEST (test_pes_timestamps)
+{
+  const guint16 programs[] = { 1, PMT_PID };
+  GstHarness *h = setup_tsdemux ();
+  guint i;
+
+  memset (cc, 0, sizeof (cc));
+  fail_unless_equals_int (gst_harness_push (h, make_pat (0, programs, 1)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, make_pmt (PMT_PID, 1,
+              VIDEO_PID, VIDEO_PID)), GST_FLOW_OK);
+
+  for (i = 0; i < 3; i++)
+    push_pes (h, VIDEO_PID, 90000 + (i + 1) * FRAME_DURATION,
+        90000 + i * FRAME_DURATION, 0x10 + i);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  check_pes_buffers (h, 3, 0x10);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Whether a PMT of @program was parsed on @pid */
+static gboolean
+pop_pmt_message (GstBus * bus, guint16 pid, guint16 program)
+{
+  GstMessage *msg;
+  gboolean found = FALSE;
+
+  while (!found && (msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (gst_structure_has_name (s, "pmt")) {
+      GstMpegtsSection *section =
+          g_value_get_boxed (gst_structure_get_value (s, "section"));
+
+      found = section->pid == pid && section->subtable_extension == program;
+    }
+    gst_message_unref (msg);
+  }
+
+  return found;
+}
+
+GST_START_TEST (test_pat_change)
+{
+  const guint16 programs[] = { 1, PMT_PID };
+  /* The PMT PID of program 1 moves and is reused by a new program */
+  const guint16 new_programs[] = { 2, PMT_PID, 1, PMT_PID + 0x100 };
+  GstHarness *h = setup_tsdemux ();
+  GstBus *bus = gst_bus_new ();
+
+  gst_element_set_bus (h->element, bus);
+
+  memset (cc, 0, sizeof (cc));
+  fail_unless_equals_int (gst_harness_push (h, make_pat (0, programs, 1)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, make_pmt (PMT_PID, 1,
+              VIDEO_PID, VIDEO_PID)), GST_FLOW_OK);
+  fail_unless (pop_pmt_message (bus, PMT_PID, 1));
+  push_pes (h, VIDEO_PID, 90000 + FRAME_DURATION, 90000, 0x10);
+
+  fail_unless_equals_int (gst_harness_push (h, make_pat (1, new_programs, 2)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, make_pmt (PMT_PID + 0x100, 1,
+              VIDEO_PID, VIDEO_PID)), GST_FLOW_OK);
+  fail_unless (pop_pmt_message (bus, PMT_PID + 0x100, 1));
+  fail_unless_equals_int (gst_harness_push (h, make_pmt (PMT_PID, 2,
+              VIDEO_PID + 1, VIDEO_PID + 1)), GST_FLOW_OK);
+  fail_unless (pop_pmt_message (bus, PMT_PID, 2));
+
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  check_pes_buffers (h, 1, 0x10);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pes_timestamps);
+  tcase_add_test (tc_chain, test_pat_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
@@ -663,6 +663,53 @@ GST_START_TEST (test_sdp_no_media)
 
 GST_END_TEST;
 
+GST_START_TEST (test_sdp_no_media_shared_pc_thread)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GstStructure *s1, *s2;
+  gboolean shared;
+  guint users;
+  guint64 tasks;
+
+  /* both webrtcbins run their operations on the same thread */
+  g_object_set (t->webrtc1, "pc-thread-pool-size", 1, NULL);
+  g_object_set (t->webrtc2, "pc-thread-pool-size", 1, NULL);
+
+  t->on_negotiation_needed = NULL;
+  t->offer_data = GUINT_TO_POINTER (0);
+  t->on_offer_created = _count_num_sdp_media;
+  t->answer_data = GUINT_TO_POINTER (0);
+  t->on_answer_created = _count_num_sdp_media;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless (t->state == STATE_ANSWER_CREATED);
+
+  g_object_get (t->webrtc1, "pc-worker-stats", &s1, NULL);
+  g_object_get (t->webrtc2, "pc-worker-stats", &s2, NULL);
+  fail_unless (s1 != NULL && s2 != NULL);
+  fail_unless (gst_structure_get (s1, "shared", G_TYPE_BOOLEAN, &shared,
+          "users", G_TYPE_UINT, &users, "tasks", G_TYPE_UINT64, &tasks, NULL));
+  fail_unless (shared);
+  fail_unless_equals_int (users, 2);
+  /* at least the offer and the answer */
+  fail_unless (tasks >= 2);
+  fail_unless (gst_structure_has_field (s2, "average-latency"));
+  fail_unless (gst_structure_has_field (s2, "max-queued"));
+  gst_structure_free (s1);
+  gst_structure_free (s2);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 static void
 add_fake_audio_src_harness (GstHarness * h, gint pt)
 {
@@ -1338,6 +1385,57 @@ GST_START_TEST (test_session_stats)
 
 GST_END_TEST;
 
+static gdouble
+_get_peer_connection_stats_timestamp (GstElement * webrtc)
+{
+  GstPromise *p = gst_promise_new ();
+  const GstStructure *reply;
+  GstStructure *pc_stats;
+  gdouble ts;
+
+  g_signal_emit_by_name (webrtc, "get-stats", NULL, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (p);
+  validate_stats (reply);
+  fail_unless (gst_structure_get (reply, "peer-connection-stats",
+          GST_TYPE_STRUCTURE, &pc_stats, NULL));
+  fail_unless (gst_structure_get_double (pc_stats, "timestamp", &ts));
+  gst_structure_free (pc_stats);
+  gst_promise_unref (p);
+
+  return ts;
+}
+
+GST_START_TEST (test_session_stats_cached)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  gdouble ts1, ts2;
+
+  t->on_negotiation_needed = NULL;
+  t->on_offer_created = NULL;
+  t->on_answer_created = NULL;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  /* without caching, every request collects new stats */
+  ts1 = _get_peer_connection_stats_timestamp (t->webrtc1);
+  g_usleep (G_USEC_PER_SEC / 100);
+  ts2 = _get_peer_connection_stats_timestamp (t->webrtc1);
+  fail_unless (ts2 > ts1);
+
+  /* the second request is answered from the cache */
+  g_object_set (t->webrtc1, "stats-cache-time", 60 * GST_SECOND, NULL);
+  ts1 = _get_peer_connection_stats_timestamp (t->webrtc1);
+  g_usleep (G_USEC_PER_SEC / 100);
+  ts2 = _get_peer_connection_stats_timestamp (t->webrtc1);
+  fail_unless_equals_float (ts1, ts2);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_add_transceiver)
 {
   struct test_webrtc *t = test_webrtc_new ();
@@ -1721,6 +1819,110 @@ GST_START_TEST (test_data_channel_transfer_string)
 
 GST_END_TEST;
 
+#define N_BURST_MESSAGES 200
+
+static void
+on_message_string_burst (GObject * channel, const gchar * str,
+    struct test_webrtc *t)
+{
+  guint received = GPOINTER_TO_UINT (g_object_get_data (channel, "received"));
+  gchar *expected = g_strdup_printf ("%s %u", test_string, received);
+
+  /* all messages must arrive, in order */
+  g_assert_cmpstr (expected, ==, str);
+  g_free (expected);
+
+  received++;
+  g_object_set_data (channel, "received", GUINT_TO_POINTER (received));
+  if (received == N_BURST_MESSAGES) {
+    /* the batches are emitted before the single messages */
+    g_assert_cmpuint (GPOINTER_TO_UINT (g_object_get_data (channel,
+                "batched")), ==, N_BURST_MESSAGES);
+    test_webrtc_signal_state (t, STATE_CUSTOM);
+  }
+}
+
+static void
+on_message_string_batch_burst (GObject * channel, gchar ** strv,
+    struct test_webrtc *t)
+{
+  guint batched = GPOINTER_TO_UINT (g_object_get_data (channel, "batched"));
+  guint i;
+
+  for (i = 0; strv[i]; i++) {
+    gchar *expected = g_strdup_printf ("%s %u", test_string, batched + i);
+
+    g_assert_cmpstr (expected, ==, strv[i]);
+    g_free (expected);
+  }
+  g_assert_cmpuint (i, >, 0);
+
+  g_object_set_data (channel, "batched", GUINT_TO_POINTER (batched + i));
+}
+
+static void
+have_data_channel_transfer_burst (struct test_webrtc *t, GstElement * element,
+    GObject * our, gpointer user_data)
+{
+  GObject *other = user_data;
+  guint i;
+
+  g_signal_connect (our, "on-message-string",
+      G_CALLBACK (on_message_string_burst), t);
+  g_signal_connect (our, "on-message-string-batch",
+      G_CALLBACK (on_message_string_batch_burst), t);
+
+  g_signal_connect (other, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+  for (i = 0; i < N_BURST_MESSAGES; i++) {
+    gchar *str = g_strdup_printf ("%s %u", test_string, i);
+    g_signal_emit_by_name (other, "send-string", str);
+    g_free (str);
+  }
+}
+
+GST_START_TEST (test_data_channel_transfer_burst)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GObject *channel = NULL;
+  struct validate_sdp offer = { on_sdp_has_datachannel, NULL };
+  struct validate_sdp answer = { on_sdp_has_datachannel, NULL };
+
+  t->on_negotiation_needed = NULL;
+  t->offer_data = &offer;
+  t->on_offer_created = validate_sdp;
+  t->answer_data = &answer;
+  t->on_answer_created = validate_sdp;
+  t->on_ice_candidate = NULL;
+  t->on_data_channel = have_data_channel_transfer_burst;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (t->webrtc1, "create-data-channel", "label", NULL,
+      &channel);
+  g_assert_nonnull (channel);
+  t->data_channel_data = channel;
+  g_signal_connect (channel, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_state_mask (t, 1 << STATE_CUSTOM);
+
+  g_object_unref (channel);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 #define g_assert_cmpbytes(b1, b2)                       \
     G_STMT_START {                                      \
       gsize l1, l2;                                     \
@@ -1867,6 +2069,67 @@ on_buffered_amount_low_emitted (GObject * channel, struct test_webrtc *t)
   test_webrtc_signal_state (t, STATE_CUSTOM);
 }
 
+static void
+on_buffered_amount_high_emitted (GObject * channel, struct test_webrtc *t)
+{
+  test_webrtc_signal_state (t, STATE_CUSTOM);
+}
+
+static void
+have_data_channel_check_high_threshold_emitted (struct test_webrtc *t,
+    GstElement * element, GObject * our, gpointer user_data)
+{
+  g_signal_connect (our, "on-buffered-amount-high",
+      G_CALLBACK (on_buffered_amount_high_emitted), t);
+  g_object_set (our, "buffered-amount-high-threshold", 1, NULL);
+
+  g_signal_connect (our, "on-error", G_CALLBACK (on_channel_error_not_reached),
+      NULL);
+  g_signal_emit_by_name (our, "send-string", "DATA");
+}
+
+GST_START_TEST (test_data_channel_high_threshold)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GObject *channel = NULL;
+  struct validate_sdp offer = { on_sdp_has_datachannel, NULL };
+  struct validate_sdp answer = { on_sdp_has_datachannel, NULL };
+
+  t->on_negotiation_needed = NULL;
+  t->offer_data = &offer;
+  t->on_offer_created = validate_sdp;
+  t->answer_data = &answer;
+  t->on_answer_created = validate_sdp;
+  t->on_ice_candidate = NULL;
+  t->on_data_channel = have_data_channel_check_high_threshold_emitted;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (t->webrtc1, "create-data-channel", "label", NULL,
+      &channel);
+  g_assert_nonnull (channel);
+  t->data_channel_data = channel;
+  g_signal_connect (channel, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_state_mask (t, 1 << STATE_CUSTOM);
+
+  g_object_unref (channel);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 static void
 have_data_channel_check_low_threshold_emitted (struct test_webrtc *t,
     GstElement * element, GObject * our, gpointer user_data)
@@ -2418,9 +2681,11 @@ webrtcbin_suite (void)
   sctpdec = gst_registry_lookup_feature (registry, "sctpdec");
 
   tcase_add_test (tc, test_sdp_no_media);
+  tcase_add_test (tc, test_sdp_no_media_shared_pc_thread);
   tcase_add_test (tc, test_no_nice_elements_request_pad);
   tcase_add_test (tc, test_no_nice_elements_state_change);
   tcase_add_test (tc, test_session_stats);
+  tcase_add_test (tc, test_session_stats_cached);
   if (nicesrc && nicesink && dtlssrtpenc && dtlssrtpdec) {
     tcase_add_test (tc, test_audio);
     tcase_add_test (tc, test_audio_video);
@@ -2439,8 +2704,10 @@ webrtcbin_suite (void)
       tcase_add_test (tc, test_data_channel_remote_notify);
       tcase_add_test (tc, test_data_channel_transfer_string);
       tcase_add_test (tc, test_data_channel_transfer_data);
+      tcase_add_test (tc, test_data_channel_transfer_burst);
       tcase_add_test (tc, test_data_channel_create_after_negotiate);
       tcase_add_test (tc, test_data_channel_low_threshold);
+      tcase_add_test (tc, test_data_channel_high_threshold);
       tcase_add_test (tc, test_data_channel_max_message_size);
       tcase_add_test (tc, test_data_channel_pre_negotiated);
       tcase_add_test (tc, test_bundle_audio_video_data);
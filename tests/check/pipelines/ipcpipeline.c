@@ -71,6 +71,7 @@ typedef enum
   TEST_FEATURE_ERROR_SINK = 0x80,       /* generates error message in the slave */
   TEST_FEATURE_LONG_DURATION = 0x100,   /* bigger num-buffers in {audio,video}testsrc */
   TEST_FEATURE_FILTER_SINK_CAPS = 0x200,        /* plugs capsfilter before fakesink */
+  TEST_FEATURE_BUFFERS_IN_FLIGHT = 0x2000,      /* sets max-buffers-in-flight in ipcpipelinesink */
 
   /* Source selection; Use only one of those, do not combine! */
   TEST_FEATURE_TEST_SOURCE = 0x400,
@@ -568,12 +569,28 @@ create_source (TestFeatures features, int fdina, int fdouta, int fdinv,
   td->two_streams = has_video;
   td->p = pipeline;
 
+  if (pipeline && (features & TEST_FEATURE_BUFFERS_IN_FLIGHT)) {
+    GstIterator *it = gst_bin_iterate_sinks (GST_BIN (pipeline));
+
+    while (gst_iterator_foreach (it, set_buffers_in_flight, NULL))
+      gst_iterator_resync (it);
+    gst_iterator_free (it);
+  }
+
   if (pipeline)
     gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, td);
 
   return pipeline;
 }
 
+static void
+set_buffers_in_flight (const GValue * v, gpointer user_data)
+{
+  GstElement *sink = g_value_get_object (v);
+
+  g_object_set (sink, "max-buffers-in-flight", 8, NULL);
+}
+
 /* sink construction */
 
 static GstElement *
@@ -5636,6 +5653,142 @@ GST_START_TEST (test_live_av_2_error_from_slave)
 
 GST_END_TEST;
 
+/**** buffers in flight test ****/
+
+typedef struct
+{
+  guint n_buffers;
+} buffers_in_flight_input_data;
+
+typedef struct
+{
+  guint n_buffers;
+  gboolean got_eos;
+  gboolean got_buffer_after_eos;
+} buffers_in_flight_slave_data;
+
+static GstPadProbeReturn
+buffers_in_flight_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  test_data *td = user_data;
+  buffers_in_flight_slave_data *d = td->sd;
+
+  if (GST_IS_BUFFER (info->data)) {
+    if (d->got_eos)
+      d->got_buffer_after_eos = TRUE;
+    d->n_buffers++;
+  } else if (GST_IS_EVENT (info->data)) {
+    if (GST_EVENT_TYPE (info->data) == GST_EVENT_EOS)
+      d->got_eos = TRUE;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+hook_buffers_in_flight_probe (const GValue * v, gpointer user_data)
+{
+  hook_probe (v, buffers_in_flight_probe, user_data);
+}
+
+static void
+setup_sink_buffers_in_flight (GstElement * sink, gpointer user_data)
+{
+  GstIterator *it;
+
+  it = gst_bin_iterate_sinks (GST_BIN (sink));
+  while (gst_iterator_foreach (it, hook_buffers_in_flight_probe, user_data))
+    gst_iterator_resync (it);
+  gst_iterator_free (it);
+}
+
+static void
+check_success_sink_buffers_in_flight (gpointer user_data)
+{
+  test_data *td = user_data;
+  buffers_in_flight_input_data *i = td->id;
+  buffers_in_flight_slave_data *d = td->sd;
+
+  /* all buffers were acked before EOS was sent */
+  FAIL_UNLESS (d->got_eos);
+  FAIL_IF (d->got_buffer_after_eos);
+  FAIL_UNLESS_EQUALS_INT (d->n_buffers, i->n_buffers);
+}
+
+GST_START_TEST (test_empty_buffers_in_flight)
+{
+  buffers_in_flight_input_data id = { 600 };
+  end_of_stream_master_data md = { 0 };
+  buffers_in_flight_slave_data sd = { 0 };
+
+  TEST_BASE (TEST_FEATURE_TEST_SOURCE | TEST_FEATURE_ASYNC_SINK |
+      TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      end_of_stream_source, setup_sink_buffers_in_flight,
+      check_success_source_end_of_stream, check_success_sink_buffers_in_flight,
+      &id, &md, &sd);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_live_a_buffers_in_flight)
+{
+  buffers_in_flight_input_data id = { 270 };
+  end_of_stream_master_data md = { 0 };
+  buffers_in_flight_slave_data sd = { 0 };
+
+  TEST_BASE (TEST_FEATURE_LIVE_A_SOURCE | TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      end_of_stream_source, setup_sink_buffers_in_flight,
+      check_success_source_end_of_stream, check_success_sink_buffers_in_flight,
+      &id, &md, &sd);
+}
+
+GST_END_TEST;
+
+/* The flow error of a buffer in flight is reported for one of the next
+ * buffers, and doesn't leak into the second run after going through NULL */
+GST_START_TEST (test_empty_error_from_slave_buffers_in_flight)
+{
+  error_from_slave_input_data id = { FALSE };
+  error_from_slave_master_data md = { 0 };
+
+  TEST_BASE (TEST_FEATURE_TEST_SOURCE | TEST_FEATURE_ERROR_SINK |
+      TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      error_from_slave_source, setup_sink_error_from_slave,
+      check_success_source_error_from_slave, NULL, &id, &md, NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_wavparse_flushing_seek_buffers_in_flight)
+{
+  flushing_seek_input_data id = FLUSHING_SEEK_INPUT_DATA_INIT;
+  flushing_seek_master_data md = FLUSHING_SEEK_MASTER_DATA_INIT;
+  flushing_seek_slave_data sd = FLUSHING_SEEK_SLAVE_DATA_INIT;
+
+  TEST_BASE (TEST_FEATURE_WAV_SOURCE | TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      flushing_seek_source, setup_sink_flushing_seek,
+      check_success_source_flushing_seek, check_success_sink_flushing_seek,
+      &id, &md, &sd);
+}
+
+GST_END_TEST;
+
+/* Buffers still in flight when stopping, and the requests cancelled by
+ * disconnecting, must not be reported once streaming again */
+GST_START_TEST (test_empty_state_changes_buffers_in_flight)
+{
+  state_changes_master_data md = { 0 };
+  state_changes_slave_data sd = { 0 };
+
+  TEST_BASE (TEST_FEATURE_TEST_SOURCE | TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      state_changes_source, setup_sink_state_changes,
+      check_success_source_state_changes, check_success_sink_state_changes,
+      NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_wavparse_slave_process_crash)
 {
   error_from_slave_input_data id = { TRUE };
@@ -6048,6 +6201,18 @@ ipcpipeline_suite (void)
     tcase_add_test (tc_chain, test_live_av_2_error_from_slave);
   }
 
+  /* buffers_in_flight tests check that buffers can be sent without
+     waiting for each of them to be acked, that their results are all
+     collected before EOS, and that results of buffers in flight do not
+     leak past a flush, a stop or a disconnection. */
+  if (1) {
+    tcase_add_test (tc_chain, test_empty_buffers_in_flight);
+    tcase_add_test (tc_chain, test_live_a_buffers_in_flight);
+    tcase_add_test (tc_chain, test_empty_error_from_slave_buffers_in_flight);
+    tcase_add_test (tc_chain, test_wavparse_flushing_seek_buffers_in_flight);
+    tcase_add_test (tc_chain, test_empty_state_changes_buffers_in_flight);
+  }
+
   /* slave_process_crash tests test that a crash of the slave
      process can be recovered from by the master, which can
      replace the slave process and continue. */